@@ -20,7 +20,8 @@
 #define RPROC_RSC_NUM  1
 #define RPROC_RPMSG_CFG_SIZE  16
 
-#define RPROC_RPMSG_FEATURES (1 << 0)
+/* VIRTIO_RPMSG_F_NS and VIRTIO_RING_F_EVENT_IDX */
+#define RPROC_RPMSG_FEATURES ((1 << 0) | (1 << VIRTIO_RING_F_EVENT_IDX))
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct
 {
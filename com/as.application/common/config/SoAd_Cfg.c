@@ -53,6 +53,13 @@ static const SoAd_SocketConnectionType SoAd_SocketConnection [SOAD_SOCKET_COUNT]
 		.SocketRemotePort = 30490,
 	},
 #endif
+	{	/* for DCM, the 2nd tester */
+		.SocketId = SOAD_SOCKET_COUNT-1,
+		.SocketLocalIpAddress = NULL,
+		.SocketLocalPort = 8989,
+		.SocketProtocol = SOAD_SOCKET_PROT_TCP,
+		.AutosarConnectorType = SOAD_AUTOSAR_CONNECTOR_DOIP,
+	},
 };
 static const DoIp_TargetAddressConfigType SoAd_DoIpTargetAddresses[DOIP_TARGET_COUNT]=
 {
@@ -66,6 +73,9 @@ static const DoIp_TesterConfigType SoAd_DoIpTesters[DOIP_TESTER_COUNT] =
 {
 	{
 		.address = 0xbeef,
+	},
+	{
+		.address = 0xbeee,
 	}
 };
 static const DoIp_RoutingActivationConfigType SoAd_DoIpRoutingActivations[DOIP_ROUTINGACTIVATION_COUNT] =
@@ -123,6 +133,10 @@ static const SoAd_SocketRouteType SoAd_SocketRoute[SOAD_SOCKET_ROUTE_COUNT] =
 		.UserRxIndicationUL = SOAD_UL_SD
 	},
 #endif
+	{
+		.SourceSocketRef = &SoAd_SocketConnection[SOAD_SOCKET_COUNT-1],
+		.SourceId = SOAD_SOCKET_COUNT-1,
+	},
 };
 
 const SoAd_ConfigType SoAd_Config =
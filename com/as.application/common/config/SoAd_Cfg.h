@@ -27,11 +27,12 @@
 #define SOADIF_ID_SD_MULTICAST_TX 2
 
 
+/* the last socket is the 2nd tester connection on the DoIP port */
 #ifdef USE_SD
 #define SOAD_PDU_ROUTE_COUNT 3
-#define SOAD_SOCKET_COUNT 3
+#define SOAD_SOCKET_COUNT 4
 #else
-#define SOAD_SOCKET_COUNT 1
+#define SOAD_SOCKET_COUNT 2
 #define SOAD_PDU_ROUTE_COUNT 1
 #endif
 
@@ -39,6 +40,13 @@
 
 #define SOAD_RX_BUFFER_SIZE 1500
 
+/* the buffer pool, SOAD_BUFFER_CLASS(size, number) in ascending size: the small ones for
+ * the DoIP/SD control messages, the full ones for the socket reads as the 3 of the former
+ * fixed buffers */
+#define SOAD_BUFFER_CLASSES					\
+	SOAD_BUFFER_CLASS(64, 4)				\
+	SOAD_BUFFER_CLASS(SOAD_RX_BUFFER_SIZE, 3)
+
 #define SOAD_DOIP_NODE_TYPE 0
 
 #define SOAD_DOIP_ANNOUNCE_NUM 2
@@ -50,9 +58,9 @@
 #define SOAD_SOCKET_ROUTE_COUNT SOAD_SOCKET_COUNT
 
 
-#define DOIP_MAX_TESTER_CONNECTIONS 1
+#define DOIP_MAX_TESTER_CONNECTIONS 2
 #define DOIP_TARGET_COUNT 1
-#define DOIP_TESTER_COUNT 1
+#define DOIP_TESTER_COUNT 2
 #define DOIP_ROUTINGACTIVATION_COUNT 1
 #define DOIP_ROUTINGACTIVATION_TO_TARGET_RELATION_COUNT 1
 
@@ -29,13 +29,15 @@ static const VirtQ_QueueConfigType queueConfig[VIRTQ_CHL_NUM] =
 		.chl = IPC_CHL_0,
 		.handler = RPMSG_PORT_DEFAULT,
 		.rxNotification = RPmsg_RxNotification ,
-		.vring = &(Rproc_ResourceTable.rpmsg_vdev.vring[1])
+		.vring = &(Rproc_ResourceTable.rpmsg_vdev.vring[1]),
+		.features = &(Rproc_ResourceTable.rpmsg_vdev.gfeatures)
 	},
 	{
 		.chl = IPC_CHL_0,
 		.handler = RPMSG_PORT_DEFAULT,
 		.rxNotification = RPmsg_TxConfirmation ,
-		.vring = &(Rproc_ResourceTable.rpmsg_vdev.vring[0])
+		.vring = &(Rproc_ResourceTable.rpmsg_vdev.vring[0]),
+		.features = &(Rproc_ResourceTable.rpmsg_vdev.gfeatures)
 	}
 };
 
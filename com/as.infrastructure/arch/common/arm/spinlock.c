@@ -26,37 +26,41 @@
 /* ============================ [ FUNCTIONS ] ====================================================== */
 void spin_lock(spinlock_t *lock)
 {
-	uint32_t val, fail;
+	uint32_t val, newval, fail;
+	uint16_t ticket;
 
+	/* take a ticket: next++ */
 #ifdef __AARCH64__
-	do {
-		asm volatile(
-		"1:	ldaxr	%w0, [%2]\n"
-		"	cbnz	%w0, 1b\n"
-		"	mov	%0, #1\n"
-		"	stxr	%w1, %w0, [%2]\n"
-		: "=&r" (val), "=&r" (fail)
-		: "r" (&lock->v)
-		: "cc" );
-	} while (fail);
+	asm volatile(
+	"1:	ldaxr	%w0, [%3]\n"
+	"	add	%w1, %w0, %w4\n"
+	"	stxr	%w2, %w1, [%3]\n"
+	"	cbnz	%w2, 1b\n"
+	: "=&r" (val), "=&r" (newval), "=&r" (fail)
+	: "r" (&lock->v), "r" (1u << 16)
+	: "cc", "memory" );
 #else
-	do {
-		asm volatile(
-		"1:	ldrex	%0, [%2]\n"
-		"	teq	%0, #0\n"
-		"	bne	1b\n"
-		"	mov	%0, #1\n"
-		"	strex	%1, %0, [%2]\n"
-		: "=&r" (val), "=&r" (fail)
-		: "r" (&lock->v)
-		: "cc" );
-	} while (fail);
+	asm volatile(
+	"1:	ldrex	%0, [%3]\n"
+	"	add	%1, %0, %4\n"
+	"	strex	%2, %1, [%3]\n"
+	"	teq	%2, #0\n"
+	"	bne	1b\n"
+	: "=&r" (val), "=&r" (newval), "=&r" (fail)
+	: "r" (&lock->v), "r" (1u << 16)
+	: "cc", "memory" );
 #endif
+	ticket = (uint16_t)(val >> 16);
+
+	/* wait until it is served */
+	while(lock->tickets.owner != ticket);
+
 	smp_mb();
 }
 
 void spin_unlock(spinlock_t *lock)
 {
 	smp_mb();
-	lock->v = 0;
+	/* only the holder writes the owner, hand over to the next ticket */
+	lock->tickets.owner++;
 }
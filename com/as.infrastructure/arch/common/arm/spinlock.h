@@ -15,10 +15,16 @@
 #ifndef _ARM_SPINLOCK_H_
 #define _ARM_SPINLOCK_H_
 /* ============================ [ INCLUDES  ] ====================================================== */
+#include <stdint.h>
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
-typedef struct {
-	int v;
+/* ticket lock: the CPUs get the lock in the order they ask for it, all zero is unlocked */
+typedef union {
+	volatile uint32_t v;
+	struct {
+		volatile uint16_t owner;
+		volatile uint16_t next;
+	} tickets;
 } spinlock_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
@@ -118,7 +118,9 @@ static boolean fifo_write(Ipc_ChannelRuntimeType* runtime, Ipc_ChannelConfigType
 #else
 	(void)pthread_mutex_unlock( (pthread_mutex_t *)config->w_lock );
 	(void)pthread_cond_signal ((pthread_cond_t *)config->w_event);
+#ifdef CONFIG_ARCH_VEXPRESS
 	usleep(1);
+#endif
 #endif
 	return ercd;
 }
@@ -161,8 +163,17 @@ void* Ipc_Daemon(void* lpParameter)
 	{
 #ifdef __WINDOWS__
 		WaitForMultipleObjects( sizeof( pvObjectList ) / sizeof( HANDLE ), pvObjectList, TRUE, INFINITE );
-#else
+#elif defined(CONFIG_ARCH_VEXPRESS)
 		(void)pthread_cond_wait ((pthread_cond_t *)config->r_event,(pthread_mutex_t *)config->r_lock);
+#else
+		/* the writer doesn't yield any more, check the fifo under the lock so a
+		 * signal sent before this wait isn't lost, several indexes are then
+		 * handled by one wakeup */
+		(void)pthread_mutex_lock((pthread_mutex_t *)config->r_lock);
+		while(0 == config->r_fifo->count)
+		{
+			(void)pthread_cond_wait ((pthread_cond_t *)config->r_event,(pthread_mutex_t *)config->r_lock);
+		}
 #endif
 		do {
 			ercd = fifo_read(runtime,config,&idx);
@@ -161,15 +161,39 @@ button_release_event( GtkWidget *widget, GdkEventButton *event )
 #endif
 #endif
 
-static gboolean Refresh(gpointer data)
+static void RefreshArea(guchar *pixels, int rowstride, int n_channels,
+		uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
 {
 	uint32_t x,y;
-	int width, height, rowstride, n_channels;
-	guchar *pixels, *p;
-	uint32_t index;
+	guchar *p;
 	uint32_t color;
+
+	for(y=y0;y<y1;y++)
+	{
+		p = pixels + y * rowstride + x0 * n_channels;
+		for(x=x0;x<x1;x++)
+		{
+			color = pLcdBuffer[y*LCD_WIDTH + x];
+			p[0] = (color>>16)&0xFF; // red
+			p[1] = (color>>8 )&0xFF; // green
+			p[2] = (color>>0 )&0xFF; // blue
+			p += n_channels;
+		}
+	}
+#if(cfgLcdHandle == LCD_DRAWING_AREA)
+	gtk_widget_queue_draw_area(pLcd, x0, y0, x1-x0, y1-y0);
+#endif
+}
+
+static gboolean Refresh(gpointer data)
+{
+	int width, height, rowstride, n_channels;
+	guchar *pixels;
 #ifdef USE_SG
-	if(FALSE == Sg_IsDataReady()) { return TRUE; }
+	SgArea area[SG_DIRTY_MAX];
+	uint32_t i,n;
+	n = Sg_GetDataReadyArea(area, SG_DIRTY_MAX);
+	if(0 == n) { return TRUE; }
 #endif
 	ASPERF_MEASURE_START();
 
@@ -190,22 +214,17 @@ static gboolean Refresh(gpointer data)
 	rowstride = gdk_pixbuf_get_rowstride (pLcdImage);
 	pixels = gdk_pixbuf_get_pixels (pLcdImage);
 
-	for(x=0;x<width;x++)
+#ifdef USE_SG
+	/* only the areas updated by Sg */
+	for(i=0;i<n;i++)
 	{
-		for(y=0;y<height;y++)
-		{
-			index = y*width + x;
-			assert(index < (width*height));
-			color = pLcdBuffer[index];
-			p = pixels + y * rowstride + x * n_channels;
-			p[0] = (color>>16)&0xFF; // red
-			p[1] = (color>>8 )&0xFF; // green
-			p[2] = (color>>0 )&0xFF; // blue
-		}
+		RefreshArea(pixels, rowstride, n_channels, LCD_X0(area[i].x0), LCD_Y0(area[i].y0),
+				LCD_X0(area[i].x1), LCD_Y0(area[i].y1));
 	}
-#if(cfgLcdHandle == LCD_DRAWING_AREA)
-	gtk_widget_queue_draw (pLcd);
 #else
+	RefreshArea(pixels, rowstride, n_channels, 0, 0, width, height);
+#endif
+#if(cfgLcdHandle != LCD_DRAWING_AREA)
 	gtk_image_set_from_pixbuf(GTK_IMAGE(pLcd),pLcdImage);
 #endif
 
@@ -378,10 +397,23 @@ void mouse_handler(SDL_Event * event)
 static void sdl_refresh(void)
 {
 #ifdef USE_SG
-	if(TRUE == Sg_IsDataReady()) { 
-#endif
-
+	SgArea area[SG_DIRTY_MAX];
+	SDL_Rect rect;
+	uint32_t i,n;
+	n = Sg_GetDataReadyArea(area, SG_DIRTY_MAX);
+	if(n > 0) {
+	/* only the areas updated by Sg to the texture */
+	for(i=0;i<n;i++)
+	{
+		rect.x = area[i].x0;
+		rect.y = area[i].y0;
+		rect.w = area[i].x1 - area[i].x0;
+		rect.h = area[i].y1 - area[i].y0;
+		SDL_UpdateTexture(pSdlTexture, &rect, &pLcdBuffer[rect.y*__SG_WIDTH__ + rect.x], __SG_WIDTH__ * sizeof(uint32_t));
+	}
+#else
 	SDL_UpdateTexture(pSdlTexture, NULL, pLcdBuffer, __SG_WIDTH__ * sizeof(uint32_t));
+#endif
 	SDL_RenderClear(pSdlRenderer);
 	SDL_RenderCopy(pSdlRenderer, pSdlTexture, NULL, NULL);
 	SDL_RenderPresent(pSdlRenderer);
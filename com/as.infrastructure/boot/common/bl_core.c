@@ -17,6 +17,7 @@
 #include "Flash.h"
 #include "Os.h"
 #include "asdebug.h"
+#include "Crc.h"
 #include "CanIf.h"
 #include "CanIf_Cbk.h"
 /* ============================ [ MACROS    ] ====================================================== */
@@ -33,6 +34,14 @@
 #endif
 #define FL_WRITE_PER_CYCLE (4096/FLASH_WRITE_SIZE)
 #define FL_READ_PER_CYCLE  (4096/FLASH_WRITE_SIZE)
+/* flash bytes read for the checksum per cycle, and by each read */
+#define FL_CHECKSUM_PER_CYCLE 4096
+#define FL_CHECKSUM_BLOCK_SIZE 256
+#if (FL_CHECKSUM_BLOCK_SIZE%FLASH_READ_SIZE) != 0
+#error "FL_CHECKSUM_BLOCK_SIZE must be multiple of FLASH_READ_SIZE"
+#endif
+/* flash operations(write of a window or erase of a sector) per cycle for the compressed download */
+#define FL_LZSS_OPS_PER_CYCLE ((4096+BL_LZSS_WINDOW_SIZE-1)/BL_LZSS_WINDOW_SIZE)
 
 #ifndef BL_STAY_TIME_MS
 #define BL_STAY_TIME_MS 1000
@@ -70,6 +79,11 @@ static uint32  blMemorySize;
 static uint32* blMemoryData;
 static TimerType appTimer;
 
+static boolean blCompressed;
+static const uint8* blCompressedData;
+
+static uint32 blChecksum;
+
 static BL_MemoryInfoType blMemoryList[] = {
 	/* STM32F017VC  */ { 0x00010000, 0x00040000, 0xFF, 0x04|0x02|0x01 },
 	/* VERSATILEPB  */ { 0x00040000, 0x08000000, 0xFF, 0x04|0x02|0x01 },
@@ -249,6 +263,165 @@ static Dcm_ReturnReadMemoryType readFlash(Dcm_OpStatusType OpStatus,uint32 Memor
 	return rv;
 }
 
+static boolean isBlankPage(const uint8* data)
+{
+	boolean rv = TRUE;
+	uint32 i;
+
+	for(i=0; i<FLASH_WRITE_SIZE; i++)
+	{
+		if(0xFF != data[i])
+		{
+			rv = FALSE;
+			break;
+		}
+	}
+
+	return rv;
+}
+
+static Std_ReturnType flushDecompressed(void)
+{
+	Std_ReturnType ercd = E_OK;
+	uint32 address;
+	uint8* data;
+	uint32 length;
+	uint32 offset = 0;
+	uint32 size;
+
+	length = BL_LzssGetFlushData(&address, &data);
+	/* the region is erased, so skip the blank pages, which also makes it possible
+	 * that the signature pages are programmed at last by another download */
+	while((offset < length) && (E_OK == ercd))
+	{
+		while((offset < length) && isBlankPage(&data[offset]))
+		{
+			offset += FLASH_WRITE_SIZE;
+		}
+		size = 0;
+		while(((offset+size) < length) && (FALSE == isBlankPage(&data[offset+size])))
+		{
+			size += FLASH_WRITE_SIZE;
+		}
+		if(size > 0)
+		{
+			blFlashParam.address = address + offset;
+			blFlashParam.length  = size;
+			blFlashParam.data    = (tData*)&data[offset];
+			FLASH_DRIVER_WRITE(FLASH_DRIVER_STARTADDRESS,&blFlashParam);
+			if(kFlashOk != blFlashParam.errorcode)
+			{
+				ASLOG(BL,("write failed: errorcode = %X(addr=%X,size=%X)\n",
+						(uint32)blFlashParam.errorcode,(uint32)blFlashParam.address,(uint32)blFlashParam.length));
+				ercd = E_NOT_OK;
+			}
+			offset += size;
+		}
+	}
+
+	if(E_OK == ercd)
+	{
+		BL_LzssFlushed(length);
+	}
+
+	return ercd;
+}
+
+#ifdef BL_LZSS_DELTA
+static Std_ReturnType stageSector(void)
+{
+	Std_ReturnType ercd = E_OK;
+	uint32 address;
+	uint8* sector;
+
+	sector = BL_LzssGetSector(&address);
+	/* keep the old content, then erase it */
+	blFlashParam.address = address;
+	blFlashParam.length  = FLASH_ERASE_SIZE;
+	blFlashParam.data    = (tData*)sector;
+	FLASH_DRIVER_READ(FLASH_DRIVER_STARTADDRESS,&blFlashParam);
+	if(kFlashOk == blFlashParam.errorcode)
+	{
+		blFlashParam.address = address;
+		blFlashParam.length  = FLASH_ERASE_SIZE;
+		FLASH_DRIVER_ERASE(FLASH_DRIVER_STARTADDRESS,&blFlashParam);
+	}
+
+	if(kFlashOk == blFlashParam.errorcode)
+	{
+		BL_LzssSectorStaged();
+	}
+	else
+	{
+		ASLOG(BL,("stage sector failed: errorcode = %X(addr=%X)\n",
+				(uint32)blFlashParam.errorcode,(uint32)address));
+		ercd = E_NOT_OK;
+	}
+
+	return ercd;
+}
+#endif
+
+static Dcm_ReturnWriteMemoryType writeFlashCompressed(Dcm_OpStatusType OpStatus,uint32 MemorySize,
+		uint8* MemoryData)
+{
+	Dcm_ReturnWriteMemoryType rv = DCM_WRITE_PENDING;
+	BL_LzssStatusType status;
+	Std_ReturnType ercd = E_OK;
+	uint32 consumed;
+	uint32 address;
+	uint8* data;
+	uint32 ops = 0;
+
+	if(DCM_INITIAL == OpStatus)
+	{
+		blCompressedData = MemoryData;
+		blMemorySize = MemorySize;
+	}
+
+	while((DCM_WRITE_PENDING == rv) && (ops < FL_LZSS_OPS_PER_CYCLE))
+	{
+		status = BL_LzssDecode(blCompressedData, blMemorySize, &consumed);
+		blCompressedData += consumed;
+		blMemorySize     -= consumed;
+		switch(status)
+		{
+			case BL_LZSS_OK:
+				/* this block is consumed, write out what is ready */
+				if(BL_LzssGetFlushData(&address, &data) > 0)
+				{
+					ercd = flushDecompressed();
+					ops ++;
+				}
+				else
+				{
+					rv = DCM_WRITE_OK;
+				}
+				break;
+			case BL_LZSS_FLUSH:
+				ercd = flushDecompressed();
+				ops ++;
+				break;
+#ifdef BL_LZSS_DELTA
+			case BL_LZSS_SECTOR:
+				ercd = stageSector();
+				ops ++;
+				break;
+#endif
+			default:
+				ercd = E_NOT_OK;
+				break;
+		}
+
+		if(E_OK != ercd)
+		{
+			rv = DCM_WRITE_FAILED;
+		}
+	}
+
+	return rv;
+}
+
 static Dcm_ReturnWriteMemoryType writeFlashDriver(Dcm_OpStatusType OpStatus,uint32 MemoryAddress,uint32 MemorySize,
 		uint8* MemoryData)
 {
@@ -262,6 +435,62 @@ static Dcm_ReturnReadMemoryType readFlashDriver(Dcm_OpStatusType OpStatus,uint32
 	memcpy((void*)MemoryData,(void*)&(FlashDriverRam[MemoryAddress/sizeof(uint32_t)]),MemorySize);
 	return DCM_READ_OK;
 }
+
+static Dcm_ReturnReadMemoryType checksumFlash(Dcm_OpStatusType OpStatus,uint32 MemoryAddress,uint32 MemorySize)
+{
+	Dcm_ReturnReadMemoryType rv = DCM_READ_PENDING;
+	uint32 buffer[FL_CHECKSUM_BLOCK_SIZE/sizeof(uint32)];
+	uint32 offset;
+	uint32 length;
+	uint32 done = 0;
+
+	if(DCM_INITIAL == OpStatus)
+	{
+		blMemoryAddress = MemoryAddress;
+		blMemorySize    = MemorySize;
+	}
+
+	while((DCM_READ_PENDING == rv) && (done < FL_CHECKSUM_PER_CYCLE))
+	{
+		if(0 == blMemorySize)
+		{
+			rv = DCM_READ_OK;
+			break;
+		}
+		/* read aligned blocks, only the requested part goes into the CRC */
+		offset = blMemoryAddress&(FLASH_READ_SIZE-1);
+		length = FL_CHECKSUM_BLOCK_SIZE - offset;
+		if(length > blMemorySize)
+		{
+			length = blMemorySize;
+		}
+		blFlashParam.address = blMemoryAddress - offset;
+		blFlashParam.length  = (offset+length+FLASH_READ_SIZE-1)&(~(FLASH_READ_SIZE-1));
+		blFlashParam.data    = (tData*)buffer;
+		FLASH_DRIVER_READ(FLASH_DRIVER_STARTADDRESS,&blFlashParam);
+		if(kFlashOk == blFlashParam.errorcode)
+		{
+			blChecksum = Crc_CalculateCRC32(&((uint8*)buffer)[offset], length, blChecksum);
+			blMemoryAddress += length;
+			blMemorySize    -= length;
+			done += length;
+		}
+		else
+		{
+			ASLOG(BL,("read failed: errorcode = %X(addr=%X,size=%X)\n",
+					(uint32)blFlashParam.errorcode,(uint32)blFlashParam.address,(uint32)blFlashParam.length));
+			rv = DCM_READ_FAILED;
+		}
+	}
+
+	return rv;
+}
+
+static Dcm_ReturnReadMemoryType checksumFlashDriver(Dcm_OpStatusType OpStatus,uint32 MemoryAddress,uint32 MemorySize)
+{
+	blChecksum = Crc_CalculateCRC32(&((uint8*)FlashDriverRam)[MemoryAddress], MemorySize, blChecksum);
+	return DCM_READ_OK;
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 
 Dcm_ReturnEraseMemoryType Dcm_EraseMemory(Dcm_OpStatusType OpStatus,
@@ -313,7 +542,14 @@ Dcm_ReturnWriteMemoryType Dcm_WriteMemory(Dcm_OpStatusType OpStatus,
 	switch(blMemoryIdentifier)
 	{
 		case BL_FLASH_IDENTIFIER:
-			rv = writeFlash(OpStatus,MemoryAddress,MemorySize,MemoryData);
+			if(blCompressed)
+			{
+				rv = writeFlashCompressed(OpStatus,MemorySize,MemoryData);
+			}
+			else
+			{
+				rv = writeFlash(OpStatus,MemoryAddress,MemorySize,MemoryData);
+			}
 			break;
 		case BL_FLSDRV_IDENTIFIER:
 			rv = writeFlashDriver(OpStatus,MemoryAddress,MemorySize,MemoryData);
@@ -360,6 +596,50 @@ Dcm_ReturnReadMemoryType Dcm_ReadMemory(Dcm_OpStatusType OpStatus,
 	return rv;
 }
 
+Dcm_ReturnReadMemoryType Dcm_ChecksumMemory(Dcm_OpStatusType OpStatus,
+											   uint8 MemoryIdentifier,
+											   uint32 MemoryAddress,
+											   uint32 MemorySize,
+											   uint8* Checksum)
+{
+	imask_t imask;
+	Dcm_ReturnReadMemoryType rv;
+	ASLOG(BL,("Dcm_ChecksumMemory(%X,%X,%X,%X)\n",
+			(uint32)OpStatus,(uint32)MemoryIdentifier,(uint32)MemoryAddress,(uint32)MemorySize));
+	if(DCM_INITIAL == OpStatus)
+	{
+		blMemoryIdentifier = MemoryIdentifier;
+		blChecksum = 0xFFFFFFFFUL;
+	}
+	Irq_Save(imask);
+	switch(blMemoryIdentifier)
+	{
+		case BL_FLASH_IDENTIFIER:
+			rv = checksumFlash(OpStatus,MemoryAddress,MemorySize);
+			break;
+		case BL_FLSDRV_IDENTIFIER:
+			rv = checksumFlashDriver(OpStatus,MemoryAddress,MemorySize);
+			break;
+		default:
+			asAssert(0);
+			rv = DCM_READ_FAILED;
+			break;
+	}
+	Irq_Restore(imask);
+
+	if(DCM_READ_OK == rv)
+	{
+		blChecksum ^= 0xFFFFFFFFUL;
+		Checksum[0] = (uint8)(blChecksum>>24);
+		Checksum[1] = (uint8)(blChecksum>>16);
+		Checksum[2] = (uint8)(blChecksum>>8);
+		Checksum[3] = (uint8)blChecksum;
+		ASLOG(BL,("checksum is %08X\n", blChecksum));
+	}
+
+	return rv;
+}
+
 boolean Dcm_CheckMemory(uint8 attr, uint8 memoryIdentifier, uint32 memoryAddress, uint32 length)
 {
 	boolean rv = FALSE;
@@ -390,6 +670,15 @@ boolean Dcm_CheckDataFormatIdentifier(uint8 dataFormatIdentifier)
 		rv = TRUE; /* no compressionMethod nor encryptingMethod is used */
 
 	}
+	else if( (0x00u == (dataFormatIdentifier&0x0Fu)) &&
+			 ( (BL_COMPRESSION_LZSS == (dataFormatIdentifier>>4))
+#ifdef BL_LZSS_DELTA
+			|| (BL_COMPRESSION_LZSS_DELTA == (dataFormatIdentifier>>4))
+#endif
+			) )
+	{
+		rv = TRUE; /* compressed but not encrypted */
+	}
 	else
 	{
 		rv = FALSE;
@@ -398,6 +687,76 @@ boolean Dcm_CheckDataFormatIdentifier(uint8 dataFormatIdentifier)
 	return rv;
 }
 
+Std_ReturnType Dcm_ProcessRequestDownload(uint8 DataFormatIdentifier, uint8 MemoryIdentifier,
+		uint32 MemoryAddress, uint32 MemorySize)
+{
+	Std_ReturnType ercd = E_OK;
+
+	ASLOG(BL,("Dcm_ProcessRequestDownload(%X,%X,%X,%X)\n",
+			(uint32)DataFormatIdentifier,(uint32)MemoryIdentifier,(uint32)MemoryAddress,(uint32)MemorySize));
+
+	blCompressed = FALSE;
+	if(0x00u != DataFormatIdentifier)
+	{
+		if( (BL_FLASH_IDENTIFIER == MemoryIdentifier) &&
+			(TRUE == Dcm_CheckDataFormatIdentifier(DataFormatIdentifier)) )
+		{
+			ercd = BL_LzssInit(DataFormatIdentifier>>4, MemoryAddress, MemorySize);
+		}
+		else
+		{
+			ercd = E_NOT_OK;
+		}
+
+		if(E_OK == ercd)
+		{
+			blCompressed = TRUE;
+		}
+	}
+
+	return ercd;
+}
+
+Std_ReturnType Dcm_ProcessRequestTransferExit(void)
+{
+	Std_ReturnType ercd = E_OK;
+
+	if(blCompressed)
+	{	/* a short stream leaves the tail or the staged sector unwritten */
+		if(FALSE == BL_LzssIsComplete())
+		{
+			ASLOG(BL,("compressed download incomplete\n"));
+			ercd = E_NOT_OK;
+		}
+		blCompressed = FALSE;
+	}
+
+	return ercd;
+}
+
+Std_ReturnType BL_ReadInstalledImage(uint32 address, uint8* data, uint32 length)
+{
+	Std_ReturnType ercd = E_OK;
+	uint32 buffer[(BL_LZSS_READ_SIZE+2*FLASH_READ_SIZE+sizeof(uint32)-1)/sizeof(uint32)];
+	uint32 offset = address&(FLASH_READ_SIZE-1);
+
+	asAssert((offset+length) <= (sizeof(buffer)-FLASH_READ_SIZE));
+	blFlashParam.address = address - offset;
+	blFlashParam.length  = (offset+length+FLASH_READ_SIZE-1)&(~(FLASH_READ_SIZE-1));
+	blFlashParam.data    = (tData*)buffer;
+	FLASH_DRIVER_READ(FLASH_DRIVER_STARTADDRESS,&blFlashParam);
+	if(kFlashOk == blFlashParam.errorcode)
+	{
+		memcpy(data, &((uint8*)buffer)[offset], length);
+	}
+	else
+	{
+		ercd = E_NOT_OK;
+	}
+
+	return ercd;
+}
+
 
 Std_ReturnType BL_TestJumpToApplicatin(uint8 *inBuffer, uint8 *outBuffer, Dcm_NegativeResponseCodeType *errorCode)
 {
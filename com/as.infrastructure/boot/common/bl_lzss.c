@@ -0,0 +1,462 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2018  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* Streaming LZSS decompression for the RequestDownload/TransferData sequence.
+ *
+ * Stream format(encoder: script/lzss.lua):
+ *   header: 1 byte, the window bits W of the encoder, 8 <= W <= BL_LZSS_WINDOW_BITS
+ *   then groups of 1 flag byte followed by up to 8 items, flag bit0 for the first item:
+ *     bit = 1: literal, 1 byte
+ *     bit = 0: reference, 2 bytes big endian, DDDDDDDDDDDDLLLL
+ *              D != 0: copy L+3 bytes from distance D of the decoded window
+ *              D == 0: delta copy(BL_COMPRESSION_LZSS_DELTA only), L must be 0,
+ *                      followed by 3 bytes signed displacement S and 2 bytes count C,
+ *                      copy C+1 bytes from the installed image at the position of
+ *                      current output + S.
+ * The stream ends when the requested size of the RequestDownload is decoded.
+ *
+ * For delta, the flash sectors are erased on the fly, just before the decoded data
+ * reaches them, and the old content of the current sector is kept in RAM. So a delta
+ * copy must reference to an old position not below the start of the current sector.
+ * Delta is only built with BL_LZSS_DELTA.
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "bootloader.h"
+#include "Flash.h"
+#include "asdebug.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#define AS_LOG_BLZ 0
+
+#define BL_LZSS_WINDOW_MASK (BL_LZSS_WINDOW_SIZE-1)
+#define BL_LZSS_MIN_MATCH   3
+
+#if (BL_LZSS_WINDOW_BITS < 8) || (BL_LZSS_WINDOW_BITS > 12)
+#error "BL_LZSS_WINDOW_BITS must be in range [8,12]"
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+enum
+{
+	BL_LZSS_STATE_HEADER = 0,
+	BL_LZSS_STATE_FLAGS,
+	BL_LZSS_STATE_ITEM,
+	BL_LZSS_STATE_REFERENCE,
+	BL_LZSS_STATE_DELTA
+};
+
+enum
+{
+	BL_LZSS_COPY_WINDOW = 0,
+	BL_LZSS_COPY_DELTA
+};
+
+typedef struct
+{
+	uint32 address;  /* start address of the download region */
+	uint32 size;     /* decompressed size of the download region */
+	uint32 produced; /* decompressed bytes */
+	uint32 flushed;  /* bytes written to flash */
+	uint32 staged;   /* delta: bytes of the region erased */
+	uint32 copyLen;
+	sint32 copyArg;  /* window distance or delta displacement */
+	uint8  copyType;
+	uint8  method;
+	uint8  state;
+	uint8  flags;
+	uint8  flagsLeft;
+	uint8  tokenPos;
+	uint8  token[7];
+} BL_LzssType;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static BL_LzssType blLzss;
+static uint32 blLzssWindow[BL_LZSS_WINDOW_SIZE/sizeof(uint32)];
+#ifdef BL_LZSS_DELTA
+static uint32 blLzssSector[FLASH_ERASE_SIZE/sizeof(uint32)];
+#endif
+/* ============================ [ LOCALS    ] ====================================================== */
+static boolean lzssHasRoom(void)
+{
+	boolean rv = TRUE;
+
+	if((blLzss.produced-blLzss.flushed) >= BL_LZSS_WINDOW_SIZE)
+	{
+		rv = FALSE;
+	}
+#ifdef BL_LZSS_DELTA
+	else if((BL_COMPRESSION_LZSS_DELTA == blLzss.method) && (blLzss.produced >= blLzss.staged))
+	{
+		rv = FALSE;
+	}
+#endif
+	else
+	{
+		/* room for at least 1 byte */
+	}
+
+	return rv;
+}
+
+static uint32 lzssRoom(void)
+{
+	uint32 room;
+	uint32 pos = blLzss.produced&BL_LZSS_WINDOW_MASK;
+
+	room = BL_LZSS_WINDOW_SIZE - (blLzss.produced-blLzss.flushed);
+	if(room > (BL_LZSS_WINDOW_SIZE-pos))
+	{	/* not cross the end of the window */
+		room = BL_LZSS_WINDOW_SIZE-pos;
+	}
+
+	if(room > (blLzss.size-blLzss.produced))
+	{
+		room = blLzss.size-blLzss.produced;
+	}
+#ifdef BL_LZSS_DELTA
+	if((BL_COMPRESSION_LZSS_DELTA == blLzss.method) && (room > (blLzss.staged-blLzss.produced)))
+	{
+		room = blLzss.staged-blLzss.produced;
+	}
+#endif
+	return room;
+}
+
+static BL_LzssStatusType lzssCopy(void)
+{
+	BL_LzssStatusType rv = BL_LZSS_OK;
+	uint8* window = (uint8*)blLzssWindow;
+	uint32 length;
+	uint32 i;
+
+	while((blLzss.copyLen > 0) && (BL_LZSS_OK == rv))
+	{
+		if(FALSE == lzssHasRoom())
+		{
+			rv = ((blLzss.produced-blLzss.flushed) >= BL_LZSS_WINDOW_SIZE) ? BL_LZSS_FLUSH : BL_LZSS_SECTOR;
+			break;
+		}
+
+		length = lzssRoom();
+		if(length > blLzss.copyLen)
+		{
+			length = blLzss.copyLen;
+		}
+
+		if(BL_LZSS_COPY_WINDOW == blLzss.copyType)
+		{	/* byte by byte as the source may overlap with the destination */
+			for(i=0; i<length; i++)
+			{
+				window[(blLzss.produced+i)&BL_LZSS_WINDOW_MASK] =
+						window[(blLzss.produced+i-blLzss.copyArg)&BL_LZSS_WINDOW_MASK];
+			}
+		}
+#ifdef BL_LZSS_DELTA
+		else
+		{
+			uint32 src = blLzss.produced + blLzss.copyArg;
+			uint32 sector = blLzss.staged - FLASH_ERASE_SIZE;
+			if((src < sector) || (src >= blLzss.size))
+			{
+				ASLOG(BLZ, ("delta copy from %X invalid, current sector %X\n", src, sector));
+				rv = BL_LZSS_ERROR;
+			}
+			else if(src < blLzss.staged)
+			{	/* old data of the current sector, in RAM */
+				if(length > (blLzss.staged-src))
+				{
+					length = blLzss.staged-src;
+				}
+				memcpy(&window[blLzss.produced&BL_LZSS_WINDOW_MASK],
+						&((uint8*)blLzssSector)[src-sector], length);
+			}
+			else
+			{	/* old data still in flash */
+				if(length > BL_LZSS_READ_SIZE)
+				{
+					length = BL_LZSS_READ_SIZE;
+				}
+				if(length > (blLzss.size-src))
+				{
+					length = blLzss.size-src;
+				}
+				if(E_OK != BL_ReadInstalledImage(blLzss.address+src,
+						&window[blLzss.produced&BL_LZSS_WINDOW_MASK], length))
+				{
+					rv = BL_LZSS_ERROR;
+				}
+			}
+		}
+#endif
+
+		if(BL_LZSS_OK == rv)
+		{
+			blLzss.produced += length;
+			blLzss.copyLen  -= length;
+		}
+	}
+
+	return rv;
+}
+
+static BL_LzssStatusType lzssReference(void)
+{
+	BL_LzssStatusType rv = BL_LZSS_OK;
+	uint32 distance = ((uint32)blLzss.token[0]<<4) + (blLzss.token[1]>>4);
+	uint32 length = (blLzss.token[1]&0x0F) + BL_LZSS_MIN_MATCH;
+
+	if(0u == distance)
+	{	/* escape for the delta copy */
+		if((BL_COMPRESSION_LZSS_DELTA == blLzss.method) && (0u == (blLzss.token[1]&0x0F)))
+		{
+			blLzss.state = BL_LZSS_STATE_DELTA;
+		}
+		else
+		{
+			rv = BL_LZSS_ERROR;
+		}
+	}
+	else if((distance > blLzss.produced) || (distance >= BL_LZSS_WINDOW_SIZE))
+	{
+		ASLOG(BLZ, ("reference distance %X invalid @%X\n", distance, blLzss.produced));
+		rv = BL_LZSS_ERROR;
+	}
+	else
+	{
+		blLzss.copyType = BL_LZSS_COPY_WINDOW;
+		blLzss.copyArg  = (sint32)distance;
+		blLzss.copyLen  = length;
+		blLzss.state = BL_LZSS_STATE_ITEM;
+	}
+
+	return rv;
+}
+
+static void lzssDelta(void)
+{
+	uint32 displacement = ((uint32)blLzss.token[2]<<16) + ((uint32)blLzss.token[3]<<8) + blLzss.token[4];
+
+	if(displacement&0x800000u)
+	{	/* sign extension */
+		displacement |= 0xFF000000u;
+	}
+	blLzss.copyType = BL_LZSS_COPY_DELTA;
+	blLzss.copyArg  = (sint32)displacement;
+	blLzss.copyLen  = ((uint32)blLzss.token[5]<<8) + blLzss.token[6] + 1;
+	blLzss.state = BL_LZSS_STATE_ITEM;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+Std_ReturnType BL_LzssInit(uint8 method, uint32 address, uint32 size)
+{
+	Std_ReturnType ercd = E_OK;
+
+	if( (0u == size) || (FALSE == FLASH_IS_WRITE_ADDRESS_ALIGNED(address)) ||
+		(FALSE == FLASH_IS_WRITE_ADDRESS_ALIGNED(size)) )
+	{
+		ercd = E_NOT_OK;
+	}
+	else if(BL_COMPRESSION_LZSS == method)
+	{
+		/* OK */
+	}
+#ifdef BL_LZSS_DELTA
+	else if(BL_COMPRESSION_LZSS_DELTA == method)
+	{	/* sector by sector erasing */
+		if( (FALSE == FLASH_IS_ERASE_ADDRESS_ALIGNED(address)) ||
+			(FALSE == FLASH_IS_ERASE_ADDRESS_ALIGNED(size)) )
+		{
+			ercd = E_NOT_OK;
+		}
+	}
+#endif
+	else
+	{
+		ercd = E_NOT_OK;
+	}
+
+	if(E_OK == ercd)
+	{
+		memset(&blLzss, 0, sizeof(blLzss));
+		blLzss.method  = method;
+		blLzss.address = address;
+		blLzss.size    = size;
+		blLzss.state   = BL_LZSS_STATE_HEADER;
+	}
+
+	ASLOG(BLZ, ("init method %X addr(%X) size(%X): %s\n", method, address, size, (E_OK==ercd)?"ok":"failed"));
+
+	return ercd;
+}
+
+BL_LzssStatusType BL_LzssDecode(const uint8* data, uint32 length, uint32* consumed)
+{
+	BL_LzssStatusType rv = BL_LZSS_OK;
+	uint32 pos = 0;
+	uint8  byte;
+
+	while(BL_LZSS_OK == rv)
+	{
+		if(blLzss.copyLen > 0)
+		{
+			rv = lzssCopy();
+			continue;
+		}
+
+		if(blLzss.produced >= blLzss.size)
+		{
+			if(pos < length)
+			{
+				ASLOG(BLZ, ("%d bytes after the end of stream\n", length-pos));
+				rv = BL_LZSS_ERROR;
+			}
+			break;
+		}
+
+		if(pos >= length)
+		{
+			break;
+		}
+
+		if( (BL_LZSS_STATE_ITEM == blLzss.state) && (blLzss.flags&0x01) && (FALSE == lzssHasRoom()) )
+		{	/* no room for the literal */
+			rv = ((blLzss.produced-blLzss.flushed) >= BL_LZSS_WINDOW_SIZE) ? BL_LZSS_FLUSH : BL_LZSS_SECTOR;
+			break;
+		}
+
+		byte = data[pos];
+		pos ++;
+		switch(blLzss.state)
+		{
+			case BL_LZSS_STATE_HEADER:
+				if((byte < 8) || (byte > BL_LZSS_WINDOW_BITS))
+				{
+					ASLOG(BLZ, ("window bits %d not supported\n", byte));
+					rv = BL_LZSS_ERROR;
+				}
+				else
+				{
+					blLzss.state = BL_LZSS_STATE_FLAGS;
+				}
+				break;
+			case BL_LZSS_STATE_FLAGS:
+				blLzss.flags = byte;
+				blLzss.flagsLeft = 8;
+				blLzss.state = BL_LZSS_STATE_ITEM;
+				break;
+			case BL_LZSS_STATE_ITEM:
+				if(blLzss.flags&0x01)
+				{
+					((uint8*)blLzssWindow)[blLzss.produced&BL_LZSS_WINDOW_MASK] = byte;
+					blLzss.produced ++;
+				}
+				else
+				{
+					blLzss.token[0] = byte;
+					blLzss.tokenPos = 1;
+					blLzss.state = BL_LZSS_STATE_REFERENCE;
+				}
+				blLzss.flags >>= 1;
+				blLzss.flagsLeft --;
+				if(0u == blLzss.flagsLeft)
+				{
+					if(BL_LZSS_STATE_ITEM == blLzss.state)
+					{
+						blLzss.state = BL_LZSS_STATE_FLAGS;
+					}
+				}
+				break;
+			case BL_LZSS_STATE_REFERENCE:
+				blLzss.token[1] = byte;
+				blLzss.tokenPos = 2;
+				rv = lzssReference();
+				if((BL_LZSS_STATE_ITEM == blLzss.state) && (0u == blLzss.flagsLeft))
+				{
+					blLzss.state = BL_LZSS_STATE_FLAGS;
+				}
+				break;
+			case BL_LZSS_STATE_DELTA:
+				blLzss.token[blLzss.tokenPos] = byte;
+				blLzss.tokenPos ++;
+				if(blLzss.tokenPos >= sizeof(blLzss.token))
+				{
+					lzssDelta();
+					if(0u == blLzss.flagsLeft)
+					{
+						blLzss.state = BL_LZSS_STATE_FLAGS;
+					}
+				}
+				break;
+			default:
+				rv = BL_LZSS_ERROR;
+				break;
+		}
+
+		if((BL_LZSS_OK == rv) && (blLzss.produced+blLzss.copyLen) > blLzss.size)
+		{
+			ASLOG(BLZ, ("overflow of the download region\n"));
+			rv = BL_LZSS_ERROR;
+		}
+	}
+
+	*consumed = pos;
+
+	return rv;
+}
+
+uint32 BL_LzssGetFlushData(uint32* address, uint8** data)
+{
+	uint32 pos = blLzss.flushed&BL_LZSS_WINDOW_MASK;
+	uint32 length = blLzss.produced-blLzss.flushed;
+
+	if(length > (BL_LZSS_WINDOW_SIZE-pos))
+	{
+		length = BL_LZSS_WINDOW_SIZE-pos;
+	}
+
+	if((blLzss.flushed+length) < blLzss.size)
+	{	/* the tail will be flushed together with the following data */
+		length &= ~(FLASH_WRITE_SIZE-1);
+	}
+
+	*address = blLzss.address + blLzss.flushed;
+	*data = &((uint8*)blLzssWindow)[pos];
+
+	return length;
+}
+
+void BL_LzssFlushed(uint32 length)
+{
+	blLzss.flushed += length;
+}
+
+uint8* BL_LzssGetSector(uint32* address)
+{
+	uint8* sector = NULL;
+#ifdef BL_LZSS_DELTA
+	*address = blLzss.address + blLzss.staged;
+	sector = (uint8*)blLzssSector;
+#endif
+	return sector;
+}
+
+void BL_LzssSectorStaged(void)
+{
+#ifdef BL_LZSS_DELTA
+	blLzss.staged += FLASH_ERASE_SIZE;
+#endif
+}
+
+boolean BL_LzssIsComplete(void)
+{	/* all of the requested size decoded and written to flash */
+	return ( (0u == blLzss.copyLen) && (blLzss.produced == blLzss.size) &&
+			 (blLzss.flushed == blLzss.size) ) ? TRUE : FALSE;
+}
@@ -28,7 +28,36 @@
 
 #define BL_SECURITY_LEVEL_EXTDS 1
 #define BL_SECURITY_LEVEL_PRGS  2
+
+/* compressionMethod, the high nibble of the RequestDownload dataFormatIdentifier */
+#define BL_COMPRESSION_NONE       0x0
+#define BL_COMPRESSION_LZSS       0x1
+#define BL_COMPRESSION_LZSS_DELTA 0x2
+
+/* the LZSS window is also the staging buffer for the flash write, so it is
+ * the only RAM cost of the plain LZSS decompression, 2^BL_LZSS_WINDOW_BITS bytes.
+ * The delta download is opt-in by BL_LZSS_DELTA, it keeps the old content of the
+ * sector being rewritten in RAM, FLASH_ERASE_SIZE bytes more.
+ * The encoder of script/flashloader.lua must use window bits not bigger than it, and the
+ * FLASH_ERASE_SIZE of the target for delta, given by its [erase_size] [window_bits] */
+#ifndef BL_LZSS_WINDOW_BITS
+#if defined(__LINUX__) || defined(__WINDOWS__)
+#define BL_LZSS_WINDOW_BITS 12
+#else
+#define BL_LZSS_WINDOW_BITS 10
+#endif
+#endif
+#define BL_LZSS_WINDOW_SIZE (1u<<BL_LZSS_WINDOW_BITS)
+/* max length of each BL_ReadInstalledImage */
+#define BL_LZSS_READ_SIZE 32
 /* ============================ [ TYPES     ] ====================================================== */
+typedef enum
+{
+	BL_LZSS_OK = 0,  /* all of the input consumed */
+	BL_LZSS_FLUSH,   /* window full, flush it to flash before decode more */
+	BL_LZSS_SECTOR,  /* delta: the next sector should be staged and erased */
+	BL_LZSS_ERROR
+} BL_LzssStatusType;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -36,4 +65,14 @@
 void BL_Init(void);
 void BL_MainFunction(void);
 void BL_StopAppTimer(void);
+
+Std_ReturnType BL_LzssInit(uint8 method, uint32 address, uint32 size);
+BL_LzssStatusType BL_LzssDecode(const uint8* data, uint32 length, uint32* consumed);
+uint32 BL_LzssGetFlushData(uint32* address, uint8** data);
+void BL_LzssFlushed(uint32 length);
+uint8* BL_LzssGetSector(uint32* address);
+void BL_LzssSectorStaged(void);
+boolean BL_LzssIsComplete(void);
+/* callout to read the currently installed image for the delta decompression */
+Std_ReturnType BL_ReadInstalledImage(uint32 address, uint8* data, uint32 length);
 #endif /* COM_AS_INFRASTRUCTURE_BOOT_COMMON_BOOTLOADER_H_ */
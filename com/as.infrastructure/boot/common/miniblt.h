@@ -196,6 +196,15 @@ Dcm_ReturnReadMemoryType Dcm_ReadMemory(Dcm_OpStatusType OpStatus,
 											   uint32 MemoryAddress,
 											   uint32 MemorySize,
 											   uint8* MemoryData);
+boolean Dcm_CheckDataFormatIdentifier(uint8 dataFormatIdentifier);
+Std_ReturnType Dcm_ProcessRequestDownload(uint8 DataFormatIdentifier, uint8 MemoryIdentifier,
+											   uint32 MemoryAddress, uint32 MemorySize);
+Std_ReturnType Dcm_ProcessRequestTransferExit(void);
+Dcm_ReturnReadMemoryType Dcm_ChecksumMemory(Dcm_OpStatusType OpStatus,
+											   uint8 MemoryIdentifier,
+											   uint32 MemoryAddress,
+											   uint32 MemorySize,
+											   uint8* Checksum);
 
 void Xcp_Init(const Xcp_ConfigType* Xcp_ConfigPtr);
 void Xcp_MainFunction(void);
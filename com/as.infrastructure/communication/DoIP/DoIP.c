@@ -59,8 +59,22 @@
 #define DOIP_E_DIAG_TP_ERROR			0x08	// Transport protocol error
 // 0x09-0xFF  Reserved by document
 
+// How long a target stays with the tester of the last request: P2 and P2* of the server
+// Largest payload taken on TCP: SA, TA and the longest diagnostic message a PduLengthType holds.
+// Must stay below 0xFFFFFFF8 so that payloadLength + 8 can't wrap.
+#ifndef DOIP_MAX_PAYLOAD
+#define DOIP_MAX_PAYLOAD	(0xFFFFu + 4u)
+#endif
+
+#ifndef DOIP_ARC_TARGET_HOLD_TIME
+#define DOIP_ARC_TARGET_HOLD_TIME			50
+#endif
+#ifndef DOIP_ARC_TARGET_HOLD_PENDING_TIME
+#define DOIP_ARC_TARGET_HOLD_PENDING_TIME	5000
+#endif
 
 static void handleTimeout(uint16 connectionIndex);
+static void abortDiagnosticReception(uint16 connectionIndex);
 
 static uint8 VinGidSyncStatus = 0x10;
 
@@ -77,6 +91,15 @@ static DoIp_ArcDoIpSocketStatusType connectionStatus[DOIP_MAX_TESTER_CONNECTIONS
  */
 static uint16 targetConnectionMap[DOIP_TARGET_COUNT];
 
+/*
+ * A target is held by its connection in targetConnectionMap while a request is received and
+ * until the response is sent or P2 expires (a suppressed response). Diagnostic messages from
+ * the other connections are left in their sockets meanwhile so that TCP paces those testers,
+ * and the first of them held back is the next to be served.
+ */
+static uint32 targetHoldTimer[DOIP_TARGET_COUNT];
+static uint16 targetWaitingConnection[DOIP_TARGET_COUNT];
+
 static uint16 pendingRoutingActivationSocket = 0xff;
 static uint16 pendingRoutingActivationSa = 0xff;
 static uint16 pendingRoutingActivationActivationType = 0xffff;
@@ -529,6 +552,8 @@ static void registerSocket(uint16 slotIndex, uint16 sockNr, uint16 activationTyp
 
 	connectionStatus[slotIndex].awaitingAliveCheckResponse = FALSE;
 
+	abortDiagnosticReception(slotIndex);
+
 	connectionStatus[slotIndex].socketState = DOIP_ARC_CONNECTION_REGISTERED;
 }
 
@@ -832,7 +857,7 @@ LookupSaTaResultType lookupSaTa(uint16 connectionIndex, uint16 sa, uint16 ta, ui
 	}
 
 	for (i = 0; i < DOIP_ROUTINGACTIVATION_COUNT; i++) {
-		if (connectionStatus[i].activationType == SoAd_Config.DoIpRoutingActivations[i].activationNumber) {
+		if (connectionStatus[connectionIndex].activationType == SoAd_Config.DoIpRoutingActivations[i].activationNumber) {
 			routingActivationIndex = i;
 			break;
 		}
@@ -1021,6 +1046,7 @@ static void handleTimeout(uint16 connectionIndex) {
 	 * Close current connection (which has timed out anyway)
 	 * and register a new connection with the pending routing activation
 	 */
+	abortDiagnosticReception(connectionIndex);
 	SoAd_SocketClose(connectionStatus[connectionIndex].sockNr);
 
 	if ((pendingRoutingActivationSocket != 0xff) && (NULL != pendingRoutingActivationTxBuffer)) {
@@ -1050,6 +1076,123 @@ static void associateTargetWithConnectionIndex(uint16 targetIndex, uint16 connec
 	targetConnectionMap[targetIndex] = connectionIndex;
 }
 
+#ifdef USE_PDUR
+/*
+ * Whether the connection may pass a diagnostic message to the target now, if not and no
+ * other connection is queued the connection is the next one to be served.
+ */
+static boolean isTargetAvailable(uint16 targetIndex, uint16 connectionIndex) {
+	uint16 holder = targetConnectionMap[targetIndex];
+	uint16 waiting = targetWaitingConnection[targetIndex];
+	boolean available = TRUE;
+
+	if ((holder < DOIP_MAX_TESTER_CONNECTIONS) && (holder != connectionIndex)) {
+		if ((targetHoldTimer[targetIndex] > 0) ||
+			((DOIP_ARC_RX_DIAGNOSTIC == connectionStatus[holder].rxState) && (targetIndex == connectionStatus[holder].targetIndex))) {
+			available = FALSE;
+		}
+	}
+
+	if ((0xffff != waiting) && (waiting != connectionIndex)) {
+		available = FALSE;
+	}
+
+	if ((FALSE == available) && (0xffff == waiting)) {
+		targetWaitingConnection[targetIndex] = connectionIndex;
+	}
+
+	return available;
+}
+
+/*
+ * Reads what is available of the message being received on the connection, the rest is
+ * read by the next DoIp_HandleTcpRx of the socket.
+ */
+static void handleDiagnosticPayload(uint16 connectionIndex) {
+	DoIp_ArcDoIpSocketStatusType *connection = &connectionStatus[connectionIndex];
+	const DoIp_TargetAddressConfigType *target;
+	int handle = SocketAdminList[connection->sockNr].ConnectionHandle;
+	uint8 *discardBuffer = NULL;
+	uint32 len;
+	int nBytes = 1;
+
+	if ((DOIP_ARC_RX_DISCARD == connection->rxState) && (FALSE == SoAd_BufferGet(SOAD_RX_BUFFER_SIZE, &discardBuffer))) {
+		// No buffer to drop the message with, try again in the next (scanSockets) loop.
+		DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TCP_RX_ID, SOAD_E_NOBUFS);
+		return;
+	}
+
+	while ((connection->rxRemaining > 0) && (nBytes > 0)) {
+		if (DOIP_ARC_RX_DIAGNOSTIC == connection->rxState) {
+			nBytes = SoAd_RecvImpl(handle, &connection->rxPduInfo->SduDataPtr[connection->rxOffset], connection->rxRemaining, 0);
+		} else {
+			len = (connection->rxRemaining < SOAD_RX_BUFFER_SIZE) ? connection->rxRemaining : SOAD_RX_BUFFER_SIZE;
+			nBytes = SoAd_RecvImpl(handle, discardBuffer, len, 0);
+		}
+
+		if (nBytes > 0) {
+			connection->rxOffset += nBytes;
+			connection->rxRemaining -= nBytes;
+			connection->generalInactivityTimer = 0;
+		}
+	}
+
+	if (NULL != discardBuffer) {
+		SoAd_BufferFree(discardBuffer);
+	}
+
+	if (0 == connection->rxRemaining) {
+		if (DOIP_ARC_RX_DIAGNOSTIC == connection->rxState) {
+			target = &SoAd_Config.DoIpTargetAddresses[connection->targetIndex];
+			// P2 of the server starts, the response may be sent from within the indication
+			targetHoldTimer[connection->targetIndex] = DOIP_ARC_TARGET_HOLD_TIME;
+
+			/* Finished reception */
+			(void)PduR_SoAdTpRxIndication(target->rxPdu, NTFRSLT_OK);
+
+			// Send diagnostic message positive ack
+			createAndSendDiagnosticAck(connection->sockNr, connection->sa, target->addressValue);
+		}
+
+		connection->rxState = DOIP_ARC_RX_IDLE;
+	}
+}
+
+static void startDiscard(uint16 connectionIndex, uint32 len) {
+	connectionStatus[connectionIndex].rxState = DOIP_ARC_RX_DISCARD;
+	connectionStatus[connectionIndex].rxRemaining = len;
+	connectionStatus[connectionIndex].rxOffset = 0;
+
+	handleDiagnosticPayload(connectionIndex);
+}
+#endif /* USE_PDUR */
+
+/*
+ * Gives up the message being received on the connection and the targets it holds or waits
+ * for, as the connection is closed.
+ */
+static void abortDiagnosticReception(uint16 connectionIndex) {
+#ifdef USE_PDUR
+	uint16 i;
+
+	if (DOIP_ARC_RX_DIAGNOSTIC == connectionStatus[connectionIndex].rxState) {
+		(void)PduR_SoAdTpRxIndication(SoAd_Config.DoIpTargetAddresses[connectionStatus[connectionIndex].targetIndex].rxPdu, NTFRSLT_E_NOT_OK);
+	}
+
+	for (i = 0; i < DOIP_TARGET_COUNT; i++) {
+		if (connectionIndex == targetConnectionMap[i]) {
+			targetHoldTimer[i] = 0;
+		}
+		if (connectionIndex == targetWaitingConnection[i]) {
+			targetWaitingConnection[i] = 0xffff;
+		}
+	}
+#endif /* USE_PDUR */
+	connectionStatus[connectionIndex].rxState = DOIP_ARC_RX_IDLE;
+	connectionStatus[connectionIndex].rxRemaining = 0;
+}
+
+/* payloadLength is bounded by DOIP_MAX_PAYLOAD in DoIp_HandleTcpRx, payloadLength + 8 doesn't wrap */
 static void handleDiagnosticMessage(uint16 sockNr, uint32 payloadLength, uint8 *rxBuffer)
 {
 #ifdef USE_PDUR
@@ -1059,8 +1202,8 @@ static void handleDiagnosticMessage(uint16 sockNr, uint32 payloadLength, uint8 *
 	uint16 sa;
 	uint16 ta;
 	uint16 targetIndex;
-	uint16 connectionIndex;
-	uint16 diagnosticMessageLength = payloadLength - 4;
+	uint16 connectionIndex = 0xffff;
+	PduLengthType diagnosticMessageLength = payloadLength - 4;
 	uint16 i;
 
 	if (payloadLength >= 4) {
@@ -1078,39 +1221,65 @@ static void handleDiagnosticMessage(uint16 sockNr, uint32 payloadLength, uint8 *
 
 		lookupResult = lookupSaTa(connectionIndex, sa, ta, &targetIndex);
 		if (lookupResult == LOOKUP_SA_TA_OK) {
-			// Send diagnostic message to PduR
-			PduLengthType len=0;
-			result = PduR_SoAdTpProvideRxBuffer(SoAd_Config.DoIpTargetAddresses[targetIndex].rxPdu,diagnosticMessageLength,&pduInfo);
+			connectionStatus[connectionIndex].generalInactivityTimer = 0;
+
+			if (FALSE == isTargetAvailable(targetIndex, connectionIndex)) {
+				// Leave the message in the socket, TCP holds the tester back until it's read.
+				return;
+			}
+
+			if ((uint32)diagnosticMessageLength != (payloadLength - 4)) {
+				result = BUFREQ_OVFL;
+			} else {
+				// Send diagnostic message to PduR
+				result = PduR_SoAdTpProvideRxBuffer(SoAd_Config.DoIpTargetAddresses[targetIndex].rxPdu,diagnosticMessageLength,&pduInfo);
+			}
+
+			// The turn of the waiting connection is over unless the target is still busy, also
+			// when the message is refused, else the other testers are locked out.
+			if ((result != BUFREQ_BUSY) && (connectionIndex == targetWaitingConnection[targetIndex])) {
+				targetWaitingConnection[targetIndex] = 0xffff;
+			}
+
 			if (result == BUFREQ_OK) {
 
 				pduInfo->SduLength = diagnosticMessageLength;
 				associateTargetWithConnectionIndex(targetIndex, connectionIndex);
+				targetHoldTimer[targetIndex] = 0;
 
 				(void)SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, rxBuffer, 12, 0);
 
-				/* Let pdur copy received data */
-				while(len < diagnosticMessageLength)
-				{
-					len += SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, &(pduInfo->SduDataPtr[len]), diagnosticMessageLength-len, 0);
+				/* Let pdur copy received data as it arrives */
+				connectionStatus[connectionIndex].targetIndex = targetIndex;
+				connectionStatus[connectionIndex].rxPduInfo = pduInfo;
+				connectionStatus[connectionIndex].rxOffset = 0;
+				connectionStatus[connectionIndex].rxRemaining = diagnosticMessageLength;
+				connectionStatus[connectionIndex].rxState = DOIP_ARC_RX_DIAGNOSTIC;
+				handleDiagnosticPayload(connectionIndex);
+			}
+			else if (result == BUFREQ_BUSY)
+			{
+				// The target is busy with a request, the message is read when it's available.
+				if (0xffff == targetWaitingConnection[targetIndex]) {
+					targetWaitingConnection[targetIndex] = connectionIndex;
 				}
-
-				/* Finished reception */
-				(void)PduR_SoAdTpRxIndication(SoAd_Config.DoIpTargetAddresses[targetIndex].rxPdu, NTFRSLT_OK);
-
-				// Send diagnostic message positive ack
-				createAndSendDiagnosticAck(sockNr, sa, ta);
+			}
+			else if (result == BUFREQ_OVFL)
+			{
+				createAndSendDiagnosticNack(sockNr, sa, ta, DOIP_E_DIAG_MESSAGE_TO_LARGE);
+				startDiscard(connectionIndex, payloadLength + 8);
 			}
 			else
 			{
 				createAndSendDiagnosticNack(sockNr, sa, ta, DOIP_E_DIAG_OUT_OF_MEMORY);
-				discardIpMessage(SocketAdminList[sockNr].ConnectionHandle, payloadLength + 8, rxBuffer);
+				startDiscard(connectionIndex, payloadLength + 8);
 				DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_DIAG_MSG_ID, SOAD_E_SHALL_NOT_HAPPEN);
 			}
 
 		} else if (lookupResult == LOOKUP_SA_TA_TAUNKNOWN) {
 			// TA not known
 			createAndSendDiagnosticNack(sockNr, sa, ta, DOIP_E_DIAG_UNKNOWN_TA);
-			discardIpMessage(SocketAdminList[sockNr].ConnectionHandle, payloadLength + 8, rxBuffer);
+			startDiscard(connectionIndex, payloadLength + 8);
 		} else {
 			// SA not registered on receiving socket
 			createAndSendDiagnosticNack(sockNr, sa, ta, DOIP_E_DIAG_INVALID_SA);
@@ -1127,22 +1296,47 @@ static void handleDiagnosticMessage(uint16 sockNr, uint32 payloadLength, uint8 *
 void DoIp_HandleTcpRx(uint16 sockNr)
 {
 	int nBytes;
+	uint8 header[8+4];
 	uint8* rxBuffer;
 	uint16 payloadType;
-	uint16 payloadLength;
+	uint32 payloadLength;
+#ifdef USE_PDUR
+	uint16 i;
 
-	if (SoAd_BufferGet(SOAD_RX_BUFFER_SIZE, &rxBuffer)) {
-		nBytes = SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, rxBuffer, SOAD_RX_BUFFER_SIZE, MSG_PEEK);
-		SoAd_SocketStatusCheck(sockNr, SocketAdminList[sockNr].ConnectionHandle);
-		if (nBytes >= 8) {
-			ASMEM(DOIP,"RX",rxBuffer,nBytes);
-			/*NOTE: REMOVE WHEN MOVED TO CANOE8.1*/
-			if (((rxBuffer[0] == 1) || (rxBuffer[0] == 2)) && (((uint8)(~rxBuffer[1]) == 1) || ((uint8)(~rxBuffer[1]) == 2))) {
-			//if ((rxBuffer[0] == DOIP_PROTOCOL_VERSION) && ((uint8)(~rxBuffer[1]) == DOIP_PROTOCOL_VERSION)) {
-				payloadType = rxBuffer[2] << 8 | rxBuffer[3];
-				payloadLength = (rxBuffer[4] << 24) | (rxBuffer[5] << 16) | (rxBuffer[6] << 8) | rxBuffer[7];
-				if ((payloadLength + 8) <= SOAD_RX_BUFFER_SIZE) {
-					if ((payloadLength + 8) <= nBytes) {
+	// Continue the message being received on this socket
+	for (i = 0; i < DOIP_MAX_TESTER_CONNECTIONS; i++) {
+		if ((sockNr == connectionStatus[i].sockNr) && (DOIP_ARC_RX_IDLE != connectionStatus[i].rxState)) {
+			handleDiagnosticPayload(i);
+			if (DOIP_ARC_RX_IDLE != connectionStatus[i].rxState) {
+				return;
+			}
+			break;
+		}
+	}
+#endif
+
+	nBytes = SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, header, sizeof(header), MSG_PEEK);
+	SoAd_SocketStatusCheck(sockNr, SocketAdminList[sockNr].ConnectionHandle);
+	if (nBytes >= 8) {
+		ASMEM(DOIP,"RX",header,nBytes);
+		/*NOTE: REMOVE WHEN MOVED TO CANOE8.1*/
+		if (((header[0] == 1) || (header[0] == 2)) && (((uint8)(~header[1]) == 1) || ((uint8)(~header[1]) == 2))) {
+		//if ((header[0] == DOIP_PROTOCOL_VERSION) && ((uint8)(~header[1]) == DOIP_PROTOCOL_VERSION)) {
+			payloadType = header[2] << 8 | header[3];
+			payloadLength = ((uint32)header[4] << 24) | (header[5] << 16) | (header[6] << 8) | header[7];
+			if (payloadLength > DOIP_MAX_PAYLOAD) {
+				// Never taken, and the length can't be skipped without wrapping the header arithmetic
+				createAndSendNack(sockNr, DOIP_E_MESSAGE_TO_LARGE);
+				SoAd_SocketClose(sockNr);
+			} else if (0x8001 == payloadType) {
+				// Diagnostic message, the payload goes from the socket to the buffer of PduR as it arrives
+				if ((nBytes >= (8+4)) || (payloadLength < 4)) {
+					handleDiagnosticMessage(sockNr, payloadLength, header);
+				}
+			} else if ((payloadLength + 8) <= SOAD_RX_BUFFER_SIZE) {
+				if (SoAd_BufferGet(payloadLength + 8, &rxBuffer)) {
+					nBytes = SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, rxBuffer, payloadLength + 8, MSG_PEEK);
+					if ((payloadLength + 8) <= (uint32)nBytes) {
 						// Grab the message
 						switch (payloadType) {
 #if 0 /* Vehicle identification requests are not to be supported over TCP */
@@ -1178,31 +1372,28 @@ void DoIp_HandleTcpRx(uint16 sockNr)
 							createAndSendNack(sockNr, DOIP_E_INVALID_PAYLOAD_LENGTH);
 							break;
 
-						case 0x8001:	// Diagnostic message
-							//nBytes = SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, rxBuffer, payloadLength + 8, 0);
-							handleDiagnosticMessage(sockNr, payloadLength, rxBuffer);
-							break;
-
 						default:
 							nBytes = SoAd_RecvImpl(SocketAdminList[sockNr].ConnectionHandle, rxBuffer, payloadLength + 8, 0);
 							createAndSendNack(sockNr, DOIP_E_UNKNOWN_PAYLOAD_TYPE);
 							break;
 						}
 					}
+					SoAd_BufferFree(rxBuffer);
 				} else {
-					createAndSendNack(sockNr, DOIP_E_MESSAGE_TO_LARGE);
-					discardIpMessage(SocketAdminList[sockNr].ConnectionHandle, payloadLength + 8, rxBuffer);
+					// No rx buffer available. Report this in Det. Message should be handled in the next (scanSockets) loop.
+					DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TCP_RX_ID, SOAD_E_NOBUFS);
 				}
+			} else if (SoAd_BufferGet(SOAD_RX_BUFFER_SIZE, &rxBuffer)) {
+				createAndSendNack(sockNr, DOIP_E_MESSAGE_TO_LARGE);
+				discardIpMessage(SocketAdminList[sockNr].ConnectionHandle, payloadLength + 8, rxBuffer);
+				SoAd_BufferFree(rxBuffer);
 			} else {
-				createAndSendNack(sockNr, DOIP_E_INCORRECT_PATTERN_FORMAT);
-				SoAd_SocketClose(sockNr);
+				DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TCP_RX_ID, SOAD_E_NOBUFS);
 			}
+		} else {
+			createAndSendNack(sockNr, DOIP_E_INCORRECT_PATTERN_FORMAT);
+			SoAd_SocketClose(sockNr);
 		}
-
-		SoAd_BufferFree(rxBuffer);
-	} else {
-		// No rx buffer available. Report this in Det. Message should be handled in the next (scanSockets) loop.
-		DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TCP_RX_ID, SOAD_E_NOBUFS);
 	}
 }
 
@@ -1293,6 +1484,72 @@ void DoIp_HandleUdpRx(uint16 sockNr)
 }
 
 
+#ifdef USE_PDUR
+static void DoIp_FillDiagnosticHeader(uint8* header, uint16 sa, uint16 ta, PduLengthType length)
+{
+	header[0] = DOIP_PROTOCOL_VERSION;
+	header[1] = ~DOIP_PROTOCOL_VERSION;
+	header[2] = 0x80;	// 0x8001->Diagnostic message
+	header[3] = 0x01;
+	header[4] = ((uint32)length+4) >> 24;
+	header[5] = ((uint32)length+4) >> 16;
+	header[6] = ((uint32)length+4) >> 8;
+	header[7] = ((uint32)length+4) >> 0;
+
+	header[8] = sa >> 8;
+	header[9] = sa >> 0;
+
+	header[10] = ta >> 8;
+	header[11] = ta >> 0;
+}
+
+/* The response to the request of the target is on the way, it's free for the next one
+ * unless the response is pending (NRC 0x78) and the final one follows within P2* */
+static void releaseTarget(uint16 targetIndex, const PduInfoType* payload, PduLengthType length)
+{
+	if ((3 == length) && (payload->SduLength >= 3) &&
+		(0x7F == payload->SduDataPtr[0]) && (0x78 == payload->SduDataPtr[2])) {
+		targetHoldTimer[targetIndex] = DOIP_ARC_TARGET_HOLD_PENDING_TIME;
+	} else {
+		targetHoldTimer[targetIndex] = 0;
+	}
+}
+
+/* Pump the diagnostic messages which PduR provides chunk by chunk */
+static void DoIp_HandleTpStreaming(PduIdType SoAdSrcPduId)
+{
+	BufReq_ReturnType result = BUFREQ_OK;
+	PduInfoType *txPayloadPduInfo;
+	PduIdType pduId = SoAd_Config.PduRoute[SoAdSrcPduId].SourcePduId;
+	PduAdminListType *admin = &PduAdminList[SoAdSrcPduId];
+
+	while ((admin->TxRemaining > 0) && (BUFREQ_OK == result)) {
+		result = PduR_SoAdTpProvideTxBuffer(pduId, &txPayloadPduInfo, 0);
+		if (BUFREQ_OK == result) {
+			if ((txPayloadPduInfo->SduLength <= admin->TxRemaining)
+				&& (SoAd_SendIpMessage(admin->SocketNr, txPayloadPduInfo->SduLength, txPayloadPduInfo->SduDataPtr) == txPayloadPduInfo->SduLength)) {
+				admin->TxRemaining -= txPayloadPduInfo->SduLength;
+			} else {
+				result = BUFREQ_NOT_OK;
+			}
+		}
+	}
+
+	if (0 == admin->TxRemaining) {
+		admin->PduStatus = PDU_IDLE;
+		PduR_SoAdTpTxConfirmation(pduId, NTFRSLT_OK);
+	} else if (BUFREQ_BUSY != result) {
+		/* the tester has got a part of the message, the connection can't be used anymore */
+		admin->PduStatus = PDU_IDLE;
+		DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TP_TRANSMIT_ID, SOAD_E_UNEXPECTED_EXECUTION);
+		PduR_SoAdTpTxConfirmation(pduId, NTFRSLT_E_NOT_OK);
+		SoAd_SocketClose(admin->SocketNr);
+	} else {
+		/* wait for PduR to receive more */
+	}
+}
+#endif
+
 Std_ReturnType DoIp_HandleTpTransmit(PduIdType SoAdSrcPduId, const PduInfoType* SoAdSrcPduInfoPtr)
 {
 	Std_ReturnType returnCode = E_OK;
@@ -1300,6 +1557,7 @@ Std_ReturnType DoIp_HandleTpTransmit(PduIdType SoAdSrcPduId, const PduInfoType*
 	PduInfoType txPduInfo;
 	uint16 socketNr;
 	uint16 bytesSent;
+	uint16 connectionId;
 	/*
 	 * Find which target the incoming Pdu belongs to:
 	 */
@@ -1319,44 +1577,54 @@ Std_ReturnType DoIp_HandleTpTransmit(PduIdType SoAdSrcPduId, const PduInfoType*
 	}
 
 	if (PduAdminList[SoAdSrcPduId].PduStatus == PDU_IDLE ) {
-		socketNr = SoAd_Config.PduRoute[SoAdSrcPduId].DestinationSocketRef->SocketId;
+		connectionId = targetConnectionMap[targetIndex];
+		if ((connectionId < DOIP_MAX_TESTER_CONNECTIONS) &&
+			(DOIP_ARC_CONNECTION_REGISTERED == connectionStatus[connectionId].socketState)) {
+			// The response goes back on the connection of the request
+			socketNr = connectionStatus[connectionId].sockNr;
+		} else {
+			connectionId = 0;
+			socketNr = SoAd_Config.PduRoute[SoAdSrcPduId].DestinationSocketRef->SocketId;
+		}
 		if ((SocketAdminList[socketNr].SocketState == SOCKET_TCP_LISTENING)
 			|| (SocketAdminList[socketNr].SocketState == SOCKET_TCP_READY)
 			|| (SocketAdminList[socketNr].SocketState == SOCKET_UDP_READY))
 		{
+				BufReq_ReturnType result;
+				PduInfoType *txPayloadPduInfo;
+				uint16 ta = connectionStatus[connectionId].sa; // Target of response is the source of the initiating party...
+				uint16 sa = SoAd_Config.DoIpTargetAddresses[targetIndex].addressValue;
+
 				PduAdminList[SoAdSrcPduId].PduStatus = PDU_TP_REQ_BUFFER;
 				txPduInfo.SduLength = SoAdSrcPduInfoPtr->SduLength + 12; // Make room for extra doip header
 
-				if(SoAd_BufferGet(txPduInfo.SduLength, &txPduInfo.SduDataPtr))
-				{
-					BufReq_ReturnType result;
-					PduInfoType *txPayloadPduInfo;
-
-					uint16 connectionId = targetConnectionMap[targetIndex];
-					uint16 ta = connectionStatus[connectionId].sa; // Target of response is the source of the initiating party...
-					uint16 sa = SoAd_Config.DoIpTargetAddresses[targetIndex].addressValue;
+				result = PduR_SoAdTpProvideTxBuffer(SoAd_Config.PduRoute[SoAdSrcPduId].SourcePduId,
+						&txPayloadPduInfo, 0);
 
+				if (BUFREQ_OK == result) {
+					releaseTarget(targetIndex, txPayloadPduInfo, SoAdSrcPduInfoPtr->SduLength);
+				}
 
+				if (BUFREQ_OK != result) {
+					DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TP_TRANSMIT_ID, SOAD_E_NOBUFS);
+					PduR_SoAdTpTxConfirmation(SoAd_Config.PduRoute[SoAdSrcPduId].SourcePduId, NTFRSLT_E_NO_BUFFER);
+				} else if (txPayloadPduInfo->SduLength < SoAdSrcPduInfoPtr->SduLength) {
+					/* PduR routes a gateway message on the fly, send the header and the payload as it arrives */
+					uint8 header[12];
+					DoIp_FillDiagnosticHeader(header, sa, ta, SoAdSrcPduInfoPtr->SduLength);
+					if ((SoAd_SendIpMessage(socketNr, sizeof(header), header) == sizeof(header))
+						&& (SoAd_SendIpMessage(socketNr, txPayloadPduInfo->SduLength, txPayloadPduInfo->SduDataPtr) == txPayloadPduInfo->SduLength)) {
+						PduAdminList[SoAdSrcPduId].SocketNr = socketNr;
+						PduAdminList[SoAdSrcPduId].TxRemaining = SoAdSrcPduInfoPtr->SduLength - txPayloadPduInfo->SduLength;
+						PduAdminList[SoAdSrcPduId].PduStatus = PDU_TP_STREAMING;
+					} else {
+						DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TP_TRANSMIT_ID, SOAD_E_UNEXPECTED_EXECUTION);
+						PduR_SoAdTpTxConfirmation(SoAd_Config.PduRoute[SoAdSrcPduId].SourcePduId, NTFRSLT_E_NOT_OK);
+					}
+				} else if(SoAd_BufferGet(txPduInfo.SduLength, &txPduInfo.SduDataPtr))
+				{
 					PduAdminList[SoAdSrcPduId].PduStatus = PDU_TP_SENDING;
-					txPduInfo.SduDataPtr[0] = DOIP_PROTOCOL_VERSION;
-					txPduInfo.SduDataPtr[1] = ~DOIP_PROTOCOL_VERSION;
-					txPduInfo.SduDataPtr[2] = 0x80;	// 0x8001->Diagnostic message
-					txPduInfo.SduDataPtr[3] = 0x01;
-					txPduInfo.SduDataPtr[4] = (SoAdSrcPduInfoPtr->SduLength+4) >> 24;
-					txPduInfo.SduDataPtr[5] = (SoAdSrcPduInfoPtr->SduLength+4) >> 16;
-					txPduInfo.SduDataPtr[6] = (SoAdSrcPduInfoPtr->SduLength+4) >> 8;
-					txPduInfo.SduDataPtr[7] = (SoAdSrcPduInfoPtr->SduLength+4) >> 0;
-
-					txPduInfo.SduDataPtr[8] = sa >> 8;
-					txPduInfo.SduDataPtr[9] = sa >> 0;
-
-					txPduInfo.SduDataPtr[10] = ta >> 8;
-					txPduInfo.SduDataPtr[11] = ta >> 0;
-
-					result = PduR_SoAdTpProvideTxBuffer(SoAd_Config.PduRoute[SoAdSrcPduId].SourcePduId,
-							&txPayloadPduInfo, 0);
-
-					asAssert(BUFREQ_OK == result );
+					DoIp_FillDiagnosticHeader(txPduInfo.SduDataPtr, sa, ta, SoAdSrcPduInfoPtr->SduLength);
 
 					memcpy(&txPduInfo.SduDataPtr[12],txPayloadPduInfo->SduDataPtr,SoAdSrcPduInfoPtr->SduLength);
 
@@ -1380,7 +1648,9 @@ Std_ReturnType DoIp_HandleTpTransmit(PduIdType SoAdSrcPduId, const PduInfoType*
 					DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_DOIP_HANDLE_TP_TRANSMIT_ID, SOAD_E_NOBUFS);
 					PduR_SoAdTpTxConfirmation(SoAd_Config.PduRoute[SoAdSrcPduId].SourcePduId, NTFRSLT_E_NO_BUFFER);
 				}
-				PduAdminList[SoAdSrcPduId].PduStatus = PDU_IDLE;
+				if (PDU_TP_STREAMING != PduAdminList[SoAdSrcPduId].PduStatus) {
+					PduAdminList[SoAdSrcPduId].PduStatus = PDU_IDLE;
+				}
 		} else {
 			/* Socket not ready */
 			returnCode = E_NOT_OK;
@@ -1399,6 +1669,22 @@ void DoIp_MainFunction() {
 	uint16 i;
 	static uint16 numAnnouncements = 0;
 
+#ifdef USE_PDUR
+	for (i = 0; i < SOAD_PDU_ROUTE_COUNT; i++) {
+		if (PDU_TP_STREAMING == PduAdminList[i].PduStatus) {
+			DoIp_HandleTpStreaming(i);
+		}
+	}
+
+	for (i = 0; i < DOIP_TARGET_COUNT; i++) {
+		if (targetHoldTimer[i] > DOIP_MAINFUNCTION_PERIOD_TIME) {
+			targetHoldTimer[i] -= DOIP_MAINFUNCTION_PERIOD_TIME;
+		} else {
+			targetHoldTimer[i] = 0;
+		}
+	}
+#endif
+
 	if (DOIP_LINK_UP == LinkStatus) {
 		DoIp_ArcAnnouncementTimer += DOIP_MAINFUNCTION_PERIOD_TIME;
 		if ((DoIp_ArcAnnounceWait <= DoIp_ArcAnnouncementTimer) &&
@@ -1427,6 +1713,15 @@ void DoIp_MainFunction() {
 	 */
 	for (i = 0; i < DOIP_MAX_TESTER_CONNECTIONS; i++) {
 
+		/*
+		 * The socket of a message being received is closed
+		 */
+		if ((DOIP_ARC_RX_IDLE != connectionStatus[i].rxState) &&
+			((DOIP_ARC_CONNECTION_REGISTERED != connectionStatus[i].socketState) ||
+			 (SOCKET_TCP_READY != SocketAdminList[connectionStatus[i].sockNr].SocketState))) {
+			abortDiagnosticReception(i);
+		}
+
 		if (DOIP_ARC_CONNECTION_REGISTERED == connectionStatus[i].socketState) {
 
 			/*
@@ -1478,6 +1773,14 @@ void DoIp_Init() {
 		connectionStatus[i].generalInactivityTimer = 0;
 		connectionStatus[i].initialInactivityTimer = 0;
 		connectionStatus[i].aliveCheckTimer = 0;
+		connectionStatus[i].rxState = DOIP_ARC_RX_IDLE;
+		connectionStatus[i].rxRemaining = 0;
+	}
+
+	for (i = 0; i < DOIP_TARGET_COUNT; i++) {
+		targetConnectionMap[i] = 0xffff;
+		targetHoldTimer[i] = 0;
+		targetWaitingConnection[i] = 0xffff;
 	}
 }
 #endif /* USE_SOAD */
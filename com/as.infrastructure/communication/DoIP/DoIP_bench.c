@@ -0,0 +1,605 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#if defined(__DOIP_BENCH__)
+/* Two simulated testers on one DoIP target: the ECU is SoAd and DoIP on the host sockets of
+ * the loopback with a fake Dcm behind PduR, which takes one request at a time and handles it
+ * in the given main cycles, the testers are child processes which send their requests of
+ * 0x36 as fast as they are answered. The result is the responses and the worst round trip
+ * of each tester, a tester which waits longer than BENCH_STALL_S for a response is stalled
+ * and fails the run. With 'ovfl' the tester 0xbeee sends one request larger than the Dcm
+ * could take while the target is busy with 0xbeef, and then stays idle, it gets the NACK of
+ * a too large message and 0xbeef shall still be served after it, not only when the general
+ * inactivity timeout closes the connection of 0xbeee. SoAd.c, DoIP.c and SoAd_Cfg.c are built in
+ * here without the generated Os and PduR configuration, the host sockets and the testers
+ * are the part of __DOIP_BENCH_SOCKET__ as SoAd_Types.h clashes with the host headers.
+ * Build and run on linux:
+ *   cd com && I="-Ias.infrastructure/include -Ias.infrastructure/system/kernel \
+ *     -Ias.infrastructure/communication/SoAd -Ias.infrastructure/communication/DoIP \
+ *     -Ias.application/common/config -Ias.application/board.posix/common"
+ *   gcc -O2 -D__DOIP_BENCH__ -D__LINUX__ $I -c as.infrastructure/communication/DoIP/DoIP_bench.c -o ecu.o
+ *   gcc -O2 -D__DOIP_BENCH_SOCKET__ -c as.infrastructure/communication/DoIP/DoIP_bench.c -o socket.o
+ *   gcc ecu.o socket.o -o doip_bench
+ *   ./doip_bench 13400 2 4095 1
+ *   ./doip_bench 13400 2 4095 5 ovfl */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/select.h>
+/* the host sockets instead of lwip, and no Os and PduR configuration */
+#define BSD_H
+#define NO_OSCFG
+#define PDUR_H
+#define PDUR_SOAD_H_
+#define USE_SOAD
+#define USE_DOIP
+#define USE_PDUR
+#define SOAD_USE_SELECT STD_ON
+#define PDUR_ID_SOAD_RX 0
+#define PDUR_ID_SOAD_TX 0
+#include "Std_Types.h"
+#include "ComStack_Types.h"
+extern uint32 inet_addr(const char *cp);
+extern uint16 htons(uint16 v);
+/* SocketLocalIpAddress is NULL for any */
+#define inet_addr(ip) ((NULL != (ip)) ? inet_addr(ip) : 0)
+BufReq_ReturnType PduR_SoAdTpProvideRxBuffer(PduIdType id, PduLengthType len, PduInfoType **info);
+void PduR_SoAdTpRxIndication(PduIdType id, NotifResultType result);
+BufReq_ReturnType PduR_SoAdTpProvideTxBuffer(PduIdType id, PduInfoType **info, PduLengthType len);
+void PduR_SoAdTpTxConfirmation(PduIdType id, NotifResultType result);
+void PduR_SoAdIfRxIndication(PduIdType id, PduInfoType* info);
+void PduR_SoAdIfTxConfirmation(PduIdType id);
+BufReq_ReturnType PduR_SoAdTpStartOfReception(PduIdType id, PduLengthType len, PduLengthType* bufferSize);
+BufReq_ReturnType PduR_SoAdTpCopyRxData(PduIdType id, PduInfoType* info, PduLengthType* bufferSize);
+BufReq_ReturnType PduR_SoAdTpCopyTxData(PduIdType id, PduInfoType* info, RetryInfoType* retry, PduLengthType* available);
+/* both have a static LinkStatus */
+#define LinkStatus SoAd_LinkStatus
+#include "SoAd.c"
+#undef LinkStatus
+#include "DoIP.c"
+#include "SoAd_Cfg.c"
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_TESTER_MAX 2
+#define BENCH_DURATION_S 5
+/* the largest request the fake Dcm takes */
+#define BENCH_DCM_BUFFER_SIZE 4100
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+extern double bench_now(void);
+extern int bench_tester(int id, int msgSize, int ovfl, int duration);
+/* ============================ [ DATAS     ] ====================================================== */
+int benchPort;
+static int benchMsgSize = 4095;
+static int benchProcTicks = 1;
+static int benchOvfl = 0;
+
+static uint8 dcmRxBuf[BENCH_DCM_BUFFER_SIZE];
+static PduInfoType dcmRxInfo = { dcmRxBuf, 0 };
+static uint8 dcmTxBuf[8];
+static PduInfoType dcmTxInfo = { dcmTxBuf, 2 };
+static enum { DCM_IDLE, DCM_RX, DCM_PROC, DCM_TX } dcmState;
+static int dcmTicks;
+static unsigned int dcmServed, dcmBusy, dcmOvfl;
+/* ============================ [ LOCALS    ] ====================================================== */
+static void dcm_main(void)
+{
+	if((DCM_PROC == dcmState) && (--dcmTicks <= 0))
+	{	/* positive response of 0x36 with the block sequence counter */
+		dcmTxBuf[0] = 0x76;
+		dcmTxBuf[1] = dcmRxBuf[1];
+		dcmState = DCM_TX;
+		if(E_OK != SoAdTp_Transmit(SOADTP_ID_SOAD_TX, &dcmTxInfo))
+		{
+			dcmState = DCM_IDLE;
+		}
+	}
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+void Det_ReportError(uint16 ModuleId, uint8 InstanceId, uint8 ApiId, uint8 ErrorId)
+{
+	printf("DET %d %d %d %d\n", ModuleId, InstanceId, ApiId, ErrorId);
+}
+
+imask_t __Irq_Save(void)
+{
+	return 0;
+}
+
+void Irq_Restore(imask_t irq_state)
+{
+	(void)irq_state;
+}
+
+BufReq_ReturnType PduR_SoAdTpProvideRxBuffer(PduIdType id, PduLengthType len, PduInfoType **info)
+{
+	(void)id;
+	if(DCM_IDLE != dcmState)
+	{
+		dcmBusy++;
+		return BUFREQ_BUSY;
+	}
+	if(len > sizeof(dcmRxBuf))
+	{
+		dcmOvfl++;
+		return BUFREQ_OVFL;
+	}
+	dcmState = DCM_RX;
+	dcmRxInfo.SduLength = len;
+	*info = &dcmRxInfo;
+	return BUFREQ_OK;
+}
+
+void PduR_SoAdTpRxIndication(PduIdType id, NotifResultType result)
+{
+	(void)id;
+	if(NTFRSLT_OK == result)
+	{
+		dcmState = DCM_PROC;
+		dcmTicks = benchProcTicks;
+		dcmServed++;
+	}
+	else
+	{
+		dcmState = DCM_IDLE;
+	}
+}
+
+BufReq_ReturnType PduR_SoAdTpProvideTxBuffer(PduIdType id, PduInfoType **info, PduLengthType len)
+{
+	(void)id;
+	(void)len;
+	*info = &dcmTxInfo;
+	return BUFREQ_OK;
+}
+
+void PduR_SoAdTpTxConfirmation(PduIdType id, NotifResultType result)
+{
+	(void)id;
+	(void)result;
+	dcmState = DCM_IDLE;
+}
+
+void PduR_SoAdIfRxIndication(PduIdType id, PduInfoType* info)
+{
+	(void)id;
+	(void)info;
+}
+
+void PduR_SoAdIfTxConfirmation(PduIdType id)
+{
+	(void)id;
+}
+
+/* the sockets of the SoAd TP, not DoIP */
+BufReq_ReturnType PduR_SoAdTpStartOfReception(PduIdType id, PduLengthType len, PduLengthType* bufferSize)
+{
+	(void)id;
+	(void)len;
+	(void)bufferSize;
+	return BUFREQ_NOT_OK;
+}
+
+BufReq_ReturnType PduR_SoAdTpCopyRxData(PduIdType id, PduInfoType* info, PduLengthType* bufferSize)
+{
+	(void)id;
+	(void)info;
+	(void)bufferSize;
+	return BUFREQ_NOT_OK;
+}
+
+BufReq_ReturnType PduR_SoAdTpCopyTxData(PduIdType id, PduInfoType* info, RetryInfoType* retry, PduLengthType* available)
+{
+	(void)id;
+	(void)info;
+	(void)retry;
+	(void)available;
+	return BUFREQ_NOT_OK;
+}
+
+int main(int argc, char* argv[])
+{
+	pid_t pid[BENCH_TESTER_MAX];
+	int i, n = 2, status, failed = 0;
+	double end;
+
+	if(argc < 2)
+	{
+		printf("usage: %s port [testers] [request size] [Dcm main cycles] [ovfl]\n", argv[0]);
+		return -1;
+	}
+	benchPort = atoi(argv[1]);
+	if(argc > 2) n = atoi(argv[2]);
+	if(argc > 3) benchMsgSize = atoi(argv[3]);
+	if(argc > 4) benchProcTicks = atoi(argv[4]);
+	for(i = 5; i < argc; i++)
+	{
+		if(0 == strcmp(argv[i], "ovfl")) benchOvfl = 1;
+	}
+	if((n < 1) || (n > BENCH_TESTER_MAX) || (benchMsgSize < 2) || (benchMsgSize > (BENCH_DCM_BUFFER_SIZE-4)) ||
+		(benchOvfl && (n != 2)))
+	{
+		printf("invalid arguments\n");
+		return -1;
+	}
+
+	SoAd_Init();
+	for(i = 0; i < 3; i++)
+	{
+		SoAd_MainFunction();
+		DoIp_MainFunction();
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		pid[i] = fork();
+		if(0 == pid[i])
+		{	/* 0xbeee comes when 0xbeef is busy with the target */
+			usleep(i*20000);
+			exit(bench_tester(i, benchMsgSize, benchOvfl, BENCH_DURATION_S));
+		}
+	}
+
+	/* the main cycle of DOIP_MAINFUNCTION_PERIOD_TIME */
+	end = bench_now() + BENCH_DURATION_S + 1.5;
+	while(bench_now() < end)
+	{
+		SoAd_MainFunction();
+		DoIp_MainFunction();
+		dcm_main();
+		usleep(DOIP_MAINFUNCTION_PERIOD_TIME*1000);
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		waitpid(pid[i], &status, 0);
+		if((!WIFEXITED(status)) || (0 != WEXITSTATUS(status)))
+		{
+			failed = 1;
+		}
+	}
+	printf("dcm: %u served, %u busy, %u ovfl\n", dcmServed, dcmBusy, dcmOvfl);
+	if(benchOvfl && (0 == dcmOvfl))
+	{
+		printf("the large request is not refused by the Dcm\n");
+		failed = 1;
+	}
+
+	return failed ? 1 : 0;
+}
+#elif defined(__DOIP_BENCH_SOCKET__)
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+/* ============================ [ MACROS    ] ====================================================== */
+/* the request of 'ovfl', larger than the Dcm buffer */
+#define BENCH_OVFL_SIZE 6000
+#define BENCH_TA 0xfeed
+/* half of DOIP_GENERAL_INACTIVITY_TIMEOUT */
+#define BENCH_STALL_S 0.5
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+extern int benchPort;
+/* ============================ [ DATAS     ] ====================================================== */
+static const uint16_t benchSa[] = { 0xbeef, 0xbeee };
+/* ============================ [ LOCALS    ] ====================================================== */
+static int readn(int s, uint8_t* buf, int len)
+{
+	int got = 0;
+	int r;
+
+	while(got < len)
+	{
+		r = recv(s, buf+got, len-got, 0);
+		if(r <= 0)
+		{
+			return -1;
+		}
+		got += r;
+	}
+
+	return got;
+}
+
+/* returns the payload type, the payload in buf */
+static int read_message(int s, uint8_t* buf, uint32_t size)
+{
+	uint8_t header[8];
+	uint32_t len;
+
+	if(readn(s, header, 8) < 0)
+	{
+		return -1;
+	}
+	len = ((uint32_t)header[4]<<24) | ((uint32_t)header[5]<<16) | ((uint32_t)header[6]<<8) | header[7];
+	if((len > size) || (readn(s, buf, len) < 0))
+	{
+		return -1;
+	}
+
+	return (header[2]<<8) | header[3];
+}
+
+static int send_request(int s, uint16_t sa, uint8_t* req, int msgSize, uint8_t seq)
+{
+	uint32_t len = msgSize + 4;
+
+	req[0] = 2; req[1] = 0xfd; req[2] = 0x80; req[3] = 0x01;
+	req[4] = len>>24; req[5] = len>>16; req[6] = len>>8; req[7] = len;
+	req[8] = sa>>8; req[9] = sa; req[10] = BENCH_TA>>8; req[11] = BENCH_TA&0xff;
+	req[12] = 0x36; req[13] = seq;
+	memset(&req[14], seq, msgSize-2);
+
+	return (send(s, req, 12+msgSize, 0) == (12+msgSize)) ? 0 : -1;
+}
+
+static void alive_check_response(int s, uint16_t sa)
+{
+	uint8_t ac[10] = { 2, 0xfd, 0, 8, 0, 0, 0, 2, sa>>8, sa&0xff };
+
+	send(s, ac, sizeof(ac), 0);
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+int bench_tester(int id, int msgSize, int ovfl, int duration)
+{
+	struct sockaddr_in addr;
+	int s, t, on = 1;
+	uint16_t sa = benchSa[id];
+	uint8_t buf[64];
+	uint8_t* req = malloc(12 + BENCH_OVFL_SIZE);
+	uint8_t ra[8+7] = { 2, 0xfd, 0, 5, 0, 0, 0, 7, sa>>8, sa&0xff, 0xda, 0, 0, 0, 0 };
+	unsigned int done = 0, wrong = 0, nack = 0;
+	uint8_t seq = 0;
+	double start, t0, rtt, worst = 0;
+	int stalled = 0;
+	struct timeval tv;
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(benchPort);
+	if(connect(s, (struct sockaddr*)&addr, sizeof(addr)))
+	{
+		perror("connect");
+		return 1;
+	}
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	/* wake up to see a stall */
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	send(s, ra, sizeof(ra), 0);
+	t = read_message(s, buf, sizeof(buf));
+	if((0x0006 != t) || (0x10 != buf[4]))
+	{
+		printf("tester %04x: routing activation failed %04x %02x\n", sa, t, buf[4]);
+		return 1;
+	}
+
+	start = bench_now();
+	while((bench_now() - start) < duration)
+	{
+		if(ovfl && (1 == id) && (0 != seq))
+		{	/* idle after the large one, answering the alive check only */
+			if(0x0007 == read_message(s, buf, sizeof(buf)))
+			{
+				alive_check_response(s, sa);
+			}
+			continue;
+		}
+
+		t0 = bench_now();
+		if(0 != send_request(s, sa, req, (ovfl && (1 == id)) ? BENCH_OVFL_SIZE : msgSize, seq))
+		{
+			printf("tester %04x: send failed\n", sa);
+			break;
+		}
+		for(;;)
+		{
+			t = read_message(s, buf, sizeof(buf));
+			if(0x8003 == t)
+			{	/* diagnostic message NACK */
+				nack++;
+				break;
+			}
+			else if(0x8001 == t)
+			{
+				uint16_t ta = (buf[2]<<8) | buf[3];
+				if((ta != sa) || (0x76 != buf[4]) || (seq != buf[5])) wrong++; else done++;
+				break;
+			}
+			else if(0x0007 == t)
+			{
+				alive_check_response(s, sa);
+			}
+			else if((t < 0) && ((EAGAIN != errno) || ((bench_now() - t0) > duration)))
+			{
+				printf("tester %04x: %s\n", sa, (EAGAIN == errno) ? "no response" : "connection lost");
+				stalled = 1;
+				break;
+			}
+			else
+			{	/* the ack 0x8002 or the wait for the response goes on */
+			}
+		}
+		if(stalled) break;
+		rtt = bench_now() - t0;
+		if(rtt > worst) worst = rtt;
+		if(rtt > BENCH_STALL_S)
+		{
+			printf("tester %04x: stalled for %.0f ms\n", sa, rtt*1000);
+			stalled = 1;
+		}
+		seq++;
+	}
+
+	printf("tester %04x: %u responses, %u wrong, %u nack, %.1f KB/s, worst round trip %.0f ms\n",
+			sa, done, wrong, nack, done*(double)msgSize/1024/(bench_now() - start), worst*1000);
+	close(s);
+	free(req);
+
+	return (stalled || (wrong > 0) || ((0 == id) && (0 == done))) ? 1 : 0;
+}
+
+int SoAd_SocketCloseImpl(int s)
+{
+	return close(s);
+}
+
+int SoAd_SocketStatusCheckImpl(int s)
+{
+	(void)s;
+	return 0;
+}
+
+int SoAd_SendImpl(int s, const void *data, size_t size, int flags)
+{	/* the whole message, as lwip_send on a blocking write */
+	size_t sent = 0;
+	int r;
+	fd_set wfds;
+	(void)flags;
+
+	while(sent < size)
+	{
+		r = send(s, (const char*)data + sent, size - sent, MSG_NOSIGNAL);
+		if(r > 0)
+		{
+			sent += r;
+		}
+		else if((r < 0) && (EAGAIN == errno))
+		{
+			FD_ZERO(&wfds);
+			FD_SET(s, &wfds);
+			select(s+1, NULL, &wfds, NULL, NULL);
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	return (int)sent;
+}
+
+int SoAd_SendToImpl(int s, const void *data, size_t size, uint32_t RemoteIpAddress, uint16_t RemotePort)
+{
+	struct sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = RemoteIpAddress;
+	addr.sin_port = RemotePort;
+
+	return sendto(s, data, size, 0, (struct sockaddr*)&addr, sizeof(addr));
+}
+
+int SoAd_CreateSocketImpl(int domain, int type, int protocol)
+{	/* SOCK_STREAM and MSG_PEEK of SoAd_Types.h have the values of linux */
+	int on = 1;
+	int s = socket(AF_INET, type, protocol);
+	(void)domain;
+
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	return s;
+}
+
+int SoAd_BindImpl(int s, uint16_t SocketLocalPort, char* SocketLocalIpAddress)
+{	/* all on the bench port of the loopback */
+	struct sockaddr_in addr;
+	(void)SocketLocalPort;
+	(void)SocketLocalIpAddress;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(benchPort);
+
+	return bind(s, (struct sockaddr*)&addr, sizeof(addr));
+}
+
+int SoAd_ListenImpl(int s, int backlog)
+{
+	fcntl(s, F_SETFL, O_NONBLOCK);
+	return listen(s, backlog);
+}
+
+int SoAd_AcceptImpl(int s, uint32_t *RemoteIpAddress, uint16_t *RemotePort)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int on = 1;
+	int c = accept(s, (struct sockaddr*)&addr, &len);
+
+	if(c >= 0)
+	{
+		fcntl(c, F_SETFL, O_NONBLOCK);
+		setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		*RemoteIpAddress = addr.sin_addr.s_addr;
+		*RemotePort = addr.sin_port;
+	}
+
+	return c;
+}
+
+int SoAd_RecvImpl(int s, void *mem, size_t len, int flags)
+{
+	return recv(s, mem, len, flags);
+}
+
+int SoAd_RecvFromImpl(int s, void *mem, size_t len, int flags, uint32_t *RemoteIpAddress, uint16_t *RemotePort)
+{
+	struct sockaddr_in addr;
+	socklen_t alen = sizeof(addr);
+	int n = recvfrom(s, mem, len, flags, (struct sockaddr*)&addr, &alen);
+
+	if(n > 0)
+	{
+		*RemoteIpAddress = addr.sin_addr.s_addr;
+		*RemotePort = addr.sin_port;
+	}
+
+	return n;
+}
+
+int SoAd_SelectImpl(int maxfdp1, fd_set *readset)
+{
+	struct timeval tv = { 0, 0 };
+
+	return select(maxfdp1, readset, NULL, NULL, &tv);
+}
+#endif /* __DOIP_BENCH__ */
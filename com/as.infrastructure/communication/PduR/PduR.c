@@ -71,6 +71,7 @@ void PduR_Init (const PduR_PBConfigType* ConfigPtr) {
 		//uint8 failed = 0;
 
 		// Initialize buffers.
+		PduR_ARC_InitTpBuffers();
 
 		/*if (failed) {
 			// TODO Report PDUR_E_INIT_FAILED to Dem.
@@ -24,6 +24,7 @@
 #include "PduR.h"
 
 #include <string.h>
+#include "Os.h"
 #include "asdebug.h"
 #if defined(USE_DET)
 #include "Det.h"
@@ -31,6 +32,9 @@
 #if defined(USE_DEM)
 #include "Dem.h"
 #endif
+#ifdef USE_SHELL
+#include "shell.h"
+#endif
 
 #if PDUR_ZERO_COST_OPERATION == STD_OFF
 
@@ -40,6 +44,81 @@
 #define HAS_BUFFER_STATUS(_pduId, _status)  (_pduId < PDUR_N_TP_ROUTES_WITH_BUFFER && PduRTpRouteBuffer(_pduId) != NULL && PduRTpRouteBuffer(_pduId)->status == _status)
 #define REPORT_BUFFER_ERROR(_serviceId) PDUR_DET_REPORTERROR(MODULE_ID_PDUR, PDUR_INSTANCE_ID, _serviceId, PDUR_E_BUFFER_ERROR);
 
+#define AS_LOG_PDUR 0
+
+typedef struct {
+	uint32 allocations;
+	uint32 waits;     /* BUFREQ_BUSY: a big enough buffer exists but is in use */
+	uint32 overflows; /* BUFREQ_OVFL: no buffer is big enough */
+	uint32 requested; /* bytes requested by the allocations */
+	uint32 allocated; /* bytes of the buffers given to them */
+} PduR_TpBufferStatisticsType;
+
+static PduR_TpBufferStatisticsType PduR_TpBufferStatistics;
+
+#ifdef USE_SHELL
+static int shellPduRTp(int argc, char *argv[]);
+static SHELL_CONST ShellCmdT cmdPduRTp  = {
+	shellPduRTp,
+	0,1,
+	"pdurtp",
+	"pdurtp [reset]",
+	"show the PduR TP buffers and the statistics of their allocations\n",
+	{NULL,NULL}
+};
+SHELL_CMD_EXPORT(cmdPduRTp)
+#endif
+
+void PduR_ARC_InitTpBuffers(void) {
+	memset(&PduR_TpBufferStatistics, 0, sizeof(PduR_TpBufferStatistics));
+#if defined(USE_SHELL) && !defined(USE_SHELL_SYMTAB)
+	SHELL_AddCmd(&cmdPduRTp);
+#endif
+}
+
+/*
+ * Best fit of the TP buffers for the route PduId, its reserved buffers are preferred.
+ * Gives BUFREQ_BUSY if a buffer big enough is in use, or else BUFREQ_OVFL.
+ */
+static BufReq_ReturnType PduR_ARC_FindTpBuffer(PduIdType PduId, PduLengthType size, uint8 *index) {
+	BufReq_ReturnType retVal = BUFREQ_OVFL;
+	PduRTpBufferInfo_type *best = NULL;
+	PduRTpBufferInfo_type *buffer;
+	PduIdType reserved = PDUR_TP_BUFFER_RESERVED(PduId);
+	uint8 i;
+
+	for (i = 0; i < PDUR_N_TP_BUFFERS; i++) {
+		buffer = PduRTpBuffer(i);
+		if (((buffer->reservedRoute == reserved) || (buffer->reservedRoute == PDUR_TP_BUFFER_SHARED))
+				&& (buffer->bufferSize >= size)
+				&& (buffer->status != PDUR_BUFFER_NOT_ALLOCATED_FROM_UP_MODULE)
+				&& (buffer->status != PDUR_BUFFER_ALLOCATED_FROM_UP_MODULE)) {
+			if (buffer->status != PDUR_BUFFER_FREE) {
+				retVal = BUFREQ_BUSY;
+			} else if ((best == NULL)
+					|| ((buffer->reservedRoute == reserved) && (best->reservedRoute != reserved))
+					|| ((buffer->reservedRoute == best->reservedRoute) && (buffer->bufferSize < best->bufferSize))) {
+				best = buffer;
+				*index = i;
+			} else {
+				/* a worse fit */
+			}
+		}
+	}
+
+	if (best != NULL) {
+		retVal = BUFREQ_OK;
+		PduR_TpBufferStatistics.allocations++;
+		PduR_TpBufferStatistics.requested += size;
+		PduR_TpBufferStatistics.allocated += best->bufferSize;
+	} else if (retVal == BUFREQ_BUSY) {
+		PduR_TpBufferStatistics.waits++;
+	} else {
+		PduR_TpBufferStatistics.overflows++;
+	}
+	return retVal;
+}
+
 BufReq_ReturnType PduR_ARC_AllocateUpRxBuffer(PduIdType PduId, PduInfoType** PduInfoPtr) {
 	BufReq_ReturnType retVal = BUFREQ_BUSY;
 	uint8 i;
@@ -57,20 +136,13 @@ BufReq_ReturnType PduR_ARC_AllocateUpRxBuffer(PduIdType PduId, PduInfoType** Pdu
 
 
 BufReq_ReturnType PduR_ARC_AllocateRxBuffer(PduIdType PduId, PduLengthType TpSduLength) {
-	BufReq_ReturnType retVal = BUFREQ_BUSY;
+	BufReq_ReturnType retVal;
 	uint8 i;
-	for (i = 0; i < PDUR_N_TP_BUFFERS; i++) {
-		if (PduRTpBuffer(i)->status == PDUR_BUFFER_FREE) {
-			if (PduRTpBuffer(i)->bufferSize < TpSduLength) {
-				retVal = BUFREQ_OVFL;
-			} else {
-				PduRTpRouteBuffer(PduId) = PduRTpBuffer(i);
-				PduRTpBuffer(i)->pduInfoPtr->SduLength = TpSduLength;
-				PduRTpRouteBuffer(PduId)->status = PDUR_BUFFER_RX_BUSY;
-				retVal = BUFREQ_OK;
-				break;
-			}
-		}
+	retVal = PduR_ARC_FindTpBuffer(PduId, TpSduLength, &i);
+	if (retVal == BUFREQ_OK) {
+		PduRTpRouteBuffer(PduId) = PduRTpBuffer(i);
+		PduRTpBuffer(i)->pduInfoPtr->SduLength = TpSduLength;
+		PduRTpRouteBuffer(PduId)->status = PDUR_BUFFER_RX_BUSY;
 	}
 	return retVal;
 }
@@ -123,6 +195,180 @@ BufReq_ReturnType PduR_ARC_ReleaseTxBuffer(PduIdType PduId) {
 	return retVal;
 }
 
+/*
+ * Routing on the fly(cut-through) of TP gateway routes.
+ *
+ * A route with one TP destination and a TpChunkSize less than the N-SDU length starts the
+ * destination TP once TpChunkSize bytes have been received, then the data streams through
+ * the TP buffer used as a ring. A full ring stalls the source TP by BUFREQ_BUSY(flow control
+ * WAIT on CanTp) and an empty ring stalls the destination TP the same way.
+ * SoAdTp sources want the whole N-SDU in one buffer, they are stored and forwarded.
+ */
+static boolean PduR_ARC_IsCutThrough(PduIdType PduId, PduLengthType TpSduLength) {
+	const PduRRoutingPath_type *route = PduRConfig->RoutingPaths[PduId];
+	boolean retVal = FALSE;
+
+	if ((PduId < PDUR_N_TP_ROUTES_WITH_BUFFER) && (route->TpChunkSize > 0) && (route->TpChunkSize < TpSduLength)
+			&& (route->SrcModule != ARC_PDUR_SOADTP)
+			&& (route->PduRDestPdus[0] != NULL) && (route->PduRDestPdus[1] == NULL)
+			&& PduR_IsTpModule(route->PduRDestPdus[0]->DestModule)) {
+		retVal = TRUE;
+	}
+	return retVal;
+}
+
+static BufReq_ReturnType PduR_ARC_AllocateCutThroughBuffer(PduIdType PduId, PduLengthType TpSduLength) {
+	BufReq_ReturnType retVal;
+	uint8 i;
+	/* the ring needs to hold the bytes received before the destination TP is started */
+	retVal = PduR_ARC_FindTpBuffer(PduId, PduRConfig->RoutingPaths[PduId]->TpChunkSize, &i);
+	if (retVal == BUFREQ_OK) {
+		PduRTpBufferInfo_type *buffer = PduRTpBuffer(i);
+		PduRTpRouteBuffer(PduId) = buffer;
+		buffer->status = PDUR_BUFFER_CUT_THROUGH;
+		buffer->rxChunk.SduLength = 0;
+		buffer->txChunk.SduLength = 0;
+		buffer->total = TpSduLength;
+		buffer->rxCount = 0;
+		buffer->rxRemain = TpSduLength;
+		buffer->head = 0;
+		buffer->tail = 0;
+		buffer->free = buffer->bufferSize;
+		buffer->ready = 0;
+		buffer->txStarted = FALSE;
+		buffer->rxDone = FALSE;
+		buffer->txDone = FALSE;
+		buffer->aborted = FALSE;
+		buffer->startTick = GetOsTick();
+	}
+	return retVal;
+}
+
+static void PduR_ARC_CutThroughRelease(PduIdType PduId) {
+	PduRTpBufferInfo_type *buffer = PduRTpRouteBuffer(PduId);
+	if (buffer->rxDone && buffer->txDone) {
+		ASLOG(PDUR, ("gateway %d: %d bytes in %d ticks%s\n", PduId, buffer->total,
+				GetOsElapsedTick(buffer->startTick), buffer->aborted ? ", aborted" : ""));
+		buffer->status = PDUR_BUFFER_FREE;
+		PduRTpRouteBuffer(PduId) = NULL;
+	}
+}
+
+static void PduR_ARC_CutThroughCommit(PduIdType PduId, PduLengthType length) {
+	const PduRRoutingPath_type *route = PduRConfig->RoutingPaths[PduId];
+	PduRTpBufferInfo_type *buffer = PduRTpRouteBuffer(PduId);
+
+	buffer->ready += length;
+	buffer->rxCount += length;
+	buffer->rxChunk.SduLength = 0;
+
+	if ((!buffer->txStarted) && (!buffer->aborted)
+			&& ((buffer->rxCount >= route->TpChunkSize) || (buffer->rxCount >= buffer->total))) {
+		PduInfoType pduInfo;
+		pduInfo.SduDataPtr = NULL;
+		pduInfo.SduLength = buffer->total;
+		buffer->txStarted = TRUE;
+		if (PduR_ARC_RouteTransmit(route->PduRDestPdus[0], &pduInfo) != E_OK) {
+			buffer->aborted = TRUE;
+			buffer->txDone = TRUE;
+		}
+	}
+}
+
+static BufReq_ReturnType PduR_ARC_CutThroughProvideRxBuffer(PduIdType PduId, PduInfoType** PduInfoPtr) {
+	BufReq_ReturnType retVal;
+	PduRTpBufferInfo_type *buffer = PduRTpRouteBuffer(PduId);
+	uint16 length;
+
+	/* the source TP asks for the next chunk once the previous one is full */
+	PduR_ARC_CutThroughCommit(PduId, buffer->rxChunk.SduLength);
+
+	if (buffer->aborted) {
+		retVal = BUFREQ_NOT_OK;
+	} else if (buffer->rxDone) {
+		/* next N-SDU while the previous one is still being transmitted */
+		retVal = BUFREQ_BUSY;
+	} else {
+		length = buffer->bufferSize - buffer->head;
+		if (length > buffer->free) {
+			length = buffer->free;
+		}
+		if (length > buffer->rxRemain) {
+			length = buffer->rxRemain;
+		}
+
+		if (0 == length) {
+			retVal = BUFREQ_BUSY;
+		} else {
+			buffer->rxChunk.SduDataPtr = &buffer->pduInfoPtr->SduDataPtr[buffer->head];
+			buffer->rxChunk.SduLength = length;
+			buffer->head = (buffer->head + length) % buffer->bufferSize;
+			buffer->free -= length;
+			buffer->rxRemain -= length;
+			*PduInfoPtr = &buffer->rxChunk;
+			retVal = BUFREQ_OK;
+		}
+	}
+	return retVal;
+}
+
+static void PduR_ARC_CutThroughRxIndication(PduIdType PduId, NotifResultType Result) {
+	PduRTpBufferInfo_type *buffer = PduRTpRouteBuffer(PduId);
+
+	if (Result == NTFRSLT_OK) {
+		/* the last chunk holds the rest of the N-SDU */
+		PduR_ARC_CutThroughCommit(PduId, buffer->total - buffer->rxCount);
+	} else {
+		buffer->aborted = TRUE;
+		if (!buffer->txStarted) {
+			buffer->txDone = TRUE;
+		}
+	}
+	buffer->rxDone = TRUE;
+	PduR_ARC_CutThroughRelease(PduId);
+}
+
+static BufReq_ReturnType PduR_ARC_CutThroughProvideTxBuffer(PduIdType PduId, PduInfoType** PduInfoPtr) {
+	BufReq_ReturnType retVal;
+	PduRTpBufferInfo_type *buffer = PduRTpRouteBuffer(PduId);
+	uint16 length;
+
+	/* the destination TP asks for the next chunk once the previous one is sent */
+	buffer->free += buffer->txChunk.SduLength;
+	buffer->txChunk.SduLength = 0;
+
+	if (buffer->aborted) {
+		retVal = BUFREQ_NOT_OK;
+	} else {
+		length = buffer->bufferSize - buffer->tail;
+		if (length > buffer->ready) {
+			length = buffer->ready;
+		}
+
+		if (0 == length) {
+			retVal = BUFREQ_BUSY;
+		} else {
+			buffer->txChunk.SduDataPtr = &buffer->pduInfoPtr->SduDataPtr[buffer->tail];
+			buffer->txChunk.SduLength = length;
+			buffer->tail = (buffer->tail + length) % buffer->bufferSize;
+			buffer->ready -= length;
+			*PduInfoPtr = &buffer->txChunk;
+			retVal = BUFREQ_OK;
+		}
+	}
+	return retVal;
+}
+
+static void PduR_ARC_CutThroughTxConfirmation(PduIdType PduId, uint8 result) {
+	PduRTpBufferInfo_type *buffer = PduRTpRouteBuffer(PduId);
+
+	if (result != NTFRSLT_OK) {
+		buffer->aborted = TRUE;
+	}
+	buffer->txDone = TRUE;
+	PduR_ARC_CutThroughRelease(PduId);
+}
+
 Std_ReturnType PduR_ARC_Transmit(PduIdType PduId, const PduInfoType* PduInfo, uint8 serviceId) {
 	Std_ReturnType retVal = E_OK;
 	uint8 i;
@@ -235,7 +481,10 @@ void PduR_ARC_TpRxIndication(PduIdType PduId, NotifResultType Result, uint8 serv
 	PDUR_VALIDATE_INITIALIZED_NORV(serviceId);
 	PDUR_VALIDATE_PDUID_NORV(serviceId, PduId);
 
-	if (Result != NTFRSLT_OK) {
+	if (HAS_BUFFER_STATUS(PduId, PDUR_BUFFER_CUT_THROUGH)) {
+		PduR_ARC_CutThroughRxIndication(PduId, Result);
+
+	} else if (Result != NTFRSLT_OK) {
 		// There was an error in the lower layer while receiving the PDU.
 		// Release any buffers and notify upper layers
 		PduR_ARC_ReleaseRxBuffer(PduId);
@@ -314,6 +563,9 @@ void PduR_ARC_TxConfirmation(PduIdType PduId, uint8 result, uint8 serviceId) {
 	if (PduR_IsUpModule(route->SrcModule)) {
 		PduR_ARC_RouteTxConfirmation(route, result);
 
+	} else if (PduR_IsLoModule(route->SrcModule) && HAS_BUFFER_STATUS(PduId, PDUR_BUFFER_CUT_THROUGH)) {
+		PduR_ARC_CutThroughTxConfirmation(PduId, result);
+
 	} else if (PduR_IsLoModule(route->SrcModule) && HAS_BUFFER_STATUS(PduId, PDUR_BUFFER_TX_BUSY)) {
 		PduRTpRouteBuffer(PduId)->nAcc++;
 
@@ -380,6 +632,16 @@ BufReq_ReturnType PduR_ARC_ProvideRxBuffer(PduIdType PduId, PduLengthType TpSduL
 			retVal = PduR_ARC_AllocateUpRxBuffer(PduId, PduInfoPtr);
 		}
 
+	} else if (HAS_BUFFER_STATUS(PduId, PDUR_BUFFER_CUT_THROUGH)) {
+		retVal = PduR_ARC_CutThroughProvideRxBuffer(PduId, PduInfoPtr);
+
+	} else if (PduR_IsLoModule(destination->DestModule) && PduR_ARC_IsCutThrough(PduId, TpSduLength)
+			&& (PduRTpRouteBuffer(PduId) == NULL)) {
+		retVal = PduR_ARC_AllocateCutThroughBuffer(PduId, TpSduLength);
+		if (retVal == BUFREQ_OK) {
+			retVal = PduR_ARC_CutThroughProvideRxBuffer(PduId, PduInfoPtr);
+		}
+
 	} else if (PduR_IsLoModule(destination->DestModule)) {
 		if (PduR_ARC_ReleaseRxBuffer(PduId) == BUFREQ_BUSY) {
 			// Transmit previous rx buffer
@@ -397,7 +659,7 @@ BufReq_ReturnType PduR_ARC_ProvideRxBuffer(PduIdType PduId, PduLengthType TpSduL
 	} else {
 		retVal = BUFREQ_NOT_OK;
 	}
-	if (retVal != BUFREQ_OK) REPORT_BUFFER_ERROR(serviceId);
+	if ((retVal != BUFREQ_OK) && !HAS_BUFFER_STATUS(PduId, PDUR_BUFFER_CUT_THROUGH)) REPORT_BUFFER_ERROR(serviceId);
 	return retVal;
 }
 
@@ -412,6 +674,9 @@ BufReq_ReturnType PduR_ARC_ProvideTxBuffer(PduIdType PduId, PduInfoType** PduInf
 	if (PduR_IsUpModule(route->SrcModule)) {
 		retVal = PduR_ARC_RouteProvideTxBuffer(route, Length, PduInfoPtr);
 
+	} else if (PduR_IsLoModule(route->SrcModule) && HAS_BUFFER_STATUS(PduId, PDUR_BUFFER_CUT_THROUGH)) {
+		retVal = PduR_ARC_CutThroughProvideTxBuffer(PduId, PduInfoPtr);
+
 	} else if (PduR_IsLoModule(route->SrcModule)) {
 		retVal = PduR_ARC_AllocateTxBuffer(PduId, Length);
 		if (retVal == BUFREQ_OK) {
@@ -425,6 +690,30 @@ BufReq_ReturnType PduR_ARC_ProvideTxBuffer(PduIdType PduId, PduInfoType** PduInf
 }
 
 
+#ifdef USE_SHELL
+static int shellPduRTp(int argc, char *argv[]) {
+	uint8 i;
+	PduIdType route;
+
+	if ((argc == 2) && (0 == strcmp(argv[1], "reset"))) {
+		memset(&PduR_TpBufferStatistics, 0, sizeof(PduR_TpBufferStatistics));
+	} else {
+		SHELL_printf("buffer  size  reserved  status  route\n");
+		for (i = 0; i < PDUR_N_TP_BUFFERS; i++) {
+			for (route = 0; (route < PDUR_N_TP_ROUTES_WITH_BUFFER) && (PduRTpRouteBuffer(route) != PduRTpBuffer(i)); route++);
+			SHELL_printf("%6d %5d  %8d  %6d  %5d\n", i, PduRTpBuffer(i)->bufferSize,
+					(int)PduRTpBuffer(i)->reservedRoute - 1,
+					PduRTpBuffer(i)->status, (route < PDUR_N_TP_ROUTES_WITH_BUFFER) ? route : -1);
+		}
+		SHELL_printf("allocations %d, waits %d, overflows %d, fill %d%%\n",
+				PduR_TpBufferStatistics.allocations, PduR_TpBufferStatistics.waits,
+				PduR_TpBufferStatistics.overflows,
+				(PduR_TpBufferStatistics.allocated > 0) ?
+						(int)((uint64)PduR_TpBufferStatistics.requested * 100 / PduR_TpBufferStatistics.allocated) : 100);
+	}
+	return 0;
+}
+#endif
 
 #endif
 
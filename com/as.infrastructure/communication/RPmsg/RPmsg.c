@@ -99,37 +99,48 @@ void RPmsg_RxNotification(RPmsg_PortType port)
 	RPmsg_HandlerType* msg;
 	Std_ReturnType ercd;
 	RPmsg_ChannelType chl;
+	uint32 count = 0;
 	const RPmsg_PortConfigType* portConfig;
 	asAssert(rpmsg.initialized);
 	asAssert(port < RPMSG_PORT_NUM);
 
 	portConfig = &(rpmsg.config->portConfig[port]);
 
-	ercd = VirtQ_GetAvailiableBuffer(portConfig->rxChl,&idx,(void**)&msg,&length);
-	if(E_OK == ercd)
+	/* one notification may stand for several messages, consume all of them and
+	 * give them back by one kick */
+	do
 	{
-		ASLOG(RPMSG, ("RPmsg rx(dst=%Xh, src=%Xh, data=%Xh, len=%d/%d)\n", msg->dst, msg->src, (uint32)msg->data, msg->len, length));
-		for(chl=0;chl<RPMSG_CHL_NUM;chl++)
+		ercd = VirtQ_GetAvailiableBuffer(portConfig->rxChl,&idx,(void**)&msg,&length);
+		if(E_OK == ercd)
 		{
-			if( (portConfig==rpmsg.config->chlConfig[chl].portConfig) &&
-				(portConfig->port == msg->dst) &&
-				(msg->src==rpmsg.config->chlConfig[chl].dst) )
+			ASLOG(RPMSG, ("RPmsg rx(dst=%Xh, src=%Xh, data=%Xh, len=%d/%d)\n", msg->dst, msg->src, (uint32)msg->data, msg->len, length));
+			for(chl=0;chl<RPMSG_CHL_NUM;chl++)
 			{
-				break;
+				if( (portConfig==rpmsg.config->chlConfig[chl].portConfig) &&
+					(portConfig->port == msg->dst) &&
+					(msg->src==rpmsg.config->chlConfig[chl].dst) )
+				{
+					break;
+				}
 			}
-		}
 
-		if(chl<RPMSG_CHL_NUM)
-		{
-			rpmsg.config->chlConfig[chl].rxNotification(chl,msg->data,msg->len);
-		}
-		else
-		{
-			/* ignore invalid message */
-			ASWARNING(("RPMSG: invalid message, ignore it\n"));
+			if(chl<RPMSG_CHL_NUM)
+			{
+				rpmsg.config->chlConfig[chl].rxNotification(chl,msg->data,msg->len);
+			}
+			else
+			{
+				/* ignore invalid message */
+				ASWARNING(("RPMSG: invalid message, ignore it\n"));
+			}
+
+			VirtQ_AddUsedBuffer(portConfig->rxChl, idx, length);
+			count++;
 		}
+	} while(E_OK == ercd);
 
-		VirtQ_AddUsedBuffer(portConfig->rxChl, idx, length);
+	if(count > 0)
+	{
 		VirtQ_Kick(portConfig->rxChl);
 	}
 	else
@@ -16,8 +16,19 @@
 #include "VirtQ.h"
 #include "Ipc.h"
 #include "asdebug.h"
+#ifdef USE_SHELL
+#include "shell.h"
+#endif
 /* ============================ [ MACROS    ] ====================================================== */
 #define AS_LOG_VIRTQ 0
+
+/* The other side runs in another thread or on another core, the ring entries
+ * must be visible before the index which publishes them, and the other way round. */
+#if defined(__GNUC__)
+#define virtq_mb() __sync_synchronize()
+#else
+#define virtq_mb()
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct
 {
@@ -26,24 +37,48 @@ typedef struct
 	boolean initialized;
 }virtq_t;
 /* ============================ [ DECLARES  ] ====================================================== */
+#ifdef USE_SHELL
+static int shellVirtQ(int argc, char *argv[]);
+#endif
 /* ============================ [ DATAS     ] ====================================================== */
 static virtq_t virtq =
 {
 	.initialized = FALSE
 };
+#ifdef USE_SHELL
+static SHELL_CONST ShellCmdT cmdVirtQ  = {
+		shellVirtQ,
+		0,0,
+		"virtq",
+		"virtq",
+		"show the buffers handled and the kicks sent per virtqueue since the last call\n",
+		{NULL,NULL}
+};
+SHELL_CMD_EXPORT(cmdVirtQ)
+#endif
 /* ============================ [ LOCALS    ] ====================================================== */
 static void *virtqueue_get_avail_buf(VirtQ_QueueType *vq, VirtQ_IdxType *idx, uint16 *len)
 {
 	void* buf;
 
-	if (vq->last_avail_idx == vq->vring.avail->idx) {
+	if ((uint16)vq->last_avail_idx == vq->vring.avail->idx) {
 		/* We need to know about added buffers */
-		vq->vring.used->flags &= ~VRING_USED_F_NO_NOTIFY;
+		if (vq->event_idx) {
+			vring_avail_event(&vq->vring) = (uint16)vq->last_avail_idx;
+		} else {
+			vq->vring.used->flags &= ~VRING_USED_F_NO_NOTIFY;
+		}
+		/* the other side may have added one before it saw the request */
+		virtq_mb();
+	}
 
+	if ((uint16)vq->last_avail_idx == vq->vring.avail->idx) {
 		buf = NULL;
 	}
 	else
 	{
+		/* read the ring entry after the index which published it */
+		virtq_mb();
 		/*
 		 * Grab the next descriptor number they're advertising, and increment
 		 * the index we've seen.
@@ -73,7 +108,10 @@ static void virtqueue_set_used_buf(VirtQ_QueueType *vq, VirtQ_IdxType idx, uint3
 		used->id = idx;
 		used->len = len;
 
+		/* the entry must be visible before the index */
+		virtq_mb();
 		vq->vring.used->idx++;
+		vq->buffers++;
 	}
 }
 /* ============================ [ FUNCTIONS ] ====================================================== */
@@ -86,6 +124,15 @@ void VirtQ_InitVq(VirtQ_ChannerlType chl)
 			);
 
 	virtq.vq[chl].last_avail_idx = 0;
+	virtq.vq[chl].last_kick_idx = 0;
+	virtq.vq[chl].event_idx = FALSE;
+	if (NULL != virtq.config->queueConfig[chl].features)
+	{
+		if ((*virtq.config->queueConfig[chl].features) & (1 << VIRTIO_RING_F_EVENT_IDX))
+		{
+			virtq.vq[chl].event_idx = TRUE;
+		}
+	}
 }
 Std_ReturnType VirtQ_GetAvailiableBuffer(VirtQ_ChannerlType chl,VirtQ_IdxType* idx,void** buf,uint16* len)
 {
@@ -118,14 +165,37 @@ void VirtQ_AddUsedBuffer(VirtQ_ChannerlType chl,VirtQ_IdxType idx,uint16 len)
 	virtqueue_set_used_buf(&virtq.vq[chl],idx,len);
 }
 
+/*
+ * Kick the other side about the used buffers added since the last kick, so several
+ * buffers are handed over by one kick. With EVENT_IDX the other side is kicked only
+ * if it has consumed all the used buffers it was kicked for before.
+ */
 void VirtQ_Kick(VirtQ_ChannerlType chl)
 {
-	if (virtq.vq[chl].vring.avail->flags & VRING_AVAIL_F_NO_INTERRUPT) {
-		/* do nothing */
+	VirtQ_QueueType *vq = &virtq.vq[chl];
+	uint16 new_idx;
+	uint16 old_idx;
+	boolean needed;
+
+	/* the used index must be visible before the event index is read */
+	virtq_mb();
+
+	new_idx = vq->vring.used->idx;
+	old_idx = vq->last_kick_idx;
+	vq->last_kick_idx = new_idx;
+
+	if (vq->event_idx) {
+		needed = vring_need_event(vring_used_event(&vq->vring), new_idx, old_idx);
+	} else if (vq->vring.avail->flags & VRING_AVAIL_F_NO_INTERRUPT) {
+		needed = FALSE;
+	} else {
+		needed = (new_idx != old_idx);
 	}
-	else
+
+	if (needed)
 	{
 		/* trigger IPC interrupt */
+		vq->kicks++;
 		Ipc_WriteIdx(virtq.config->queueConfig[chl].chl,virtq.config->queueConfig[chl].vring->notifyid);
 	}
 }
@@ -135,6 +205,9 @@ void VirtQ_Init(const VirtQ_ConfigType *config)
 	{
 		virtq.config = config;
 		virtq.initialized = TRUE;
+#if defined(USE_SHELL) && !defined(USE_SHELL_SYMTAB)
+		SHELL_AddCmd(&cmdVirtQ);
+#endif
 	}
 	else
 	{
@@ -155,3 +228,21 @@ void VirtQ_TxConfirmation(VirtQ_ChannerlType chl)
 {
 	(void)chl;
 }
+#ifdef USE_SHELL
+static int shellVirtQ(int argc, char *argv[])
+{
+	VirtQ_ChannerlType chl;
+	(void)argc; (void)argv;
+
+	SHELL_printf("virtq event_idx buffers kicks\n");
+	for(chl = 0; chl < VIRTQ_CHL_NUM; chl++)
+	{
+		SHELL_printf("%5d %9d %7d %5d\n", chl, virtq.vq[chl].event_idx,
+				virtq.vq[chl].buffers, virtq.vq[chl].kicks);
+		virtq.vq[chl].buffers = 0;
+		virtq.vq[chl].kicks = 0;
+	}
+
+	return 0;
+}
+#endif
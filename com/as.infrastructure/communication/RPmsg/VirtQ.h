@@ -36,6 +36,15 @@ typedef struct virtqueue
     /* Last available index */
     VirtQ_IdxType           last_avail_idx;
 
+    /* VIRTIO_RING_F_EVENT_IDX negotiated */
+    boolean                 event_idx;
+    /* used->idx when the other side was kicked the last time */
+    uint16                  last_kick_idx;
+
+    /* statistics */
+    uint32                  buffers;
+    uint32                  kicks;
+
 }VirtQ_QueueType;
 
 typedef struct
@@ -48,6 +57,9 @@ typedef struct
 
 	Rproc_ReseouceVdevVringType* vring;
 
+	/* The features negotiated with the other side(can be NULL) */
+	const uint32*               features;
+
 }VirtQ_QueueConfigType;
 
 typedef struct
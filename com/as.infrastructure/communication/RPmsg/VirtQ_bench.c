@@ -0,0 +1,242 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifdef __VIRTQ_BENCH__
+/* Kicks per frame of the VirtQ notification: the ECU side puts a CAN frame sized message
+ * into the used ring at the given rate, as RPmsg does for the frames received from the bus,
+ * and a driver thread, the Qt front-end of as.virtual, takes them back to the avail ring as
+ * the virtio driver does, waking up by Ipc_WriteIdx only. The result is the kicks per frame
+ * and the latency from the used ring to the driver, with or without VIRTIO_RING_F_EVENT_IDX.
+ * Build and run on a 64 bit linux(the ring addresses are 32 bit, so mapped below 4GB):
+ *   cd com && gcc -O2 -D__VIRTQ_BENCH__ -Ias.infrastructure/include \
+ *     -Ias.infrastructure/communication/RPmsg -Ias.infrastructure/arch/posix/mcal \
+ *     -Ias.application/board.posix/common -Ias.application/common/config \
+ *     as.infrastructure/communication/RPmsg/VirtQ_bench.c \
+ *     as.infrastructure/communication/RPmsg/VirtQ.c -o virtq_bench -lpthread
+ *   ./virtq_bench 0 10000; ./virtq_bench 1 10000
+ *   ./virtq_bench 0 100000; ./virtq_bench 1 100000 */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "VirtQ.h"
+#include "Ipc.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_VRING_NUM   256
+#define BENCH_VRING_ALIGN 4096
+/* a CAN FD frame with the RPmsg header */
+#define BENCH_BUFFER_SIZE 96
+/* busy loops of the driver for each frame, the handling on the Qt side */
+#define BENCH_DRIVER_WORK 2000
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static pthread_mutex_t benchLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t benchEvent = PTHREAD_COND_INITIALIZER;
+static int benchPending = 0;
+static volatile int benchStop = 0;
+static unsigned long benchKicks = 0;
+
+static uint32 benchFeatures;
+static Rproc_ReseouceVdevVringType benchVring = { 0, BENCH_VRING_ALIGN, BENCH_VRING_NUM, 1, 0 };
+static const VirtQ_QueueConfigType benchQueue[1] = {
+	{
+		.chl = 0,
+		.handler = 0,
+		.rxNotification = NULL,
+		.vring = &benchVring,
+		.features = &benchFeatures
+	}
+};
+static const VirtQ_ConfigType benchConfig = { benchQueue };
+
+/* the driver view of the ring */
+static Vring_Type benchDriverVring;
+static uint16 benchLastUsed = 0;
+static double benchLatencySum = 0;
+static double benchLatencyMax = 0;
+static unsigned long benchFrames = 0;
+/* ============================ [ LOCALS    ] ====================================================== */
+static double bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+static void* bench_alloc(size_t size)
+{
+	void* p = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_32BIT, -1, 0);
+	if(MAP_FAILED == p)
+	{
+		perror("mmap");
+		exit(-1);
+	}
+	memset(p, 0, size);
+	return p;
+}
+
+static void* bench_driver(void* param)
+{
+	int eventIdx = benchFeatures & (1<<VIRTIO_RING_F_EVENT_IDX);
+	Vring_Type* vr = &benchDriverVring;
+	Vring_UsedElemType* used;
+	double stamp, latency;
+	volatile int work;
+	(void)param;
+
+	while(!benchStop)
+	{
+		pthread_mutex_lock(&benchLock);
+		while((0 == benchPending) && (!benchStop))
+		{
+			pthread_cond_wait(&benchEvent, &benchLock);
+		}
+		benchPending = 0;
+		pthread_mutex_unlock(&benchLock);
+
+		for(;;)
+		{
+			if(benchLastUsed == vr->used->idx)
+			{	/* ask for the next kick, then check again for the one put meanwhile */
+				if(eventIdx)
+				{
+					vring_used_event(vr) = benchLastUsed;
+				}
+				else
+				{
+					vr->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+				}
+				__sync_synchronize();
+				if(benchLastUsed == vr->used->idx)
+				{
+					break;
+				}
+			}
+			__sync_synchronize();
+			used = &vr->used->ring[benchLastUsed%BENCH_VRING_NUM];
+			benchLastUsed++;
+			memcpy(&stamp, (void*)(unsigned long)vr->desc[used->id].addr, sizeof(stamp));
+			latency = bench_now() - stamp;
+			benchLatencySum += latency;
+			if(latency > benchLatencyMax)
+			{
+				benchLatencyMax = latency;
+			}
+			benchFrames++;
+			for(work = 0; work < BENCH_DRIVER_WORK; work++);
+
+			vr->avail->ring[vr->avail->idx%BENCH_VRING_NUM] = used->id;
+			__sync_synchronize();
+			vr->avail->idx++;
+		}
+	}
+
+	return NULL;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+unsigned long as_phys_to_virt(unsigned long addr)
+{
+	return addr;
+}
+
+void Ipc_WriteIdx(Ipc_ChannelType chl, uint16 idx)
+{
+	(void)chl;
+	(void)idx;
+	benchKicks++;
+	pthread_mutex_lock(&benchLock);
+	benchPending++;
+	pthread_mutex_unlock(&benchLock);
+	pthread_cond_signal(&benchEvent);
+}
+
+int main(int argc, char* argv[])
+{
+	int eventIdx, rate, seconds = 1;
+	unsigned long i, frames, dropped = 0;
+	double period, next, stamp;
+	void* ring;
+	pthread_t driver;
+	VirtQ_IdxType idx;
+	void* buffer;
+	uint16 len;
+
+	if(argc < 3)
+	{
+		printf("usage: %s event_idx(0/1) frames_per_second [seconds]\n", argv[0]);
+		return -1;
+	}
+	eventIdx = atoi(argv[1]);
+	rate = atoi(argv[2]);
+	if(argc > 3)
+	{
+		seconds = atoi(argv[3]);
+	}
+	frames = (unsigned long)rate*seconds;
+
+	benchFeatures = eventIdx ? (1<<VIRTIO_RING_F_EVENT_IDX) : 0;
+	ring = bench_alloc(vring_size(BENCH_VRING_NUM, BENCH_VRING_ALIGN));
+	benchVring.da = (uint32)(unsigned long)ring;
+
+	VirtQ_Init(&benchConfig);
+	VirtQ_InitVq(0);
+	vring_init(&benchDriverVring, BENCH_VRING_NUM, ring, BENCH_VRING_ALIGN);
+	for(i = 0; i < BENCH_VRING_NUM; i++)
+	{	/* all the buffers are given to the ECU side */
+		benchDriverVring.desc[i].addr = (uint32)(unsigned long)bench_alloc(BENCH_BUFFER_SIZE);
+		benchDriverVring.desc[i].len = BENCH_BUFFER_SIZE;
+		benchDriverVring.avail->ring[i] = i;
+	}
+	benchDriverVring.avail->idx = BENCH_VRING_NUM;
+
+	pthread_create(&driver, NULL, bench_driver, NULL);
+
+	period = 1e6/rate;
+	next = bench_now();
+	for(i = 0; i < frames; i++)
+	{
+		while(bench_now() < next);
+		next += period;
+		if(E_OK == VirtQ_GetAvailiableBuffer(0, &idx, &buffer, &len))
+		{
+			stamp = bench_now();
+			memcpy(buffer, &stamp, sizeof(stamp));
+			VirtQ_AddUsedBuffer(0, idx, len);
+			VirtQ_Kick(0);
+		}
+		else
+		{
+			dropped++;
+		}
+	}
+
+	usleep(100000);
+	benchStop = 1;
+	pthread_cond_signal(&benchEvent);
+	pthread_join(driver, NULL);
+
+	printf("event_idx=%d rate=%d frames=%lu kicks=%lu kicks/frame=%.3f latency avg=%.1fus max=%.1fus dropped=%lu\n",
+			eventIdx, rate, benchFrames, benchKicks,
+			(benchFrames > 0) ? ((double)benchKicks/benchFrames) : 0.0,
+			(benchFrames > 0) ? (benchLatencySum/benchFrames) : 0.0,
+			benchLatencyMax, dropped);
+
+	return 0;
+}
+#endif /* __VIRTQ_BENCH__ */
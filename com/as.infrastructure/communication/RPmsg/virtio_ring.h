@@ -96,6 +96,20 @@ typedef struct {
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
+/* We publish the used event index at the end of the available ring, and vice
+ * versa. They are at the end for backwards compatibility. */
+#define vring_used_event(vr) ((vr)->avail->ring[(vr)->num])
+#define vring_avail_event(vr) (*(uint16 *)&(vr)->used->ring[(vr)->num])
+
+/* The following is used with USED_EVENT_IDX and AVAIL_EVENT_IDX */
+/* Assuming a given event_idx value from the other side, if
+ * we have just incremented index from old to new_idx,
+ * should we trigger an event? */
+static inline int vring_need_event(uint16 event_idx, uint16 new_idx, uint16 old)
+{
+	return (uint16)(new_idx - event_idx - 1) < (uint16)(new_idx - old);
+}
+
 static inline void vring_init(Vring_Type *vr, uint32 num, void *p,
 			      uint32 align)
 {
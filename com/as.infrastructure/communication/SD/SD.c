@@ -216,6 +216,7 @@ void ClearSdDynConfig(void){
         Sd_DynConfig.Instance->SdClientService[i].TcpEndpoint = null_endpoint;
         /** @req 4.2.2/SWS_SD_00034 */
         Sd_DynConfig.Instance->SdClientService[i].UnicastSessionID = 1;
+        Sd_DynConfig.Instance->SdClientService[i].FindCache.Valid = FALSE;
     }
 
     for (uint8 i=0; i<Sd_DynConfig.Instance->InstanceCfg->SdNoOfServerServices; i++){
@@ -246,6 +247,7 @@ void ClearSdDynConfig(void){
         Sd_DynConfig.Instance->SdServerService[i].UdpSoConOpened = FALSE;
         /** @req 4.2.2/SWS_SD_00034 */
         Sd_DynConfig.Instance->SdServerService[i].UnicastSessionID = 1;
+        Sd_DynConfig.Instance->SdServerService[i].OfferCache.Valid = FALSE;
     }
 
 }
@@ -507,6 +509,10 @@ void Sd_LocalIpAddrAssignmentChg( SoAd_SoConIdType SoConId, TcpIp_IpAddrStateTyp
     {
         if (Sd_DynConfig.Instance[instance].TxSoCon == SoConId) {
             Sd_DynConfig.Instance[instance].TxPduIpAddressAssigned = (State == TCPIP_IPADDR_STATE_ASSIGNED);
+            /* The endpoint options of the cached OfferService carry the local address */
+            for (uint8 i=0; i<Sd_DynConfig.Instance[instance].InstanceCfg->SdNoOfServerServices; i++){
+                Sd_DynConfig.Instance[instance].SdServerService[i].OfferCache.Valid = FALSE;
+            }
             break;
         }
     }
@@ -561,4 +567,7 @@ void Sd_MainFunction( void ){
         Sd_UpdateServerService(instance);
     }
 
+    /* Send the multicast entries due in this cycle */
+    FlushSdMessages();
+
 }
@@ -104,6 +104,8 @@ static int EntryReceived(uint32 instanceno, Sd_Entry_Type *entry, TcpIp_SockAddr
     }else
     {
         entryType = SD_ENTRY_INVALID;
+        /* Skip it, all the entries are of ENTRY_TYPE_SIZE */
+        msg.EntriesArray += ENTRY_TYPE_SIZE;
     }
 
     if(entryType > 0) {
@@ -927,7 +929,8 @@ void Sd_UpdateClientService(uint32 instanceno)
             flags[clientno>>3] |= 1<<(clientno&0x07);
             UpdateClientService(instanceno, clientno, entryType, &entry, &ipaddress, is_multicast);
         }
-    } while(entryType > 0);
+        /* Entries of unknown services are skipped rather than ending the loop, a message carries many entries */
+    } while(entryType != SD_ENTRY_EMPTY);
 
     for (clientno=0; clientno < SdCfgPtr->Instance[instanceno].SdNoOfClientServices; clientno++)
     {
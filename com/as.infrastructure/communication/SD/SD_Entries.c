@@ -598,13 +598,14 @@ void BuildOptionsArray(Sd_EntryType entry_type,  const Sd_DynClientServiceType *
 void OptionsReceived (uint8 *options_array, uint32 length, Sd_Entry_Type1_Services *entry1, Sd_Entry_Type2_EventGroups *entry2, uint8 **options1, uint8 **options2) {
 
     uint8* opt_address[MAX_OPTIONS];
-    memset (opt_address, 0, (MAX_OPTIONS * 4));
+    memset (opt_address, 0, sizeof(opt_address));
 
-    /* Assign startaddresses of all options in the Options Array */
+    /* Assign startaddresses of all options in the Options Array, the options beyond
+     * MAX_OPTIONS are not referenced */
     uint32 offset = 0;
     uint8 index = 0;
-    while (offset < length) {
-        uint16 current_option_length = (uint16) (options_array[offset] * 16 + options_array[offset+1]);
+    while ((offset < length) && (index < MAX_OPTIONS)) {
+        uint16 current_option_length = (uint16) (options_array[offset] * 256 + options_array[offset+1]);
 
         opt_address[index] = (uint8 *) (options_array + offset);
 
@@ -619,18 +620,18 @@ void OptionsReceived (uint8 *options_array, uint32 length, Sd_Entry_Type1_Servic
     /** @req SWS_SD_0226 */
     uint8 opt = 0;
     if (entry1 != NULL){
-        for (opt = 0; opt < entry1->NumberOfOption1; opt++) {
+        for (opt = 0; (opt < entry1->NumberOfOption1) && ((entry1->IndexFirstOptionRun + opt) < MAX_OPTIONS); opt++) {
             options1[opt] = opt_address[entry1->IndexFirstOptionRun + opt];
         }
-        for (opt = 0; opt < entry1->NumberOfOption2; opt++) {
+        for (opt = 0; (opt < entry1->NumberOfOption2) && ((entry1->IndexSecondOptionRun + opt) < MAX_OPTIONS); opt++) {
             options2[opt] = opt_address[entry1->IndexSecondOptionRun + opt];
         }
     }
     else if (entry2 != NULL){
-        for (opt = 0; opt < entry2->NumberOfOption1; opt++) {
+        for (opt = 0; (opt < entry2->NumberOfOption1) && ((entry2->IndexFirstOptionRun + opt) < MAX_OPTIONS); opt++) {
             options1[opt] = opt_address[entry2->IndexFirstOptionRun + opt];
         }
-        for (opt = 0; opt < entry2->NumberOfOption2; opt++) {
+        for (opt = 0; (opt < entry2->NumberOfOption2) && ((entry2->IndexSecondOptionRun + opt) < MAX_OPTIONS); opt++) {
             options2[opt] = opt_address[entry2->IndexSecondOptionRun + opt];
         }
     }
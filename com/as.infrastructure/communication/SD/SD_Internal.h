@@ -62,6 +62,19 @@ typedef struct {
     boolean Acknowledged;
 }Sd_DynConsumedEventGroupType;
 
+#ifndef SD_TX_CACHE_OPTIONS_SIZE
+#define SD_TX_CACHE_OPTIONS_SIZE 64u
+#endif
+/* Serialized entry and options of the OfferService or FindService of a service instance, built
+ * at its first transmission and reused until a state change invalidates it. Options larger than
+ * SD_TX_CACHE_OPTIONS_SIZE are built at each transmission as before. */
+typedef struct {
+    boolean Valid;
+    uint16 OptionsLength;
+    uint8 Entry[16];
+    uint8 Options[SD_TX_CACHE_OPTIONS_SIZE];
+} Sd_TxCacheType;
+
 /* Sd_DynClientServiceType */
 typedef struct {
     const Sd_ClientServiceType *ClientServiceCfg; /* static config */
@@ -84,6 +97,7 @@ typedef struct {
     Ipv4Endpoint UdpEndpoint;
     Ipv4Endpoint TcpEndpoint;
     uint16 UnicastSessionID;
+    Sd_TxCacheType FindCache;
 } Sd_DynClientServiceType;
 
 #define MAX_NO_OF_SUBSCRIBERS 15 /* TBD */
@@ -120,6 +134,7 @@ typedef struct {
     boolean TcpSoConOpened;
     boolean UdpSoConOpened;
     uint16 UnicastSessionID;
+    Sd_TxCacheType OfferCache;
 } Sd_DynServerServiceType;
 
 /* Sd_DynInstanceType */
@@ -271,6 +286,8 @@ uint32 RandomDelay(uint32 min, uint32 max); //lint !e526
 
 void TransmitSdMessage(Sd_DynInstanceType *instance, Sd_DynClientServiceType *client, Sd_DynServerServiceType *server, Sd_Entry_Type2_EventGroups *subscribe_entry, uint8 event_group_index, Sd_EntryType entry_type, TcpIp_SockAddrType *ipaddress, boolean is_rxmulticast); //lint !e526
 
+void FlushSdMessages(void);
+
 boolean ReceiveSdMessage(Sd_Message *msg,  TcpIp_SockAddrType *ipaddress, uint8 queue, Sd_InstanceType **server_svc, boolean *is_multicast);
 
 void InitMessagePool(void);
@@ -74,6 +74,34 @@ static DelayedRespType DelayedResp_Pool[RECEIVE_MAX];
 static CirqBufferType cirqBuf[NO_OF_TOTAL_QUEUES];
 static MsgType *fetched_message;
 
+/* -----------------Transmit batch (multicast) --------------- */
+/* The multicast entries due in one main function cycle are packed into one SD message per
+ * instance, sent by FlushSdMessages() at the end of the main function or as soon as the next
+ * entry does not fit in PAYLOAD_MAX, the largest message the receivers take. A receiver
+ * dispatches a message on its first entry, so FindService entries are not mixed with
+ * (Stop)OfferService entries. An option run already in the message is referenced again
+ * rather than copied, and the options are kept within the MAX_OPTIONS a receiver indexes. */
+#define SD_MESSAGE_HEADER_SIZE 28u /* header and the lengths of the entries and options arrays */
+
+typedef struct {
+    uint32 offset;
+    uint32 length;
+    uint8 index;
+} OptionRunType;
+
+typedef struct {
+    uint8 entries[PAYLOAD_MAX];
+    uint8 options[PAYLOAD_MAX];
+    uint32 entries_length;
+    uint32 options_length;
+    uint8 entry_type;
+    uint8 no_of_options;
+    uint8 no_of_runs;
+    OptionRunType runs[MAX_OPTIONS];
+} TxBatchType;
+
+static TxBatchType TxBatch[SD_NUMBER_OF_INSTANCES];
+
 
 
 static void * PushSdMessage(uint8 queue)
@@ -159,6 +187,13 @@ void InitMessagePool()
     CirqBuff_Init(&cirqBuf[CLIENT_QUEUE],    &Message_Pool[0],            RECEIVE_MAX, sizeof(MsgType));
     CirqBuff_Init(&cirqBuf[SERVER_QUEUE],    &Message_Pool[RECEIVE_MAX],  RECEIVE_MAX, sizeof(MsgType));
     CirqBuff_Init(&cirqBuf[DELAYRESP_QUEUE], &DelayedResp_Pool[0],        RECEIVE_MAX, sizeof(DelayedRespType));
+
+    for (uint32 i=0; i<SD_NUMBER_OF_INSTANCES; i++){
+        TxBatch[i].entries_length = 0;
+        TxBatch[i].options_length = 0;
+        TxBatch[i].no_of_options = 0;
+        TxBatch[i].no_of_runs = 0;
+    }
 }
 
 void Handle_RxIndication(PduIdType RxPduId, const PduInfoType* PduInfoPtr) {
@@ -264,6 +299,165 @@ boolean ReceiveSdMessage(Sd_Message *msg,  TcpIp_SockAddrType *ipaddress, uint8
 }
 
 
+/* Fills in the header of an SD message, the SessionID is filled in later */
+static void InitSdMessage(Sd_Message *sd_msg)
+{
+    /* IMPROVEMENT: Handling of flags according to chapter 7.3.6. Reboot_Flag and Unicast_Flag is const until then. */
+    const uint8 Reboot_Flag = 1u; /* Default value after reboot */
+    const uint8 Unicast_Flag = 1u; /* Supports Unicast messages */
+    const uint8 Flags = 0u;
+
+    sd_msg->MessageID = SOMEIP_SD_MESSAGE_ID;
+    sd_msg->RequestID = (uint32) ((CLIENT_ID << 16)); /* SessionID is filled in later */ /*lint !e835 Want to use CLIENT_ID even though zero as left argument */
+    sd_msg->ProtocolVersion = (uint8) PROTOCOL_VERSION;
+    sd_msg->InterfaceVersion = (uint8) INTERFACE_VERSION;
+    sd_msg->MessageType = (uint8) MESSAGE_TYPE;
+    sd_msg->ReturnCode = (uint8) RETURN_CODE;
+    sd_msg->Flags =  (uint8) (Flags | (Reboot_Flag << 7u) |  (Unicast_Flag << 6u));
+    sd_msg->Reserved = 0u;
+}
+
+/* Combines the entries and options to the SD message and transmits it to the remote address
+ * set on the TxSoCon */
+static void SendSdMessage(Sd_DynInstanceType *instance, Sd_Message *sd_msg)
+{
+    PduInfoType pduinfo;
+    uint32 messagelength;
+
+    /* FillMessage writes all the bytes up to messagelength */
+    sd_msg->Length = 20+sd_msg->LengthOfEntriesArray+sd_msg->LengthOfOptionsArray;
+    FillMessage(sd_msg, message, &messagelength);
+    pduinfo.SduDataPtr = message;
+    pduinfo.SduLength = (uint16) messagelength;
+
+    /** @req 4.2.2/SWS_SD_00039 */
+    /** @req 4.2.2/SWS_SD_00709 */
+    (void)SoAd_IfTransmit(instance->InstanceCfg->TxPduId,&pduinfo);
+
+    /** @req 4.2.2/SWS_SD_00705 */
+    (void)SoAd_SetRemoteAddr(instance->TxSoCon, &wildcard);
+}
+
+/* Sends the multicast entries packed for this instance, if any */
+static void FlushSdMessage(Sd_DynInstanceType *instance, TxBatchType *batch)
+{
+    Sd_Message sd_msg;
+
+    if (batch->entries_length == 0u) {
+        return;
+    }
+
+    InitSdMessage(&sd_msg);
+    sd_msg.EntriesArray = batch->entries;
+    sd_msg.LengthOfEntriesArray = batch->entries_length;
+    if (batch->options_length > 0u) {
+        sd_msg.OptionsArray = batch->options;
+        sd_msg.LengthOfOptionsArray = batch->options_length;
+    } else {
+        sd_msg.OptionsArray = NULL;
+        sd_msg.LengthOfOptionsArray = 0;
+    }
+
+    /* Use Multicast. Retreive multicast address from Multicast RxPdu. */
+    SoAd_SoConIdType multicast_rx_socket = instance->MulticastRxSoCon;
+    SoAd_SoConIdType tx_socket = instance->TxSoCon;
+    TcpIp_SockAddrType destination;
+    uint8 netmask;
+    TcpIp_SockAddrType default_router;
+
+    destination.domain = TCPIP_AF_INET;
+    default_router.domain = TCPIP_AF_INET;
+    (void)SoAd_GetLocalAddr(multicast_rx_socket,  &destination, &netmask, &default_router);
+    /* Set the remote multicast address before sending */
+    (void)SoAd_SetRemoteAddr(tx_socket, &destination);
+
+    /* Assign sessionID for this SD messsage */
+    sd_msg.RequestID |= instance->MulticastSessionID;
+    /** @req 4.2.2/SWS_SD_00035 */
+    /** @req 4.2.2/SWS_SD_00036 */
+    if (instance->MulticastSessionID == 0xFFFF){
+        instance->MulticastSessionID = 1u;
+    }
+    else {
+        instance->MulticastSessionID++;
+    }
+
+    SendSdMessage(instance, &sd_msg);
+
+    batch->entries_length = 0;
+    batch->options_length = 0;
+    batch->no_of_options = 0;
+    batch->no_of_runs = 0;
+}
+
+/* Returns the option run of the batch equal to the given options, NULL if none */
+static OptionRunType *FindOptionRun(TxBatchType *batch, const uint8 *options, uint32 options_length)
+{
+    for (uint8 i=0; i < batch->no_of_runs; i++){
+        if ((batch->runs[i].length == options_length) &&
+            (0 == memcmp(&batch->options[batch->runs[i].offset], options, options_length))) {
+            return &batch->runs[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Packs the single entry of sd_msg and its options into the multicast message of this instance */
+static void AppendSdEntry(Sd_DynInstanceType *instance, const Sd_Message *sd_msg)
+{
+    TxBatchType *batch = &TxBatch[instance - Sd_DynConfig.Instance];
+    const uint8 *entry = sd_msg->EntriesArray;
+    uint8 no_of_options = (uint8) ((entry[3] & 0xF0) >> 4);
+    uint32 options_length = sd_msg->LengthOfOptionsArray;
+    OptionRunType *run;
+
+    run = FindOptionRun(batch, sd_msg->OptionsArray, options_length);
+    if (run != NULL) {
+        /* Referenced, nothing to copy */
+        no_of_options = 0;
+        options_length = 0;
+    }
+
+    if ((batch->entries_length > 0u) &&
+        ((entry[0] != batch->entry_type) ||
+         ((SD_MESSAGE_HEADER_SIZE + batch->entries_length + ENTRY_TYPE_SIZE + batch->options_length + options_length) > PAYLOAD_MAX) ||
+         ((batch->no_of_options + no_of_options) > MAX_OPTIONS))) {
+        FlushSdMessage(instance, batch);
+        run = NULL;
+        no_of_options = (uint8) ((entry[3] & 0xF0) >> 4);
+        options_length = sd_msg->LengthOfOptionsArray;
+    }
+
+    batch->entry_type = entry[0];
+    memcpy(&batch->entries[batch->entries_length], entry, ENTRY_TYPE_SIZE);
+
+    if ((run == NULL) && (no_of_options > 0u)) {
+        run = &batch->runs[batch->no_of_runs];
+        batch->no_of_runs++;
+        run->offset = batch->options_length;
+        run->length = options_length;
+        run->index = batch->no_of_options;
+        memcpy(&batch->options[batch->options_length], sd_msg->OptionsArray, options_length);
+        batch->options_length += options_length;
+        batch->no_of_options += no_of_options;
+    }
+
+    if (run != NULL) {
+        /** @req SWS_SD_0164 */
+        batch->entries[batch->entries_length + 1u] = run->index;
+    }
+    batch->entries_length += ENTRY_TYPE_SIZE;
+}
+
+/* Sends the multicast entries packed in this main function cycle */
+void FlushSdMessages(void)
+{
+    for (uint32 i=0; i<SD_NUMBER_OF_INSTANCES; i++){
+        FlushSdMessage(&Sd_DynConfig.Instance[i], &TxBatch[i]);
+    }
+}
+
 /* TransmitSdMessage assembles and transmits one SD message of any type, both client and server messages
  * Parameters:
  * instance - ref to the current instance
@@ -276,6 +470,8 @@ boolean ReceiveSdMessage(Sd_Message *msg,  TcpIp_SockAddrType *ipaddress, uint8
  * ipaddress - unicast address to set if applicable
  * is_rxmulticast - parameter to identify if the reply message has to be delayed in case message
  *                  is received from multicast address
+ * The multicast messages are not sent at once but packed with the others due in this main
+ * function cycle, see FlushSdMessages.
  */
 void TransmitSdMessage(Sd_DynInstanceType *instance,
                        Sd_DynClientServiceType *client,
@@ -328,62 +524,75 @@ void TransmitSdMessage(Sd_DynInstanceType *instance,
         uint8 entry_type1_array[ENTRY_TYPE_1_SIZE];
         uint8 entry_type2_array[ENTRY_TYPE_2_SIZE];
         boolean send_by_multicast = FALSE;
+        Sd_TxCacheType *cache = NULL;
 
-        PduIdType pdu;
-        PduInfoType pduinfo;
-        uint32  messagelength;
         uint32 optionslength = 0;
         uint8 no_of_options = 0;
 
-        /* IMPROVEMENT: Handling of flags according to chapter 7.3.6. Reboot_Flag and Unicast_Flag is const until then. */
-        const uint8 Reboot_Flag = 1u; /* Default value after reboot */
-        const uint8 Unicast_Flag = 1u; /* Supports Unicast messages */
-        const uint8 Flags = 0u;
-        const uint8 NoOfEntries = 1; /* IMPROVEMENT:Change this later.*/
-
-        sd_msg.MessageID = SOMEIP_SD_MESSAGE_ID;
-        sd_msg.RequestID = (uint32) ((CLIENT_ID << 16)); /* SessionID is filled in later */ /*lint !e835 Want to use CLIENT_ID even though zero as left argument */
-        sd_msg.ProtocolVersion = (uint8) PROTOCOL_VERSION;
-        sd_msg.InterfaceVersion = (uint8) INTERFACE_VERSION;
-        sd_msg.MessageType = (uint8) MESSAGE_TYPE;
-        sd_msg.ReturnCode = (uint8) RETURN_CODE;
-        sd_msg.Flags =  (uint8) (Flags | (Reboot_Flag << 7u) |  (Unicast_Flag << 6u));
-        sd_msg.Reserved = 0u;
-
-        /* Create the options array */
-        sd_msg.LengthOfOptionsArray = 0;
-        sd_msg.OptionsArray = NULL;
-        BuildOptionsArray(entry_type, client, server, event_index, options, &optionslength, &no_of_options,instance->InstanceCfg->HostName);
-        if (optionslength > 0) {
-            sd_msg.OptionsArray = &options[0];
-            sd_msg.LengthOfOptionsArray = optionslength;
+        const uint8 NoOfEntries = 1; /* One entry built here, packed by AppendSdEntry if multicast */
+
+        InitSdMessage(&sd_msg);
+
+        /* The OfferService and FindService are serialized once and rebuilt only on a state change */
+        if ((entry_type == SD_OFFER_SERVICE) && (server != NULL)) {
+            cache = &server->OfferCache;
+        } else if ((entry_type == SD_FIND_SERVICE) && (client != NULL)) {
+            cache = &client->FindCache;
         } else {
-            sd_msg.OptionsArray = NULL;
-            sd_msg.LengthOfOptionsArray = 0;
+            /* Built at each transmission */
         }
 
-        /* Create entries array */
-        /* NB: Currently only one entry per SD_Message is used.
-         * IMPROVEMENT: Handle packing of more than one entry in each message. */
-        switch (entry_type) {
-        case SD_OFFER_SERVICE: /** @req 4.2.2/SWS_SD_00478 */
-        case SD_FIND_SERVICE:
-        case SD_STOP_OFFER_SERVICE:
+        if ((cache != NULL) && (cache->Valid)) {
             sd_msg.LengthOfEntriesArray = (uint32) ENTRY_TYPE_1_SIZE  * NoOfEntries;
-            BuildServiceEntry(entry_type, client, server, entry_type1_array, no_of_options);
-            sd_msg.EntriesArray = entry_type1_array;
-            break;
-        case SD_SUBSCRIBE_EVENTGROUP:
-        case SD_STOP_SUBSCRIBE_EVENTGROUP:
-        case SD_SUBSCRIBE_EVENTGROUP_ACK:
-        case SD_SUBSCRIBE_EVENTGROUP_NACK:
-            sd_msg.LengthOfEntriesArray = (uint32) ENTRY_TYPE_2_SIZE  * NoOfEntries;
-            BuildEventGroupsEntry(entry_type, client, subscribe_entry, event_index, entry_type2_array, no_of_options);
-            sd_msg.EntriesArray = entry_type2_array;
-            break;
-        default:
-            /* Error */
-            break;
+            sd_msg.EntriesArray = cache->Entry;
+            if (cache->OptionsLength > 0) {
+                sd_msg.OptionsArray = cache->Options;
+                sd_msg.LengthOfOptionsArray = cache->OptionsLength;
+            } else {
+                sd_msg.OptionsArray = NULL;
+                sd_msg.LengthOfOptionsArray = 0;
+            }
+        } else {
+            /* Create the options array */
+            sd_msg.LengthOfOptionsArray = 0;
+            sd_msg.OptionsArray = NULL;
+            BuildOptionsArray(entry_type, client, server, event_index, options, &optionslength, &no_of_options,instance->InstanceCfg->HostName);
+            if (optionslength > 0) {
+                sd_msg.OptionsArray = &options[0];
+                sd_msg.LengthOfOptionsArray = optionslength;
+            } else {
+                sd_msg.OptionsArray = NULL;
+                sd_msg.LengthOfOptionsArray = 0;
+            }
+
+            /* Create entries array */
+            switch (entry_type) {
+            case SD_OFFER_SERVICE: /** @req 4.2.2/SWS_SD_00478 */
+            case SD_FIND_SERVICE:
+            case SD_STOP_OFFER_SERVICE:
+                sd_msg.LengthOfEntriesArray = (uint32) ENTRY_TYPE_1_SIZE  * NoOfEntries;
+                BuildServiceEntry(entry_type, client, server, entry_type1_array, no_of_options);
+                sd_msg.EntriesArray = entry_type1_array;
+                break;
+            case SD_SUBSCRIBE_EVENTGROUP:
+            case SD_STOP_SUBSCRIBE_EVENTGROUP:
+            case SD_SUBSCRIBE_EVENTGROUP_ACK:
+            case SD_SUBSCRIBE_EVENTGROUP_NACK:
+                sd_msg.LengthOfEntriesArray = (uint32) ENTRY_TYPE_2_SIZE  * NoOfEntries;
+                BuildEventGroupsEntry(entry_type, client, subscribe_entry, event_index, entry_type2_array, no_of_options);
+                sd_msg.EntriesArray = entry_type2_array;
+                break;
+            default:
+                /* Error */
+                break;
+            }
+
+            if ((cache != NULL) && (optionslength <= SD_TX_CACHE_OPTIONS_SIZE)) {
+                memcpy(cache->Entry, entry_type1_array, ENTRY_TYPE_1_SIZE);
+                memcpy(cache->Options, options, optionslength);
+                cache->OptionsLength = (uint16) optionslength;
+                cache->Valid = TRUE;
+            }
         }
 
 
@@ -535,47 +744,11 @@ void TransmitSdMessage(Sd_DynInstanceType *instance,
         }
 
         if (send_by_multicast) {
-            /* Use Multicast. Retreive multicast address from Multicast RxPdu. */
-            SoAd_SoConIdType multicast_rx_socket = instance->MulticastRxSoCon;
-            SoAd_SoConIdType tx_socket = instance->TxSoCon;
-            TcpIp_SockAddrType destination;
-            uint8 netmask;
-            TcpIp_SockAddrType default_router;
-
-            destination.domain = TCPIP_AF_INET;
-            default_router.domain = TCPIP_AF_INET;
-            (void)SoAd_GetLocalAddr(multicast_rx_socket,  &destination, &netmask, &default_router);
-            /* Set the remote multicast address before sending */
-            (void)SoAd_SetRemoteAddr(tx_socket, &destination);
-
-            /* Assign sessionID for this SD messsage */
-            sd_msg.RequestID |= instance->MulticastSessionID;
-            /** @req 4.2.2/SWS_SD_00035 */
-            /** @req 4.2.2/SWS_SD_00036 */
-            if (instance->MulticastSessionID == 0xFFFF){
-                instance->MulticastSessionID = 1u;
-            }
-            else {
-                instance->MulticastSessionID++;
-            }
+            /* Sent with the other multicast entries of this cycle by FlushSdMessages */
+            AppendSdEntry(instance, &sd_msg);
+        } else {
+            SendSdMessage(instance, &sd_msg);
         }
-
-
-        /* Combine entries and options to sd message */
-        memset(message,0,PAYLOAD_MAX);
-        sd_msg.Length = 20+sd_msg.LengthOfEntriesArray+sd_msg.LengthOfOptionsArray;
-        FillMessage(&sd_msg, message, &messagelength);
-        pduinfo.SduDataPtr = message;
-        pduinfo.SduLength = (uint16) messagelength;
-
-        pdu = instance->InstanceCfg->TxPduId;
-
-        /** @req 4.2.2/SWS_SD_00039 */
-        /** @req 4.2.2/SWS_SD_00709 */
-        (void)SoAd_IfTransmit(pdu,&pduinfo);
-
-        /** @req 4.2.2/SWS_SD_00705 */
-        (void)SoAd_SetRemoteAddr(instance->TxSoCon, &wildcard);
     }
 }
 
@@ -101,6 +101,8 @@ static int EntryReceived(uint32 instanceno, Sd_Entry_Type * entry,
     } else
     {
         entryType = SD_ENTRY_INVALID;
+        /* Skip it, all the entries are of ENTRY_TYPE_SIZE */
+        msg.EntriesArray += ENTRY_TYPE_SIZE;
     }
 
     if(entryType > 0) {
@@ -295,6 +297,9 @@ static void UpdateServerService(uint32 instanceno, uint32 serverno,
 
             /** @req 4.2.2/SWS_SD_00606 */
             OpenSocketConnections(server);
+
+            /* The endpoint options are rebuilt from the (re)opened socket connections */
+            server->OfferCache.Valid = FALSE;
         }
         break;
 
@@ -838,7 +843,8 @@ void Sd_UpdateServerService(uint32 instanceno)
             flags[serverno>>3] |= 1<<(serverno&0x07);
             UpdateServerService(instanceno, serverno, entryType, &entry, &ipaddress, is_multicast);
         }
-    } while(entryType > 0);
+        /* Entries of unknown services are skipped rather than ending the loop, a message carries many entries */
+    } while(entryType != SD_ENTRY_EMPTY);
 
     for (serverno=0; serverno < SdCfgPtr->Instance[instanceno].SdNoOfServerServices; serverno++)
     {
@@ -118,82 +118,186 @@ void SoAd_BufferFree(uint8* buffPtr)
 	free(buffPtr);
 }
 #else
+/* The pool is made of size classes, each with its own free list, so get and free cost
+ * O(number of classes). SOAD_BUFFER_CLASSES of SoAd_Cfg.h lists SOAD_BUFFER_CLASS(size, number)
+ * in ascending size, a request takes the smallest class which is big enough and has a
+ * free buffer. Use the "soadbuf" shell command to see the usage for the sizing. */
+#ifndef SOAD_BUFFER_CLASSES
+#error "SOAD_BUFFER_CLASSES shall be configured in SoAd_Cfg.h"
+#endif
+
+/* STD_ON to fill the freed buffers with 0xaa, for debugging the use after free */
+#ifndef SOAD_BUFFER_POISON
+#define SOAD_BUFFER_POISON STD_OFF
+#endif
+
+#define SOAD_BUFFER_ALIGN(size)	(((size)+3)&(~3))
+#define SOAD_BUFFER_NIL			0xFFFF
+/* bufferNext of a buffer given out, to detect the double free */
+#define SOAD_BUFFER_USED		0xFFFE
+
 typedef struct  {
 	uint8*	bufferPtr;
 	uint16	bufferLen;
-	boolean	bufferInUse;
+	uint16	bufferNum;
+	uint16	firstIndex;
+	uint16	freeHead;
+	uint16	inUse;
+	uint16	highWater;
+	/* times a request of this size went to a bigger class or failed as all are in use */
+	uint32	exhausted;
 } AdminBufferType;
 
-static uint8 buffer1[42];
-static uint8 buffer2[SOAD_RX_BUFFER_SIZE];
-static uint8 buffer3[SOAD_RX_BUFFER_SIZE];
-static uint8 buffer4[SOAD_RX_BUFFER_SIZE];
-#define BUFFER_COUNT	4
-static AdminBufferType	adminBuffer[BUFFER_COUNT] = {
-		{
-				.bufferInUse = FALSE,
-				.bufferLen = sizeof(buffer1),
-				.bufferPtr = buffer1,
-		},
-		{
-				.bufferInUse = FALSE,
-				.bufferLen = sizeof(buffer2),
-				.bufferPtr = buffer2,
-		},
-		{
-				.bufferInUse = FALSE,
-				.bufferLen = sizeof(buffer3),
-				.bufferPtr = buffer3,
-		},
-		{
-				.bufferInUse = FALSE,
-				.bufferLen = sizeof(buffer4),
-				.bufferPtr = buffer4,
+#define SOAD_BUFFER_CLASS(size, num) + (num)
+static uint16 bufferNext[0 SOAD_BUFFER_CLASSES];
+#undef SOAD_BUFFER_CLASS
+
+#define SOAD_BUFFER_CLASS(size, num) + (SOAD_BUFFER_ALIGN(size)*(num)/sizeof(uint32))
+static uint32 bufferArena[0 SOAD_BUFFER_CLASSES];
+#undef SOAD_BUFFER_CLASS
+
+#define SOAD_BUFFER_CLASS(size, num)		\
+		{									\
+				.bufferLen = SOAD_BUFFER_ALIGN(size),	\
+				.bufferNum = num,			\
 		},
+static AdminBufferType	adminBuffer[] = {
+		SOAD_BUFFER_CLASSES
 };
+#undef SOAD_BUFFER_CLASS
+
+#define BUFFER_CLASS_COUNT	(sizeof(adminBuffer)/sizeof(adminBuffer[0]))
 
+/* buffers failed to get */
+static uint32 bufferFailed;
+
+static void bufferInit(void)
+{
+	uint16 i, j;
+	uint16 index = 0;
+	uint8* ptr = (uint8*)bufferArena;
+
+	for (i = 0; i < BUFFER_CLASS_COUNT; i++) {
+		adminBuffer[i].bufferPtr = ptr;
+		adminBuffer[i].firstIndex = index;
+		adminBuffer[i].freeHead = index;
+		adminBuffer[i].inUse = 0;
+		adminBuffer[i].highWater = 0;
+		adminBuffer[i].exhausted = 0;
+		for (j = 0; j < adminBuffer[i].bufferNum; j++) {
+			bufferNext[index+j] = index + j + 1;
+		}
+		index += adminBuffer[i].bufferNum;
+		if (adminBuffer[i].bufferNum > 0) {
+			bufferNext[index-1] = SOAD_BUFFER_NIL;
+		} else {
+			adminBuffer[i].freeHead = SOAD_BUFFER_NIL;
+		}
+		ptr += (uint32)adminBuffer[i].bufferLen*adminBuffer[i].bufferNum;
+	}
+	bufferFailed = 0;
+}
 
 boolean SoAd_BufferGet(uint32 size, uint8** buffPtr)
 {
 	boolean returnCode = FALSE;
-	uint16 i;
+	uint16 i, index;
+	AdminBufferType* admin;
 	imask_t state;
 	Irq_Save(state);
 
 	*buffPtr = NULL;
-	for (i = 0; i < BUFFER_COUNT; i++) {
-		if ((!adminBuffer[i].bufferInUse) && (adminBuffer[i].bufferLen >= size)) {
-			adminBuffer[i].bufferInUse = TRUE;
-			*buffPtr = adminBuffer[i].bufferPtr;
-			returnCode = TRUE;
-			break;
+	for (i = 0; i < BUFFER_CLASS_COUNT; i++) {
+		admin = &adminBuffer[i];
+		if (admin->bufferLen >= size) {
+			index = admin->freeHead;
+			if (index != SOAD_BUFFER_NIL) {
+				admin->freeHead = bufferNext[index];
+				bufferNext[index] = SOAD_BUFFER_USED;
+				admin->inUse++;
+				if (admin->inUse > admin->highWater) {
+					admin->highWater = admin->inUse;
+				}
+				*buffPtr = admin->bufferPtr + (uint32)(index - admin->firstIndex)*admin->bufferLen;
+				returnCode = TRUE;
+				break;
+			} else {
+				admin->exhausted++;
+			}
 		}
 	}
 
+	if (FALSE == returnCode) {
+		bufferFailed++;
+	}
+
 	Irq_Restore(state);
 	return returnCode;
 }
 
 void SoAd_BufferFree(uint8* buffPtr)
 {
-	uint16 i;
+	uint16 i, index;
+	uint32 offset;
+	AdminBufferType* admin;
 	imask_t state;
 	Irq_Save(state);
 
-	for (i = 0; i < BUFFER_COUNT; i++) {
-		if (adminBuffer[i].bufferPtr == buffPtr) {
-			adminBuffer[i].bufferInUse = FALSE;
-			uint16 j;
-
-			for (j = 0; j < adminBuffer[i].bufferLen; j++) {
-				adminBuffer[i].bufferPtr[j] = 0xaa;
+	for (i = 0; i < BUFFER_CLASS_COUNT; i++) {
+		admin = &adminBuffer[i];
+		if ((buffPtr >= admin->bufferPtr) &&
+			(buffPtr < (admin->bufferPtr + (uint32)admin->bufferLen*admin->bufferNum))) {
+			offset = (uint32)(buffPtr - admin->bufferPtr);
+			index = admin->firstIndex + (uint16)(offset/admin->bufferLen);
+			if ((0 != (offset%admin->bufferLen)) || (SOAD_BUFFER_USED != bufferNext[index])) {
+				/* not the start of a buffer, or the buffer is already free */
+				DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_BUFFER_FREE_ID, SOAD_E_PARAM_POINTER);
+				break;
 			}
+#if (SOAD_BUFFER_POISON == STD_ON)
+			memset(buffPtr, 0xaa, admin->bufferLen);
+#endif
+			bufferNext[index] = admin->freeHead;
+			admin->freeHead = index;
+			admin->inUse--;
 			break;
 		}
 	}
 
+	if (i >= BUFFER_CLASS_COUNT) {
+		/* not a buffer of the pool */
+		DET_REPORTERROR(MODULE_ID_SOAD, 0, SOAD_BUFFER_FREE_ID, SOAD_E_PARAM_POINTER);
+	}
+
     Irq_Restore(state);
 }
+
+#ifdef USE_SHELL
+static int shellSoAdBuffer(int argc, char* argv[])
+{
+	uint16 i;
+
+	SHELL_printf(" size  number  in use  high water  exhausted\n");
+	for (i = 0; i < BUFFER_CLASS_COUNT; i++) {
+		SHELL_printf("%5d  %6d  %6d  %10d  %9d\n",
+				adminBuffer[i].bufferLen, adminBuffer[i].bufferNum,
+				adminBuffer[i].inUse, adminBuffer[i].highWater,
+				(int)adminBuffer[i].exhausted);
+	}
+	SHELL_printf("failed: %d\n", (int)bufferFailed);
+
+	return 0;
+}
+static SHELL_CONST ShellCmdT cmdSoAdBuffer  = {
+		shellSoAdBuffer,
+		0,0,
+		"soadbuf",
+		"soadbuf",
+		"show the SoAd buffer pool usage\n",
+		{NULL,NULL}
+};
+SHELL_CMD_EXPORT(cmdSoAdBuffer)
+#endif
 #endif
 
 void SoAd_SocketClose(uint16 sockNr)
@@ -544,11 +648,71 @@ static void socketUdpRead(uint16 sockNr)
 }
 
 
+#if (SOAD_USE_SELECT == STD_ON)
+static int socketReadyHandle(uint16 sockNr)
+{
+	int handle;
+
+	switch (SocketAdminList[sockNr].SocketState) {
+	case SOCKET_TCP_LISTENING:
+	case SOCKET_UDP_READY:
+		handle = SocketAdminList[sockNr].SocketHandle;
+		break;
+	case SOCKET_TCP_READY:
+		handle = SocketAdminList[sockNr].ConnectionHandle;
+		break;
+	default:
+		handle = -1;
+		break;
+	}
+
+	return handle;
+}
+#endif
+
 static void scanSockets(void)
 {
 	uint16 i;
+#if (SOAD_USE_SELECT == STD_ON)
+	fd_set readset;
+	int handle;
+	int maxfd = -1;
+	int nready = 0;
+	boolean serviceAll = FALSE;
+
+	FD_ZERO(&readset);
+	for (i = 0; i < SOAD_SOCKET_COUNT; i++) {
+		handle = socketReadyHandle(i);
+		if (handle >= 0) {
+			FD_SET(handle, &readset);
+			if (handle > maxfd) {
+				maxfd = handle;
+			}
+		}
+	}
+
+	if (maxfd >= 0) {
+		nready = SoAd_SelectImpl(maxfd + 1, &readset);
+	}
+
+	if (nready < 0) {
+		/* select failed and the read set is undefined, the sockets are non-blocking
+		 * so they are all serviced this cycle as without select */
+		serviceAll = TRUE;
+	} else if (0 == nready) {
+		FD_ZERO(&readset);
+	}
+#endif
 
 	for (i = 0; i < SOAD_SOCKET_COUNT; i++) {
+#if (SOAD_USE_SELECT == STD_ON)
+		/* the socket whose handle is changed by the accept in this cycle is
+		 * picked up by the next select */
+		handle = socketReadyHandle(i);
+		if ((FALSE == serviceAll) && (handle >= 0) && (!FD_ISSET(handle, &readset))) {
+			continue;
+		}
+#endif
 		switch (SocketAdminList[i].SocketState) {
 		case SOCKET_INIT:
 			socketCreate(i);
@@ -592,6 +756,10 @@ void SoAd_Init(void)
 {
 	sint16 i, j;
 
+#ifndef USE_CLIB_ASHEAP
+	bufferInit();
+#endif
+
 	// Initiate the socket administration list
 	for (i = 0; i < SOAD_SOCKET_COUNT; i++) {
 		SocketAdminList[i].SocketNr = i;
@@ -831,6 +999,9 @@ void TcpIp_Init(void)
 {
 #if defined(USE_SHELL) && !defined(USE_SHELL_SYMTAB)
 	SHELL_AddCmd(&cmdIfconfig);
+#ifndef USE_CLIB_ASHEAP
+	SHELL_AddCmd(&cmdSoAdBuffer);
+#endif
 #endif
 
 	#ifdef USE_LWIP
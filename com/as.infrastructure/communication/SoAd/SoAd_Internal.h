@@ -47,6 +47,21 @@
 #define DET_REPORTERROR(_x,_y,_z,_q)
 #endif
 
+/* STD_ON: one select per SoAd_MainFunction and only the readable sockets are serviced,
+ * instead of the accept/recv tries on every socket. The readiness comes from the lwIP
+ * socket event callbacks, so it's for LWIP only(posix and target). */
+#ifndef SOAD_USE_SELECT
+#ifdef USE_LWIP
+#define SOAD_USE_SELECT STD_ON
+#else
+#define SOAD_USE_SELECT STD_OFF
+#endif
+#endif
+
+#if (SOAD_USE_SELECT == STD_ON)
+#include "Bsd.h"
+#endif
+
 typedef enum {
 	SOCKET_UNINIT = 0,
 	SOCKET_DUPLICATE,
@@ -74,7 +89,8 @@ typedef enum {
 	PDU_IDLE,
 	PDU_IF_SENDING,
 	PDU_TP_REQ_BUFFER,
-	PDU_TP_SENDING
+	PDU_TP_SENDING,
+	PDU_TP_STREAMING
 } PduStatusType;
 
 typedef enum {
@@ -85,6 +101,9 @@ typedef enum {
 
 typedef struct {
 	PduStatusType		PduStatus;
+	/* PDU_TP_STREAMING: the payload is sent as PduR provides it */
+	uint16				SocketNr;
+	PduLengthType		TxRemaining;
 } PduAdminListType;
 
 typedef enum {
@@ -92,6 +111,14 @@ typedef enum {
 	DOIP_ARC_CONNECTION_REGISTERED,
 } SoAd_ArcDoIpSocketStateType;
 
+typedef enum {
+	DOIP_ARC_RX_IDLE,
+	/* the payload of a diagnostic message is copied to the buffer of PduR */
+	DOIP_ARC_RX_DIAGNOSTIC,
+	/* the rest of a rejected message is dropped */
+	DOIP_ARC_RX_DISCARD,
+} SoAd_ArcDoIpRxStateType;
+
 typedef struct {
 	uint16 sockNr;
 	uint16 sa;
@@ -114,6 +141,14 @@ typedef struct {
 	 */
 	PduStatusType pduStatus;
 
+	/*
+	 * The message being received on this connection, it's read as the tester sends it
+	 * so that a slow or a blocked tester doesn't hold up the other connections.
+	 */
+	SoAd_ArcDoIpRxStateType rxState;
+	PduInfoType *rxPduInfo;
+	PduLengthType rxOffset;
+	uint32 rxRemaining;
 
 } DoIp_ArcDoIpSocketStatusType;
 
@@ -166,4 +201,8 @@ int SoAd_AcceptImpl(int s, uint32 *RemoteIpAddress, uint16 *RemotePort);
 int SoAd_RecvFromImpl(int s, void *mem, size_t len, int flags,
 					  uint32 *RemoteIpAddress, uint16 *RemotePort);
 int SoAd_RecvImpl(int s, void *mem, size_t len, int flags);
+#if (SOAD_USE_SELECT == STD_ON)
+/* wait for no time, return the number of the ready sockets left in readset */
+int SoAd_SelectImpl(int maxfdp1, fd_set *readset);
+#endif
 #endif /* SOAD_INTERNAL_H_ */
@@ -15,6 +15,8 @@
  */
 #if defined(USE_SOAD) && defined(USE_LWIP)
 /* ============================ [ INCLUDES  ] ====================================================== */
+/* the SoAd_Types.h enums(MSG_PEEK etc.) shall go before the lwip sockets.h macros */
+#include "SoAd_Internal.h"
 #include "Bsd.h"
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
@@ -165,5 +167,16 @@ int SoAd_RecvFromImpl(int s, void *mem, size_t len, int flags,
 	return nbytes;
 }
 
+#if (SOAD_USE_SELECT == STD_ON)
+int SoAd_SelectImpl(int maxfdp1, fd_set *readset)
+{
+	struct timeval timeout;
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 0;
+
+	return lwip_select(maxfdp1, readset, NULL, NULL, &timeout);
+}
+#endif
 
 #endif
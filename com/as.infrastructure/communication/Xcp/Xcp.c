@@ -35,6 +35,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include "asdebug.h"
+#ifdef USE_SHELL
+#include "shell.h"
+#endif
 
 
 #define AS_LOG_XCP 0
@@ -59,6 +62,148 @@ static Xcp_UnlockType Xcp_Unlock;
 Xcp_MtaType Xcp_Mta;
 Xcp_ContextType Xcp_Context;
 
+#ifdef USE_SHELL
+static TickType Xcp_SampleTick;
+static uint32 Xcp_TxFrames;
+#endif
+
+/* Bytes ahead of the ODT data in a DTO */
+static int Xcp_DtoHeaderSize(int ts) {
+	int size;
+#if (XCP_IDENTIFICATION == XCP_IDENTIFICATION_ABSOLUTE)
+	size = 1;
+#elif (XCP_IDENTIFICATION == XCP_IDENTIFICATION_RELATIVE_BYTE)
+	size = 2;
+#elif (XCP_IDENTIFICATION == XCP_IDENTIFICATION_RELATIVE_WORD)
+	size = 3;
+#else /* XCP_IDENTIFICATION_RELATIVE_WORD_ALIGNED */
+	size = 4;
+#endif
+	if (ts) {
+		size += XCP_TIMESTAMP_SIZE;
+	}
+	return size;
+}
+
+/**
+ * Compile the ODT into its gather plan: the valid entries are flattened into
+ * (address, length) runs with the adjacent entries merged, so that the event
+ * channel only does memcpy. The runs are kept in place in the first entries of
+ * the ODT entry array, which is contiguous for both the static and the dynamic
+ * configuration. An ODT that refers to DIO is left to the MTA path.
+ *
+ * @param odt the ODT to compile
+ * @param ts the ODT carries the timestamp
+ */
+static void Xcp_CompileOdt(Xcp_OdtType* odt, int ts) {
+	Xcp_OdtEntryType* ent = odt->XcpOdtEntry;
+	Xcp_OdtEntryType* run = odt->XcpOdtEntry;
+	int room = XCP_MAX_DTO - Xcp_DtoHeaderSize(ts);
+	int count = 0;
+	int size = 0;
+	boolean gather = TRUE;
+
+	for (int i = 0; (i < odt->XcpOdtEntriesCount) && ent; i++) {
+		const uint8* address = (const uint8*)ent->XcpOdtEntryAddress;
+		uint8 len = ent->XcpOdtEntryLength;
+		if (len > (room - size)) {
+			break;
+		}
+
+		if (len > 0) {
+			if ((ent->XcpOdtEntryExtension != XCP_MTA_EXTENSION_MEMORY)
+					&& (ent->XcpOdtEntryExtension != XCP_MTA_EXTENSION_FLASH)) {
+				gather = FALSE;
+				break;
+			}
+
+			if ((count > 0) && ((run[count - 1].XcpGatherAddress + run[count - 1].XcpGatherLength) == address)) {
+				run[count - 1].XcpGatherLength += len;
+			} else {
+				run[count].XcpGatherAddress = address;
+				run[count].XcpGatherLength = len;
+				count++;
+			}
+			size += len;
+		}
+		ent = ent->XcpNextOdtEntry;
+	}
+
+	if (gather) {
+		odt->XcpGatherCount = count;
+		odt->XcpGatherSize = size;
+	} else {
+		odt->XcpGatherCount = 0;
+		odt->XcpGatherSize = 0;
+	}
+}
+
+/* Compile all ODTs of the DAQ list, the timestamp goes with the first sampled ODT */
+static void Xcp_CompileDaq(const Xcp_DaqListType* daq) {
+	int ts = daq->XcpParams->Mode & XCP_DAQLIST_MODE_TIMESTAMP;
+
+	Xcp_OdtType* odt = daq->XcpOdt;
+	for (int o = 0; (o < daq->XcpOdtCount) && odt; o++, odt = odt->XcpNextOdt) {
+		if (!odt->XcpOdtEntriesValid) {
+			odt->XcpGatherCount = 0;
+			odt->XcpGatherSize = 0;
+		} else {
+			Xcp_CompileOdt(odt, ts);
+			ts = 0;
+		}
+	}
+}
+
+#ifdef USE_SHELL
+static uint32 Xcp_PerSecond(uint32 count, TickType elapsed)
+{
+	return (uint32)(((uint64)count * OS_TICKS_PER_SECOND) / elapsed);
+}
+
+static int shellXcpDaq(int argc, char* argv[])
+{
+	TickType elapsed = GetOsElapsedTick(Xcp_SampleTick);
+	uint32 total = 0;
+	uint32 frames = Xcp_TxFrames;
+
+	Xcp_SampleTick = GetOsTick();
+	Xcp_TxFrames = 0;
+	if (0 == elapsed) {
+		elapsed = 1;
+	}
+
+	SHELL_printf(" channel  samples  samples/s  signals/s  name\n");
+	for (int i = 0; (NULL != Xcp_Context.config) && (i < Xcp_Context.config->XcpMaxEventChannel); i++) {
+		Xcp_EventChannelType* ech = Xcp_Context.config->XcpEventChannel + i;
+		uint32 samples = ech->XcpEventChannelSamples;
+		uint32 signals = ech->XcpEventChannelSignals;
+		ech->XcpEventChannelSamples = 0;
+		ech->XcpEventChannelSignals = 0;
+		total += samples;
+		SHELL_printf("%8d  %7u  %9u  %9u  %s\n", i, (unsigned int)samples,
+				(unsigned int)Xcp_PerSecond(samples, elapsed),
+				(unsigned int)Xcp_PerSecond(signals, elapsed),
+				ech->XcpEventChannelName);
+	}
+	SHELL_printf("total %u samples in %u frames(%u frames/s, MAX_DTO %d) in %u ms\n",
+			(unsigned int)total, (unsigned int)frames,
+			(unsigned int)Xcp_PerSecond(frames, elapsed), XCP_MAX_DTO,
+			(unsigned int)(((uint64)elapsed * 1000) / OS_TICKS_PER_SECOND));
+
+	return 0;
+}
+static SHELL_CONST ShellCmdT cmdXcpDaq  = {
+		shellXcpDaq,
+		0,0,
+		"xcpdaq",
+		"xcpdaq",
+		"show the DTOs and signals sampled per event channel and the frames\n"
+		"transmitted since the last call\n",
+		{NULL,NULL}
+};
+SHELL_CMD_EXPORT(cmdXcpDaq)
+#endif
+
 #if (XCP_VERSION_INFO_API == STD_ON)
 /**
  * Returns the version information of this module.
@@ -156,6 +301,7 @@ void Xcp_Init(const Xcp_ConfigType* Xcp_ConfigPtr) {
 			}
 		}
 
+		Xcp_CompileDaq(daq);
 	}
 
 #if(XCP_DAQ_CONFIG_TYPE == DAQ_DYNAMIC)
@@ -169,6 +315,9 @@ void Xcp_Init(const Xcp_ConfigType* Xcp_ConfigPtr) {
 	}
 #endif /*XCP_DAQ_CONFIG_TYPE == DAQ_DYNAMIC*/
 
+#if defined(USE_SHELL) && !defined(USE_SHELL_SYMTAB)
+	SHELL_AddCmd(&cmdXcpDaq);
+#endif
 	Xcp_Inited = 1;
 }
 
@@ -282,40 +431,62 @@ static void Xcp_ProcessDaq_STIM(const Xcp_DaqListType* daq) {
 }
 
 /** @req XCP705 *//*The AUTOSAR XCP Module shall support Synchronous data acquisition (measurement)*/
-static void Xcp_ProcessDaq_DAQ(const Xcp_DaqListType* daq) {
+static void Xcp_ProcessDaq_DAQ(const Xcp_DaqListType* daq, Xcp_EventChannelType* ech) {
 	int ts = daq->XcpParams->Mode & XCP_DAQLIST_MODE_TIMESTAMP;
+	Xcp_BufferType* e = NULL;
 
 	Xcp_OdtType* odt = daq->XcpOdt;
-	for (int o = 0; o < daq->XcpOdtCount; o++) {
+	for (int o = 0; (o < daq->XcpOdtCount) && odt; o++, odt = odt->XcpNextOdt) {
 		if (!odt->XcpOdtEntriesValid)
 			continue;
 
-		FIFO_GET_WRITE(Xcp_FifoTx, e)
-		{
+#if (XCP_ARC_DTO_MULTI_ODT == STD_ON)
+		/* put the DTOs of this event into one frame as long as they fit */
+		if ((NULL != e) && ((0 == odt->XcpGatherCount)
+				|| ((e->len + Xcp_DtoHeaderSize(ts) + odt->XcpGatherSize) > XCP_MAX_DTO))) {
+			Xcp_Fifo_Put(&Xcp_FifoTx, e);
+			e = NULL;
+		}
+#endif
+		if (NULL == e) {
+			e = Xcp_Fifo_Get(Xcp_FifoTx.free);
+			if (NULL == e) {
+				break;
+			}
+		}
 
-			FIFO_ADD_U8(e, odt->XcpOdt2DtoMapping.XcpDtoPid);
+		FIFO_ADD_U8(e, odt->XcpOdt2DtoMapping.XcpDtoPid);
 
 #if   (XCP_IDENTIFICATION == XCP_IDENTIFICATION_RELATIVE_WORD)
-			FIFO_ADD_U16(e, daq->XcpDaqListNumber);
+		FIFO_ADD_U16(e, daq->XcpDaqListNumber);
 #elif (XCP_IDENTIFICATION == XCP_IDENTIFICATION_RELATIVE_WORD_ALIGNED)
-			FIFO_ADD_U8 (e, 0); /* RESERVED */
-			FIFO_ADD_U16(e, daq->XcpDaqListNumber);
+		FIFO_ADD_U8 (e, 0); /* RESERVED */
+		FIFO_ADD_U16(e, daq->XcpDaqListNumber);
 #elif (XCP_IDENTIFICATION == XCP_IDENTIFICATION_RELATIVE_BYTE)
-			FIFO_ADD_U8(e, daq->XcpDaqListNumber);
+		FIFO_ADD_U8(e, daq->XcpDaqListNumber);
 #endif
 
-			if (ts) {
+		if (ts) {
 #if   (XCP_TIMESTAMP_SIZE == 1)
-				FIFO_ADD_U8 (e, Xcp_GetTimeStamp());
+			FIFO_ADD_U8 (e, Xcp_GetTimeStamp());
 #elif (XCP_TIMESTAMP_SIZE == 2)
-				FIFO_ADD_U16(e, Xcp_GetTimeStamp());
+			FIFO_ADD_U16(e, Xcp_GetTimeStamp());
 #elif (XCP_TIMESTAMP_SIZE == 4)
-				FIFO_ADD_U32(e, Xcp_GetTimeStamp());
+			FIFO_ADD_U32(e, Xcp_GetTimeStamp());
 #endif
-				ts = 0;
+			ts = 0;
+		}
+		if ((odt->XcpGatherCount > 0) && ((e->len + odt->XcpGatherSize) <= XCP_MAX_DTO)) {
+			const Xcp_OdtEntryType* run = odt->XcpOdtEntry;
+			uint8* dst = e->data + e->len;
+			for (int i = 0; i < odt->XcpGatherCount; i++) {
+				memcpy(dst, run[i].XcpGatherAddress, run[i].XcpGatherLength);
+				dst += run[i].XcpGatherLength;
 			}
+			e->len += odt->XcpGatherSize;
+		} else {
 			Xcp_OdtEntryType* ent = odt->XcpOdtEntry;
-			for (int i = 0; i < odt->XcpOdtEntriesCount; i++) {
+			for (int i = 0; (i < odt->XcpOdtEntriesCount) && ent; i++) {
 				uint8 len = ent->XcpOdtEntryLength;
 				Xcp_MtaType mta;
 				Xcp_MtaInit(&mta, (uint32)ent->XcpOdtEntryAddress,
@@ -327,17 +498,27 @@ static void Xcp_ProcessDaq_DAQ(const Xcp_DaqListType* daq) {
 				e->len += len;
 				ent = ent->XcpNextOdtEntry;
 			}
-			odt = odt->XcpNextOdt;
 		}
+		ech->XcpEventChannelSamples++;
+		ech->XcpEventChannelSignals += odt->XcpOdtEntriesValid;
+
+#if (XCP_ARC_DTO_MULTI_ODT != STD_ON)
+		Xcp_Fifo_Put(&Xcp_FifoTx, e);
+		e = NULL;
+#endif
+	}
+
+	if (NULL != e) {
+		Xcp_Fifo_Put(&Xcp_FifoTx, e);
 	}
 }
 
 /* Process all entries in DAQ */
-static void Xcp_ProcessDaq(const Xcp_DaqListType* daq) {
+static void Xcp_ProcessDaq(const Xcp_DaqListType* daq, Xcp_EventChannelType* ech) {
 	if (daq->XcpParams->Mode & XCP_DAQLIST_MODE_STIM) {
 		Xcp_ProcessDaq_STIM(daq);
 	} else {
-		Xcp_ProcessDaq_DAQ(daq);
+		Xcp_ProcessDaq_DAQ(daq, ech);
 	}
 }
 
@@ -356,7 +537,7 @@ static void Xcp_ProcessChannel(Xcp_EventChannelType* ech) {
 
 		if ((ech->XcpEventChannelCounter % daq->XcpParams->Prescaler) != 0)
 			continue;
-		Xcp_ProcessDaq(ech->XcpEventChannelTriggeredDaqListRef[d]);
+		Xcp_ProcessDaq(ech->XcpEventChannelTriggeredDaqListRef[d], ech);
 	}
 	ech->XcpEventChannelCounter++;
 }
@@ -1009,6 +1190,7 @@ static Std_ReturnType Xcp_CmdClearDaqList(uint8 pid, void* data, int len) {
 		}
 		odt = odt->XcpNextOdt;
 	}
+	Xcp_CompileDaq(daq);
 	RETURN_SUCCESS();
 }
 
@@ -1105,6 +1287,7 @@ static Std_ReturnType Xcp_CmdWriteDaq(uint8 pid, void* data, int len) {
 		Xcp_DaqState.odt->XcpOdtEntriesValid--;
 
 	Xcp_DaqState.ptr->XcpOdtEntryLength = daqElemSize;
+	Xcp_CompileDaq(Xcp_DaqState.daq);
 
 	Xcp_DaqState.ptr = Xcp_DaqState.ptr->XcpNextOdtEntry;
 	if (Xcp_DaqState.ptr == NULL) {
@@ -1185,6 +1368,7 @@ static Std_ReturnType Xcp_CmdSetDaqListMode(uint8 pid, void* data, int len) {
 	Xcp_CmdSetDaqListMode_EventChannel(daq, GET_UINT16(data, 3));
 	daq->XcpParams->Prescaler = GET_UINT8(data, 5);
 	daq->XcpParams->Priority = prio;
+	Xcp_CompileDaq(daq);
 
 	RETURN_SUCCESS();
 }
@@ -1228,6 +1412,7 @@ static Std_ReturnType Xcp_CmdStartStopDaqList(uint8 pid, void* data, int len) {
 		daq->XcpParams->Mode &= ~XCP_DAQLIST_MODE_RUNNING;
 	} else if (mode == 1) {
 		/* START */
+		Xcp_CompileDaq(daq);
 		daq->XcpParams->Mode |= XCP_DAQLIST_MODE_RUNNING;
 	} else if (mode == 2) {
 		/* SELECT */
@@ -1260,6 +1445,7 @@ static Std_ReturnType Xcp_CmdStartStopSynch(uint8 pid, void* data, int len) {
 		/* START SELECTED */
 		for (int i = 0; i < Xcp_Context.XcpMaxDaq; i++) {
 			if (daq->XcpParams->Mode & XCP_DAQLIST_MODE_SELECTED) {
+				Xcp_CompileDaq(daq);
 				daq->XcpParams->Mode |= XCP_DAQLIST_MODE_RUNNING;
 				daq->XcpParams->Mode &= ~XCP_DAQLIST_MODE_SELECTED;
 			}
@@ -1604,6 +1790,7 @@ static Std_ReturnType Xcp_CmdAllocOdt(uint8 pid, void* data, int len) {
 	newOdt->XcpOdtNumber = 0;
 	newOdt->XcpOdtEntriesCount = 0;
 	newOdt->XcpOdtEntriesValid = 0;
+	newOdt->XcpGatherCount = 0;
 	newOdt->XcpOdt2DtoMapping.XcpDtoPid = 0;
 	newOdt->XcpStim = NULL;
 	newOdt->XcpNextOdt = NULL;
@@ -1619,6 +1806,7 @@ static Std_ReturnType Xcp_CmdAllocOdt(uint8 pid, void* data, int len) {
 		newOdt->XcpOdtNumber = i;
 		newOdt->XcpOdtEntriesCount = 0;
 		newOdt->XcpOdtEntriesValid = 0;
+		newOdt->XcpGatherCount = 0;
 		newOdt->XcpStim = NULL;
 		newOdt->XcpNextOdt = NULL;
 		odt->XcpNextOdt = newOdt;
@@ -1695,6 +1883,7 @@ static Std_ReturnType Xcp_CmdAllocOdtEntry(uint8 pid, void* data, int len) {
 	}
 	odt->XcpOdtEntriesCount = odtEntriesCount;
 	odt->XcpOdtEntriesValid = odtEntriesCount;
+	odt->XcpGatherCount = 0;
 	Xcp_DaqState.dyn = XCP_DYNAMIC_STATE_ALLOC_ODT_ENTRY;
 	RETURN_SUCCESS();
 }
@@ -2057,6 +2246,9 @@ void Xcp_Transmit_Main(void) {
 		if (E_OK == retVal) {
 			Xcp_Fifo_Free(&Xcp_FifoTx, it);
 			it = NULL;
+#ifdef USE_SHELL
+			Xcp_TxFrames++;
+#endif
 		}
 	}
 }
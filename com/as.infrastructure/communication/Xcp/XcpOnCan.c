@@ -30,6 +30,21 @@
 
 #define AS_LOG_XCP 0
 
+#if (XCP_MAX_DTO > 64) || (XCP_MAX_CTO > 64)
+#error "XCP on CAN supports MAX_DTO and MAX_CTO up to 64(CAN FD)"
+#endif
+
+#if (XCP_MAX_DTO > 8) || (XCP_MAX_CTO > 8)
+#define XCP_CAN_FD STD_ON
+#else
+#define XCP_CAN_FD STD_OFF
+#endif
+
+/* value of the bytes padded up to the next valid CAN FD data length */
+#ifndef XCP_CAN_FD_PADDING
+#define XCP_CAN_FD_PADDING 0x55
+#endif
+
 typedef enum {
 	XCP_CAN_CMD_SET_DAQ_ID   = 0xFD,
 	XCP_CAN_CMD_GET_DAQ_ID   = 0xFE,
@@ -161,9 +176,42 @@ Std_ReturnType Xcp_CanIfTriggerTransmit(
  * @param len
  * @return
  */
+#if (XCP_CAN_FD == STD_ON)
+/* CAN FD data length of 0..8, 12, 16, 20, 24, 32, 48 or 64 that holds len bytes */
+static int Xcp_CanFdLength(int len)
+{
+	int dl;
+
+	if (len <= 8) {
+		dl = len;
+	} else if (len <= 24) {
+		dl = (len + 3) & ~3;
+	} else if (len <= 32) {
+		dl = 32;
+	} else if (len <= 48) {
+		dl = 48;
+	} else {
+		dl = 64;
+	}
+
+	return dl;
+}
+#endif
+
 Std_ReturnType Xcp_Transmit(const void* data, int len)
 {
 	PduInfoType pdu;
+#if (XCP_CAN_FD == STD_ON)
+	uint8 frame[64];
+	int dl = Xcp_CanFdLength(len);
+
+	if (dl != len) {
+		memcpy(frame, data, len);
+		memset(&frame[len], XCP_CAN_FD_PADDING, dl - len);
+		data = frame;
+		len  = dl;
+	}
+#endif
 	pdu.SduDataPtr = (uint8*)data;
 	pdu.SduLength  = len;
 	return CanIf_Transmit(XCP_PDU_ID_TX, &pdu);
@@ -78,6 +78,11 @@ typedef struct Xcp_OdtEntryType {
 	struct Xcp_OdtEntryType *XcpNextOdtEntry;
 	uint8 BitOffSet;
 	uint8 XcpOdtEntryExtension;
+
+	/* One run of the ODT gather plan, the plan is kept in the first
+	 * XcpGatherCount entries of the ODT entry array */
+	const uint8* XcpGatherAddress;
+	uint8 XcpGatherLength;
 } Xcp_OdtEntryType;
 
 struct Xcp_BufferType;
@@ -94,6 +99,8 @@ typedef struct Xcp_OdtType {
 	int XcpOdtEntriesValid; /* Number of non zero entries */
 	struct Xcp_OdtType *XcpNextOdt;
 	struct Xcp_BufferType *XcpStim;
+	uint8 XcpGatherCount; /* runs of the gather plan, 0: not compiled, sampled by MTA */
+	uint8 XcpGatherSize; /* bytes gathered by the plan */
 } Xcp_OdtType;
 
 typedef enum {
@@ -243,6 +250,13 @@ typedef struct {
 	 */
 	uint8 XcpEventChannelDaqCount;
 
+	/**
+	 * Number of DTOs and ODT entries sampled, reset by the shell command xcpdaq
+	 *   [INTERNAL]
+	 */
+	uint32 XcpEventChannelSamples;
+	uint32 XcpEventChannelSignals;
+
 } Xcp_EventChannelType;
 
 typedef enum {
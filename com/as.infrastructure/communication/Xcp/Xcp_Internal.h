@@ -218,6 +218,14 @@ typedef struct {
 #define XCP_SEEDKEY_LENGTH (XCP_MAX_CTO-2)
 #endif
 
+/* Non-standard extension: the DTOs of the ODTs sampled by one event go into one frame
+ * as long as they fit in MAX_DTO, the master splits them by the PID and the ODT sizes it
+ * configured. This is not the SET_DAQ_PACKED_MODE of XCP 1.4, which packs several samples
+ * of the same ODT, so a standard master can't decode it; only for a master which knows. */
+#ifndef XCP_ARC_DTO_MULTI_ODT
+#define XCP_ARC_DTO_MULTI_ODT STD_OFF
+#endif
+
 typedef struct {
     Xcp_ProtectType res;
 
@@ -168,7 +168,6 @@ Std_ReturnType Diag_GetSeedEXTDS(uint8 *securityAccessDataRecord, uint8 *seed, D
 Std_ReturnType Diag_CompareKeyEXTDS(uint8 *key);
 
 boolean Dcm_CheckMemory(uint8 attr, uint8 memoryIdentifier, uint32 memoryAddress, uint32 length);
-boolean Dcm_CheckDataFormatIdentifier(uint8 dataFormatIdentifier);
 /* ============================ [ DATAS     ] ====================================================== */
 static Dcm_RuntimeType dcmRTE[DCM_INSTANCE_NUM];
 /* uint64 for 8 byte alignment */
@@ -237,6 +236,17 @@ boolean __weak Dcm_CheckDataFormatIdentifier(uint8 dataFormatIdentifier)
 {
 	return TRUE;
 }
+
+Std_ReturnType __weak Dcm_ProcessRequestDownload(uint8 DataFormatIdentifier, uint8 MemoryIdentifier,
+		uint32 MemoryAddress, uint32 MemorySize)
+{
+	return E_OK;
+}
+
+Std_ReturnType __weak Dcm_ProcessRequestTransferExit(void)
+{
+	return E_OK;
+}
 #endif
 #endif
 
@@ -455,6 +465,62 @@ static void BL_StartEraseFlash(PduIdType Instance)
 	}
 }
 
+static void BL_StartChecksum(PduIdType Instance)
+{
+	uint32 memoryAddress;
+	uint32 length;
+	uint8  memoryIdentifier;
+	Dcm_ReturnReadMemoryType checksumRet;
+	if(13 == DCM_RTE.rxPduLength)
+	{
+		memoryAddress = ((uint32)DCM_RXSDU_DATA[4]<<24) + ((uint32)DCM_RXSDU_DATA[5]<<16)
+				+ ((uint32)DCM_RXSDU_DATA[6]<<8) +((uint32)DCM_RXSDU_DATA[7]);
+		length  = ((uint32)DCM_RXSDU_DATA[8]<<24) + ((uint32)DCM_RXSDU_DATA[9]<<16)
+				+ ((uint32)DCM_RXSDU_DATA[10]<<8) +((uint32)DCM_RXSDU_DATA[11]);
+		memoryIdentifier = DCM_RXSDU_DATA[12];
+		if(DCM_RTE.currentSession != DCM_PROGRAMMING_SESSION)
+		{
+			SendNRC(Instance, DCM_E_SERVICE_NOT_SUPPORTED_IN_ACTIVE_SESSION);
+		}
+		else if(DCM_RTE.currentLevel != 2 /* PRGS */)
+		{
+			SendNRC(Instance, DCM_E_SECUTITY_ACCESS_DENIED);
+		}
+		else if(FALSE == Dcm_CheckMemory(0x04 /* READ */, memoryIdentifier, memoryAddress, length))
+		{
+			SendNRC(Instance, DCM_E_REQUEST_OUT_OF_RANGE);
+		}
+		else
+		{
+			checksumRet = Dcm_ChecksumMemory( (1==DCM_RTE.counter)?DCM_INITIAL:DCM_PENDING,
+										memoryIdentifier,
+										memoryAddress,
+										length,
+										&DCM_TXSDU_DATA[4]);
+			if(DCM_READ_OK == checksumRet)
+			{
+				DCM_TXSDU_DATA[1] = DCM_RXSDU_DATA[1];
+				DCM_TXSDU_DATA[2] = DCM_RXSDU_DATA[2];
+				DCM_TXSDU_DATA[3] = DCM_RXSDU_DATA[3];
+				DCM_RTE.txPduLength = 7;
+				SendPRC(Instance);
+			}
+			else if(DCM_READ_PENDING == checksumRet)
+			{
+				/* nothing */
+			}
+			else
+			{
+				SendNRC(Instance, DCM_E_GENERAL_PROGRAMMING_FAILURE);
+			}
+		}
+	}
+	else
+	{
+		SendNRC(Instance, DCM_E_INCORRECT_MESSAGE_LENGTH_OR_INVALID_FORMAT);
+	}
+}
+
 Std_ReturnType BL_TestJumpToApplicatin(uint8 *inBuffer, uint8 *outBuffer, Dcm_NegativeResponseCodeType *errorCode);
 static void BL_StartApplication(PduIdType Instance)
 {
@@ -472,6 +538,9 @@ static void HandleRoutineControlStart(PduIdType Instance)
 		case 0xFF01:
 			BL_StartEraseFlash(Instance);
 			break;
+		case 0xFF02:
+			BL_StartChecksum(Instance);
+			break;
 		case 0xFF03:
 			BL_StartApplication(Instance);
 			break;
@@ -541,7 +610,9 @@ static void HandleRequestDownloadOrUpload(PduIdType Instance, Dcm_UDTStateType s
 		if((addressFormat+lengthFormat+4u) == DCM_RTE.rxPduLength)
 		{
 			if( (addressFormat<=4) && (lengthFormat<=4) && 	\
-				(Dcm_CheckDataFormatIdentifier(dataFormatIdentifier)))
+				(Dcm_CheckDataFormatIdentifier(dataFormatIdentifier)) &&
+				/* no compression for upload */
+				((DCM_UDT_DOWNLOAD_STATE==state) || (0x00u == dataFormatIdentifier)))
 			{
 				uint32 memoryAddress=0u,memorySize=0u;
 				int i;
@@ -555,7 +626,10 @@ static void HandleRequestDownloadOrUpload(PduIdType Instance, Dcm_UDTStateType s
 				}
 
 				if(Dcm_CheckMemory((DCM_UDT_DOWNLOAD_STATE==state)?0x02:0x04,
-						memoryIdentifier, memoryAddress, memorySize))
+						memoryIdentifier, memoryAddress, memorySize) &&
+					((DCM_UDT_DOWNLOAD_STATE!=state) ||
+					 (E_OK == Dcm_ProcessRequestDownload(dataFormatIdentifier, memoryIdentifier,
+							 memoryAddress, memorySize))))
 				{
 					DCM_RTE.UDTData.state   = state;
 					DCM_RTE.UDTData.memoryAddress = memoryAddress;
@@ -620,7 +694,7 @@ static void HandleTransferDownload(PduIdType Instance)
 			memoryAddress = DCM_RTE.UDTData.memoryAddress;
 			length = DCM_RTE.rxPduLength-4;
 			memoryIdentifier = DCM_RXSDU_DATA[3];
-			if(DCM_RTE.UDTData.memorySize < length)
+			if((0u == DCM_RTE.UDTData.dataFormatIdentifier) && (DCM_RTE.UDTData.memorySize < length))
 			{
 				length = DCM_RTE.UDTData.memorySize;
 			}
@@ -638,8 +712,11 @@ static void HandleTransferDownload(PduIdType Instance)
 											&DCM_RXSDU_DATA[4]);
 				if(DCM_WRITE_OK == writeRet)
 				{
-					DCM_RTE.UDTData.memoryAddress += length;
-					DCM_RTE.UDTData.memorySize    -= length;
+					if(0u == DCM_RTE.UDTData.dataFormatIdentifier)
+					{	/* else compressed, tracked by Dcm_WriteMemory */
+						DCM_RTE.UDTData.memoryAddress += length;
+						DCM_RTE.UDTData.memorySize    -= length;
+					}
 					DCM_RTE.UDTData.blockSequenceCounter ++; /* may roll-over from 0xFF to 0x00 */
 
 					/* create positive response code */
@@ -763,8 +840,20 @@ static void HandleRequestTransferExit(PduIdType Instance)
 		if( (DCM_UDT_IDLE_STATE != DCM_RTE.UDTData.state)
 			/* && (0u == DCM_RTE.UDTData.memorySize) */)
 		{
+			if( (DCM_UDT_DOWNLOAD_STATE == DCM_RTE.UDTData.state) &&
+				(E_OK != Dcm_ProcessRequestTransferExit()) )
+			{
+				responseCode = DCM_E_GENERAL_PROGRAMMING_FAILURE;
+			}
 			memset(&DCM_RTE.UDTData,0u,sizeof(DCM_RTE.UDTData)); /* Exit */
-			SendPRC(Instance);
+			if(DCM_E_POSITIVE_RESPONSE == responseCode)
+			{
+				SendPRC(Instance);
+			}
+			else
+			{
+				SendNRC(Instance, responseCode);
+			}
 		}
 		else
 		{
@@ -40,6 +40,28 @@ Dcm_ReturnReadMemoryType __weak Dcm_ReadMemory(Dcm_OpStatusType OpStatus,
 }
 
 
+Std_ReturnType __weak Dcm_ProcessRequestDownload(uint8 DataFormatIdentifier,
+											   uint8 MemoryIdentifier,
+											   uint32 MemoryAddress,
+											   uint32 MemorySize)
+{
+	return E_OK;
+}
+
+Std_ReturnType __weak Dcm_ProcessRequestTransferExit(void)
+{
+	return E_OK;
+}
+
+Dcm_ReturnReadMemoryType __weak Dcm_ChecksumMemory(Dcm_OpStatusType OpStatus,
+											   uint8 MemoryIdentifier,
+											   uint32 MemoryAddress,
+											   uint32 MemorySize,
+											   uint8* Checksum)
+{
+	return DCM_READ_FAILED;
+}
+
 Dcm_ReturnEraseMemoryType __weak Dcm_EraseMemory(Dcm_OpStatusType OpStatus,
 											   uint8 MemoryIdentifier,
 											   uint32 MemoryAddress,
@@ -204,9 +204,13 @@ typedef enum{
 	DCM_MEMORY_READ,
 	DCM_MEMORY_WRITE,
 	DCM_MEMORY_ERASE,
+	DCM_MEMORY_CHECKSUM,
 	DCM_MEMORY_FAILED	
 }Dcm_DspMemoryStateType;
 static Dcm_DspMemoryStateType dspMemoryState;
+#ifdef __AS_BOOTLOADER__
+static uint8* dspChecksumData;
+#endif
 
 typedef enum{
 	DCM_DDD_SOURCE_DEFAULT,
@@ -355,6 +359,27 @@ static void DspMainFunctionErase(void)
 
 	}
 }
+#ifdef __AS_BOOTLOADER__
+static void DspMainFunctionChecksum(void)
+{
+	Dcm_ReturnReadMemoryType ChecksumRet;
+	ChecksumRet = Dcm_ChecksumMemory(DCM_PENDING,0,0,0,dspChecksumData);
+	if(ChecksumRet == DCM_READ_OK)/* asynchronous checksum is OK */
+	{
+		DsdDspProcessingDone(DCM_E_POSITIVE_RESPONSE);
+		dspMemoryState = DCM_MEMORY_UNUSED;
+	}
+	else if(ChecksumRet == DCM_READ_FAILED)
+	{
+		DsdDspProcessingDone(DCM_E_GENERAL_PROGRAMMING_FAILURE);
+		dspMemoryState = DCM_MEMORY_UNUSED;
+	}
+	else
+	{
+
+	}
+}
+#endif
 /* OBD */
 /*
 *   end  
@@ -421,6 +446,11 @@ void DspMemoryMainFunction(void)
 		case DCM_MEMORY_ERASE:
 			DspMainFunctionErase();
 			break;
+#ifdef __AS_BOOTLOADER__
+		case DCM_MEMORY_CHECKSUM:
+			DspMainFunctionChecksum();
+			break;
+#endif
 			default:
 			break;
 	}
@@ -1976,7 +2006,7 @@ void DspUdsRoutineControl(const PduInfoType *pduRxData, PduInfoType *pduTxData)
 
 	if ( (responseCode == DCM_E_POSITIVE_RESPONSE)
 		#ifdef __AS_BOOTLOADER__
-		|| ((responseCode == DCM_E_RESPONSE_PENDING) && (0xFF01 == routineId))
+		|| ((responseCode == DCM_E_RESPONSE_PENDING) && ((0xFF01 == routineId) || (0xFF02 == routineId)))
 		#endif
 	   )
 	{
@@ -1990,6 +2020,10 @@ void DspUdsRoutineControl(const PduInfoType *pduRxData, PduInfoType *pduTxData)
 	{
 		dspMemoryState=DCM_MEMORY_ERASE;
 	}
+	else if ((responseCode == DCM_E_RESPONSE_PENDING) && (0xFF02 == routineId))
+	{
+		dspMemoryState=DCM_MEMORY_CHECKSUM;
+	}
 	else
 	#endif
 	{
@@ -4417,7 +4451,7 @@ void DspObdRequestvehicleinformation(const PduInfoType *pduRxData,PduInfoType *p
 #endif
 
 #if defined(DCM_USE_SERVICE_REQUEST_DOWNLOAD) || defined(DCM_USE_SERVICE_REQUEST_UPLOAD)
-static boolean checkDataFormatIdentifier(uint8 dataFormatIdentifier)
+static boolean checkDataFormatIdentifier(DspMemoryServiceType serviceType, uint8 dataFormatIdentifier)
 {
 	boolean rv = FALSE;
 
@@ -4426,12 +4460,18 @@ static boolean checkDataFormatIdentifier(uint8 dataFormatIdentifier)
 		rv = TRUE; //no compressionMethod nor encryptingMethod is used
 
 	}
-	else
-	{
-#ifdef Dcm_UserCheckDataFormatIdentifier
+	else if(DCM_WRITE_MEMORY == serviceType)
+	{	/* only download supports compression */
+#if defined(Dcm_UserCheckDataFormatIdentifier)
 		rv = Dcm_UserCheckDataFormatIdentifier(dataFormatIdentifier);
+#elif defined(__AS_BOOTLOADER__)
+		rv = Dcm_CheckDataFormatIdentifier(dataFormatIdentifier);
 #endif
 	}
+	else
+	{
+		/* rv = FALSE */
+	}
 
 	return rv;
 }
@@ -4452,7 +4492,7 @@ void DspRequestDownload(const PduInfoType *pduRxData,PduInfoType *pduTxData)
 			if(DCM_UDT_IDLE_STATE == dspUDTData.state )
 			{
 				if( (addressFormat<=4) && (lengthFormat<=4) && 	\
-					(checkDataFormatIdentifier(dataFormatIdentifier)))
+					(checkDataFormatIdentifier(DCM_WRITE_MEMORY,dataFormatIdentifier)))
 				{
 					uint32 memoryAddress=0u,memorySize=0u;
 					for(int i=0;i<addressFormat;i++)
@@ -4466,6 +4506,12 @@ void DspRequestDownload(const PduInfoType *pduRxData,PduInfoType *pduTxData)
 
 					responseCode = checkAddressRange(DCM_WRITE_MEMORY,memoryIdentifier,memoryAddress,memorySize);
 
+					if( (DCM_E_POSITIVE_RESPONSE == responseCode) &&
+						(E_OK != Dcm_ProcessRequestDownload(dataFormatIdentifier,memoryIdentifier,memoryAddress,memorySize)) )
+					{
+						responseCode = DCM_E_REQUEST_OUT_OF_RANGE;
+					}
+
 					if(DCM_E_POSITIVE_RESPONSE == responseCode)
 					{
 						dspUDTData.state   = DCM_UDT_DOWNLOAD_STATE;
@@ -4521,7 +4567,7 @@ void DspRequestUpload(const PduInfoType *pduRxData,PduInfoType *pduTxData)
 			if(DCM_UDT_IDLE_STATE == dspUDTData.state )
 			{
 				if( (addressFormat<=4) && (lengthFormat<=4) && 	\
-					(checkDataFormatIdentifier(dataFormatIdentifier)))
+					(checkDataFormatIdentifier(DCM_READ_MEMORY,dataFormatIdentifier)))
 				{
 					uint32 memoryAddress=0u,memorySize=0u;
 					for(int i=0;i<addressFormat;i++)
@@ -4650,7 +4696,7 @@ void DspTransferData(const PduInfoType *pduRxData,PduInfoType *pduTxData)
 				memoryAddress = dspUDTData.memoryAddress;
 				length = pduRxData->SduLength-4;
 				memoryIdentifier = pduRxData->SduDataPtr[3];
-				if(dspUDTData.memorySize < length)
+				if((0u == dspUDTData.dataFormatIdentifier) && (dspUDTData.memorySize < length))
 				{
 					length = dspUDTData.memorySize;
 				}
@@ -4672,8 +4718,11 @@ void DspTransferData(const PduInfoType *pduRxData,PduInfoType *pduTxData)
 						dspMemoryState = DCM_MEMORY_WRITE;
 					}
 
-					dspUDTData.memoryAddress += length;
-					dspUDTData.memorySize    -= length;
+					if(0u == dspUDTData.dataFormatIdentifier)
+					{	/* else compressed, tracked by Dcm_WriteMemory */
+						dspUDTData.memoryAddress += length;
+						dspUDTData.memorySize    -= length;
+					}
 					dspUDTData.blockSequenceCounter ++; // may roll-over from 0xFF to 0x00
 
 					// create positive response code
@@ -4721,6 +4770,11 @@ void DspRequestTransferExit(const PduInfoType *pduRxData,PduInfoType *pduTxData)
 		if( (DCM_UDT_IDLE_STATE != dspUDTData.state)
 			/* && (0u == dspUDTData.memorySize) */)
 		{
+			if( (DCM_UDT_DOWNLOAD_STATE == dspUDTData.state) &&
+				(E_OK != Dcm_ProcessRequestTransferExit()) )
+			{
+				responseCode = DCM_E_GENERAL_PROGRAMMING_FAILURE;
+			}
 			memset(&dspUDTData,0u,sizeof(dspUDTData)); // Exit
 			pduTxData->SduLength = 1;
 		}
@@ -4768,6 +4822,36 @@ Std_ReturnType BL_StartEraseFlash(uint8 *inBuffer, uint8 *outBuffer, Dcm_Negativ
 
 	return E_OK;
 }
+
+Std_ReturnType BL_StartChecksum(uint8 *inBuffer, uint8 *outBuffer, Dcm_NegativeResponseCodeType *errorCode)
+{
+	uint32 memoryAddress = ((uint32)inBuffer[0]<<24) + ((uint32)inBuffer[1]<<16) + ((uint32)inBuffer[2]<<8) +((uint32)inBuffer[3]);
+	uint32 length  = ((uint32)inBuffer[4]<<24) + ((uint32)inBuffer[5]<<16) + ((uint32)inBuffer[6]<<8) +((uint32)inBuffer[7]);
+	uint8  memoryIdentifier = inBuffer[8];
+	Dcm_ReturnReadMemoryType checksumRet;
+
+	*errorCode = checkAddressRange(DCM_READ_MEMORY, memoryIdentifier, memoryAddress, length);
+
+	if( DCM_E_POSITIVE_RESPONSE == *errorCode )
+	{
+		checksumRet = Dcm_ChecksumMemory(DCM_INITIAL, memoryIdentifier, memoryAddress, length, outBuffer);
+		if(DCM_READ_FAILED == checksumRet)
+		{
+			*errorCode = DCM_E_GENERAL_PROGRAMMING_FAILURE;
+		}
+		else if(DCM_READ_PENDING == checksumRet)
+		{	/* the CRC is computed by the DspMemoryMainFunction cycle by cycle */
+			dspChecksumData = outBuffer;
+			*errorCode = DCM_E_RESPONSE_PENDING;
+		}
+		else
+		{
+			/* OK */
+		}
+	}
+
+	return E_OK;
+}
 #endif
 
 #endif /* USE_DCM */
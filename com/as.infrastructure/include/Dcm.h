@@ -106,6 +106,17 @@ void Dcm_MainFunction( void ); /** @req DCM053 */
 Dcm_ReturnEraseMemoryType Dcm_EraseMemory(Dcm_OpStatusType OpStatus, uint8 MemoryIdentifier, uint32 MemoryAddress, uint32 MemorySize);
 Dcm_ReturnWriteMemoryType Dcm_WriteMemory(Dcm_OpStatusType OpStatus, uint8 MemoryIdentifier, uint32 MemoryAddress, uint32 MemorySize, uint8* MemoryData);
 Dcm_ReturnReadMemoryType  Dcm_ReadMemory(Dcm_OpStatusType OpStatus, uint8 MemoryIdentifier, uint32 MemoryAddress, uint32 MemorySize, uint8* MemoryData);
+boolean Dcm_CheckDataFormatIdentifier(uint8 dataFormatIdentifier);
+/* For a download with compressionMethod(dataFormatIdentifier != 0), the data of each
+ * TransferData is passed as is to Dcm_WriteMemory, the callout is then responsible for
+ * the decompression and the tracking of the memory address and size. */
+Std_ReturnType Dcm_ProcessRequestDownload(uint8 DataFormatIdentifier, uint8 MemoryIdentifier, uint32 MemoryAddress, uint32 MemorySize);
+/* RequestTransferExit of a download, E_NOT_OK if the data is not completely written, the
+ * transfer is then ended with NRC generalProgrammingFailure */
+Std_ReturnType Dcm_ProcessRequestTransferExit(void);
+/* CRC32(IEEE 802.3) of the memory, may be computed piece by piece with DCM_READ_PENDING,
+ * the result is stored into Checksum in big endian when DCM_READ_OK */
+Dcm_ReturnReadMemoryType Dcm_ChecksumMemory(Dcm_OpStatusType OpStatus, uint8 MemoryIdentifier, uint32 MemoryAddress, uint32 MemorySize, uint8* Checksum);
 void Dcm_DiagnosticSessionControl(Dcm_SesCtrlType session);
 Std_ReturnType DcmE_EcuReset(Dcm_EcuResetType resetType);
 void DcmE_EcuPerformReset(Dcm_EcuResetType resetType);
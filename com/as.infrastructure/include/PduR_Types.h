@@ -94,14 +94,42 @@ typedef enum {
 	PDUR_BUFFER_TX_READY,
 	PDUR_BUFFER_TX_BUSY,
 	PDUR_BUFFER_NOT_ALLOCATED_FROM_UP_MODULE,
-	PDUR_BUFFER_ALLOCATED_FROM_UP_MODULE
+	PDUR_BUFFER_ALLOCATED_FROM_UP_MODULE,
+	PDUR_BUFFER_CUT_THROUGH
 } PduRTpBufferStatus_type;
 
+/* TP buffer in the pool shared by all the gateway routes, 0 so that an
+ * initializer which leaves reservedRoute out gives a shared buffer */
+#define PDUR_TP_BUFFER_SHARED ((PduIdType)0)
+/* TP buffer reserved for the route, stored as route + 1 */
+#define PDUR_TP_BUFFER_RESERVED(route) ((PduIdType)((route) + 1))
+
 typedef struct {
 	PduInfoType *pduInfoPtr;
 	PduRTpBufferStatus_type status;
 	uint16 bufferSize;
 	uint8 nAcc;
+	/* PDUR_TP_BUFFER_RESERVED(route) for the route the buffer is reserved for,
+	 * or PDUR_TP_BUFFER_SHARED.
+	 * A route takes its reserved buffers first, then the best fit of the pool. */
+	PduIdType reservedRoute;
+
+	/* Runtime of the routing on the fly, the buffer is used as a ring:
+	 * [tail: tx chunk][ready][rx chunk][free: head] */
+	PduInfoType rxChunk;
+	PduInfoType txChunk;
+	PduLengthType total;    /* length of the N-SDU */
+	PduLengthType rxCount;  /* bytes received */
+	PduLengthType rxRemain; /* bytes not yet given to the source TP */
+	uint16 head;
+	uint16 tail;
+	uint16 free;
+	uint16 ready;
+	boolean txStarted;
+	boolean rxDone;
+	boolean txDone;
+	boolean aborted;
+	uint32 startTick;
 } PduRTpBufferInfo_type;
 
 typedef struct {
@@ -148,7 +176,9 @@ typedef struct {
 	const uint16 SduLength;
 
 	/**
-	 * Chunk size for routing on the fly.
+	 * Chunk size for routing on the fly: the destination TP is started
+	 * once this number of bytes has been received, 0 or 0xFFFF to store
+	 * the whole N-SDU before it's forwarded.
 	 *
 	 * Comment: Only required for TP gateway PDUs.
 	 */
@@ -133,6 +133,7 @@
 #define SOAD_SOCKET_UDP_READ_ID				0xa1u
 #define SOAD_SCAN_SOCKETS_ID				0xa2u
 #define SOAD_SOCKET_CLOSE_ID				0xa3u
+#define SOAD_BUFFER_FREE_ID					0xa4u
 
 #define SOAD_DOIP_HANDLE_DIAG_MSG_ID		0xb0u
 #define SOAD_DOIP_CREATE_AND_SEND_NACK_ID	0xb1u
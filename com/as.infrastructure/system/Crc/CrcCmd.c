@@ -0,0 +1,207 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2018  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifdef USE_CRC_CMD
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "Crc_Internal.h"
+#include "shell.h"
+#include "Os.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#ifndef CRC_CMD_BUFFER_SIZE
+#define CRC_CMD_BUFFER_SIZE 4096
+#endif
+
+/* cross check all the lengths up to it with all the 8 alignments */
+#ifndef CRC_CMD_CHECK_SIZE
+#define CRC_CMD_CHECK_SIZE 300
+#endif
+
+/* run each kernel at least this long for the benchmark */
+#ifndef CRC_CMD_BENCH_MS
+#define CRC_CMD_BENCH_MS 500
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct
+{
+	const char* name;
+	uint32 (*crc32)(const uint8 *s, uint32 len, uint32 startVal);
+	uint16 (*crc16)(const uint8 *s, uint32 len, uint16 startVal);
+} CrcCmd_KernelType;
+/* ============================ [ DECLARES  ] ====================================================== */
+static int shellCrc(int argc, char *argv[]);
+/* ============================ [ DATAS     ] ====================================================== */
+SHELL_CONST ShellCmdT cmdCrc  = {
+		shellCrc,
+		1,1,
+		"crc",
+		"crc test|bench",
+		"test: check the CRC kernels with the standard vectors and against each other\n"
+		"bench: throughput of each CRC kernel in MB/s\n",
+		{NULL,NULL}
+};
+SHELL_CMD_EXPORT(cmdCrc)
+
+static const CrcCmd_KernelType crcCmdKernels[] = {
+	{ "table", Crc_CalculateCRC32Table, Crc_CalculateCRC16Table },
+	{ "slice-by-8", Crc_CalculateCRC32Slice8, Crc_CalculateCRC16Slice8 },
+#ifdef CRC_32_HW_ENABLED
+	{ "hw", Crc_CalculateCRC32Hw, Crc_CalculateCRC16Slice8 },
+#endif
+};
+
+static uint8 crcCmdBuffer[CRC_CMD_BUFFER_SIZE];
+/* keeps the benchmark results alive */
+static volatile uint32 crcCmdSink;
+/* ============================ [ LOCALS    ] ====================================================== */
+static void fill_buffer(void)
+{
+	uint32 i;
+	uint32 seed = 0x12345678;
+
+	for(i=0; i<sizeof(crcCmdBuffer); i++)
+	{
+		seed = seed*1103515245 + 12345;
+		crcCmdBuffer[i] = (uint8)(seed>>16);
+	}
+}
+
+static int check_kernel(const CrcCmd_KernelType* kernel)
+{
+	int rv = 0;
+	uint32 len, offset, split;
+	uint32 crc32, ref32;
+	uint16 crc16, ref16;
+	static const uint8 vector[] = "123456789";
+
+	/* the check values of CRC-32 and CRC-16/CCITT-FALSE */
+	crc32 = ~kernel->crc32(vector, 9, 0xFFFFFFFF);
+	crc16 = kernel->crc16(vector, 9, 0xFFFF);
+	if((0xCBF43926 != crc32) || (0x29B1 != crc16))
+	{
+		SHELL_printf("  %s: check value %08X %04X\n", kernel->name, crc32, crc16);
+		rv = -1;
+	}
+
+	for(offset=0; (0 == rv) && (offset < 8); offset++)
+	{
+		for(len=0; (0 == rv) && (len <= CRC_CMD_CHECK_SIZE); len++)
+		{
+			ref32 = Crc_CalculateCRC32Table(&crcCmdBuffer[offset], len, 0xFFFFFFFF);
+			ref16 = Crc_CalculateCRC16Table(&crcCmdBuffer[offset], len, 0xFFFF);
+			crc32 = kernel->crc32(&crcCmdBuffer[offset], len, 0xFFFFFFFF);
+			crc16 = kernel->crc16(&crcCmdBuffer[offset], len, 0xFFFF);
+			/* the calculation may be done piece by piece */
+			split = len/3;
+			if((ref32 != crc32) || (ref16 != crc16) ||
+				(ref32 != kernel->crc32(&crcCmdBuffer[offset+split], len-split,
+						kernel->crc32(&crcCmdBuffer[offset], split, 0xFFFFFFFF))) ||
+				(ref16 != kernel->crc16(&crcCmdBuffer[offset+split], len-split,
+						kernel->crc16(&crcCmdBuffer[offset], split, 0xFFFF))))
+			{
+				SHELL_printf("  %s: mismatch at offset %d length %d\n", kernel->name, (int)offset, (int)len);
+				rv = -1;
+			}
+		}
+	}
+
+	if(0 == rv)
+	{
+		ref32 = Crc_CalculateCRC32Table(crcCmdBuffer, sizeof(crcCmdBuffer), 0);
+		ref16 = Crc_CalculateCRC16Table(crcCmdBuffer, sizeof(crcCmdBuffer), 0);
+		if((ref32 != kernel->crc32(crcCmdBuffer, sizeof(crcCmdBuffer), 0)) ||
+			(ref16 != kernel->crc16(crcCmdBuffer, sizeof(crcCmdBuffer), 0)))
+		{
+			SHELL_printf("  %s: mismatch on %d bytes\n", kernel->name, (int)sizeof(crcCmdBuffer));
+			rv = -1;
+		}
+	}
+
+	return rv;
+}
+
+static uint32 bench_kernel(const CrcCmd_KernelType* kernel, boolean is16)
+{
+	TickType start, ticks;
+	uint64 bytes = 0;
+	uint32 crc = 0;
+
+	start = GetOsTick();
+	do
+	{
+		if(is16)
+		{
+			crc ^= kernel->crc16(crcCmdBuffer, sizeof(crcCmdBuffer), (uint16)crc);
+		}
+		else
+		{
+			crc = kernel->crc32(crcCmdBuffer, sizeof(crcCmdBuffer), crc);
+		}
+		bytes += sizeof(crcCmdBuffer);
+		ticks = GetOsElapsedTick(start);
+	} while(ticks < MS2TICKS(CRC_CMD_BENCH_MS));
+
+	crcCmdSink = crc;
+	/* KB/s */
+	return (uint32)((bytes*OS_TICKS_PER_SECOND)/((uint64)ticks*1024));
+}
+
+static int shellCrc(int argc, char *argv[])
+{
+	int rv = 0;
+	uint32 i;
+	uint32 kbps32, kbps16;
+	(void)argc;
+
+	fill_buffer();
+	if(0 == strcmp(argv[1], "test"))
+	{
+		for(i=0; i<ARRAY_SIZE(crcCmdKernels); i++)
+		{
+			if(0 == check_kernel(&crcCmdKernels[i]))
+			{
+				SHELL_printf("  %s: pass\n", crcCmdKernels[i].name);
+			}
+			else
+			{
+				rv = -1;
+			}
+		}
+	}
+	else if(0 == strcmp(argv[1], "bench"))
+	{
+		SHELL_printf("  %-12s %10s %10s\n", "kernel", "CRC32 MB/s", "CRC16 MB/s");
+		for(i=0; i<ARRAY_SIZE(crcCmdKernels); i++)
+		{
+			kbps32 = bench_kernel(&crcCmdKernels[i], FALSE);
+			kbps16 = bench_kernel(&crcCmdKernels[i], TRUE);
+			SHELL_printf("  %-12s %6d.%02d  %6d.%02d\n", crcCmdKernels[i].name,
+					(int)(kbps32/1024), (int)((kbps32%1024)*100/1024),
+					(int)(kbps16/1024), (int)((kbps16%1024)*100/1024));
+		}
+#ifdef CRC_32_HW_ENABLED
+		if(FALSE == Crc_IsHwAvailable())
+		{
+			SHELL_printf("  hw: no CRC instructions on this CPU, it's slice-by-8\n");
+		}
+#endif
+	}
+	else
+	{
+		rv = -1;
+	}
+
+	return rv;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+#endif /* USE_CRC_CMD */
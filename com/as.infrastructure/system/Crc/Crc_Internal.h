@@ -0,0 +1,56 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2018  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifndef CRC_INTERNAL_H_
+#define CRC_INTERNAL_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "Crc.h"
+/* ============================ [ MACROS    ] ====================================================== */
+/* The kernel behind Crc_CalculateCRC32/16 is selected by Kconfig:
+ *   CRC_TABLE:      the classic byte by byte table, for the targets short of ROM
+ *   CRC_SLICE_BY_8: 8 bytes per step with 7KB(CRC32) + 3.5KB(CRC16) more tables
+ *   CRC_HW:         CRC32 by ARMv8 CRC32 instructions or x86 PCLMULQDQ folding, slice-by-8
+ *                   for the rest and for the CPU without the instructions.
+ * The crc shell command needs all of them to cross check and benchmark. */
+#if !defined(USE_CRC_TABLE) || defined(USE_CRC_CMD)
+#define CRC_SLICE_BY_8_ENABLED
+#endif
+
+/* SSE4.2 crc32 instruction is the Castagnoli polynomial, not usable for IEEE-802.3 */
+#if defined(USE_CRC_HW) || defined(USE_CRC_CMD)
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC_32_HW_ARMV8
+#define CRC_32_HW_ENABLED
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC_32_HW_PCLMUL
+#define CRC_32_HW_ENABLED
+#endif
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+uint32 Crc_CalculateCRC32Table(const uint8 *s, uint32 len, uint32 startVal);
+uint16 Crc_CalculateCRC16Table(const uint8 *s, uint32 len, uint16 startVal);
+#ifdef CRC_SLICE_BY_8_ENABLED
+uint32 Crc_CalculateCRC32Slice8(const uint8 *s, uint32 len, uint32 startVal);
+uint16 Crc_CalculateCRC16Slice8(const uint8 *s, uint32 len, uint16 startVal);
+#endif
+#ifdef CRC_32_HW_ENABLED
+/* FALSE if the CPU running has no such instructions, Crc_CalculateCRC32Hw falls back to slice-by-8 */
+boolean Crc_IsHwAvailable(void);
+uint32 Crc_CalculateCRC32Hw(const uint8 *s, uint32 len, uint32 startVal);
+#endif
+#endif /* CRC_INTERNAL_H_ */
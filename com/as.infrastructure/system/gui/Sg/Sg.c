@@ -25,8 +25,19 @@
 #include "json-c/json.h"
 #endif
 /* ============================ [ MACROS    ] ====================================================== */
-
+#define SG_AREA_IS_EMPTY(a) (((a)->x0 >= (a)->x1) || ((a)->y0 >= (a)->y1))
 /* ============================ [ TYPES     ] ====================================================== */
+#ifdef USE_LCD
+typedef struct
+{	/* the widget as drawn by the last frame */
+	SgArea a;
+	uint32 x;
+	uint32 y;
+	uint16 d;
+	uint8  l;
+	uint8  ri;
+}SgWidgetState;
+#endif
 /* ============================ [ DECLARES  ] ====================================================== */
 #ifdef USE_AWS
 extern int AsWsjOnline(void);
@@ -38,9 +49,24 @@ static boolean sgUpdateInProcessing  = FALSE;
 static uint8   sgLayer = 0;
 static uint32  sgWI    = 0;
 static uint32  sgX     = 0;
+static uint32  sgDI    = 0;	/* dirty area index of the widget in drawing */
+static boolean sgDamaged = FALSE;
+static SgArea  sgClip;
+static SgArea  sgDirty[SG_DIRTY_MAX];
+static uint32  sgDirtyNum = 0;
+static SgArea  sgReady[SG_DIRTY_MAX];
+static uint32  sgReadyNum = 0;
+static SgWidgetState sgState[SGW_MAX];
 #endif
 /* ============================ [ LOCALS    ] ====================================================== */
 #ifdef USE_LCD
+static void SgDrawClipPixel(uint32 x, uint32 y, uint32 c)
+{
+	if((x >= sgClip.x0) && (x < sgClip.x1) && (y >= sgClip.y0) && (y < sgClip.y1))
+	{
+		Sg_DrawPixel(x,y,c);
+	}
+}
 static void	SgDrawDot(uint32 x, uint32 y,const uint8* d,uint32 c)
 {
 	uint8 w,h;
@@ -55,7 +81,7 @@ static void	SgDrawDot(uint32 x, uint32 y,const uint8* d,uint32 c)
 			uint8 Dot = d[Y*((w+7)/8)+X/8];
 			if(Dot&(1<<(X&7)))
 			{
-				Sg_DrawPixel(X+x,Y+y,c);
+				SgDrawClipPixel(X+x,Y+y,c);
 			}
 		}
 	}
@@ -82,13 +108,15 @@ static const uint8* SgfLookup(const SgTXT* txt,uint16 code)
 
 	return NULL;
 }
-static boolean SgDrawBMP0(SgWidget* w)
+static boolean SgDrawBMP0(SgWidget* w, uint32* weight)
 {
 	boolean rv;
 	const SgBMP* bmp;
 	uint32 x,y,W,H,color;
 	uint32 X;
 	uint32 Y;
+	uint32 x0,x1,y0,y1;
+	uint32 columns;
 	uint32 width;
 	bmp = (SgBMP*)w->src->r[w->ri];
 	W = bmp->w;
@@ -96,42 +124,50 @@ static boolean SgDrawBMP0(SgWidget* w)
 	X = w->x;
 	Y = w->y;
 
-	width = (w->src->weight+99)/100;
-	x = (W+width-1)/width;
-
-	if((sgX+x) < W)
-	{
-		width=sgX+x;
-		rv = FALSE;
-	}
-	else
-	{
-		width = W;
-		rv = TRUE;
-	}
-
-
 	if( (w->w >= W) && (w->h >= H) )
 	{
 		X += (w->w-W)/2;
 		Y += (w->h-H)/2;
-		for(x=sgX;x<width;x++)
+		/* the clip is inside the BMP, only its columns and rows are drawn */
+		x0 = sgClip.x0 - X;
+		x1 = sgClip.x1 - X;
+		y0 = sgClip.y0 - Y;
+		y1 = sgClip.y1 - Y;
+
+		width = (w->src->weight+99)/100;
+		columns = (W+width-1)/width;
+
+		if((x0+sgX+columns) < x1)
+		{
+			width=x0+sgX+columns;
+			rv = FALSE;
+		}
+		else
+		{
+			width = x1;
+			rv = TRUE;
+		}
+
+		for(y=y0;y<y1;y++)
 		{
-			for(y=0;y<H;y++)
+			for(x=x0+sgX;x<width;x++)
 			{
 				color = bmp->p[y*W + x];
 				Sg_DrawPixel(X+x,Y+y,color);
 			}
 		}
+		/* each full columns of the BMP weight 100 */
+		*weight += (100*(width-x0-sgX)*(y1-y0) + columns*H - 1)/(columns*H);
+
+		sgX = width - x0;
 	}
 	else
 	{
 		/* out of range */
 		asAssert(0);
+		rv = TRUE;
 	}
 
-	sgX = width;
-
 	return rv;
 }
 #if defined(__WINDOWS__) || defined(__LINUX__)
@@ -175,25 +211,22 @@ static boolean SgDrawBMPd(SgWidget* w)
 			cy = Yc + y - bmp->y;
 			Sg_Calc(&cx,&cy,Xc,Yc,w->d);
 			color = bmp->p[y*W + x];
-			Sg_DrawPixel(cx,cy,color);
-			Sg_DrawPixel(cx+1,cy,color);
+			SgDrawClipPixel(cx,cy,color);
+			SgDrawClipPixel(cx+1,cy,color);
 		}
 	}
 
 	return TRUE;
 }
-static boolean SgDrawBMP(SgWidget* w)
+static boolean SgDrawBMP(SgWidget* w, uint32* weight)
 {
 	boolean rv;
-	if(NULL != w->src->rf)
-	{
-		w->src->rf(w);
-	}
+	/* refreshed by SgDamage of this frame */
 	if(w->ri < w->src->rs)
 	{
 		if(0xFFFF == w->d)
 		{	/* no degree */
-			rv=SgDrawBMP0(w);
+			rv=SgDrawBMP0(w,weight);
 		}
 		else
 		{	/* draw with rotation */
@@ -245,7 +278,7 @@ static boolean SgDrawTXT(SgWidget* w)
 
 	return TRUE;
 }
-static boolean SgDrawWidget(SgWidget* w)
+static boolean SgDrawWidget(SgWidget* w, uint32* weight)
 {
 	boolean rv;
 	switch(w->src->t)
@@ -254,7 +287,7 @@ static boolean SgDrawWidget(SgWidget* w)
 			rv = TRUE;
 			break;
 		case SGT_BMP:
-			rv = SgDrawBMP(w);
+			rv = SgDrawBMP(w,weight);
 			break;
 		case SGT_TXT:
 			rv =SgDrawTXT(w);
@@ -281,6 +314,177 @@ static void SgCache(void)
 		}
 	}
 }
+
+static boolean SgAreaClip(const SgArea* a, const SgArea* b, SgArea* clip)
+{
+	clip->x0 = (a->x0 > b->x0) ? a->x0 : b->x0;
+	clip->y0 = (a->y0 > b->y0) ? a->y0 : b->y0;
+	clip->x1 = (a->x1 < b->x1) ? a->x1 : b->x1;
+	clip->y1 = (a->y1 < b->y1) ? a->y1 : b->y1;
+
+	return SG_AREA_IS_EMPTY(clip) ? FALSE : TRUE;
+}
+
+static void SgAreaUnion(SgArea* a, const SgArea* b)
+{
+	if(b->x0 < a->x0) { a->x0 = b->x0; }
+	if(b->y0 < a->y0) { a->y0 = b->y0; }
+	if(b->x1 > a->x1) { a->x1 = b->x1; }
+	if(b->y1 > a->y1) { a->y1 = b->y1; }
+}
+
+static uint32 SgAreaSize(const SgArea* a)
+{
+	return (a->x1-a->x0)*(a->y1-a->y0);
+}
+
+static void SgWidgetArea(SgWidget* w, SgArea* a)
+{
+	const SgBMP* bmp;
+	uint32 i,x,y;
+	sint32 X0 = 0, Y0 = 0, X1 = 0, Y1 = 0;
+
+	if((w->l < SGL_MAX) && (w->ri < w->src->rs))
+	{
+		switch(w->src->t)
+		{
+			case SGT_BMP:
+				bmp = (SgBMP*)w->src->r[w->ri];
+				if(0xFFFF == w->d)
+				{
+					if( (w->w >= bmp->w) && (w->h >= bmp->h) )
+					{
+						X0 = w->x + (w->w-bmp->w)/2;
+						Y0 = w->y + (w->h-bmp->h)/2;
+						X1 = X0 + bmp->w;
+						Y1 = Y0 + bmp->h;
+					}
+				}
+				else
+				{	/* box of the rotated corners, the BMP is drawn 2 dots wide */
+					for(i=0;i<4;i++)
+					{
+						x = w->x - bmp->x + ((i&1) ? (bmp->w-1) : 0);
+						y = w->y - bmp->y + ((i&2) ? (bmp->h-1) : 0);
+						Sg_Calc(&x,&y,w->x,w->y,w->d);
+						if((0 == i) || ((sint32)x < X0)) { X0 = (sint32)x; }
+						if((0 == i) || ((sint32)y < Y0)) { Y0 = (sint32)y; }
+						if((0 == i) || ((sint32)x > X1)) { X1 = (sint32)x; }
+						if((0 == i) || ((sint32)y > Y1)) { Y1 = (sint32)y; }
+					}
+					/* 1 more each side for the rounding */
+					X0 -= 1;
+					Y0 -= 1;
+					X1 += 3;
+					Y1 += 2;
+				}
+				break;
+			case SGT_TXT:
+				X0 = w->x;
+				Y0 = w->y;
+				X1 = w->x + w->w;
+				Y1 = w->y + w->h;
+				break;
+			default:
+				/* SGT_DMP draws nothing */
+				break;
+		}
+	}
+
+	a->x0 = (X0 < 0) ? 0 : ((X0 > SG_LCD_WIGTH)  ? SG_LCD_WIGTH  : X0);
+	a->y0 = (Y0 < 0) ? 0 : ((Y0 > SG_LCD_HEIGHT) ? SG_LCD_HEIGHT : Y0);
+	a->x1 = (X1 < 0) ? 0 : ((X1 > SG_LCD_WIGTH)  ? SG_LCD_WIGTH  : X1);
+	a->y1 = (Y1 < 0) ? 0 : ((Y1 > SG_LCD_HEIGHT) ? SG_LCD_HEIGHT : Y1);
+}
+
+static void SgDirtyAdd(const SgArea* area)
+{
+	uint32 i,best,grow,size;
+	boolean added = FALSE;
+	SgArea a = *area;
+	SgArea u;
+
+	if(SG_AREA_IS_EMPTY(&a))
+	{
+		return;
+	}
+
+	while(FALSE == added)
+	{
+		i = 0;
+		while(i < sgDirtyNum)
+		{
+			if(TRUE == SgAreaClip(&a,&sgDirty[i],&u))
+			{	/* overlapped, take the union and look again at the others */
+				SgAreaUnion(&a,&sgDirty[i]);
+				sgDirtyNum--;
+				sgDirty[i] = sgDirty[sgDirtyNum];
+				i = 0;
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		if(sgDirtyNum < SG_DIRTY_MAX)
+		{
+			sgDirty[sgDirtyNum] = a;
+			sgDirtyNum++;
+			added = TRUE;
+		}
+		else
+		{	/* full, merge with the one grows the least */
+			best = 0;
+			grow = (uint32)-1;
+			for(i=0;i<sgDirtyNum;i++)
+			{
+				u = sgDirty[i];
+				SgAreaUnion(&u,&a);
+				size = SgAreaSize(&u) - SgAreaSize(&sgDirty[i]);
+				if(size < grow)
+				{
+					grow = size;
+					best = i;
+				}
+			}
+			SgAreaUnion(&a,&sgDirty[best]);
+			sgDirtyNum--;
+			sgDirty[best] = sgDirty[sgDirtyNum];
+		}
+	}
+}
+
+static void SgDamage(void)
+{	/* both the old and the new area of the changed widgets are to be redrawn */
+	uint32 i;
+	SgWidget* w;
+	SgWidgetState* s;
+	SgArea a;
+	for(i=0;i<SGW_MAX;i++)
+	{
+		w = &SGWidget[i];
+		s = &sgState[i];
+		if((SGT_BMP == w->src->t) && (NULL != w->src->rf))
+		{
+			w->src->rf(w);
+		}
+		SgWidgetArea(w,&a);
+		if( (SGT_TXT == w->src->t) ||	/* the text is only known at draw */
+			(s->x != w->x) || (s->y != w->y) || (s->d != w->d) ||
+			(s->l != w->l) || (s->ri != w->ri) )
+		{
+			SgDirtyAdd(&s->a);
+			SgDirtyAdd(&a);
+			s->x  = w->x;
+			s->y  = w->y;
+			s->d  = w->d;
+			s->l  = w->l;
+			s->ri = w->ri;
+		}
+		s->a = a;
+	}
+}
 #endif /* USE_LCD */
 /* ============================ [ FUNCTIONS ] ====================================================== */
 #ifdef USE_AWS
@@ -329,9 +533,29 @@ void Sg_WsjRefresh(void)
 void Sg_Init(void)
 {
 	uint32 x,y;
+	SgArea a;
 	sgLayer = 0;
 	sgWI    = 0;
+	sgX     = 0;
+	sgDI    = 0;
+	sgDamaged = FALSE;
 	sgUpdateInProcessing = FALSE;
+	sgReadyNum = 0;
+	sgDirtyNum = 0;
+
+	for(x=0;x<SGW_MAX;x++)
+	{	/* no widget drawn */
+		sgState[x].a.x0 = 0;
+		sgState[x].a.y0 = 0;
+		sgState[x].a.x1 = 0;
+		sgState[x].a.y1 = 0;
+		sgState[x].l = SGL_INVALID;
+	}
+	a.x0 = 0;
+	a.y0 = 0;
+	a.x1 = SG_LCD_WIGTH;
+	a.y1 = SG_LCD_HEIGHT;
+	SgDirtyAdd(&a);
 
 	for(x=0;x<SG_LCD_WIGTH;x++)
 	{
@@ -345,7 +569,7 @@ void Sg_Init(void)
 void Sg_ManagerTask(void)
 {
 	SgWidget* w;
-	uint32_t weight=0;
+	uint32 weight=0;
 #ifdef USE_AWS
 	if(AsWsjOnline())
 	{
@@ -359,29 +583,38 @@ void Sg_ManagerTask(void)
 	}
 	else
 	{
+		if(FALSE == sgDamaged)
+		{
+			SgDamage();
+			sgDamaged = TRUE;
+		}
 		while (sgLayer < SGL_MAX)
 		{	/* render 1 widget */
 			while(sgWI < SGW_MAX)
 			{
 				w = &SGWidget[sgWI];
 
-				if(w->l == sgLayer)
-				{
-					if(TRUE==SgDrawWidget(w))
+				if((w->l == sgLayer) && (sgDI < sgDirtyNum))
+				{	/* only what of the widget is inside of each dirty area */
+					if(TRUE == SgAreaClip(&sgState[sgWI].a,&sgDirty[sgDI],&sgClip))
 					{
-						sgWI++;
-						sgX = 0;
-						weight += w->src->weight%100;
+						if(TRUE==SgDrawWidget(w,&weight))
+						{
+							sgDI++;
+							sgX = 0;
+							weight += w->src->weight%100;
+						}
 					}
 					else
 					{
-						weight += 100;
+						sgDI++;
 					}
 				}
 				else
 				{
 					/* continue */
 					sgWI ++;
+					sgDI = 0;
 				}
 			}
 			if(SGW_MAX <= sgWI)
@@ -399,7 +632,20 @@ void Sg_ManagerTask(void)
 		if(SGL_MAX <= sgLayer)
 		{
 			sgLayer = 0;
-			sgUpdateInProcessing = TRUE;
+			sgDamaged = FALSE;
+			if(sgDirtyNum > 0)
+			{
+				for(sgReadyNum=0;sgReadyNum<sgDirtyNum;sgReadyNum++)
+				{
+					sgReady[sgReadyNum] = sgDirty[sgReadyNum];
+				}
+				sgDirtyNum = 0;
+				sgUpdateInProcessing = TRUE;
+			}
+			else
+			{
+				/* nothing changed, no update of the LCD */
+			}
 			SgCache();
 		}
 	}
@@ -414,6 +660,31 @@ boolean Sg_IsDataReady ( void )
 
 	return isReady;
 }
+
+uint32 Sg_GetDataReadyArea(SgArea* area, uint32 max)
+{
+	uint32 i;
+	uint32 n = 0;
+
+	if((TRUE == sgUpdateInProcessing) && (max > 0))
+	{
+		for(i=0;i<sgReadyNum;i++)
+		{
+			if(i < max)
+			{
+				area[i] = sgReady[i];
+			}
+			else
+			{
+				SgAreaUnion(&area[max-1],&sgReady[i]);
+			}
+		}
+		n = (sgReadyNum < max) ? sgReadyNum : max;
+		sgUpdateInProcessing = FALSE;
+	}
+
+	return n;
+}
 #else /* USE_LCD */
 void Sg_Init(void)
 {
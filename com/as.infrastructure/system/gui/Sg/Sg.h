@@ -22,6 +22,11 @@
 #define SG_LCD_WIGTH 	__SG_WIDTH__
 #define SG_LCD_HEIGHT   __SG_HEIGHT__
 
+/* max number of the dirty areas of a frame, the overflow is merged */
+#ifndef SG_DIRTY_MAX
+#define SG_DIRTY_MAX    8
+#endif
+
 enum
 {
 	SGT_DMP,
@@ -132,6 +137,14 @@ typedef struct
 	uint8  ri;  /* resource index */
 	const SgSRC const* src;
 }SgWidget;
+
+typedef struct
+{	/* [x0,x1) x [y0,y1) of the LCD */
+	uint32 x0;
+	uint32 y0;
+	uint32 x1;
+	uint32 y1;
+}SgArea;
 #include "SgRes.h"
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
@@ -140,4 +153,7 @@ typedef struct
 void Sg_Init(void);
 void Sg_ManagerTask(void);
 boolean Sg_IsDataReady ( void );
+/* as Sg_IsDataReady, and gives the areas updated by the frame, returns the number of the areas
+ * or 0 if the data is not ready */
+uint32 Sg_GetDataReadyArea(SgArea* area, uint32 max);
 #endif /* COM_CLANG_INCLUDE_SG_H_ */
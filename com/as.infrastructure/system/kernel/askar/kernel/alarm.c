@@ -97,7 +97,7 @@ StatusType GetAlarm    ( AlarmType AlarmID ,TickRefType Tick )
 	if( AlarmID < ALARM_NUM )
 	{
 	#endif
-		LOCK_KERNEL(imask);
+		LOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 		if( OS_IS_ALARM_STARTED(&AlarmVarArray[AlarmID]) )
 		{
 			/* rely on the trick of integer overflow */
@@ -107,7 +107,7 @@ StatusType GetAlarm    ( AlarmType AlarmID ,TickRefType Tick )
 		{
 			ercd = E_OS_NOFUNC;
 		}
-		UNLOCK_KERNEL(imask);
+		UNLOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 	#if(OS_STATUS == EXTENDED)
 	}
 	else
@@ -190,7 +190,7 @@ StatusType SetRelAlarm ( AlarmType AlarmID , TickType Increment ,TickType Cycle
 
 	if(E_OK == ercd)
 	{
-		LOCK_KERNEL(imask);
+		LOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 		if( FALSE == OS_IS_ALARM_STARTED(&AlarmVarArray[AlarmID]) )
 		{
 			TickType Start = (TickType)(AlarmConstArray[AlarmID].pCounter->pVar->value+Increment);
@@ -200,7 +200,7 @@ StatusType SetRelAlarm ( AlarmType AlarmID , TickType Increment ,TickType Cycle
 		{
 			ercd = E_OS_STATE;
 		}
-		UNLOCK_KERNEL(imask);
+		UNLOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 	}
 
 
@@ -260,6 +260,7 @@ StatusType SetAbsAlarm ( AlarmType AlarmID , TickType Start ,TickType Cycle )
 {
 	StatusType ercd = E_OK;
 	imask_t imask;
+	boolean expired = FALSE;
 	DECLARE_SMP_PROCESSOR_ID();
 
 	#if(OS_STATUS == EXTENDED)
@@ -280,7 +281,7 @@ StatusType SetAbsAlarm ( AlarmType AlarmID , TickType Start ,TickType Cycle )
 
 	if(E_OK == ercd)
 	{
-		LOCK_KERNEL(imask);
+		LOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 		if( FALSE == OS_IS_ALARM_STARTED(&AlarmVarArray[AlarmID]) )
 		{
 			TickType Increment = AlarmConstArray[AlarmID].pCounter->pVar->value%AlarmConstArray[AlarmID].pCounter->base.maxallowedvalue;
@@ -292,7 +293,8 @@ StatusType SetAbsAlarm ( AlarmType AlarmID , TickType Start ,TickType Cycle )
 					Start = AlarmConstArray[AlarmID].pCounter->pVar->value + Cycle;
 					Os_StartAlarm(AlarmID,Start,Cycle);
 				}
-				AlarmConstArray[AlarmID].Action();
+				/* the action is fired out of the counter lock */
+				expired = TRUE;
 			}
 			else
 			{
@@ -312,7 +314,12 @@ StatusType SetAbsAlarm ( AlarmType AlarmID , TickType Start ,TickType Cycle )
 		{
 			ercd = E_OS_STATE;
 		}
-		UNLOCK_KERNEL(imask);
+		UNLOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
+
+		if(expired)
+		{
+			AlarmConstArray[AlarmID].Action();
+		}
 	}
 
 	OSErrorThree(SetAbsAlarm,AlarmID,Start,Cycle);
@@ -348,7 +355,7 @@ StatusType CancelAlarm ( AlarmType AlarmID )
 	if( AlarmID < ALARM_NUM )
 	{
 	#endif
-		LOCK_KERNEL(imask);
+		LOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 		if( OS_IS_ALARM_STARTED(&AlarmVarArray[AlarmID]) )
 		{
 			TAILQ_REMOVE(&(AlarmConstArray[AlarmID].pCounter->pVar->head), &AlarmVarArray[AlarmID], entry);
@@ -358,7 +365,7 @@ StatusType CancelAlarm ( AlarmType AlarmID )
 		{
 			ercd = E_OS_NOFUNC;
 		}
-		UNLOCK_KERNEL(imask);
+		UNLOCK_OBJECT(AlarmConstArray[AlarmID].pCounter->pVar, imask);
 	#if(OS_STATUS == EXTENDED)
 	}
 	else
@@ -33,7 +33,7 @@ StatusType SignalCounter(CounterType CounterID)
 
 	if(CounterID < COUNTER_NUM)
 	{
-		LOCK_KERNEL(imask);
+		LOCK_OBJECT(&CounterVarArray[CounterID], imask);
 		savedLevel = CallLevel;
 		CallLevel = TCL_LOCK;
 		/* yes, only software counter supported */
@@ -54,9 +54,9 @@ StatusType SignalCounter(CounterType CounterID)
 						AlarmVarArray[AlarmID].period);
 				}
 
-				UNLOCK_KERNEL(imask);
+				UNLOCK_OBJECT(&CounterVarArray[CounterID], imask);
 				AlarmConstArray[AlarmID].Action();
-				LOCK_KERNEL(imask);
+				LOCK_OBJECT(&CounterVarArray[CounterID], imask);
 			}
 			else
 			{
@@ -65,7 +65,7 @@ StatusType SignalCounter(CounterType CounterID)
 		}
 		#endif
 		CallLevel = savedLevel;
-		UNLOCK_KERNEL(imask);
+		UNLOCK_OBJECT(&CounterVarArray[CounterID], imask);
 	}
 	else
 	{
@@ -83,6 +83,9 @@ void Os_CounterInit(void)
 	{
 		CounterVarArray[id].value = 0;
 		TAILQ_INIT(&CounterVarArray[id].head);
+		#ifdef USE_SMP
+		CounterVarArray[id].lock.v = 0;
+		#endif
 	}
 }
 #ifdef USE_SHELL
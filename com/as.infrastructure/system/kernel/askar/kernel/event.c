@@ -16,10 +16,40 @@
 #include "kernel_internal.h"
 #ifdef EXTENDED_TASK
 /* ============================ [ MACROS    ] ====================================================== */
+#ifdef USE_SMP
+/* the set mask is updated without any lock, the WaitEvent publishes its wait mask and then
+ * reads the set mask again, the full barriers make sure that either the SetEvent sees the
+ * wait mask or the WaitEvent sees the event */
+#define EVENT_LOAD(v)      __atomic_load_n(&(v), __ATOMIC_SEQ_CST)
+#define EVENT_STORE(v, m)  __atomic_store_n(&(v), (m), __ATOMIC_SEQ_CST)
+/* set the events, TRUE if the task may be waiting for one of them */
+#define EVENT_FAST_SET(pEventVar, m)	\
+	((void)__atomic_fetch_or(&(pEventVar)->set, (m), __ATOMIC_SEQ_CST), \
+	 (0u != (EVENT_LOAD((pEventVar)->wait) & (m))))
+#define EVENT_SET(pEventVar, m)
+#else
+#define EVENT_LOAD(v)      (v)
+#define EVENT_STORE(v, m)  (v) = (m)
+/* masking the interrupt is as cheap as an atomic on one CPU, so always the locked path */
+#define EVENT_FAST_SET(pEventVar, m) TRUE
+#define EVENT_SET(pEventVar, m) (pEventVar)->set |= (m)
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
+static void Os_EventClear(EventVarType* pEventVar, EventMaskType Mask)
+{
+#ifdef USE_SMP
+	(void)__atomic_fetch_and(&pEventVar->set, ~Mask, __ATOMIC_SEQ_CST);
+#else
+	imask_t imask;
+
+	Irq_Save(imask);
+	pEventVar->set &= ~Mask;
+	Irq_Restore(imask);
+#endif
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 /* |------------------+----------------------------------------------------------| */
 /* | Syntax:          | StatusType SetEvent ( TaskType <TaskID>                  | */
@@ -54,6 +84,8 @@ StatusType SetEvent  ( TaskType TaskID , EventMaskType Mask )
 {
 	StatusType ercd = E_OK;
 	imask_t imask;
+	imask_t kmask;
+	EventVarType* pEventVar;
 	DECLARE_SMP_PROCESSOR_ID();
 
 	#if(OS_STATUS == EXTENDED)
@@ -73,22 +105,35 @@ StatusType SetEvent  ( TaskType TaskID , EventMaskType Mask )
 
 	if( E_OK == ercd )
 	{
-		LOCK_KERNEL(imask);
-		TaskConstArray[TaskID].pEventVar->set |= Mask;
-		if( 0u != (TaskConstArray[TaskID].pEventVar->set & TaskConstArray[TaskID].pEventVar->wait) )
+		pEventVar = TaskConstArray[TaskID].pEventVar;
+		/* no lock if the task is running, ready or waiting for other events */
+		if(EVENT_FAST_SET(pEventVar, Mask))
 		{
-			TaskConstArray[TaskID].pEventVar->wait = 0;
-			TaskVarArray[TaskID].state = READY;
-			OS_TRACE_TASK_ACTIVATION(&TaskVarArray[TaskID]);
-			Sched_AddReady(TaskID);
-			if( (TCL_TASK == CallLevel) &&
-				(ReadyVar->priority > RunningVar->priority) )
+			LOCK_OBJECT(pEventVar, imask);
+			EVENT_SET(pEventVar, Mask);
+			if( 0u != (pEventVar->set & pEventVar->wait) )
 			{
-				Sched_Preempt();
-				Os_PortDispatch();
+				pEventVar->wait = 0;
+				/* the kernel lock is only needed to make the task ready */
+				LOCK_KERNEL(kmask);
+				RELEASE_OBJECT(pEventVar);
+				TaskVarArray[TaskID].state = READY;
+				OS_TRACE_TASK_ACTIVATION(&TaskVarArray[TaskID]);
+				Sched_AddReady(TaskID);
+				if( (TCL_TASK == CallLevel) &&
+					(ReadyVar->priority > RunningVar->priority) )
+				{
+					Sched_Preempt();
+					Os_PortDispatch();
+				}
+				UNLOCK_KERNEL(kmask);
+				Irq_Restore(imask);
+			}
+			else
+			{	/* not waiting, woken up by another SetEvent or the WaitEvent has seen it */
+				UNLOCK_OBJECT(pEventVar, imask);
 			}
 		}
-		UNLOCK_KERNEL(imask);
 	}
 
 	OSErrorTwo(SetEvent, TaskID, Mask);
@@ -117,7 +162,6 @@ StatusType SetEvent  ( TaskType TaskID , EventMaskType Mask )
 StatusType ClearEvent( EventMaskType Mask )
 {
 	StatusType ercd = E_OK;
-	imask_t imask;
 
 	DECLARE_SMP_PROCESSOR_ID();
 
@@ -134,9 +178,7 @@ StatusType ClearEvent( EventMaskType Mask )
 
 	if( E_OK == ercd )
 	{
-		LOCK_KERNEL(imask);
-		RunningVar->pConst->pEventVar->set &= ~Mask;
-		UNLOCK_KERNEL(imask);
+		Os_EventClear(RunningVar->pConst->pEventVar, Mask);
 	}
 
 	OSErrorOne(ClearEvent, Mask);
@@ -173,7 +215,6 @@ StatusType ClearEvent( EventMaskType Mask )
 StatusType GetEvent  ( TaskType TaskID , EventMaskRefType Mask )
 {
 	StatusType ercd = E_OK;
-	imask_t imask;
 	DECLARE_SMP_PROCESSOR_ID();
 
 	#if(OS_STATUS == EXTENDED)
@@ -193,10 +234,7 @@ StatusType GetEvent  ( TaskType TaskID , EventMaskRefType Mask )
 
 	if( E_OK == ercd )
 	{
-		LOCK_KERNEL(imask);
-		*Mask = TaskConstArray[TaskID].pEventVar->set;
-		UNLOCK_KERNEL(imask);
-
+		*Mask = EVENT_LOAD(TaskConstArray[TaskID].pEventVar->set);
 	}
 	OSErrorTwo(GetEvent, TaskID, Mask);
 	return ercd;
@@ -231,6 +269,8 @@ StatusType WaitEvent ( EventMaskType Mask )
 {
 	StatusType ercd = E_OK;
 	imask_t imask;
+	imask_t kmask;
+	EventVarType* pEventVar;
 	DECLARE_SMP_PROCESSOR_ID();
 
 	#if(OS_STATUS == EXTENDED)
@@ -250,17 +290,38 @@ StatusType WaitEvent ( EventMaskType Mask )
 
 	if( E_OK == ercd )
 	{
-		LOCK_KERNEL(imask);
-		if( 0u == (Mask&RunningVar->pConst->pEventVar->set))
+		pEventVar = RunningVar->pConst->pEventVar;
+		LOCK_OBJECT(pEventVar, imask);
+		if( 0u == (Mask&EVENT_LOAD(pEventVar->set)) )
+		{
+			/* take the kernel lock before the wait mask is visible, so that a SetEvent
+			 * on another CPU can't make this task ready before it is switched out */
+			LOCK_KERNEL(kmask);
+			EVENT_STORE(pEventVar->wait, Mask);
+			if( 0u != (Mask&EVENT_LOAD(pEventVar->set)) )
+			{	/* a lock free SetEvent came before the wait mask was visible */
+				pEventVar->wait = 0;
+				UNLOCK_KERNEL(kmask);
+				UNLOCK_OBJECT(pEventVar, imask);
+			}
+			else
+			{
+				RELEASE_OBJECT(pEventVar);
+				RunningVar->priority = RunningVar->pConst->initPriority;
+				RunningVar->state=WAITING;
+				Sched_GetReady();
+				Os_PortDispatch();
+				/* may be resumed on another CPU */
+				GET_SMP_PROCESSOR_ID();
+				RunningVar->priority = RunningVar->pConst->runPriority;
+				UNLOCK_KERNEL(kmask);
+				Irq_Restore(imask);
+			}
+		}
+		else
 		{
-			RunningVar->priority = RunningVar->pConst->initPriority;
-			RunningVar->pConst->pEventVar->wait = Mask;
-			RunningVar->state=WAITING;
-			Sched_GetReady();
-			Os_PortDispatch();
-			RunningVar->priority = RunningVar->pConst->runPriority;
+			UNLOCK_OBJECT(pEventVar, imask);
 		}
-		UNLOCK_KERNEL(imask);
 	}
 
 	OSErrorOne(ClearEvent, Mask);
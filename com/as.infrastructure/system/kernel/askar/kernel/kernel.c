@@ -281,13 +281,56 @@ void Os_RestoreKernelLock(void)
 {
 	DECLARE_SMP_PROCESSOR_ID();
 
+	int cpu;
+
 	if(RunningVar != NULL)
 	{
 		if(0 == RunningVar->lock)
 		{
-			asAssert((NULL==RunningVars[cpuid?0:1]) || (0==RunningVars[cpuid?0:1]->lock));
+			for(cpu=0; cpu<CPU_CORE_NUMBER; cpu++)
+			{
+				asAssert((cpu==cpuid) || (NULL==RunningVars[cpu]) || (0==RunningVars[cpu]->lock));
+			}
 			Os_PortSpinUnLock();
 		}
 	}
 }
+
+/* kick the CPU that should run a task of the priority which was just made ready on
+ * <oncpu>, for a task which could run on any CPU, the CPU running the lowest priority */
+void Os_RequestSchedule(uint8 oncpu, PriorityType priority)
+{
+	DECLARE_SMP_PROCESSOR_ID();
+	int cpu;
+	PriorityType lowest = priority;
+
+	if(OS_ON_ANY_CPU == oncpu)
+	{
+		for(cpu=0; cpu<CPU_CORE_NUMBER; cpu++)
+		{
+			if((cpu != cpuid) && (NULL != RunningVars[cpu]) &&
+				(RunningVars[cpu]->priority < lowest))
+			{
+				lowest = RunningVars[cpu]->priority;
+				oncpu = cpu;
+			}
+		}
+	}
+	else if(oncpu != cpuid)
+	{
+		if((NULL != RunningVars[oncpu]) && (priority <= RunningVars[oncpu]->priority))
+		{
+			oncpu = OS_ON_ANY_CPU;
+		}
+	}
+	else
+	{
+		oncpu = OS_ON_ANY_CPU;
+	}
+
+	if(OS_ON_ANY_CPU != oncpu)
+	{
+		Os_PortRequestSchedule(oncpu);
+	}
+}
 #endif
@@ -26,6 +26,7 @@
 #endif
 #ifdef USE_SMP
 #include "smp.h"
+#include "spinlock.h"
 #endif
 /* ============================ [ MACROS    ] ====================================================== */
 #ifndef USE_PTHREAD
@@ -223,6 +224,7 @@ enum {
 #define PTHREAD_DYNAMIC_CREATED_MASK 0x10
 #define PTHREAD_JOINABLE_MASK        0x20
 #define PTHREAD_JOINED_MASK          0x40
+#define PTHREAD_MIGRATABLE_MASK      0x80
 
 
 #ifdef USE_SHELL
@@ -246,12 +248,22 @@ enum {
 
 #define LOCK_KERNEL(imask )  imask = Os_LockKernel()
 #define UNLOCK_KERNEL(imask) Os_UnLockKernel(imask)
+
+/* per object(event/counter) lock, the order is always object then kernel, and an object
+ * lock is never held across a dispatch */
+#define LOCK_OBJECT(pObj, imask) do { Irq_Save(imask); spin_lock(&(pObj)->lock); } while(0)
+#define UNLOCK_OBJECT(pObj, imask) do { spin_unlock(&(pObj)->lock); Irq_Restore(imask); } while(0)
+/* release the object lock but keep the interrupt masked */
+#define RELEASE_OBJECT(pObj) spin_unlock(&(pObj)->lock)
 #else
 #define DECLARE_SMP_PROCESSOR_ID()
 #define GET_SMP_PROCESSOR_ID()
 #define SMP_PROCESSOR_ID() 0
 #define LOCK_KERNEL(imask )  Irq_Save(imask)
 #define UNLOCK_KERNEL(imask) Irq_Restore(imask)
+#define LOCK_OBJECT(pObj, imask) Irq_Save(imask)
+#define UNLOCK_OBJECT(pObj, imask) Irq_Restore(imask)
+#define RELEASE_OBJECT(pObj)
 #endif
 
 #define OS_ON_ANY_CPU CPU_CORE_NUMBER
@@ -277,6 +289,9 @@ typedef struct
 {
 	EventMaskType set;
 	EventMaskType wait;
+	#ifdef USE_SMP
+	spinlock_t lock;
+	#endif
 } EventVarType;
 
 typedef struct
@@ -350,6 +365,9 @@ typedef struct
 {
 	TickType value;
 	TAILQ_HEAD(AlarmVarHead,AlarmVar) head;
+	#ifdef USE_SMP
+	spinlock_t lock;
+	#endif
 } CounterVarType;
 
 typedef struct
@@ -445,6 +463,10 @@ extern void Os_PortDispatch(void);
 #ifdef USE_SMP
 extern void Os_PortSpinLock(void);
 extern void Os_PortSpinUnLock(void);
+extern imask_t Os_LockKernel(void);
+extern void Os_UnLockKernel(imask_t imask);
+extern void Os_PortRequestSchedule(uint8 cpu);
+extern void Os_RequestSchedule(uint8 oncpu, PriorityType priority);
 #endif
 extern void Sched_Init(void);
 extern void Sched_AddReady(TaskType TaskID);
@@ -466,9 +488,5 @@ extern int Os_PortInstallSignal(TaskVarType* pTaskVar, int sig, void* handler);
 extern void Os_FreeSignalHandler(struct pthread* tid);
 extern void Os_SignalInit(void);
 extern void Os_SignalBroadCast(int signo);
-
-extern imask_t Os_LockKernel(void);
-extern void Os_UnLockKernel(imask_t imask);
-extern void Os_PortRequestSchedule(uint8 cpu);
 #endif
 #endif /* KERNEL_INTERNAL_H_ */
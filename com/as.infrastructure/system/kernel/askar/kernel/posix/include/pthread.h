@@ -28,6 +28,10 @@
 #define PTHREAD_SCOPE_PROCESS   0
 #define PTHREAD_SCOPE_SYSTEM    1
 
+/* non-portable: the ready thread may be stolen by an idle CPU(SMP only) */
+#define PTHREAD_PINNED          0
+#define PTHREAD_MIGRATABLE      1
+
 #define PTHREAD_COND_INITIALIZER    { {NULL, NULL}, FALSE }
 #define PTHREAD_MUTEX_INITIALIZER   { {NULL, NULL}, FALSE }
 
@@ -48,6 +52,7 @@ struct pthread_attr
 	uint8_t detachstate;     /* detach state */
 	uint8_t policy;          /* scheduler policy */
 	uint8_t inheritsched;    /* Inherit parent prio/policy */
+	uint8_t migratable;      /* pinned or migratable */
 };
 typedef struct pthread_attr pthread_attr_t;
 
@@ -95,6 +100,8 @@ int pthread_attr_setguardsize(pthread_attr_t *attr, size_t guard_size);
 int pthread_attr_getguardsize(pthread_attr_t const *attr, size_t *guard_size);
 int pthread_attr_setscope(pthread_attr_t *attr, int scope);
 int pthread_attr_getscope(pthread_attr_t const *attr);
+int pthread_attr_setmigratable_np(pthread_attr_t *attr, int migratable);
+int pthread_attr_getmigratable_np(pthread_attr_t const *attr, int *migratable);
 
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
 int pthread_mutex_destroy(pthread_mutex_t *mutex);
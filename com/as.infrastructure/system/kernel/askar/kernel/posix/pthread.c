@@ -201,6 +201,16 @@ int pthread_create (pthread_t *tid, const pthread_attr_t *attr,
 		{
 			pTaskConst->flag |= PTHREAD_JOINABLE_MASK;
 		}
+#ifdef USE_SMP
+		/* the thread starts on the creator CPU, a migratable one may be stolen later */
+		GET_SMP_PROCESSOR_ID();
+		pTaskConst->cpu = SMP_PROCESSOR_ID();
+		pTaskVar->oncpu = SMP_PROCESSOR_ID();
+		if((NULL != attr) && (PTHREAD_MIGRATABLE == attr->migratable))
+		{
+			pTaskConst->flag |= PTHREAD_MIGRATABLE_MASK;
+		}
+#endif
 		Sched_AddReady(pTaskVar - TaskVarArray);
 		UNLOCK_KERNEL(imask);
 	}
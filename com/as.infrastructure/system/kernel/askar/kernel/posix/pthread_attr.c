@@ -29,7 +29,8 @@ const pthread_attr_t pthread_default_attr =
 	PTHREAD_DEFAULT_PRIORITY,   /* priority */
 	PTHREAD_CREATE_JOINABLE,    /* detach state */
 	SCHED_FIFO,                 /* scheduler policy */
-	PTHREAD_INHERIT_SCHED       /* Inherit parent prio/policy */
+	PTHREAD_INHERIT_SCHED,      /* Inherit parent prio/policy */
+	PTHREAD_PINNED              /* pinned on the creator CPU */
 };
 /* ============================ [ LOCALS    ] ====================================================== */
 /* ============================ [ FUNCTIONS ] ====================================================== */
@@ -204,4 +205,29 @@ int pthread_attr_getscope(pthread_attr_t const *attr)
 }
 ELF_EXPORT(pthread_attr_getscope);
 
+int pthread_attr_setmigratable_np(pthread_attr_t *attr, int migratable)
+{
+	int ercd = 0;
+
+	if ((migratable != PTHREAD_PINNED) && (migratable != PTHREAD_MIGRATABLE))
+	{
+		ercd = -EINVAL;
+	}
+	else
+	{
+		attr->migratable = migratable;
+	}
+
+	return ercd;
+}
+ELF_EXPORT(pthread_attr_setmigratable_np);
+
+int pthread_attr_getmigratable_np(pthread_attr_t const *attr, int *migratable)
+{
+	*migratable = (int)attr->migratable;
+
+	return 0;
+}
+ELF_EXPORT(pthread_attr_getmigratable_np);
+
 #endif
@@ -90,16 +90,21 @@ StatusType GetResource (ResourceType ResID)
 
 	if(E_OK == ercd)
 	{
-		if(TCL_TASK == CallLevel)
+		if((TCL_TASK == CallLevel) &&
+			(RunningVar->priority >= ResourceConstArray[ResID].ceilPrio))
+		{	/* already at the ceiling, the priority is not changed, so only the bookkeeping
+			 * of the running task, which is never touched by ISRs or other CPUs */
+			ResourceVarArray[ResID].prevRes = RunningVar->currentResource;
+			ResourceVarArray[ResID].prevPrio = RunningVar->priority;
+			RunningVar->currentResource = ResID;
+		}
+		else if(TCL_TASK == CallLevel)
 		{
 			LOCK_KERNEL(imask);
 			ResourceVarArray[ResID].prevRes = RunningVar->currentResource;
 			ResourceVarArray[ResID].prevPrio = RunningVar->priority;
 			RunningVar->currentResource = ResID;
-			if(RunningVar->priority < ResourceConstArray[ResID].ceilPrio)
-			{
-				RunningVar->priority = ResourceConstArray[ResID].ceilPrio;
-			}
+			RunningVar->priority = ResourceConstArray[ResID].ceilPrio;
 			UNLOCK_KERNEL(imask);
 		}
 		else if(TCL_ISR2 == CallLevel)
@@ -174,7 +179,13 @@ StatusType ReleaseResource ( ResourceType ResID )
 
 	if(E_OK == ercd)
 	{
-		if(TCL_TASK == CallLevel)
+		if((TCL_TASK == CallLevel) &&
+			(ResourceVarArray[ResID].prevPrio == RunningVar->priority))
+		{	/* the priority is not lowered, so no ready task could preempt now */
+			RunningVar->currentResource = ResourceVarArray[ResID].prevRes;
+			ResourceVarArray[ResID].prevPrio = INVALID_PRIORITY;
+		}
+		else if(TCL_TASK == CallLevel)
 		{
 			LOCK_KERNEL(imask);
 			RunningVar->currentResource = ResourceVarArray[ResID].prevRes;
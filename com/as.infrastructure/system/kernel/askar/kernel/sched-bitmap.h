@@ -0,0 +1,199 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* The ready priority bitmap of the FIFO schedulers. If the portable defines OS_PORT_HAS_CLZ,
+ * it's 32 bit words in 2 levels and the highest ready priority is 2 count leading zeros,
+ * else the uCOS like 3 levels of bytes with the tableUnMap lookup, which is also selected
+ * by USE_SCHED_TABLE to compare them. Only to be included by the scheduler. */
+#ifndef SCHED_BITMAP_H_
+#define SCHED_BITMAP_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "kernel_internal.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#if defined(OS_PORT_HAS_CLZ) && !defined(USE_SCHED_TABLE)
+#define SCHED_BITMAP_CLZ
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+#ifdef SCHED_BITMAP_CLZ
+typedef struct
+{
+#if (PRIORITY_NUM > 31)
+	uint32 group;
+#endif
+	uint32 map[(PRIORITY_NUM+32)/32];
+} ReadyBitmapType;
+#else
+typedef struct
+{
+#if (PRIORITY_NUM > 63)
+	uint8 group;
+#endif
+#if (PRIORITY_NUM > 7)
+	uint8 groupTable[(PRIORITY_NUM+64)/64];
+#endif
+	uint8 map[(PRIORITY_NUM+8)/8];
+} ReadyBitmapType;
+#endif
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+#ifndef SCHED_BITMAP_CLZ
+/**************************************************
+#include <stdio.h>
+int main(int argc, char *argv[])
+{
+    unsigned int i;
+    printf("static uint8_t tableUnMap[256]=\n{");
+    for (i=0; i <= 0xff; ++i)
+    {
+        if(i%16==0) printf("\n\t");
+        if(i&(1u<<7))
+            printf("7,");
+        else if(i&(1u<<6))
+            printf("6,");
+        else if(i&(1u<<5))
+            printf("5,");
+        else if(i&(1u<<4))
+            printf("4,");
+        else if(i&(1u<<3))
+            printf("3,");
+        else if(i&(1u<<2))
+            printf("2,");
+        else if(i&(1u<<1))
+            printf("1,");
+        else if(i&(1u<<0))
+            printf("0,");
+        else printf("0,");
+    }
+    printf("\n}\n");
+    return 0;
+}
+used to generate the map like ucos,but inverted from low to high
+*******************************************************/
+static const uint8_t tableUnMap[256]=
+{
+	0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3,
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+};
+#endif
+/* ============================ [ LOCALS    ] ====================================================== */
+#ifdef SCHED_BITMAP_CLZ
+static inline void Sched_BitmapSet(ReadyBitmapType* bitmap, PriorityType priority)
+{
+#if (PRIORITY_NUM > 31)
+	bitmap->group |= (1u << (priority >> 5));
+#endif
+	bitmap->map[priority >> 5] |= (1u << (priority&0x1Fu));
+}
+
+static inline void Sched_BitmapClear(ReadyBitmapType* bitmap, PriorityType priority)
+{
+	bitmap->map[priority >> 5] &= ~(1u << (priority&0x1Fu));
+
+#if (PRIORITY_NUM > 31)
+	if(0u == bitmap->map[priority >> 5])
+	{
+		bitmap->group &= ~(1u << (priority >> 5));
+	}
+#endif
+}
+
+/* the highest ready priority, 0 if none is ready */
+static inline PriorityType Sched_BitmapGet(ReadyBitmapType* bitmap)
+{
+	uint32 X = 0;
+	uint32 Y = 0;
+
+#if (PRIORITY_NUM > 31)
+	if(0u != bitmap->group)
+	{
+		X = 31u - (uint32)__builtin_clz(bitmap->group);
+	}
+#endif
+
+	if(0u != bitmap->map[X])
+	{
+		Y = 31u - (uint32)__builtin_clz(bitmap->map[X]);
+	}
+
+	return (PriorityType)((X<<5) + Y);
+}
+#else
+static inline void Sched_BitmapSet(ReadyBitmapType* bitmap, PriorityType priority)
+{
+#if (PRIORITY_NUM > 63)
+	bitmap->group |= (1u << (priority >> 6));
+#endif
+
+#if (PRIORITY_NUM > 7)
+	bitmap->groupTable[priority >> 6] |= (1u << ((priority&0x3Fu) >> 3));
+#endif
+
+	bitmap->map[priority >> 3] |= (1u << (priority&0x7u));
+}
+
+static inline void Sched_BitmapClear(ReadyBitmapType* bitmap, PriorityType priority)
+{
+	bitmap->map[priority >> 3] &= ~(1u << (priority&0x7u));
+
+#if (PRIORITY_NUM > 7)
+	if(0u == bitmap->map[priority >> 3])
+	{
+		bitmap->groupTable[priority >> 6] &= ~(1u << ((priority&0x3Fu) >> 3));
+	}
+#endif
+
+#if (PRIORITY_NUM > 63)
+	if(0u == bitmap->groupTable[priority >> 6])
+	{
+		bitmap->group &= ~(1u << (priority >> 6));
+	}
+#endif
+}
+
+/* the highest ready priority, 0 if none is ready */
+static inline PriorityType Sched_BitmapGet(ReadyBitmapType* bitmap)
+{
+	uint8 Z = 0;
+	uint8 X = 0;
+	uint8 Y;
+
+#if (PRIORITY_NUM > 63)
+	Z = tableUnMap[bitmap->group];
+#endif
+
+#if (PRIORITY_NUM > 7)
+	X = tableUnMap[bitmap->groupTable[Z]];
+#endif
+
+	Y = tableUnMap[bitmap->map[(Z<<3) + X]];
+
+	return (PriorityType)((Z<<6) + (X<<3) + Y);
+}
+#endif
+/* ============================ [ FUNCTIONS ] ====================================================== */
+#endif /* SCHED_BITMAP_H_ */
@@ -217,12 +217,9 @@ void Sched_AddReady(TaskType TaskID)
 
 	Sched_FindReady(&pReadyQueue);
 
-	if(cpuid != oncpu)
+	if((cpuid != oncpu) && (ReadyVar != &TaskVarArray[TaskID]))
 	{
-		if(priority > RunningVars[oncpu]->priority)
-		{
-			Os_PortRequestSchedule(oncpu);
-		}
+		Os_RequestSchedule(oncpu, priority);
 	}
 }
 
@@ -15,8 +15,11 @@
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "kernel_internal.h"
 #if defined(USE_SCHED_FIFO) && defined(USE_SMP)
+#include "sched-bitmap.h"
 #include "asdebug.h"
 /* ============================ [ MACROS    ] ====================================================== */
+#define AS_LOG_STEAL 0
+
 #define SCHED_FIFO_SIZE(fifo) ((fifo)->pFIFO)[0]
 #define SCHED_FIFO_HEAD(fifo) ((fifo)->pFIFO)[1]
 #define SCHED_FIFO_TAIL(fifo) ((fifo)->pFIFO)[2]
@@ -27,125 +30,23 @@
 /* ============================ [ DATAS     ] ====================================================== */
 extern const ReadyFIFOType ReadyFIFO[CPU_CORE_NUMBER+1][PRIORITY_NUM+1];
 
-#if (PRIORITY_NUM > 63)
-static uint8 ReadyGroup[CPU_CORE_NUMBER+1];
-#endif
-
-#if (PRIORITY_NUM > 7)
-static uint8 ReadyGroupTable[CPU_CORE_NUMBER+1][(PRIORITY_NUM+64)/64];
-#endif
-
-static uint8 ReadyMapTable[CPU_CORE_NUMBER+1][(PRIORITY_NUM+8)/8];
-/**************************************************
-#include <stdio.h>
-int main(int argc, char *argv[])
-{
-    unsigned int i;
-    printf("static uint8_t tableUnMap[256]=\n{");
-    for (i=0; i <= 0xff; ++i)
-    {
-        if(i%16==0) printf("\n\t");
-        if(i&(1u<<7))
-            printf("7,");
-        else if(i&(1u<<6))
-            printf("6,");
-        else if(i&(1u<<5))
-            printf("5,");
-        else if(i&(1u<<4))
-            printf("4,");
-        else if(i&(1u<<3))
-            printf("3,");
-        else if(i&(1u<<2))
-            printf("2,");
-        else if(i&(1u<<1))
-            printf("1,");
-        else if(i&(1u<<0))
-            printf("0,");
-        else printf("0,");
-    }
-    printf("\n}\n");
-    return 0;
-}
-used to generate the map like ucos,but inverted from low to high
-*******************************************************/
-static uint8_t tableUnMap[256]=
-{
-	0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3,
-	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
-	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
-	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-};
+static ReadyBitmapType ReadyBitmap[CPU_CORE_NUMBER+1];
 /* ============================ [ LOCALS    ] ====================================================== */
 static inline void Sched_SetReadyBit(uint8 oncpu, PriorityType priority)
 {
-#if (PRIORITY_NUM > 63)
-	ReadyGroup[oncpu] |= (1u << (priority >> 6));
-#endif
-
-#if (PRIORITY_NUM > 7)
-	ReadyGroupTable[oncpu][priority >> 6] |= (1u << ((priority&0x3Fu) >> 3));
-#endif
-
-	ReadyMapTable[oncpu][(priority >> 6)*8 + ((priority&0x3Fu) >> 3)] |= (1u << (priority&0x7u));
+	Sched_BitmapSet(&ReadyBitmap[oncpu], priority);
 }
 
 static inline void Sched_ClearReadyBit(uint8 oncpu, PriorityType priority)
 {
-	ReadyMapTable[oncpu][(priority >> 6)*8 + ((priority&0x3Fu) >> 3)] &= ~(1u << (priority&0x7u));
-
-#if (PRIORITY_NUM > 7)
-	if(0u == ReadyMapTable[oncpu][(priority >> 6)*8 + ((priority&0x3Fu) >> 3)])
-	{
-		ReadyGroupTable[oncpu][priority >> 6] &= ~(1u << ((priority&0x3Fu) >> 3));
-	}
-#endif
-
-#if (PRIORITY_NUM > 63)
-	if(0u == ReadyGroupTable[oncpu][priority >> 6])
-	{
-		ReadyGroup &= ~(1u << (priority >> 6));
-	}
-#endif
+	Sched_BitmapClear(&ReadyBitmap[oncpu], priority);
 }
 
 static inline PriorityType Sched_GetReadyBit(uint8 oncpu)
 {
-#if (PRIORITY_NUM > 63)
-	uint8 Z;
-#endif
-#if (PRIORITY_NUM > 7)
-	uint8 X;
-#endif
-	uint8 Y;
-
-#if (PRIORITY_NUM > 63)
-	Z = tableUnMap[ReadyGroup[oncpu]];
-#else
-#define Z 0u
-#endif
-
-#if (PRIORITY_NUM > 7)
-	X = tableUnMap[ReadyGroupTable[oncpu][Z]];
-#else
-#define X 0u
-#endif
-
-	Y = tableUnMap[ReadyMapTable[oncpu][(Z<<6) + X]];
-
-	return ((Z<<6) + (X<<3) + Y);
+	return Sched_BitmapGet(&ReadyBitmap[oncpu]);
 }
+
 static void RemoveFromFifo(TaskType TaskID, PriorityType priority)
 {
 	const ReadyFIFOType* fifo;
@@ -187,6 +88,89 @@ static void RemoveFromFifo(TaskType TaskID, PriorityType priority)
 		Sched_ClearReadyBit(oncpu, priority);
 	}
 }
+
+#if(OS_PTHREAD_NUM > 0)
+static inline boolean Sched_IsMigratable(TaskType TaskID)
+{
+	return (TaskID >= TASK_NUM) &&
+		(0u != (TaskVarArray[TaskID].pConst->flag & PTHREAD_MIGRATABLE_MASK));
+}
+
+/* Steal the highest priority migratable thread which is ready on another CPU and whose
+ * priority is not less than "priority", the FIFO order of each priority is kept and the
+ * ReadyVar of the victim CPU is never taken. Only the pthread priorities are searched as
+ * the OSEK tasks are always pinned. */
+static TaskVarType* Sched_Steal(uint8 cpuid, PriorityType priority)
+{
+	const ReadyFIFOType* fifo;
+	TaskVarType* pTaskVar = NULL;
+	PriorityType prio;
+	PriorityType best = priority;
+	TaskType TaskID = INVALID_TASK;
+	uint32 i,pos;
+	uint8 victim;
+
+	for(victim=0; victim<CPU_CORE_NUMBER; victim++)
+	{
+		if(victim == cpuid)
+		{
+			continue;
+		}
+
+		prio = Sched_GetReadyBit(victim);
+		if(prio >= OS_PTHREAD_PRIORITY)
+		{
+			prio = OS_PTHREAD_PRIORITY - 1;
+		}
+
+		/* after the first hit, only a higher priority on a later victim is taken */
+		while((prio > best) || ((prio == best) && (INVALID_TASK == TaskID)))
+		{
+			fifo = &(ReadyFIFO[victim][prio]);
+			if((NULL != fifo->pFIFO) && (SCHED_FIFO_SIZE(fifo) > 0))
+			{
+				for(i=0; i<SCHED_FIFO_SIZE(fifo); i++)
+				{
+					pos = SCHED_FIFO_HEAD(fifo) + i;
+					if(pos >= fifo->max)
+					{
+						pos = pos - fifo->max + SCHED_FIFO_SLOT_OFFSET;
+					}
+					if(Sched_IsMigratable(fifo->pFIFO[pos]) &&
+						(ReadyVars[victim] != &TaskVarArray[fifo->pFIFO[pos]]))
+					{
+						TaskID = fifo->pFIFO[pos];
+						best = prio;
+						break;
+					}
+				}
+			}
+
+			if((best == prio) && (INVALID_TASK != TaskID))
+			{
+				break;
+			}
+
+			if(0u == prio)
+			{
+				break;
+			}
+			prio--;
+		}
+	}
+
+	if(INVALID_TASK != TaskID)
+	{
+		pTaskVar = &TaskVarArray[TaskID];
+		ASLOG(STEAL, ("CPU%d steal pthread%d from CPU%d\n", cpuid,
+				TaskID-TASK_NUM, pTaskVar->oncpu));
+		RemoveFromFifo(TaskID, best);
+		pTaskVar->oncpu = cpuid;
+	}
+
+	return pTaskVar;
+}
+#endif
 /* ============================ [ FUNCTIONS ] ====================================================== */
 void Sched_Init(void)
 {
@@ -206,15 +190,7 @@ void Sched_Init(void)
 			}
 		}
 	}
-	#if (PRIORITY_NUM > 63)
-	memset(ReadyGroup, 0, sizeof(ReadyGroup));
-	#endif
-
-	#if (PRIORITY_NUM > 7)
-	memset(ReadyGroupTable, 0, sizeof(ReadyGroupTable));
-	#endif
-
-	memset(ReadyMapTable, 0, sizeof(ReadyMapTable));
+	memset(ReadyBitmap, 0, sizeof(ReadyBitmap));
 }
 
 void Sched_AddReady(TaskType TaskID)
@@ -245,7 +221,11 @@ void Sched_AddReady(TaskType TaskID)
 
 	Sched_SetReadyBit(oncpu, priority);
 
-	if(priority > ReadyVar->priority)
+	if((cpuid != oncpu) && (OS_ON_ANY_CPU != oncpu))
+	{
+		/* pinned on another CPU, the ReadyVar of this CPU is not affected */
+	}
+	else if(priority > ReadyVar->priority)
 	{
 		ReadyVar = &TaskVarArray[fifo->pFIFO[SCHED_FIFO_HEAD(fifo)]];
 	}
@@ -253,22 +233,22 @@ void Sched_AddReady(TaskType TaskID)
 	{
 		PriorityType priority1;
 		PriorityType priority2;
+		uint8 readycpu;
 
 		priority1 = Sched_GetReadyBit(cpuid);
 		priority2 = Sched_GetReadyBit(OS_ON_ANY_CPU);
 
 		if(priority1 >= priority2)
 		{
-			priority = priority1;
-			oncpu = cpuid;
+			readycpu = cpuid;
 		}
 		else
 		{
-			priority = priority2;
-			oncpu = OS_ON_ANY_CPU;
+			priority1 = priority2;
+			readycpu = OS_ON_ANY_CPU;
 		}
 
-		fifo = &ReadyFIFO[oncpu][priority];
+		fifo = &ReadyFIFO[readycpu][priority1];
 		asAssert(fifo->pFIFO);
 		ReadyVar = &TaskVarArray[fifo->pFIFO[SCHED_FIFO_HEAD(fifo)]];
 	}
@@ -277,13 +257,17 @@ void Sched_AddReady(TaskType TaskID)
 		/* no update of ReadyVar */
 	}
 
-	if(cpuid != oncpu)
+	if((cpuid != oncpu) && (ReadyVar != &TaskVarArray[TaskID]))
 	{
-		if(priority > RunningVars[oncpu]->priority)
-		{
-			Os_PortRequestSchedule(oncpu);
-		}
+		Os_RequestSchedule(oncpu, priority);
+	}
+#if(OS_PTHREAD_NUM > 0)
+	else if(Sched_IsMigratable(TaskID) && (ReadyVar != &TaskVarArray[TaskID]))
+	{
+		/* queued on this CPU, wake up a lower priority CPU to steal it */
+		Os_RequestSchedule(OS_ON_ANY_CPU, priority);
 	}
+#endif
 }
 
 void Sched_Preempt(void)
@@ -355,6 +339,23 @@ void Sched_GetReady(void)
 
 	fifo = &ReadyFIFO[oncpu][priority];
 
+#if(OS_PTHREAD_NUM > 0)
+	/* the local ready task wins over a stolen thread of the same priority */
+	if((NULL != fifo->pFIFO) && (SCHED_FIFO_SIZE(fifo) > 0))
+	{
+		ReadyVar = Sched_Steal(cpuid, priority+1);
+	}
+	else
+	{
+		ReadyVar = Sched_Steal(cpuid, 0);
+	}
+
+	if(NULL != ReadyVar)
+	{
+		/* pass */
+	}
+	else
+#endif
 	if(NULL != fifo->pFIFO)
 	{
 		if(SCHED_FIFO_SIZE(fifo) > 0)
@@ -421,6 +422,21 @@ boolean Sched_Schedule(void)
 	}
 
 	fifo = &ReadyFIFO[oncpu][priority];
+
+#if(OS_PTHREAD_NUM > 0)
+	/* a stolen thread shall be higher than both the running task and the local ready one */
+	priority1 = RunningVar->priority;
+	if((NULL != fifo->pFIFO) && (SCHED_FIFO_SIZE(fifo) > 0) && (priority > priority1))
+	{
+		priority1 = priority;
+	}
+	ReadyVar = Sched_Steal(cpuid, priority1+1);
+	if(NULL != ReadyVar)
+	{
+		needSchedule = TRUE;
+	}
+	else
+#endif
 	if(NULL != fifo->pFIFO)
 	{
 		if(SCHED_FIFO_SIZE(fifo) > 0)
@@ -446,26 +462,29 @@ boolean Sched_Schedule(void)
 				}
 
 				ReadyVar->oncpu = cpuid;
-
-				/* put the RunningVar back to the head of queue */
-				priority = RunningVar->priority;
-				fifo = &ReadyFIFO[cpuid][priority];
-				asAssert(fifo->pFIFO);
-
-				SCHED_FIFO_SIZE(fifo) ++;
-				SCHED_FIFO_HEAD(fifo) --;
-				if(SCHED_FIFO_HEAD(fifo) < SCHED_FIFO_SLOT_OFFSET)
-				{
-					SCHED_FIFO_HEAD(fifo) = fifo->max-1;
-				}
-				fifo->pFIFO[SCHED_FIFO_HEAD(fifo)] = RunningVar - TaskVarArray;
-
-				Sched_SetReadyBit(cpuid, priority);
 				needSchedule = TRUE;
 			}
 		}
 	}
 
+	if(needSchedule)
+	{
+		/* put the RunningVar back to the head of queue */
+		priority = RunningVar->priority;
+		fifo = &ReadyFIFO[cpuid][priority];
+		asAssert(fifo->pFIFO);
+
+		SCHED_FIFO_SIZE(fifo) ++;
+		SCHED_FIFO_HEAD(fifo) --;
+		if(SCHED_FIFO_HEAD(fifo) < SCHED_FIFO_SLOT_OFFSET)
+		{
+			SCHED_FIFO_HEAD(fifo) = fifo->max-1;
+		}
+		fifo->pFIFO[SCHED_FIFO_HEAD(fifo)] = RunningVar - TaskVarArray;
+
+		Sched_SetReadyBit(cpuid, priority);
+	}
+
 	return needSchedule;
 }
 #endif /* USE_SCHED_FIFO */
@@ -15,6 +15,7 @@
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "kernel_internal.h"
 #if defined(USE_SCHED_FIFO) && !defined(USE_SMP)
+#include "sched-bitmap.h"
 #include "asdebug.h"
 /* ============================ [ MACROS    ] ====================================================== */
 #define SCHED_FIFO_SIZE(fifo) ((fifo)->pFIFO)[0]
@@ -26,125 +27,23 @@
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 extern const ReadyFIFOType ReadyFIFO[PRIORITY_NUM+1];
-#if (PRIORITY_NUM > 63)
-static uint8 ReadyGroup;
-#endif
-
-#if (PRIORITY_NUM > 7)
-static uint8 ReadyGroupTable[(PRIORITY_NUM+64)/64];
-#endif
-
-static uint8 ReadyMapTable[(PRIORITY_NUM+8)/8];
-/**************************************************
-#include <stdio.h>
-int main(int argc, char *argv[])
-{
-    unsigned int i;
-    printf("static uint8_t tableUnMap[256]=\n{");
-    for (i=0; i <= 0xff; ++i)
-    {
-        if(i%16==0) printf("\n\t");
-        if(i&(1u<<7))
-            printf("7,");
-        else if(i&(1u<<6))
-            printf("6,");
-        else if(i&(1u<<5))
-            printf("5,");
-        else if(i&(1u<<4))
-            printf("4,");
-        else if(i&(1u<<3))
-            printf("3,");
-        else if(i&(1u<<2))
-            printf("2,");
-        else if(i&(1u<<1))
-            printf("1,");
-        else if(i&(1u<<0))
-            printf("0,");
-        else printf("0,");
-    }
-    printf("\n}\n");
-    return 0;
-}
-used to generate the map like ucos,but inverted from low to high
-*******************************************************/
-static uint8_t tableUnMap[256]=
-{
-	0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3,
-	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
-	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
-	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-};
+static ReadyBitmapType ReadyBitmap;
 /* ============================ [ LOCALS    ] ====================================================== */
 static inline void Sched_SetReadyBit(PriorityType priority)
 {
-#if (PRIORITY_NUM > 63)
-	ReadyGroup |= (1u << (priority >> 6));
-#endif
-
-#if (PRIORITY_NUM > 7)
-	ReadyGroupTable[priority >> 6] |= (1u << ((priority&0x3Fu) >> 3));
-#endif
-
-	ReadyMapTable[(priority >> 6)*8 + ((priority&0x3Fu) >> 3)] |= (1u << (priority&0x7u));
+	Sched_BitmapSet(&ReadyBitmap, priority);
 }
 
 static inline void Sched_ClearReadyBit(PriorityType priority)
 {
-	ReadyMapTable[(priority >> 6)*8 + ((priority&0x3Fu) >> 3)] &= ~(1u << (priority&0x7u));
-
-#if (PRIORITY_NUM > 7)
-	if(0u == ReadyMapTable[(priority >> 6)*8 + ((priority&0x3Fu) >> 3)])
-	{
-		ReadyGroupTable[priority >> 6] &= ~(1u << ((priority&0x3Fu) >> 3));
-	}
-#endif
-
-#if (PRIORITY_NUM > 63)
-	if(0u == ReadyGroupTable[priority >> 6])
-	{
-		ReadyGroup &= ~(1u << (priority >> 6));
-	}
-#endif
+	Sched_BitmapClear(&ReadyBitmap, priority);
 }
 
 static inline PriorityType Sched_GetReadyBit(void)
 {
-#if (PRIORITY_NUM > 63)
-	uint8 Z;
-#endif
-#if (PRIORITY_NUM > 7)
-	uint8 X;
-#endif
-	uint8 Y;
-
-#if (PRIORITY_NUM > 63)
-	Z = tableUnMap[ReadyGroup];
-#else
-#define Z 0u
-#endif
-
-#if (PRIORITY_NUM > 7)
-	X = tableUnMap[ReadyGroupTable[Z]];
-#else
-#define X 0u
-#endif
-
-	Y = tableUnMap[ReadyMapTable[(Z<<6) + X]];
-
-	return ((Z<<6) + (X<<3) + Y);
+	return Sched_BitmapGet(&ReadyBitmap);
 }
+
 static void RemoveFromFifo(TaskType TaskID, PriorityType priority)
 {
 	uint32 i,j,pos,posI,posJ;
@@ -198,21 +97,7 @@ void Sched_Init(void)
 		}
 	}
 
-#if (PRIORITY_NUM > 63)
-	ReadyGroup = 0;
-#endif
-
-#if (PRIORITY_NUM > 7)
-	for(prio=0; prio < sizeof(ReadyGroupTable); prio++)
-	{
-		ReadyGroupTable[prio] = 0;
-	}
-#endif
-
-	for(prio=0; prio < sizeof(ReadyMapTable); prio++)
-	{
-		ReadyMapTable[prio] = 0;
-	}
+	memset(&ReadyBitmap, 0, sizeof(ReadyBitmap));
 }
 
 void Sched_AddReady(TaskType TaskID)
@@ -240,7 +125,7 @@ void Sched_AddReady(TaskType TaskID)
 
 	Sched_SetReadyBit(priority);
 
-	if(priority > ReadyVar->priority)
+	if((NULL == ReadyVar) || (priority > ReadyVar->priority))
 	{
 		ReadyVar = &TaskVarArray[fifo->pFIFO[SCHED_FIFO_HEAD(fifo)]];
 	}
@@ -16,6 +16,31 @@
 #include "kernel_internal.h"
 #include "asdebug.h"
 /* ============================ [ MACROS    ] ====================================================== */
+#if defined(USE_SMP) && defined(EXTENDED_TASK)
+/* InitContext resets the events of an extended task under the lock of its EventVar, which
+ * is taken before the kernel lock as the order is object then kernel, and is released
+ * before any dispatch, the same as SetEvent does */
+#define LOCK_TASK_EVENT(pTaskVar, imask) do {						\
+		Irq_Save(imask);											\
+		if(NULL != (pTaskVar)->pConst->pEventVar) {					\
+			spin_lock(&(pTaskVar)->pConst->pEventVar->lock);		\
+		}															\
+	} while(0)
+#define RELEASE_TASK_EVENT(pTaskVar) do {							\
+		if(NULL != (pTaskVar)->pConst->pEventVar) {					\
+			RELEASE_OBJECT((pTaskVar)->pConst->pEventVar);			\
+		}															\
+	} while(0)
+#define RESTORE_TASK_EVENT(imask) Irq_Restore(imask)
+/* SetEvent sets the events by an atomic or without the lock once it sees the task is not
+ * SUSPENDED, so the reset is ordered before the new state */
+#define EVENT_RESET(v) __atomic_store_n(&(v), 0u, __ATOMIC_SEQ_CST)
+#else
+#define LOCK_TASK_EVENT(pTaskVar, imask) (void)imask
+#define RELEASE_TASK_EVENT(pTaskVar)
+#define RESTORE_TASK_EVENT(imask)
+#define EVENT_RESET(v) (v) = 0u
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
@@ -30,8 +55,17 @@ static const char* statsNames[] =
 };
 #endif
 /* ============================ [ LOCALS    ] ====================================================== */
+/* called with the kernel lock and the LOCK_TASK_EVENT of the task held */
 static void InitContext(TaskVarType* pTaskVar)
 {
+	#ifdef EXTENDED_TASK
+	if(NULL != pTaskVar->pConst->pEventVar)
+	{
+		EVENT_RESET(pTaskVar->pConst->pEventVar->set);
+		EVENT_RESET(pTaskVar->pConst->pEventVar->wait);
+	}
+	#endif
+
 	pTaskVar->state = READY;
 	pTaskVar->priority = pTaskVar->pConst->initPriority;
 	pTaskVar->currentResource = INVALID_RESOURCE;
@@ -41,14 +75,6 @@ static void InitContext(TaskVarType* pTaskVar)
 	pTaskVar->oncpu = pTaskVar->pConst->cpu;
 	#endif
 
-	#ifdef EXTENDED_TASK
-	if(NULL != pTaskVar->pConst->pEventVar)
-	{
-		pTaskVar->pConst->pEventVar->set = 0u;
-		pTaskVar->pConst->pEventVar->wait = 0u;
-	}
-	#endif
-
 	Os_PortInitContext(pTaskVar);
 }
 #ifdef USE_SHELL
@@ -145,6 +171,7 @@ StatusType ActivateTask ( TaskType TaskID )
 	StatusType ercd = E_OK;
 	TaskVarType* pTaskVar;
 	imask_t imask;
+	imask_t emask;
 	DECLARE_SMP_PROCESSOR_ID();
 
 	#if(OS_STATUS == EXTENDED)
@@ -152,6 +179,7 @@ StatusType ActivateTask ( TaskType TaskID )
 	{
 	#endif
 		pTaskVar   = &TaskVarArray[TaskID];
+		LOCK_TASK_EVENT(pTaskVar, emask);
 		LOCK_KERNEL(imask);
 		if(SUSPENDED == TASK_STATE(pTaskVar))
 		{
@@ -182,6 +210,7 @@ StatusType ActivateTask ( TaskType TaskID )
 				ercd = E_OS_LIMIT;
 			}
 		}
+		RELEASE_TASK_EVENT(pTaskVar);
 
 		if( (E_OK == ercd) &&
 			(TCL_TASK == CallLevel) &&
@@ -192,6 +221,7 @@ StatusType ActivateTask ( TaskType TaskID )
 		}
 
 		UNLOCK_KERNEL(imask);
+		RESTORE_TASK_EVENT(emask);
 	#if(OS_STATUS == EXTENDED)
 	}
 	else
@@ -244,6 +274,7 @@ StatusType TerminateTask( void )
 {
 	StatusType ercd = E_OK;
 	imask_t mask;
+	imask_t emask;
 	DECLARE_SMP_PROCESSOR_ID();
 
 	#if(OS_STATUS == EXTENDED)
@@ -259,6 +290,7 @@ StatusType TerminateTask( void )
 
 	if(E_OK == ercd)
 	{
+		LOCK_TASK_EVENT(RunningVar, emask);
 		LOCK_KERNEL(mask);
 		#ifdef MULTIPLY_TASK_ACTIVATION
 		asAssert(RunningVar->activation > 0);
@@ -275,12 +307,14 @@ StatusType TerminateTask( void )
 		{
 			RunningVar->state = SUSPENDED;
 		}
+		RELEASE_TASK_EVENT(RunningVar);
 
 		Sched_GetReady();
 		OSPostTaskHook();
 		Os_PortStartDispatch();
 
 		UNLOCK_KERNEL(mask);
+		RESTORE_TASK_EVENT(emask);
 	}
 
 	OSErrorNone(TerminateTask);
@@ -339,6 +373,7 @@ StatusType ChainTask    ( TaskType TaskID )
 {
 	StatusType ercd = E_OK;
 	imask_t mask;
+	imask_t emask;
 	TaskVarType* pTaskVar;
 	DECLARE_SMP_PROCESSOR_ID();
 	
@@ -363,13 +398,17 @@ StatusType ChainTask    ( TaskType TaskID )
 
 		if(pTaskVar == RunningVar)
 		{
+			LOCK_TASK_EVENT(RunningVar, emask);
 			LOCK_KERNEL(mask);
 			InitContext(RunningVar);
 			Sched_AddReady(TaskID);
+			RELEASE_TASK_EVENT(RunningVar);
 			UNLOCK_KERNEL(mask);
+			RESTORE_TASK_EVENT(emask);
 		}
 		else
 		{
+			LOCK_TASK_EVENT(pTaskVar, emask);
 			LOCK_KERNEL(mask);
 			if(SUSPENDED == TASK_STATE(pTaskVar))
 			{
@@ -397,10 +436,13 @@ StatusType ChainTask    ( TaskType TaskID )
 					ercd = E_OS_LIMIT;
 				}
 			}
+			RELEASE_TASK_EVENT(pTaskVar);
 			UNLOCK_KERNEL(mask);
+			RESTORE_TASK_EVENT(emask);
 
 			if(ercd == E_OK)
 			{
+				LOCK_TASK_EVENT(RunningVar, emask);
 				LOCK_KERNEL(mask);
 				#ifdef MULTIPLY_TASK_ACTIVATION
 				asAssert(RunningVar->activation > 0);
@@ -417,7 +459,9 @@ StatusType ChainTask    ( TaskType TaskID )
 				{
 					RunningVar->state = SUSPENDED;
 				}
+				RELEASE_TASK_EVENT(RunningVar);
 				UNLOCK_KERNEL(mask);
+				RESTORE_TASK_EVENT(emask);
 			}
 		}
 
@@ -77,9 +77,13 @@ void Os_PortActivateImpl(void)
 void Os_PortInit(void)
 {
 #ifdef USE_SMP
+	int cpu;
 	memset(ISR2Counter, 0, sizeof(ISR2Counter));
-	Irq_Install(0, Os_PortSchedule, 0);
-	Irq_Install(1, Os_PortSchedule, 1);
+	/* the SGI <cpu> is the schedule request to the CPU <cpu> */
+	for(cpu=0; cpu<CPU_CORE_NUMBER; cpu++)
+	{
+		Irq_Install(cpu, Os_PortSchedule, cpu);
+	}
 #else
 	ISR2Counter = 0;
 	Os_PortStartSysTick();
@@ -129,13 +133,13 @@ void Os_PortSpinUnLock(void)
 	spin_unlock(&knlSpinlock);
 }
 
-TASK(TaskIdle2)
+static void Os_PortIdleMain(void)
 {
 	DECLARE_SMP_PROCESSOR_ID();
 
 	RunningVar->priority = 0;
 
-	ASLOG(SMP, ("TaskIdle2 is running on CPU%d\n", smp_processor_id()));
+	ASLOG(SMP, ("%s is running on CPU%d\n", RunningVar->pConst->name, smp_processor_id()));
 
 	for(;;)
 	{
@@ -143,6 +147,25 @@ TASK(TaskIdle2)
 	}
 }
 
+TASK(TaskIdle2)
+{
+	Os_PortIdleMain();
+}
+
+#if (CPU_CORE_NUMBER > 2)
+TASK(TaskIdle3)
+{
+	Os_PortIdleMain();
+}
+#endif
+
+#if (CPU_CORE_NUMBER > 3)
+TASK(TaskIdle4)
+{
+	Os_PortIdleMain();
+}
+#endif
+
 void secondary_main(void)
 {
 	DECLARE_SMP_PROCESSOR_ID();
@@ -162,8 +185,13 @@ void Os_PortRequestSchedule(uint8 cpu)
 
 void Os_PortStartFirstDispatch(void)
 {
+	int cpu;
+
 	ASLOG(SMP, ("!!!CPU%d is up!!!\n", smp_processor_id()));
-	smp_boot_secondary(1, secondary_start);
+	for(cpu=1; cpu<CPU_CORE_NUMBER; cpu++)
+	{
+		smp_boot_secondary(cpu, secondary_start);
+	}
 	Os_PortStartSysTick();
 
 	Os_PortStartDispatch();
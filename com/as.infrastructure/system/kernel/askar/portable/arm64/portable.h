@@ -16,8 +16,15 @@
 #define PORTABLE_H_
 /* ============================ [ INCLUDES  ] ====================================================== */
 /* ============================ [ MACROS    ] ====================================================== */
+/* the ready bitmap of the FIFO scheduler uses __builtin_clz */
+#define OS_PORT_HAS_CLZ
+
 #ifdef USE_SMP
-#define CPU_NUM 2
+#define CPU_NUM CPU_CORE_NUMBER
+/* the per-cpu stack and context area of startup.S and portableS.S */
+#if (CPU_CORE_NUMBER > 4)
+#error "the per-cpu stack and context area support up to 4 CPUs"
+#endif
 #endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct
@@ -16,6 +16,10 @@
 #define PORTABLE_H_
 /* ============================ [ INCLUDES  ] ====================================================== */
 /* ============================ [ MACROS    ] ====================================================== */
+#ifdef __ARM_FEATURE_CLZ
+/* the ready bitmap of the FIFO scheduler uses __builtin_clz */
+#define OS_PORT_HAS_CLZ
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct
 {
@@ -0,0 +1,341 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* Run the ASKAR kernel as a Linux process: all the tasks share the process main thread and
+ * are switched by swapcontext. An interrupt is a bit of irqPending plus the signal
+ * OS_PORT_SIG_IRQ to the main thread, the mask is a flag but not the signal mask, so that
+ * Irq_Save/Irq_Restore cost no system call. The handler runs on the stack of the
+ * interrupted task and dispatches from there just like a hardware ISR, the preempted task
+ * returns from the handler when it is resumed. The SysTick is a timerfd read by a helper
+ * thread. */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "kernel_internal.h"
+#include "asdebug.h"
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/timerfd.h>
+/* ============================ [ MACROS    ] ====================================================== */
+#define AS_LOG_OS  0
+#define AS_LOG_OSE 1
+
+#define OS_PORT_SIG_IRQ SIGUSR1
+
+#define OS_PORT_IDLE_STACK_SIZE (64*1024)
+
+#ifndef OS_TICKS_PER_SECOND
+#define OS_TICKS_PER_SECOND 1000
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+static void Os_PortIsrHandler(void);
+/* ============================ [ DATAS     ] ====================================================== */
+static volatile sig_atomic_t irqMasked = 1;
+static volatile uint32 irqPending;
+static volatile uint32 tickPending;
+static void (*isrVector[OS_PORT_IRQ_NUM])(void);
+
+static pthread_t knlThread;
+static pthread_t tickThread;
+static boolean tickStarted = FALSE;
+
+static ucontext_t idleContext;
+static uint64 idleStack[OS_PORT_IDLE_STACK_SIZE/sizeof(uint64)];
+/* ============================ [ LOCALS    ] ====================================================== */
+static void Os_PortUnmask(void)
+{
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	irqMasked = 0;
+	/* take the interrupts raised when it was masked */
+	while(0u != __atomic_load_n(&irqPending, __ATOMIC_ACQUIRE))
+	{
+		Os_PortIsrHandler();
+		irqMasked = 0;
+	}
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static void Os_PortSignalHandler(int sig)
+{
+	(void)sig;
+
+	if(0 == irqMasked)
+	{
+		Os_PortIsrHandler();
+		Os_PortUnmask();
+	}
+	/* else: keep it pending, the Irq_Restore/Irq_Enable will take it */
+}
+
+static void Os_PortSysTick(void)
+{
+	uint32 ticks;
+
+	ticks = __atomic_exchange_n(&tickPending, 0u, __ATOMIC_ACQ_REL);
+	while(ticks > 0u)
+	{
+		OsTick();
+		Os_PortTickCounter();
+		ticks--;
+	}
+}
+
+static void Os_PortIsrHandler(void)
+{
+	unsigned int savedLevel;
+	uint32 pending;
+	int irq;
+
+	irqMasked = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+	savedLevel = CallLevel;
+	CallLevel = TCL_ISR2;
+
+	while(0u != (pending = __atomic_exchange_n(&irqPending, 0u, __ATOMIC_ACQ_REL)))
+	{
+		for(irq=0; irq<OS_PORT_IRQ_NUM; irq++)
+		{
+			if((0u != (pending & (1u<<irq))) && (NULL != isrVector[irq]))
+			{
+				isrVector[irq]();
+			}
+		}
+	}
+
+	CallLevel = savedLevel;
+
+	if( (NULL != RunningVar) && (NULL != ReadyVar) &&
+		(TCL_TASK == CallLevel) && (RunningVar != ReadyVar) &&
+		(RunningVar->priority < ReadyVar->priority) )
+	{
+		Sched_Preempt();
+		Os_PortDispatch();
+	}
+}
+
+static void* Os_PortTickThread(void* arg)
+{
+	int fd;
+	uint64 expirations;
+	struct itimerspec its;
+
+	(void)arg;
+
+	fd = timerfd_create(CLOCK_MONOTONIC, 0);
+	asAssert(fd >= 0);
+
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = 1000000000/OS_TICKS_PER_SECOND;
+	its.it_value = its.it_interval;
+	timerfd_settime(fd, 0, &its, NULL);
+
+	for(;;)
+	{
+		if(sizeof(expirations) == read(fd, &expirations, sizeof(expirations)))
+		{
+			__atomic_add_fetch(&tickPending, (uint32)expirations, __ATOMIC_ACQ_REL);
+			Os_PortRaiseIsr(OS_PORT_IRQ_SYSTICK);
+		}
+	}
+
+	return NULL;
+}
+
+static void Os_PortIdle(void)
+{
+	sigset_t set;
+	sigset_t old;
+
+	ASLOG(OS, ("enter idle\n"));
+
+	sigemptyset(&set);
+	sigaddset(&set, OS_PORT_SIG_IRQ);
+	pthread_sigmask(SIG_BLOCK, &set, &old);
+
+	Os_PortUnmask();
+	while(NULL == ReadyVar)
+	{	/* the ISR runs inside of sigsuspend */
+		sigsuspend(&old);
+	}
+	Irq_Disable();
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	Sched_GetReady();
+	Os_PortStartDispatch();
+}
+
+static void Os_PortActivate(void)
+{
+	/* get internal resource or NON schedule */
+	RunningVar->priority = RunningVar->pConst->runPriority;
+
+	ASLOG(OS, ("%s(%d) is running\n",  RunningVar->pConst->name,
+			RunningVar->pConst->initPriority));
+
+	CallLevel = TCL_TASK;
+	Irq_Enable();
+
+	RunningVar->pConst->entry();
+
+	/* Should not return here */
+	TerminateTask();
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+void __weak Os_PortTickCounter(void)
+{
+#if (COUNTER_NUM > 0)
+	SignalCounter(0);
+#endif
+}
+
+imask_t __Irq_Save(void)
+{
+	imask_t imask = irqMasked;
+
+	irqMasked = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+	return imask;
+}
+
+void Irq_Restore(imask_t imask)
+{
+	if(0u == imask)
+	{
+		Os_PortUnmask();
+	}
+}
+
+void Irq_Enable(void)
+{
+	Os_PortUnmask();
+}
+
+void Irq_Disable(void)
+{
+	irqMasked = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+void EnterISR(void)
+{
+	/* done by Os_PortIsrHandler */
+}
+
+void LeaveISR(void)
+{
+	/* done by Os_PortIsrHandler */
+}
+
+void Os_PortInstallIsr(int irq, void (*handler)(void))
+{
+	asAssert((irq >= 0) && (irq < OS_PORT_IRQ_NUM));
+
+	isrVector[irq] = handler;
+}
+
+void Os_PortRaiseIsr(int irq)
+{
+	asAssert((irq >= 0) && (irq < OS_PORT_IRQ_NUM));
+
+	__atomic_or_fetch(&irqPending, 1u<<irq, __ATOMIC_ACQ_REL);
+
+	if(pthread_equal(pthread_self(), knlThread))
+	{
+		if(0 == irqMasked)
+		{	/* a software interrupt from the task, taken at once */
+			Os_PortUnmask();
+		}
+	}
+	else
+	{
+		pthread_kill(knlThread, OS_PORT_SIG_IRQ);
+	}
+}
+
+void Os_PortInit(void)
+{
+	struct sigaction sa;
+
+	knlThread = pthread_self();
+
+	/* no buffer as the ISRs and tasks print in any order */
+	setvbuf(stdout, NULL, _IONBF, 0);
+
+	/* SA_NODEFER: all the contexts have the same signal mask, the handler is guarded
+	 * by irqMasked but not by the kernel */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = Os_PortSignalHandler;
+	sa.sa_flags = SA_RESTART | SA_NODEFER;
+	sigemptyset(&sa.sa_mask);
+	sigaction(OS_PORT_SIG_IRQ, &sa, NULL);
+
+	Os_PortInstallIsr(OS_PORT_IRQ_SYSTICK, Os_PortSysTick);
+
+	if(FALSE == tickStarted)
+	{
+		tickStarted = TRUE;
+		pthread_create(&tickThread, NULL, Os_PortTickThread, NULL);
+	}
+}
+
+void Os_PortInitContext(TaskVarType* pTaskVar)
+{
+	getcontext(&pTaskVar->context.uc);
+	pTaskVar->context.uc.uc_stack.ss_sp = pTaskVar->pConst->pStack;
+	pTaskVar->context.uc.uc_stack.ss_size = pTaskVar->pConst->stackSize;
+	pTaskVar->context.uc.uc_link = NULL;
+	makecontext(&pTaskVar->context.uc, Os_PortActivate, 0);
+}
+
+void Os_PortDispatch(void)
+{
+	TaskVarType* pTaskVar = RunningVar;
+
+	OSPostTaskHook();
+
+	RunningVar = ReadyVar;
+
+	OSPreTaskHook();
+
+	swapcontext(&pTaskVar->context.uc, &RunningVar->context.uc);
+}
+
+void Os_PortStartDispatch(void)
+{
+	if(NULL == ReadyVar)
+	{
+		RunningVar = NULL;
+		getcontext(&idleContext);
+		idleContext.uc_stack.ss_sp = idleStack;
+		idleContext.uc_stack.ss_size = sizeof(idleStack);
+		idleContext.uc_link = NULL;
+		makecontext(&idleContext, Os_PortIdle, 0);
+		setcontext(&idleContext);
+	}
+	else
+	{
+		RunningVar = ReadyVar;
+
+		OSPreTaskHook();
+
+		setcontext(&RunningVar->context.uc);
+	}
+
+	/* should never return */
+	asAssert(0);
+}
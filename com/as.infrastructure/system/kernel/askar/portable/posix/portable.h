@@ -0,0 +1,40 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifndef PORTABLE_H_
+#define PORTABLE_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <ucontext.h>
+/* ============================ [ MACROS    ] ====================================================== */
+/* the ready bitmap of the FIFO scheduler uses __builtin_clz */
+#define OS_PORT_HAS_CLZ
+
+/* the emulated interrupt lines, 0 is the SysTick from timerfd */
+#define OS_PORT_IRQ_NUM     32
+#define OS_PORT_IRQ_SYSTICK 0
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct
+{
+	ucontext_t uc;
+} TaskContextType;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+extern void Os_PortTickCounter(void);
+extern void Os_PortInstallIsr(int irq, void (*handler)(void));
+/* could be called from any host thread, the ISR is taken by the kernel thread once the
+ * interrupt is not masked */
+extern void Os_PortRaiseIsr(int irq);
+#endif /* PORTABLE_H_ */
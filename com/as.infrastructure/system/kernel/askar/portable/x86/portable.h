@@ -25,6 +25,9 @@
 #define GDT_SIZE (INDEX_LDT_FIRST+TASK_NUM+OS_PTHREAD_NUM)
 #define IDT_SIZE 256
 
+/* the ready bitmap of the FIFO scheduler uses __builtin_clz(bsr) */
+#define OS_PORT_HAS_CLZ
+
 #define EnterISR()			 \
 	unsigned int savedLevel; \
 	imask_t mask;			 \
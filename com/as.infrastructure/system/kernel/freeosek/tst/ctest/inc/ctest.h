@@ -270,6 +270,13 @@ void TriggerISR2(void);
 void TriggerISR3(void);
 #endif /* #if (ISR_CATEGORY_3 == ENABLE) */
 
+/** \brief Benchmark Cycle Counter
+ **
+ ** This function shall return a free running CPU cycle counter, or 0 if the
+ ** architecture has none, then the benchmarks only report the time
+ **/
+uint64 GetCycleCounter(void);
+
 /** \brief Conformance Test Error Checking Type Extended */
 #define CT_ERROR_CHECKING_EXTENDED	1
 
@@ -0,0 +1,174 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* ActivateTask and SetEvent throughput, 4 pairs of tasks, each pair is pinned on one CPU
+ * by the case(1, 2 or 4 cores), so the same load is spread over more cores:
+ *   TaskBench<n> -> ActivateTask(TaskAct<n>)   : TaskAct<n> preempts and terminates
+ *   TaskBench<n> -> SetEvent(TaskWait<n>)      : TaskWait<n> preempts and waits again
+ * The result is the sum of the services done by all pairs divided by the elapsed time
+ * from the first pair start to the last pair end. */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "os.h"
+#include "ctest.h"
+
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_PAIRS 4
+#define BENCH_LOOPS 50000
+
+#ifndef OS_TICKS_PER_SECOND
+#define OS_TICKS_PER_SECOND 1000
+#endif
+
+#define BENCH_PAIR(n)								\
+TASK(TaskBench##n)									\
+{													\
+	Bench(n, TaskAct##n, TaskWait##n);				\
+	TerminateTask();								\
+}													\
+TASK(TaskAct##n)									\
+{													\
+	actCounter[n]++;								\
+	TerminateTask();								\
+}													\
+TASK(TaskWait##n)									\
+{													\
+	for(;;)											\
+	{												\
+		WaitEvent(EventPing);						\
+		ClearEvent(EventPing);						\
+		evtCounter[n]++;							\
+	}												\
+}													\
+TASK(TaskIdle##n)									\
+{													\
+	Idle(n);										\
+}
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct
+{
+	TickType start;
+	TickType end;
+} BenchTimeType;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static volatile uint32 actCounter[BENCH_PAIRS];
+static volatile uint32 evtCounter[BENCH_PAIRS];
+static volatile BenchTimeType actTime[BENCH_PAIRS];
+static volatile BenchTimeType evtTime[BENCH_PAIRS];
+static volatile boolean benchDone[BENCH_PAIRS];
+/* ============================ [ LOCALS    ] ====================================================== */
+static void Bench(int n, TaskType act, TaskType wait)
+{
+	uint32 i;
+
+	actTime[n].start = OsTickCounter;
+	for(i=0; i<BENCH_LOOPS; i++)
+	{
+		ActivateTask(act);
+	}
+	actTime[n].end = OsTickCounter;
+
+	evtTime[n].start = OsTickCounter;
+	for(i=0; i<BENCH_LOOPS; i++)
+	{
+		SetEvent(wait, EventPing);
+	}
+	evtTime[n].end = OsTickCounter;
+
+	benchDone[n] = TRUE;
+}
+
+static void Report(const char* name, volatile uint32* counter, volatile BenchTimeType* time)
+{
+	int n;
+	uint32 sum = 0;
+	TickType start = time[0].start;
+	TickType end = time[0].end;
+
+	for(n=0; n<BENCH_PAIRS; n++)
+	{
+		sum += counter[n];
+		if(time[n].start < start)
+		{
+			start = time[n].start;
+		}
+		if(time[n].end > end)
+		{
+			end = time[n].end;
+		}
+	}
+
+	if(start == end)
+	{
+		end = start + 1;
+	}
+
+	printf(" >> %s: %u calls on %d cores in %u ticks, %u calls/s\n", name,
+			(unsigned int)sum, CPU_CORE_NUMBER, (unsigned int)(end-start),
+			(unsigned int)(((uint64)sum*OS_TICKS_PER_SECOND)/(end-start)));
+
+	if(sum != (BENCH_PAIRS*BENCH_LOOPS))
+	{
+		ASSERT(OTHER, FAILED);
+	}
+}
+
+static void Idle(int n)
+{
+	int i;
+	boolean done;
+
+	/* only TaskIdle0 reports, after all the pairs are done, the others spin without the
+	 * kernel lock as the pairs are pinned and need no schedule request from other CPUs */
+	while(0 == n)
+	{
+		done = TRUE;
+		for(i=0; i<BENCH_PAIRS; i++)
+		{
+			if(FALSE == benchDone[i])
+			{
+				done = FALSE;
+			}
+		}
+
+		if(done)
+		{
+			Report("ActivateTask", actCounter, actTime);
+			Report("SetEvent", evtCounter, evtTime);
+			printf(" >> END << \n");
+			break;
+		}
+	}
+
+	while(1);
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int main
+(
+	void
+)
+{
+	/* start OS in AppMode 1 */
+	StartOS(AppMode1);
+
+	/* shall never return */
+	while(1);
+
+	return 0;
+}
+
+BENCH_PAIR(0)
+BENCH_PAIR(1)
+BENCH_PAIR(2)
+BENCH_PAIR(3)
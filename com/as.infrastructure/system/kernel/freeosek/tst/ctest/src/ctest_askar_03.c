@@ -0,0 +1,163 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* Cost of the kernel services which need no dispatch:
+ *   GetResource/ReleaseResource(ResShared)  : TaskBench already runs at the ceiling
+ *   GetResource/ReleaseResource(ResCeiling) : the ceiling(TaskHigh) is above TaskBench
+ *   SetEvent(TaskWait, EventPing)           : TaskWait waits, but only for EventStop
+ * Each is run BENCH_ROUNDS times and the fastest round is taken, less the cost of the empty
+ * loop, the result is the time and the CPU cycles per pair of resource calls or per SetEvent. */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "os.h"
+#include "ctest.h"
+
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_LOOPS  100000
+#define BENCH_ROUNDS 5
+
+#ifndef OS_TICKS_PER_SECOND
+#define OS_TICKS_PER_SECOND 1000
+#endif
+
+#define BENCH_RUN(cost, call)								\
+	do {													\
+		uint32 i, r;										\
+		TickType ticks;										\
+		uint64 cycles;										\
+		(cost)->ticks = (TickType)-1;						\
+		(cost)->cycles = (uint64)-1;						\
+		for(r=0; r<BENCH_ROUNDS; r++)						\
+		{													\
+			ticks = OsTickCounter;							\
+			cycles = GetCycleCounter();						\
+			for(i=0; i<BENCH_LOOPS; i++)					\
+			{												\
+				call;										\
+				loopCounter++;								\
+			}												\
+			cycles = GetCycleCounter() - cycles;			\
+			ticks = OsTickCounter - ticks;					\
+			if(ticks < (cost)->ticks)						\
+			{												\
+				(cost)->ticks = ticks;						\
+			}												\
+			if(cycles < (cost)->cycles)						\
+			{												\
+				(cost)->cycles = cycles;					\
+			}												\
+		}													\
+	} while(0)
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct
+{
+	TickType ticks;
+	uint64 cycles;
+} BenchCostType;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static volatile uint32 loopCounter;
+static BenchCostType loopCost;
+/* ============================ [ LOCALS    ] ====================================================== */
+static void Report(const char* name, BenchCostType* cost)
+{
+	uint32 ticks = 0;
+	uint64 cycles = 0;
+
+	if(cost->ticks > loopCost.ticks)
+	{
+		ticks = cost->ticks - loopCost.ticks;
+	}
+	if(cost->cycles > loopCost.cycles)
+	{
+		cycles = cost->cycles - loopCost.cycles;
+	}
+
+	printf(" >> %s: %u ns, %u cycles\n", name,
+			(unsigned int)(((uint64)ticks*1000000000u/OS_TICKS_PER_SECOND)/BENCH_LOOPS),
+			(unsigned int)(cycles/BENCH_LOOPS));
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int main
+(
+	void
+)
+{
+	/* start OS in AppMode 1 */
+	StartOS(AppMode1);
+
+	/* shall never return */
+	while(1);
+
+	return 0;
+}
+
+TASK(TaskBench)
+{
+	StatusType ret;
+	EventMaskType EventMask;
+	BenchCostType cost;
+
+	ret = GetResource(ResShared);
+	ASSERT(OTHER, ret != E_OK);
+	ret = ReleaseResource(ResShared);
+	ASSERT(OTHER, ret != E_OK);
+
+	BENCH_RUN(&loopCost, (void)0);
+
+	BENCH_RUN(&cost, (void)GetResource(ResShared); (void)ReleaseResource(ResShared));
+	Report("GetResource/ReleaseResource at the ceiling", &cost);
+
+	BENCH_RUN(&cost, (void)GetResource(ResCeiling); (void)ReleaseResource(ResCeiling));
+	Report("GetResource/ReleaseResource below the ceiling", &cost);
+
+	BENCH_RUN(&cost, (void)SetEvent(TaskWait, EventPing));
+	Report("SetEvent to a task not waiting for it", &cost);
+
+	ret = GetEvent(TaskWait, &EventMask);
+	ASSERT(OTHER, ret != E_OK);
+	ASSERT(OTHER, EventMask != EventPing);
+
+	/* TaskWait preempts and ends the test */
+	ret = SetEvent(TaskWait, EventStop);
+	ASSERT(OTHER, ret != E_OK);
+
+	TerminateTask();
+}
+
+TASK(TaskWait)
+{
+	StatusType ret;
+	EventMaskType EventMask;
+
+	ret = WaitEvent(EventStop);
+	ASSERT(OTHER, ret != E_OK);
+
+	ret = GetEvent(TaskWait, &EventMask);
+	ASSERT(OTHER, ret != E_OK);
+	ASSERT(OTHER, EventMask != (EventPing|EventStop));
+
+	printf(" >> END << \n");
+
+	TerminateTask();
+}
+
+TASK(TaskLow)
+{
+	TerminateTask();
+}
+
+TASK(TaskHigh)
+{
+	TerminateTask();
+}
@@ -0,0 +1,127 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* Dispatch latency over the full range of priorities 0..254, TaskMid(64) and TaskLow(1)
+ * are kept ready in other groups of the ready bitmap:
+ *   TaskBench(128) -> ActivateTask(TaskHigh)  : until TaskHigh(254) runs
+ *   TaskHigh(254)  -> TerminateTask()         : until TaskBench runs again
+ * Each is run BENCH_ROUNDS times and the fastest round is taken, the result is the CPU
+ * cycles per dispatch and the time per round trip. It's for the FIFO scheduler, to compare
+ * the clz and the table ready bitmap:
+ *   schedfifo=yes [schedtable=yes] python3 ctest.py ctest_askar_04 Standard */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "os.h"
+#include "ctest.h"
+
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_LOOPS  100000
+#define BENCH_ROUNDS 5
+
+#ifndef OS_TICKS_PER_SECOND
+#define OS_TICKS_PER_SECOND 1000
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static volatile uint64 activateStamp;
+static volatile uint64 terminateStamp;
+static uint64 activateCycles;
+static uint64 terminateCycles;
+static volatile boolean midDone;
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int main
+(
+	void
+)
+{
+	/* start OS in AppMode 1 */
+	StartOS(AppMode1);
+
+	/* shall never return */
+	while(1);
+
+	return 0;
+}
+
+TASK(TaskBench)
+{
+	uint32 i, r;
+	TickType ticks;
+	TickType minTicks = (TickType)-1;
+	uint64 minActivate = (uint64)-1;
+	uint64 minTerminate = (uint64)-1;
+
+	for(r=0; r<BENCH_ROUNDS; r++)
+	{
+		activateCycles = 0;
+		terminateCycles = 0;
+		ticks = OsTickCounter;
+		for(i=0; i<BENCH_LOOPS; i++)
+		{
+			activateStamp = GetCycleCounter();
+			(void)ActivateTask(TaskHigh);
+			terminateCycles += GetCycleCounter() - terminateStamp;
+		}
+		ticks = OsTickCounter - ticks;
+
+		if(ticks < minTicks)
+		{
+			minTicks = ticks;
+		}
+		if(activateCycles < minActivate)
+		{
+			minActivate = activateCycles;
+		}
+		if(terminateCycles < minTerminate)
+		{
+			minTerminate = terminateCycles;
+		}
+	}
+
+	printf(" >> ActivateTask to a higher priority: %u cycles\n",
+			(unsigned int)(minActivate/BENCH_LOOPS));
+	printf(" >> TerminateTask back to the lower priority: %u cycles\n",
+			(unsigned int)(minTerminate/BENCH_LOOPS));
+	printf(" >> round trip: %u ns\n",
+			(unsigned int)(((uint64)minTicks*1000000000u/OS_TICKS_PER_SECOND)/BENCH_LOOPS));
+
+	TerminateTask();
+}
+
+TASK(TaskHigh)
+{
+	activateCycles += GetCycleCounter() - activateStamp;
+	terminateStamp = GetCycleCounter();
+	TerminateTask();
+}
+
+TASK(TaskMid)
+{
+	midDone = TRUE;
+	TerminateTask();
+}
+
+TASK(TaskLow)
+{
+	/* the bitmap shall give TaskMid before TaskLow */
+	if(FALSE == midDone)
+	{
+		ASSERT(OTHER, FAILED);
+	}
+
+	printf(" >> END << \n");
+
+	TerminateTask();
+}
@@ -118,7 +118,7 @@ TASK(Task2)
 	EventMaskType EventMask;
 
 	Sequence(1);
-	GetEvent(Task1, &EventMask);
+	ret = GetEvent(Task2, &EventMask);
 	ASSERT(OTHER, EventMask != 0);
 	ASSERT(OTHER, ret != E_OK);
 	
@@ -142,7 +142,7 @@ TASK(Task3)
 	EventMaskType EventMask;
 
 	Sequence(4);
-	GetEvent(Task3, &EventMask);
+	ret = GetEvent(Task3, &EventMask);
 	ASSERT(OTHER, EventMask != 0);
 	ASSERT(OTHER, ret != E_OK);
 
@@ -46,6 +46,27 @@ def isLowerLayer(layer):
         return True
     return False
 
+def GetTpBuffers():
+    """ the TP buffers: the pool given by General.TpBufferPool as 'size*count,...'
+        and the ones reserved by the routes, as a list of (size, route index or None)
+    """
+    General=GLGet('General')
+    buffers = []
+    pool = General.attrib.get('TpBufferPool','').replace(' ','')
+    if(pool not in ['','NULL']):
+        for cls in pool.split(','):
+            if('*' in cls):
+                size,count = cls.split('*')
+            else:
+                size,count = cls,'1'
+            for i in range(int(count,0)):
+                buffers.append((int(size,0),None))
+    for id,path in enumerate(GLGet('RoutineList')):
+        size = int(path.attrib.get('TpBufferReserved','0'),0)
+        if(size > 0):
+            buffers.append((size,id))
+    return buffers
+
 def GenH():
     global __dir
     # =========================  PduR_Cfg.h ==================
@@ -123,9 +144,8 @@ def GenH():
 
 /* The maximum numbers of Tx buffers. */
 #define PDUR_MAX_TX_BUFFER_NUMBER            10 /* Not used */
-/* TBD: not supported by easySAR */
-#define PDUR_N_TP_ROUTES_WITH_BUFFER         0
-#define PDUR_N_TP_BUFFERS                    0
+#define PDUR_N_TP_ROUTES_WITH_BUFFER         %s
+#define PDUR_N_TP_BUFFERS                    %s
 
 // Multicast,not understand by parai
 #define PDUR_MULTICAST_TOIF_SUPPORT            STD_ON
@@ -201,7 +221,7 @@ def GenH():
 #endif  /* PDUR_ZERO_COST_OPERATION */
 
 #endif /* PDUR_CFG_H_ */    
-    """)
+    """%(len(GLGet('RoutineList')) if len(GetTpBuffers()) > 0 else 0, len(GetTpBuffers())))
     fp.close()
     
     # =========================  PduR_Cfg.h ==================
@@ -316,16 +336,30 @@ const PduRDestPdu_type PduR_PduRDestination[] = {
         cstr += """
 const PduRRoutingPath_type %s_PduRRoutingPath = {
     /*.SduLength =*/  8,
-    /*.TpChunkSize =*/ -1,
+    /*.TpChunkSize =*/ %s,
     /*.PduRDefaultValue =*/ {-1, NULL},
     /*.SrcPduId =*/  %s_ID_%s,
     /*.SrcModule =*/  ARC_PDUR_%s,
     /*.PduRDestPdus =*/  %s_PduRDestinations
-};\n"""%(GAGet(path,'PduRef'),
+};\n"""%(GAGet(path,'PduRef'),path.attrib.get('TpChunkSize','-1'),
          GAGet(path,'Module').upper(),GAGet(path,'PduRef'),
          GAGet(path,'Module').upper(),
          GAGet(path,'PduRef'))
     fp.write(cstr)
+    buffers = GetTpBuffers()
+    if(len(buffers) > 0):
+        cstr = ''
+        for id,(size,route) in enumerate(buffers):
+            cstr += 'static uint8 PduR_TpBufferData%s[%s];\n'%(id,size)
+        cstr += 'static PduInfoType PduR_TpPduInfos[] = {\n'
+        for id,(size,route) in enumerate(buffers):
+            cstr += '\t{ PduR_TpBufferData%s, 0 },\n'%(id)
+        cstr += '};\n\nstatic PduRTpBufferInfo_type PduR_TpBuffers[] = {\n'
+        for id,(size,route) in enumerate(buffers):
+            cstr += '\t{ &PduR_TpPduInfos[%s], PDUR_BUFFER_FREE, %s, 0, %s },\n'%(id,size,
+                        'PDUR_TP_BUFFER_SHARED' if route is None else 'PDUR_TP_BUFFER_RESERVED(%s)'%(route))
+        cstr += '};\n\nstatic PduRTpBufferInfo_type* PduR_TpRouteBuffers[PDUR_N_TP_ROUTES_WITH_BUFFER];\n'
+        fp.write(cstr)
     cstr = ''
     for path in GLGet('RoutineList'):
         cstr += '\t&%s_PduRRoutingPath,\n'%(GAGet(path,'PduRef'))
@@ -339,11 +373,13 @@ const PduR_PBConfigType PduR_Config = {
     /*.PduRConfigurationId =*/  0,
     /*.NRoutingPaths =*/  %s,       
     /*.RoutingPaths =*/  PduRRoutingPaths,
-    /*.TpBuffers =*/  NULL,
-    /*.TpRouteBuffers =*/  NULL
+    /*.TpBuffers =*/  %s,
+    /*.TpRouteBuffers =*/  %s
 };
 
 #endif //(PDUR_ZERO_COST_OPERATION == STD_OFF)  
-    \n"""%( cstr, len( GLGet('RoutineList') ) ) )
+    \n"""%( cstr, len( GLGet('RoutineList') ),
+            'PduR_TpBuffers' if len(buffers) > 0 else 'NULL',
+            'PduR_TpRouteBuffers' if len(buffers) > 0 else 'NULL' ) )
     fp.write('#endif /* USE_PDUR */\n')
     fp.close() 
@@ -50,6 +50,8 @@ def GenH():
     fp.write('#define XCP_ODT_COUNT  %s\n'%(GAGet(General,'XcpOdtCount')))
     fp.write('#define XCP_ODT_ENTRIES_COUNT %s\n'%(GAGet(General,'XcpOdtEntriesCount')))
     fp.write('#define XCP_MAX_CTO %s\n'%(GAGet(General,'XcpMaxCto')))
+    # XCP on CAN, up to 64 with CAN FD
+    assert(int(GAGet(General,'XcpMaxDto')) <= 64 and int(GAGet(General,'XcpMaxCto')) <= 64)
     fp.write('#define XCP_MAX_DTO %s\n'%(GAGet(General,'XcpMaxDto')))
     fp.write('#define XCP_MAX_RXTX_QUEUE %s\n'%(GAGet(General,'XcpMaxRxTxQueue')))
     fp.write('#define XCP_PROTOCOL XCP_PROTOCOL_CAN\n')
@@ -62,7 +64,12 @@ def GenH():
     fp.write('#define XCP_FEATURE_PROTECTION STD_ON\n')
     fp.write('#define XCP_FEATURE_PGM STD_ON\n')
     fp.write('#define XCP_FEATURE_BLOCKMODE STD_ON\n')
-    fp.write('#define XCP_FEATURE_CALPAG STD_ON\n\n')
+    fp.write('#define XCP_FEATURE_CALPAG STD_ON\n')
+    # non-standard, several ODTs in one frame, not the XCP 1.4 DAQ packed mode
+    if(General.attrib.get('XcpArcDtoMultiOdt','False') == 'True'):
+        fp.write('#define XCP_ARC_DTO_MULTI_ODT STD_ON\n\n')
+    else:
+        fp.write('#define XCP_ARC_DTO_MULTI_ODT STD_OFF\n\n')
     
     for id,evchl in enumerate(GLGet('XcpEventChannelList')):
         fp.write('#define XCP_EVCHL_%-32s %s\n'%(GAGet(evchl,'Name'),id))
@@ -44,6 +44,7 @@ re_general_SHUTDOWNHOOK = re.compile(r'SHUTDOWNHOOK\s*=\s*(\w+)\s*;')
 re_general_STARTUPHOOK = re.compile(r'STARTUPHOOK\s*=\s*(\w+)\s*;')
 re_general_SystemTimer = re.compile(r'SystemTimer\s*=\s*(\w+)\s*;')
 re_general_TickTime = re.compile(r'TickTime\s*=\s*(\w+)\s*;')
+re_general_CPU_CORE_NUMBER = re.compile(r'CPU_CORE_NUMBER\s*=\s*(\w+)\s*;')
 
 # 4: for task
 re_oil_os_task = re.compile(r'^\s*(TASK)\s*(\w+)')
@@ -57,6 +58,7 @@ re_task_appmode_list = re.compile(r'AUTOSTART\s*=\s*TRUE\s*{([^{}]*)}\s*;')
 re_task_APPMODE = re.compile(r'APPMODE\s*=\s*(\w+)')
 re_task_RESOURCE = re.compile(r'RESOURCE\s*=\s*(\w+)')
 re_task_EVENT = re.compile(r'EVENT\s*=\s*(\w+)')
+re_task_CPU = re.compile(r'\bCPU\s*=\s*(\w+)\s*;')
 
 # 6: for counter
 re_oil_os_counter = re.compile(r'^\s*(COUNTER)\s*(\w+)')
@@ -129,6 +131,8 @@ def oil_process_os(item, oscfg):
         general.attrib['ShutdownHook'] = re_general_SHUTDOWNHOOK.search(item).groups()[0];
     if(re_general_STARTUPHOOK.search(item)):
         general.attrib['StartupHook'] = re_general_STARTUPHOOK.search(item).groups()[0];
+    if(re_general_CPU_CORE_NUMBER.search(item)):
+        general.attrib['CPU_CORE_NUMBER'] = re_general_CPU_CORE_NUMBER.search(item).groups()[0];
     if(re_general_SystemTimer.search(item)):
         cnt = findObj(oscfg, 'Counter', 'SystemTimer')
         cnt.attrib['MaxAllowed'] = '32767'
@@ -165,6 +169,8 @@ def oil_process_task(item, oscfg):
                         modend = ET.Element('ApplicationMode')
                         modend.attrib['Name'] = modename
                         modelist.append(modend)
+    if(re_task_CPU.search(item)):
+        tsk.attrib['Cpu'] = re_task_CPU.search(item).groups()[0];
     if(re_task_StackSize.search(item)):
         tsk.attrib['StackSize'] = re_task_StackSize.search(item).groups()[0];
     elif(re_task_STACK.search(item)):
@@ -830,7 +830,7 @@ class Qemu():
         candrvtgt = '%s/com/as.tool/lua/script/socketwin_can_driver.exe'%(ASROOT)
         cmd = '%s -I%s/com/as.infrastructure/include -D__SOCKET_WIN_CAN_DRIVER__ %s -o %s'%(Env['CC'], ASROOT, candrvsrc, candrvtgt)
         if(IsPlatformWindows()):
-            cmd += ' -D__WINDOWS__ -lwsock32'
+            cmd += ' -D__WINDOWS__ -lws2_32'
         else:
             cmd += ' -D__LINUX__'
         MKObject(candrvsrc, candrvtgt, cmd)
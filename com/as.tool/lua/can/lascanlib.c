@@ -21,14 +21,24 @@
 #include <time.h>
 #include <sys/time.h>
 #include <ctype.h>
+#include <errno.h>
 #include "asdebug.h"
 /* ============================ [ MACROS    ] ====================================================== */
 #define CAN_BUS_NUM   4
 #define CAN_BUS_PDU_NUM   16
 #define CAN_BUS_Q_PDU_NUM   1024
+/* the most frames got by one can_read_batch */
+#define CAN_READ_BATCH_MAX  CAN_BUS_Q_PDU_NUM
 
 #define AS_LOG_LUA 0
 #define AS_LOG_CAN 0
+
+#ifdef __WINDOWS__
+#define CAN_CLOCK CLOCK_REALTIME
+#else
+/* the timeout of can_read_batch is not changed by setting the time of the system */
+#define CAN_CLOCK CLOCK_MONOTONIC
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
     /* the CAN ID, 29 or 11-bit */
@@ -38,6 +48,8 @@ typedef struct {
     uint8_t		length;
     /* data ptr */
     uint8_t 	sdu[64];
+    /* us of CAN_CLOCK when it's taken from the device */
+    uint64_t    timestamp;
 } Can_PduType;
 struct Can_Pdu_s {
 	Can_PduType msg;
@@ -61,6 +73,7 @@ struct Can_Bus_s {
 	STAILQ_HEAD(,Can_Pdu_s) headQ;	/* for all the message RX or TX by this bus with single Queue */
 	uint32_t                sizeQ;
 	uint32_t                warningQ;
+	pthread_cond_t          rx_cond; /* signaled with q_lock when any is saved */
 	STAILQ_ENTRY(Can_Bus_s) entry;
 };
 
@@ -107,6 +120,31 @@ static const Can_DeviceOpsType* canOps [] =
 };
 static FILE* canLog = NULL;
 /* ============================ [ LOCALS    ] ====================================================== */
+static uint64_t getTimestamp(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CAN_CLOCK, &ts);
+
+	return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+static void initB(struct Can_Bus_s* b)
+{
+	pthread_condattr_t attr;
+
+	STAILQ_INIT(&b->head);
+	STAILQ_INIT(&b->head2);
+	STAILQ_INIT(&b->headQ);
+	b->size2 = 0;
+	b->sizeQ = 0;
+
+	pthread_condattr_init(&attr);
+	#ifndef __WINDOWS__
+	pthread_condattr_setclock(&attr, CAN_CLOCK);
+	#endif
+	pthread_cond_init(&b->rx_cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
 static void freeQ(struct Can_PduQueue_s* l)
 {
 	struct Can_Pdu_s* pdu;
@@ -140,6 +178,7 @@ static void freeH(struct Can_BusList_s*h)
 		b = STAILQ_FIRST(&h->head);
 		STAILQ_REMOVE_HEAD(&h->head,entry);
 		freeB(b);
+		pthread_cond_destroy(&b->rx_cond);
 		free(b);
 	}
 	pthread_mutex_unlock(&h->q_lock);
@@ -184,18 +223,20 @@ static void saveQ(struct Can_Bus_s* b, uint32_t canid, uint8_t dlc, uint8_t * da
 		pdu->msg.id = canid;
 		pdu->msg.length = dlc;
 		memcpy(&(pdu->msg.sdu),data,dlc);
+		pdu->msg.timestamp = getTimestamp();
 		(void)pthread_mutex_lock(&canbusH.q_lock);
 		STAILQ_INSERT_TAIL(&b->headQ, pdu, entry);
 		b->sizeQ ++;
+		pthread_cond_broadcast(&b->rx_cond);
 		(void)pthread_mutex_unlock(&canbusH.q_lock);
 		/* b->warningQ = FALSE; */
 	}
 }
 
+/* the q_lock is taken by the caller */
 static struct Can_Pdu_s* getQ(struct Can_Bus_s* b)
 {
 	struct Can_Pdu_s* pdu = NULL;
-	(void)pthread_mutex_lock(&canbusH.q_lock);
 	if((FALSE == STAILQ_EMPTY(&b->headQ)))
 	{
 		pdu = STAILQ_FIRST(&b->headQ);
@@ -204,11 +245,11 @@ static struct Can_Pdu_s* getQ(struct Can_Bus_s* b)
 		b->sizeQ --;
 
 	}
-	(void)pthread_mutex_unlock(&canbusH.q_lock);
 	return pdu;
 }
 
-static struct Can_Pdu_s* getPdu(struct Can_Bus_s* b,uint32_t canid)
+/* the q_lock is taken by the caller */
+static struct Can_Pdu_s* getPduLocked(struct Can_Bus_s* b,uint32_t canid)
 {
 	struct Can_PduQueue_s* L=NULL;
 	struct Can_Pdu_s* pdu = NULL;
@@ -219,7 +260,6 @@ static struct Can_Pdu_s* getPdu(struct Can_Bus_s* b,uint32_t canid)
 		return getQ(b);
 	}
 
-	(void)pthread_mutex_lock(&canbusH.q_lock);
 	if((uint32_t)-1 == canid)
 	{	/* id is -1, means get the first of queue from b->head2 */
 		if(FALSE == STAILQ_EMPTY(&b->head2))
@@ -246,16 +286,59 @@ static struct Can_Pdu_s* getPdu(struct Can_Bus_s* b,uint32_t canid)
 	if(L && (FALSE == STAILQ_EMPTY(&L->head)))
 	{
 		pdu = STAILQ_FIRST(&L->head);
-		/* when remove, should remove from the both queue */
+		/* when remove, should remove from the both queue, it's not the head of head2 if
+		 * read by canid */
 		STAILQ_REMOVE_HEAD(&L->head,entry);
-		STAILQ_REMOVE_HEAD(&b->head2,entry2);
+		STAILQ_REMOVE(&b->head2,pdu,Can_Pdu_s,entry2);
 		b->size2 --;
 		L->size --;
 	}
+	return pdu;
+}
+
+static struct Can_Pdu_s* getPdu(struct Can_Bus_s* b,uint32_t canid)
+{
+	struct Can_Pdu_s* pdu;
+	(void)pthread_mutex_lock(&canbusH.q_lock);
+	pdu = getPduLocked(b,canid);
 	(void)pthread_mutex_unlock(&canbusH.q_lock);
 	return pdu;
 }
 
+/* up to num of the PDUs got as getPdu, wait for timeout ms if there is none */
+static uint32_t getPdus(struct Can_Bus_s* b,uint32_t canid,struct Can_Pdu_s** pdus,uint32_t num,uint32_t timeout)
+{
+	uint32_t n = 0;
+	struct timespec ts;
+
+	clock_gettime(CAN_CLOCK, &ts);
+	ts.tv_sec += timeout/1000;
+	ts.tv_nsec += (timeout%1000)*1000000;
+	if(ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec += 1;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	(void)pthread_mutex_lock(&canbusH.q_lock);
+	while(n < num)
+	{
+		pdus[n] = getPduLocked(b,canid);
+		if(NULL != pdus[n])
+		{
+			n ++;
+		}
+		else if((n > 0) ||
+				(ETIMEDOUT == pthread_cond_timedwait(&b->rx_cond,&canbusH.q_lock,&ts)))
+		{
+			break;
+		}
+	}
+	(void)pthread_mutex_unlock(&canbusH.q_lock);
+
+	return n;
+}
+
 static void saveB(struct Can_Bus_s* b,struct Can_Pdu_s* pdu)
 {
 	struct Can_PduQueue_s* L;
@@ -298,6 +381,7 @@ static void saveB(struct Can_Bus_s* b,struct Can_Pdu_s* pdu)
 			b->size2 ++;
 			L->size ++;
 			L->warning = FALSE;
+			pthread_cond_broadcast(&b->rx_cond);
 		}
 		else
 		{
@@ -318,7 +402,12 @@ static void rx_notification(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t*
 	if((busid < CAN_BUS_NUM) && ((uint32_t)-1 != canid))
 	{	/* canid -1 reserved for can_read get the first received CAN message on bus */
 		struct Can_Bus_s* b = getBus(busid);
-		if(NULL != b)
+		if((NULL != b) && lascantp_rx_indication(busid,canid,dlc,data))
+		{	/* taken by the ISO-TP channel, not for can_read */
+			saveQ(b,canid,dlc,data);
+			logCan(TRUE,busid,canid,dlc,data);
+		}
+		else if(NULL != b)
 		{
 			struct Can_Pdu_s* pdu = malloc(sizeof(struct Can_Pdu_s));
 			if(pdu)
@@ -327,6 +416,7 @@ static void rx_notification(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t*
 				pdu->msg.id = canid;
 				pdu->msg.length = dlc;
 				memcpy(&(pdu->msg.sdu),data,dlc);
+				pdu->msg.timestamp = getTimestamp();
 
 				saveB(b,pdu);
 				saveQ(b,canid,dlc,data);
@@ -477,11 +567,7 @@ int luai_can_open  (lua_State *L)
 
 				if(rv)
 				{
-					STAILQ_INIT(&b->head);
-					STAILQ_INIT(&b->head2);
-					STAILQ_INIT(&b->headQ);
-					b->size2 = 0;
-					b->sizeQ = 0;
+					initB(b);
 					pthread_mutex_lock(&canbusH.q_lock);
 					STAILQ_INSERT_TAIL(&canbusH.head,b,entry);
 					pthread_mutex_unlock(&canbusH.q_lock);
@@ -670,6 +756,86 @@ int luai_can_read  (lua_State *L)
 	}
 }
 
+int luai_can_read_batch (lua_State *L)
+{
+	int n = lua_gettop(L);  /* number of arguments */
+	if(4==n)
+	{
+		uint32_t busid,canid,num,timeout;
+		uint32_t i,j,got;
+		struct Can_Pdu_s** pdus;
+		int is_num,table_index,frame_index,data_index;
+
+		busid = lua_tounsignedx(L, 1,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument busid to function 'can_read_batch'");
+		}
+
+		canid = lua_tounsignedx(L, 2,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument canid to function 'can_read_batch'");
+		}
+
+		num = lua_tounsignedx(L, 3,&is_num);
+		if((!is_num) || (0 == num) || (num > CAN_READ_BATCH_MAX))
+		{
+			 return luaL_error(L,"incorrect argument num to function 'can_read_batch', 1..%d",CAN_READ_BATCH_MAX);
+		}
+
+		timeout = lua_tounsignedx(L, 4,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument timeout to function 'can_read_batch'");
+		}
+
+		struct Can_Bus_s* b = getBus(busid);
+		if(NULL == b)
+		{
+			 return luaL_error(L,"bus(%d) is not on-line 'can_read_batch'",busid);
+		}
+
+		pdus = malloc(sizeof(struct Can_Pdu_s*)*num);
+		if(NULL == pdus)
+		{
+			return luaL_error(L,"malloc failed to function 'can_read_batch'");
+		}
+
+		got = getPdus(b,canid,pdus,num,timeout);
+
+		lua_pushinteger(L, got);
+		lua_createtable(L, got, 0);
+		table_index = lua_gettop(L);
+		for(i=0; i<got; i++)
+		{
+			lua_createtable(L, 0, 3);
+			frame_index = lua_gettop(L);
+			lua_pushinteger(L, pdus[i]->msg.id);
+			lua_setfield(L, frame_index, "id");
+			lua_pushinteger(L, pdus[i]->msg.timestamp);
+			lua_setfield(L, frame_index, "time");
+			lua_createtable(L, pdus[i]->msg.length, 0);
+			data_index = lua_gettop(L);
+			for(j=0; j<pdus[i]->msg.length; j++)
+			{
+				lua_pushinteger(L, pdus[i]->msg.sdu[j]);
+				lua_seti(L, data_index, j+1);
+			}
+			lua_setfield(L, frame_index, "data");
+			lua_seti(L, table_index, i+1);
+			free(pdus[i]);
+		}
+		free(pdus);
+
+		return 2;
+	}
+	else
+	{
+		return luaL_error(L, "can_read_batch (bus_id, can_id, num, timeout) API should has 4 arguments");
+	}
+}
+
 int luai_can_close  (lua_State *L)
 {
 	int n = lua_gettop(L);  /* number of arguments */
@@ -693,6 +859,7 @@ int luai_can_close  (lua_State *L)
 		(void)pthread_mutex_lock(&canbusH.q_lock);
 		b->device.ops->close(b->device.busid,b->device.port);
 		STAILQ_REMOVE(&canbusH.head,b,Can_Bus_s,entry);
+		pthread_cond_destroy(&b->rx_cond);
 		free(b);
 		(void)pthread_mutex_unlock(&canbusH.q_lock);
 
@@ -703,6 +870,57 @@ int luai_can_close  (lua_State *L)
 		return luaL_error(L, "can_close (bus_id) API should has 1 arguments");
 	}
 }
+int luai_can_filter (lua_State *L)
+{
+	int n = lua_gettop(L);  /* number of arguments */
+	if(3==n)
+	{
+		uint32_t busid,mask,code;
+		int is_num;
+
+		busid = lua_tounsignedx(L, 1,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument busid to function 'can_filter'");
+		}
+
+		mask = lua_tounsignedx(L, 2,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument mask to function 'can_filter'");
+		}
+
+		code = lua_tounsignedx(L, 3,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument code to function 'can_filter'");
+		}
+
+		struct Can_Bus_s* b = getBus(busid);
+		if(NULL == b)
+		{
+			 return luaL_error(L,"bus(%d) is not on-line 'can_filter'",busid);
+		}
+
+		if(NULL == b->device.ops->filter)
+		{
+			return luaL_error(L,"can bus(%d) device <%s> has no filter 'can_filter'",busid,b->device.ops->name);
+		}
+
+		if(FALSE == b->device.ops->filter(b->device.busid,b->device.port,mask,code))
+		{
+			return luaL_error(L, "can_filter bus(%d) failed!",busid);
+		}
+
+		lua_pushboolean(L, TRUE);        /* result OK */
+		return 1;
+	}
+	else
+	{
+		return luaL_error(L, "can_filter (bus_id,mask,code) API should has 3 arguments");
+	}
+}
+
 int luai_can_log  (lua_State *L)
 {
 	int n = lua_gettop(L);  /* number of arguments */
@@ -757,6 +975,20 @@ int luai_can_log  (lua_State *L)
 	}
 }
 #endif /* __AS_PY_CAN__ */
+boolean lascan_write(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t* data)
+{
+	boolean rv = FALSE;
+	struct Can_Bus_s * b = getBus(busid);
+
+	if((NULL != b) && (NULL != b->device.ops->write))
+	{
+		rv = b->device.ops->write(b->device.busid,b->device.port,canid,dlc,data);
+		saveQ(b,canid,dlc,data);
+		logCan(FALSE,busid,canid,dlc,data);
+	}
+
+	return rv;
+}
 void luai_canlib_open(void)
 {
 	if(canbusH.initialized)
@@ -812,11 +1044,7 @@ int can_open(unsigned long busid,const char* device_name,unsigned long port, uns
 
 			if(rv)
 			{
-				STAILQ_INIT(&b->head);
-				STAILQ_INIT(&b->head2);
-				STAILQ_INIT(&b->headQ);
-				b->size2 = 0;
-				b->sizeQ = 0;
+				initB(b);
 				pthread_mutex_lock(&canbusH.q_lock);
 				STAILQ_INSERT_TAIL(&canbusH.head,b,entry);
 				pthread_mutex_unlock(&canbusH.q_lock);
@@ -924,6 +1152,42 @@ int can_read(unsigned long busid,unsigned long canid,unsigned long* p_canid,unsi
 	return rv;
 }
 
+int can_read_batch(unsigned long busid,unsigned long canid,unsigned long num,unsigned long timeout,
+		unsigned long* p_canid,unsigned long* dlc,unsigned char* data,unsigned long long* timestamp)
+{
+	int rv = 0;
+	int i;
+	struct Can_Pdu_s** pdus;
+	struct Can_Bus_s* b = getBus(busid);
+
+	if(NULL == b)
+	{
+		printf("ERROR :: bus(%d) is not on-line 'can_read_batch'\n",(int)busid);
+	}
+	else if((0 == num) || (num > CAN_READ_BATCH_MAX))
+	{
+		printf("ERROR :: bus(%d) 'can_read_batch' with invalid num(%d), 1..%d\n",(int)busid,(int)num,CAN_READ_BATCH_MAX);
+	}
+	else
+	{
+		pdus = malloc(sizeof(struct Can_Pdu_s*)*num);
+		asAssert(pdus);
+		rv = getPdus(b,canid,pdus,num,timeout);
+		for(i=0; i<rv; i++)
+		{
+			p_canid[i] = pdus[i]->msg.id;
+			dlc[i] = pdus[i]->msg.length;
+			memcpy(&data[i*CAN_READ_BATCH_MTU],pdus[i]->msg.sdu,pdus[i]->msg.length);
+			timestamp[i] = pdus[i]->msg.timestamp;
+			free(pdus[i]);
+		}
+		free(pdus);
+	}
+
+	fflush(stdout);
+	return rv;
+}
+
 int can_close(unsigned long busid)
 {
 	int rv;
@@ -938,6 +1202,7 @@ int can_close(unsigned long busid)
 		(void)pthread_mutex_lock(&canbusH.q_lock);
 		b->device.ops->close(b->device.busid,b->device.port);
 		STAILQ_REMOVE(&canbusH.head,b,Can_Bus_s,entry);
+		pthread_cond_destroy(&b->rx_cond);
 		free(b);
 		(void)pthread_mutex_unlock(&canbusH.q_lock);
 		rv = TRUE;
@@ -945,6 +1210,31 @@ int can_close(unsigned long busid)
 
 	return rv;
 }
+int can_filter(unsigned long busid,unsigned long mask,unsigned long code)
+{
+	int rv;
+	struct Can_Bus_s * b = getBus(busid);
+	rv = FALSE;
+	if(NULL == b)
+	{
+		printf("ERROR :: can bus(%d) is not on-line 'can_filter'\n",(int)busid);
+	}
+	else if(NULL == b->device.ops->filter)
+	{
+		printf("ERROR :: can bus(%d) device <%s> has no filter 'can_filter'\n",(int)busid,b->device.ops->name);
+	}
+	else
+	{
+		rv = b->device.ops->filter(b->device.busid,b->device.port,mask,code);
+		if(FALSE == rv)
+		{
+			printf("ERROR :: can_filter bus(%d) failed!\n",(int)busid);
+		}
+	}
+
+	fflush(stdout);
+	return rv;
+}
 int can_reset(unsigned long busid)
 {
 	int rv;
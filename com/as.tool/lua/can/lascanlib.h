@@ -23,12 +23,18 @@
 #endif
 /* ============================ [ MACROS    ] ====================================================== */
 #define CAN_DEVICE_NAME_SIZE 32
+/* the bytes of each frame in the data of can_read_batch */
+#define CAN_READ_BATCH_MTU 64
 /* ============================ [ TYPES     ] ====================================================== */
 typedef void (*can_device_rx_notification_t)(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t* data);
 typedef boolean (*can_device_probe_t)(uint32_t busid,uint32_t port,uint32_t baudrate,can_device_rx_notification_t rx_notification);
 typedef boolean (*can_device_write_t)(uint32_t busid,uint32_t port,uint32_t canid,uint32_t dlc,uint8_t* data);
 typedef boolean (*can_device_reset_t)(uint32_t busid,uint32_t port);
 typedef void (*can_device_close_t)(uint32_t busid,uint32_t port);
+/* add an acceptance filter, a frame is received if (canid&mask) == (code&mask) for any of
+ * them, mask 0 accepts all and so clears them. Optional, the device without it receives
+ * all the frames */
+typedef boolean (*can_device_filter_t)(uint32_t busid,uint32_t port,uint32_t mask,uint32_t code);
 
 typedef struct
 {
@@ -37,6 +43,7 @@ typedef struct
 	can_device_close_t close;
 	can_device_write_t write;
 	can_device_reset_t reset;
+	can_device_filter_t filter;
 }Can_DeviceOpsType;
 
 typedef struct
@@ -59,12 +66,30 @@ extern const Can_DeviceOpsType can_socketwin_ops;
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
 /* ============================ [ FUNCTIONS ] ====================================================== */
+/* the write of can_write without the checks, for the ISO-TP */
+boolean lascan_write(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t* data);
+/* ISO 15765-2 on the bus, lascantp.c. The rx indication is called by the rx notification of
+ * lascanlib first and returns TRUE if the frame is taken by a channel. The transmit and the
+ * receive block the caller for up to timeout ms, the data got by the receive is to be freed
+ * by the caller. */
+boolean lascantp_rx_indication(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t* data);
+boolean lascantp_open(uint32_t channel,uint32_t busid,uint32_t rxid,uint32_t txid,
+		uint32_t ll_dl,uint32_t bs,uint32_t stmin_us,uint32_t padding);
+void lascantp_close(uint32_t channel);
+boolean lascantp_transmit(uint32_t channel,uint8_t* data,uint32_t size,uint32_t timeout);
+boolean lascantp_receive(uint32_t channel,uint8_t** data,uint32_t* size,uint32_t timeout);
 #if !defined(__AS_PY_CAN__) && !defined(__AS_CAN_BUS__)
 int luai_can_write (lua_State *L);
 int luai_can_read  (lua_State *L);
+int luai_can_read_batch(lua_State *L);
 int luai_can_open  (lua_State *L);
 int luai_can_close (lua_State *L);
+int luai_can_filter(lua_State *L);
 int luai_can_log   (lua_State *L);
+int luai_cantp_open    (lua_State *L);
+int luai_cantp_transmit(lua_State *L);
+int luai_cantp_receive (lua_State *L);
+int luai_cantp_close   (lua_State *L);
 void luai_canlib_open(void);
 void luai_canlib_close(void);
 #endif
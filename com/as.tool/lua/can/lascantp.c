@@ -0,0 +1,908 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* ISO 15765-2 for the Lua and Python testers. The reception runs on the rx thread of the CAN
+ * device: lascanlib gives it the frames of the channel rxid, which are then not queued for
+ * can_read. It answers the FF and the end of each block with the FC at once and queues the
+ * whole message for cantp_receive. The transmission runs on the caller, which waits for the
+ * FC on a condition variable signaled by the rx thread and keeps STmin to the us. With
+ * ll_dl above 8 it's CAN FD: the SF and FF escape forms and the frames padded to the next
+ * valid DLC. */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "Std_Types.h"
+#include "lascanlib.h"
+#include <sys/queue.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include "asdebug.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#define CANTP_CHANNEL_NUM 8
+/* the messages received but not yet taken by cantp_receive */
+#define CANTP_MSG_NUM 16
+#define CANTP_MAX_SIZE (1024*1024)
+/* a reception in progress is given up only if no CF in this time, even if cantp_receive
+ * is polled with a shorter timeout */
+#define CANTP_N_CR_MS 1000
+
+#define ISO15765_TPCI_MASK  0xF0
+#define ISO15765_TPCI_SF    0x00         /* Single Frame */
+#define ISO15765_TPCI_FF    0x10         /* First Frame */
+#define ISO15765_TPCI_CF    0x20         /* Consecutive Frame */
+#define ISO15765_TPCI_FC    0x30         /* Flow Control */
+#define ISO15765_TPCI_DL    0x0F         /* Single frame data length mask */
+#define ISO15765_TPCI_FS_MASK 0x0F       /* Flow control status mask */
+
+#define ISO15765_FLOW_CONTROL_STATUS_CTS    0
+#define ISO15765_FLOW_CONTROL_STATUS_WAIT   1
+#define ISO15765_FLOW_CONTROL_STATUS_OVFLW  2
+
+#define CANTP_ST_IDLE    0
+#define CANTP_ST_WAIT_CF 1
+
+#define AS_LOG_CANTP 0
+#define AS_LOG_CANTPE 1
+
+#ifdef __WINDOWS__
+#define CANTP_CLOCK CLOCK_REALTIME
+#else
+/* the timeout is not changed by setting the time of the system */
+#define CANTP_CLOCK CLOCK_MONOTONIC
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+struct Can_TpMsg_s {
+	uint32_t size;
+	STAILQ_ENTRY(Can_TpMsg_s) entry;
+	uint8_t data[1];
+};
+
+struct Can_TpChannel_s {
+	boolean online;
+	uint32_t busid;
+	uint32_t rxid;
+	uint32_t txid;
+	uint32_t ll_dl;	/* 8, or up to 64 for CAN FD */
+	uint8_t bs;		/* the block size and STmin in the FC to the sender */
+	uint8_t stmin;
+	uint8_t padding;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	/* reception, on the rx thread */
+	uint32_t rxState;
+	uint8_t* rxBuf;
+	uint32_t rxSize;
+	uint32_t rxOffset;
+	uint8_t rxSN;
+	uint8_t rxBS;
+	struct timespec rxStamp;
+	STAILQ_HEAD(,Can_TpMsg_s) msgs;
+	uint32_t msgNum;
+	/* the FC to the transmission */
+	boolean fcGot;
+	uint8_t fcFS;
+	uint8_t fcBS;
+	uint8_t fcSTmin;
+};
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static struct Can_TpChannel_s cantpChannels[CANTP_CHANNEL_NUM];
+static pthread_mutex_t cantpLock = PTHREAD_MUTEX_INITIALIZER;
+/* ============================ [ LOCALS    ] ====================================================== */
+static void cantp_deadline(struct timespec* ts, uint32_t ms)
+{
+	clock_gettime(CANTP_CLOCK, ts);
+	ts->tv_sec += ms/1000;
+	ts->tv_nsec += (ms%1000)*1000000;
+	if(ts->tv_nsec >= 1000000000)
+	{
+		ts->tv_sec += 1;
+		ts->tv_nsec -= 1000000000;
+	}
+}
+
+static void cantp_sleep_until(const struct timespec* ts)
+{
+#ifdef __WINDOWS__
+	struct timespec now;
+	do {
+		clock_gettime(CANTP_CLOCK, &now);
+	} while((now.tv_sec < ts->tv_sec) || ((now.tv_sec == ts->tv_sec) && (now.tv_nsec < ts->tv_nsec)));
+#else
+	while(EINTR == clock_nanosleep(CANTP_CLOCK, TIMER_ABSTIME, ts, NULL));
+#endif
+}
+
+/* STmin in the FC: 0..127 ms or 0xF1..0xF9 for 100..900 us */
+static uint8_t cantp_encode_stmin(uint32_t us)
+{
+	uint8_t stmin;
+
+	if(us < 100)
+	{
+		stmin = 0;
+	}
+	else if(us < 1000)
+	{
+		stmin = 0xF0 + us/100;
+	}
+	else if(us < 127000)
+	{
+		stmin = (us+999)/1000;
+	}
+	else
+	{
+		stmin = 127;
+	}
+
+	return stmin;
+}
+
+static uint32_t cantp_decode_stmin(uint8_t stmin)
+{
+	uint32_t us;
+
+	if(stmin <= 0x7F)
+	{
+		us = stmin*1000;
+	}
+	else if((stmin >= 0xF1) && (stmin <= 0xF9))
+	{
+		us = (stmin-0xF0)*100;
+	}
+	else
+	{	/* reserved, the longest one */
+		us = 127000;
+	}
+
+	return us;
+}
+
+/* the length padded to a valid DLC of CAN FD */
+static uint32_t cantp_fd_length(uint32_t len)
+{
+	static const uint8_t fdLength[] = { 12, 16, 20, 24, 32, 48, 64 };
+	uint32_t i;
+
+	if(len <= 8)
+	{
+		len = 8;
+	}
+	else
+	{
+		for(i=0; i<sizeof(fdLength); i++)
+		{
+			if(len <= fdLength[i])
+			{
+				len = fdLength[i];
+				break;
+			}
+		}
+	}
+
+	return len;
+}
+
+static boolean cantp_send(struct Can_TpChannel_s* ch, uint8_t* pdu, uint32_t len)
+{
+	uint32_t dlc = cantp_fd_length(len);
+
+	memset(&pdu[len], ch->padding, dlc-len);
+
+	return lascan_write(ch->busid, ch->txid, dlc, pdu);
+}
+
+static struct Can_TpChannel_s* cantp_get(uint32_t channel)
+{
+	struct Can_TpChannel_s* ch = NULL;
+
+	if((channel < CANTP_CHANNEL_NUM) && cantpChannels[channel].online)
+	{
+		ch = &cantpChannels[channel];
+	}
+
+	return ch;
+}
+
+static void cantp_send_fc(struct Can_TpChannel_s* ch, uint8_t fs)
+{
+	uint8_t pdu[64];
+
+	pdu[0] = ISO15765_TPCI_FC | fs;
+	pdu[1] = ch->bs;
+	pdu[2] = ch->stmin;
+
+	(void)cantp_send(ch, pdu, 3);
+}
+
+static void cantp_abort_rx(struct Can_TpChannel_s* ch)
+{
+	if(NULL != ch->rxBuf)
+	{
+		free(ch->rxBuf);
+		ch->rxBuf = NULL;
+	}
+	ch->rxState = CANTP_ST_IDLE;
+}
+
+static void cantp_queue(struct Can_TpChannel_s* ch, uint8_t* data, uint32_t size)
+{
+	struct Can_TpMsg_s* msg;
+
+	if(ch->msgNum >= CANTP_MSG_NUM)
+	{
+		msg = STAILQ_FIRST(&ch->msgs);
+		STAILQ_REMOVE_HEAD(&ch->msgs, entry);
+		ch->msgNum --;
+		free(msg);
+		ASWARNING(("CANTP rxid=%X message list is full, the oldest is dropped\n", ch->rxid));
+	}
+
+	msg = malloc(sizeof(struct Can_TpMsg_s) + size);
+	if(NULL != msg)
+	{
+		msg->size = size;
+		memcpy(msg->data, data, size);
+		STAILQ_INSERT_TAIL(&ch->msgs, msg, entry);
+		ch->msgNum ++;
+		pthread_cond_broadcast(&ch->cond);
+	}
+	else
+	{
+		ASWARNING(("CANTP RX malloc failed\n"));
+	}
+}
+
+static void cantp_rx_sf(struct Can_TpChannel_s* ch, uint32_t dlc, uint8_t* data)
+{
+	uint32_t size = data[0]&ISO15765_TPCI_DL;
+	uint32_t offset = 1;
+
+	if((0 == size) && (dlc > 8))
+	{	/* CAN FD, the length in the 2nd byte */
+		size = data[1];
+		offset = 2;
+	}
+
+	if(CANTP_ST_IDLE != ch->rxState)
+	{
+		ASLOG(CANTPE, ("CANTP rxid=%X SF in the middle of a message, restart\n", ch->rxid));
+		cantp_abort_rx(ch);
+	}
+
+	if((size > 0) && ((size+offset) <= dlc))
+	{
+		cantp_queue(ch, &data[offset], size);
+	}
+}
+
+static void cantp_rx_ff(struct Can_TpChannel_s* ch, uint32_t dlc, uint8_t* data)
+{
+	uint32_t size = ((uint32_t)(data[0]&0x0F)<<8) + data[1];
+	uint32_t offset = 2;
+
+	if(0 == size)
+	{	/* more than 4095 bytes */
+		size = ((uint32_t)data[2]<<24) + ((uint32_t)data[3]<<16) + ((uint32_t)data[4]<<8) + data[5];
+		offset = 6;
+	}
+
+	if(CANTP_ST_IDLE != ch->rxState)
+	{
+		ASLOG(CANTPE, ("CANTP rxid=%X FF in the middle of a message, restart\n", ch->rxid));
+		cantp_abort_rx(ch);
+	}
+
+	if((dlc <= offset) || (size < dlc-offset))
+	{	/* not a valid FF */
+		return;
+	}
+
+	if(size > CANTP_MAX_SIZE)
+	{
+		cantp_send_fc(ch, ISO15765_FLOW_CONTROL_STATUS_OVFLW);
+		return;
+	}
+
+	ch->rxBuf = malloc(size);
+	if(NULL == ch->rxBuf)
+	{
+		cantp_send_fc(ch, ISO15765_FLOW_CONTROL_STATUS_OVFLW);
+		return;
+	}
+
+	memcpy(ch->rxBuf, &data[offset], dlc-offset);
+	ch->rxSize = size;
+	ch->rxOffset = dlc-offset;
+	ch->rxSN = 1;
+	ch->rxBS = ch->bs;
+	ch->rxState = CANTP_ST_WAIT_CF;
+	clock_gettime(CANTP_CLOCK, &ch->rxStamp);
+
+	cantp_send_fc(ch, ISO15765_FLOW_CONTROL_STATUS_CTS);
+}
+
+static void cantp_rx_cf(struct Can_TpChannel_s* ch, uint32_t dlc, uint8_t* data)
+{
+	uint32_t size;
+
+	if(CANTP_ST_WAIT_CF != ch->rxState)
+	{
+		return;
+	}
+
+	if((data[0]&0x0F) != ch->rxSN)
+	{
+		ASLOG(CANTPE, ("CANTP rxid=%X wrong sequence number %d, expect %d!\n",
+				ch->rxid, data[0]&0x0F, ch->rxSN));
+		cantp_abort_rx(ch);
+		return;
+	}
+
+	size = ch->rxSize - ch->rxOffset;
+	if(size > (dlc-1))
+	{
+		size = dlc-1;
+	}
+	memcpy(&ch->rxBuf[ch->rxOffset], &data[1], size);
+	ch->rxOffset += size;
+	ch->rxSN = (ch->rxSN+1)&0x0F;
+	clock_gettime(CANTP_CLOCK, &ch->rxStamp);
+
+	if(ch->rxOffset >= ch->rxSize)
+	{
+		cantp_queue(ch, ch->rxBuf, ch->rxSize);
+		cantp_abort_rx(ch);
+	}
+	else if(ch->bs > 0)
+	{
+		ch->rxBS --;
+		if(0 == ch->rxBS)
+		{
+			ch->rxBS = ch->bs;
+			cantp_send_fc(ch, ISO15765_FLOW_CONTROL_STATUS_CTS);
+		}
+	}
+}
+
+static void cantp_rx_fc(struct Can_TpChannel_s* ch, uint32_t dlc, uint8_t* data)
+{
+	if(dlc >= 3)
+	{
+		ch->fcFS = data[0]&ISO15765_TPCI_FS_MASK;
+		ch->fcBS = data[1];
+		ch->fcSTmin = data[2];
+		ch->fcGot = TRUE;
+		pthread_cond_broadcast(&ch->cond);
+	}
+}
+
+/* the FC for the transmission, FALSE if none in the timeout */
+static boolean cantp_wait_fc(struct Can_TpChannel_s* ch, uint32_t timeout)
+{
+	boolean rv = TRUE;
+	struct timespec ts;
+
+	cantp_deadline(&ts, timeout);
+
+	pthread_mutex_lock(&ch->lock);
+	while(FALSE == ch->fcGot)
+	{
+		if(ETIMEDOUT == pthread_cond_timedwait(&ch->cond, &ch->lock, &ts))
+		{
+			rv = ch->fcGot;
+			break;
+		}
+	}
+	ch->fcGot = FALSE;
+	pthread_mutex_unlock(&ch->lock);
+
+	return rv;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+boolean lascantp_rx_indication(uint32_t busid, uint32_t canid, uint32_t dlc, uint8_t* data)
+{
+	uint32_t i;
+	struct Can_TpChannel_s* ch = NULL;
+
+	/* kept locked so the channel is not closed under the rx thread */
+	pthread_mutex_lock(&cantpLock);
+	for(i=0; i<CANTP_CHANNEL_NUM; i++)
+	{
+		if( cantpChannels[i].online && (cantpChannels[i].busid == busid) &&
+			(cantpChannels[i].rxid == canid) )
+		{
+			ch = &cantpChannels[i];
+			break;
+		}
+	}
+
+	if((NULL != ch) && (dlc > 0))
+	{
+		pthread_mutex_lock(&ch->lock);
+		switch(data[0]&ISO15765_TPCI_MASK)
+		{
+			case ISO15765_TPCI_SF:
+				cantp_rx_sf(ch, dlc, data);
+				break;
+			case ISO15765_TPCI_FF:
+				cantp_rx_ff(ch, dlc, data);
+				break;
+			case ISO15765_TPCI_CF:
+				cantp_rx_cf(ch, dlc, data);
+				break;
+			case ISO15765_TPCI_FC:
+				cantp_rx_fc(ch, dlc, data);
+				break;
+			default:
+				break;
+		}
+		pthread_mutex_unlock(&ch->lock);
+	}
+	pthread_mutex_unlock(&cantpLock);
+
+	return (NULL != ch);
+}
+
+boolean lascantp_open(uint32_t channel, uint32_t busid, uint32_t rxid, uint32_t txid,
+		uint32_t ll_dl, uint32_t bs, uint32_t stmin_us, uint32_t padding)
+{
+	boolean rv = FALSE;
+	struct Can_TpChannel_s* ch;
+	pthread_condattr_t attr;
+
+	if((channel < CANTP_CHANNEL_NUM) && (ll_dl >= 8) && (ll_dl <= 64) && (bs <= 0xFF))
+	{
+		pthread_mutex_lock(&cantpLock);
+		ch = &cantpChannels[channel];
+		if(FALSE == ch->online)
+		{
+			ch->busid = busid;
+			ch->rxid = rxid;
+			ch->txid = txid;
+			ch->ll_dl = cantp_fd_length(ll_dl);
+			ch->bs = bs;
+			ch->stmin = cantp_encode_stmin(stmin_us);
+			ch->padding = padding;
+			ch->rxState = CANTP_ST_IDLE;
+			ch->rxBuf = NULL;
+			ch->fcGot = FALSE;
+			ch->msgNum = 0;
+			STAILQ_INIT(&ch->msgs);
+			pthread_mutex_init(&ch->lock, NULL);
+			pthread_condattr_init(&attr);
+			#ifndef __WINDOWS__
+			pthread_condattr_setclock(&attr, CANTP_CLOCK);
+			#endif
+			pthread_cond_init(&ch->cond, &attr);
+			pthread_condattr_destroy(&attr);
+			ch->online = TRUE;
+			rv = TRUE;
+		}
+		pthread_mutex_unlock(&cantpLock);
+	}
+
+	return rv;
+}
+
+void lascantp_close(uint32_t channel)
+{
+	struct Can_TpChannel_s* ch;
+	struct Can_TpMsg_s* msg;
+
+	pthread_mutex_lock(&cantpLock);
+	ch = cantp_get(channel);
+	if(NULL != ch)
+	{
+		ch->online = FALSE;
+	}
+	pthread_mutex_unlock(&cantpLock);
+
+	if(NULL != ch)
+	{	/* no longer seen by the rx thread */
+		pthread_mutex_lock(&ch->lock);
+		cantp_abort_rx(ch);
+		while(FALSE == STAILQ_EMPTY(&ch->msgs))
+		{
+			msg = STAILQ_FIRST(&ch->msgs);
+			STAILQ_REMOVE_HEAD(&ch->msgs, entry);
+			free(msg);
+		}
+		ch->msgNum = 0;
+		pthread_mutex_unlock(&ch->lock);
+		pthread_mutex_destroy(&ch->lock);
+		pthread_cond_destroy(&ch->cond);
+	}
+}
+
+boolean lascantp_transmit(uint32_t channel, uint8_t* data, uint32_t size, uint32_t timeout)
+{
+	boolean rv = FALSE;
+	struct Can_TpChannel_s* ch = cantp_get(channel);
+	uint8_t pdu[64];
+	uint32_t offset, len, bs, n;
+	uint8_t SN;
+	uint64_t stmin;
+	struct timespec next;
+
+	if((NULL == ch) || (0 == size) || (size > CANTP_MAX_SIZE))
+	{
+		return FALSE;
+	}
+
+	if(size <= 7)
+	{
+		pdu[0] = ISO15765_TPCI_SF | size;
+		memcpy(&pdu[1], data, size);
+		return cantp_send(ch, pdu, size+1);
+	}
+
+	if(size <= (ch->ll_dl-2))
+	{	/* CAN FD SF */
+		pdu[0] = ISO15765_TPCI_SF;
+		pdu[1] = size;
+		memcpy(&pdu[2], data, size);
+		return cantp_send(ch, pdu, size+2);
+	}
+
+	if(size <= 4095)
+	{
+		pdu[0] = ISO15765_TPCI_FF | (size>>8);
+		pdu[1] = size&0xFF;
+		offset = 2;
+	}
+	else
+	{
+		pdu[0] = ISO15765_TPCI_FF;
+		pdu[1] = 0;
+		pdu[2] = size>>24;
+		pdu[3] = size>>16;
+		pdu[4] = size>>8;
+		pdu[5] = size;
+		offset = 6;
+	}
+	len = ch->ll_dl - offset;
+	memcpy(&pdu[offset], data, len);
+
+	pthread_mutex_lock(&ch->lock);
+	ch->fcGot = FALSE;
+	pthread_mutex_unlock(&ch->lock);
+
+	rv = cantp_send(ch, pdu, ch->ll_dl);
+	offset = len;
+	SN = 1;
+
+	while(rv && (offset < size))
+	{
+		rv = cantp_wait_fc(ch, timeout);
+		if(FALSE == rv)
+		{
+			ASLOG(CANTPE, ("CANTP txid=%X timeout when waiting FC\n", ch->txid));
+			break;
+		}
+
+		if(ISO15765_FLOW_CONTROL_STATUS_WAIT == ch->fcFS)
+		{
+			continue;
+		}
+		else if(ISO15765_FLOW_CONTROL_STATUS_CTS != ch->fcFS)
+		{
+			ASLOG(CANTPE, ("CANTP txid=%X FC with status %d, cancel\n", ch->txid, ch->fcFS));
+			rv = FALSE;
+			break;
+		}
+
+		bs = ch->fcBS;
+		stmin = (uint64_t)cantp_decode_stmin(ch->fcSTmin)*1000;
+		clock_gettime(CANTP_CLOCK, &next);
+
+		for(n=0; rv && (offset < size) && ((0 == bs) || (n < bs)); n++)
+		{
+			if((n > 0) && (stmin > 0))
+			{
+				next.tv_nsec += stmin;
+				while(next.tv_nsec >= 1000000000)
+				{
+					next.tv_sec += 1;
+					next.tv_nsec -= 1000000000;
+				}
+				cantp_sleep_until(&next);
+			}
+
+			len = size - offset;
+			if(len > (ch->ll_dl-1))
+			{
+				len = ch->ll_dl-1;
+			}
+			pdu[0] = ISO15765_TPCI_CF | SN;
+			memcpy(&pdu[1], &data[offset], len);
+			rv = cantp_send(ch, pdu, len+1);
+			offset += len;
+			SN = (SN+1)&0x0F;
+		}
+	}
+
+	return rv;
+}
+
+boolean lascantp_receive(uint32_t channel, uint8_t** data, uint32_t* size, uint32_t timeout)
+{
+	boolean rv = FALSE;
+	struct Can_TpChannel_s* ch = cantp_get(channel);
+	struct Can_TpMsg_s* msg = NULL;
+	struct timespec ts, now;
+	uint32_t ncr = (timeout > CANTP_N_CR_MS) ? timeout : CANTP_N_CR_MS;
+
+	*data = NULL;
+	*size = 0;
+
+	if(NULL == ch)
+	{
+		return FALSE;
+	}
+
+	cantp_deadline(&ts, timeout);
+
+	pthread_mutex_lock(&ch->lock);
+	while(STAILQ_EMPTY(&ch->msgs))
+	{
+		if(ETIMEDOUT == pthread_cond_timedwait(&ch->cond, &ch->lock, &ts))
+		{
+			if((CANTP_ST_WAIT_CF == ch->rxState) && STAILQ_EMPTY(&ch->msgs))
+			{	/* still receiving, the timeout is from the last CF */
+				ts = ch->rxStamp;
+				ts.tv_sec += ncr/1000;
+				ts.tv_nsec += (ncr%1000)*1000000;
+				if(ts.tv_nsec >= 1000000000)
+				{
+					ts.tv_sec += 1;
+					ts.tv_nsec -= 1000000000;
+				}
+				clock_gettime(CANTP_CLOCK, &now);
+				if((now.tv_sec < ts.tv_sec) || ((now.tv_sec == ts.tv_sec) && (now.tv_nsec < ts.tv_nsec)))
+				{
+					continue;
+				}
+				ASLOG(CANTPE, ("CANTP rxid=%X timeout when waiting CF\n", ch->rxid));
+				cantp_abort_rx(ch);
+			}
+			break;
+		}
+	}
+
+	if(FALSE == STAILQ_EMPTY(&ch->msgs))
+	{
+		msg = STAILQ_FIRST(&ch->msgs);
+		STAILQ_REMOVE_HEAD(&ch->msgs, entry);
+		ch->msgNum --;
+	}
+	pthread_mutex_unlock(&ch->lock);
+
+	if(NULL != msg)
+	{
+		*data = malloc(msg->size);
+		if(NULL != *data)
+		{
+			memcpy(*data, msg->data, msg->size);
+			*size = msg->size;
+			rv = TRUE;
+		}
+		free(msg);
+	}
+
+	return rv;
+}
+
+#if !defined(__AS_PY_CAN__) && !defined(__AS_CAN_BUS__)
+int luai_cantp_open (lua_State *L)
+{
+	int n = lua_gettop(L);  /* number of arguments */
+	if((n >= 4) && (n <= 8))
+	{
+		uint32_t args[8] = { 0, 0, 0, 0, 8, 8, 10000, 0x55 };
+		int i,is_num;
+
+		for(i=0; i<n; i++)
+		{
+			args[i] = lua_tounsignedx(L, i+1,&is_num);
+			if(!is_num)
+			{
+				return luaL_error(L,"incorrect argument %d to function 'cantp_open'",i+1);
+			}
+		}
+
+		if(FALSE == lascantp_open(args[0],args[1],args[2],args[3],args[4],args[5],args[6],args[7]))
+		{
+			return luaL_error(L,"cantp_open channel(%d) failed!",args[0]);
+		}
+
+		lua_pushboolean(L, TRUE);        /* result OK */
+		return 1;
+	}
+	else
+	{
+		return luaL_error(L, "cantp_open (channel,bus_id,rxid,txid,[ll_dl,bs,stmin_us,padding]) API should has 4 to 8 arguments");
+	}
+}
+
+int luai_cantp_transmit (lua_State *L)
+{
+	int n = lua_gettop(L);  /* number of arguments */
+	if((2==n) || (3==n))
+	{
+		uint32_t channel,size,timeout=5000;
+		uint8_t* data;
+		uint32_t i;
+		int is_num;
+		boolean rv;
+
+		channel = lua_tounsignedx(L, 1,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument channel to function 'cantp_transmit'");
+		}
+
+		if(3==n)
+		{
+			timeout = lua_tounsignedx(L, 3,&is_num);
+			if(!is_num)
+			{
+				 return luaL_error(L,"incorrect argument timeout to function 'cantp_transmit'");
+			}
+		}
+
+		size = luaL_len(L, 2);
+		data = malloc(size+1);
+		if(NULL == data)
+		{
+			return luaL_error(L,"malloc failed to function 'cantp_transmit'");
+		}
+
+		for(i=0; i<size; i++)
+		{
+			lua_geti(L, 2, i+1);
+			data[i] = lua_tounsignedx(L, -1,&is_num);
+			lua_pop(L, 1);
+			if(!is_num)
+			{
+				free(data);
+				return luaL_error(L,"invalid data[%d] to function 'cantp_transmit'",i);
+			}
+		}
+
+		rv = lascantp_transmit(channel,data,size,timeout);
+		free(data);
+
+		lua_pushboolean(L, rv);
+		return 1;
+	}
+	else
+	{
+		return luaL_error(L, "cantp_transmit (channel,{xx,xx,...},[timeout]) API should has 2 or 3 arguments");
+	}
+}
+
+int luai_cantp_receive (lua_State *L)
+{
+	int n = lua_gettop(L);  /* number of arguments */
+	if((1==n) || (2==n))
+	{
+		uint32_t channel,size,timeout=5000;
+		uint8_t* data;
+		uint32_t i;
+		int is_num,table_index;
+
+		channel = lua_tounsignedx(L, 1,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument channel to function 'cantp_receive'");
+		}
+
+		if(2==n)
+		{
+			timeout = lua_tounsignedx(L, 2,&is_num);
+			if(!is_num)
+			{
+				 return luaL_error(L,"incorrect argument timeout to function 'cantp_receive'");
+			}
+		}
+
+		if(lascantp_receive(channel,&data,&size,timeout))
+		{
+			lua_pushboolean(L, TRUE);
+			lua_createtable(L, size, 0);
+			table_index = lua_gettop(L);
+			for(i=0; i<size; i++)
+			{
+				lua_pushinteger(L, data[i]);
+				lua_seti(L, table_index, i+1);
+			}
+			free(data);
+		}
+		else
+		{
+			lua_pushboolean(L, FALSE);
+			lua_pushnil(L);
+		}
+
+		return 2;
+	}
+	else
+	{
+		return luaL_error(L, "cantp_receive (channel,[timeout]) API should has 1 or 2 arguments");
+	}
+}
+
+int luai_cantp_close (lua_State *L)
+{
+	int n = lua_gettop(L);  /* number of arguments */
+	if(1==n)
+	{
+		uint32_t channel;
+		int is_num;
+
+		channel = lua_tounsignedx(L, 1,&is_num);
+		if(!is_num)
+		{
+			 return luaL_error(L,"incorrect argument channel to function 'cantp_close'");
+		}
+
+		lascantp_close(channel);
+
+		return 0;
+	}
+	else
+	{
+		return luaL_error(L, "cantp_close (channel) API should has 1 arguments");
+	}
+}
+#endif /* __AS_PY_CAN__ */
+
+#if defined(__AS_PY_CAN__)
+int cantp_open(unsigned long channel,unsigned long busid,unsigned long rxid,unsigned long txid,
+		unsigned long ll_dl,unsigned long bs,unsigned long stmin_us,unsigned long padding)
+{
+	int rv = lascantp_open(channel,busid,rxid,txid,ll_dl,bs,stmin_us,padding);
+
+	if(FALSE == rv)
+	{
+		printf("ERROR :: cantp_open channel(%d) failed!\n",(int)channel);
+		fflush(stdout);
+	}
+
+	return rv;
+}
+
+int cantp_transmit(unsigned long channel,unsigned long size,unsigned char* data,unsigned long timeout)
+{
+	return lascantp_transmit(channel,data,size,timeout);
+}
+
+int cantp_receive(unsigned long channel,unsigned long* size,unsigned char** data,unsigned long timeout)
+{
+	int rv;
+	uint32_t sz;
+
+	rv = lascantp_receive(channel,data,&sz,timeout);
+	*size = sz;
+
+	return rv;
+}
+
+int cantp_close(unsigned long channel)
+{
+	lascantp_close(channel);
+
+	return TRUE;
+}
+#endif /* __AS_PY_CAN__ */
@@ -0,0 +1,212 @@
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+#ifdef __LASCANTP_BENCH__
+/* Throughput of the ISO-TP of lascantp: the tester sends the messages of the given size on
+ * channel 0 and the ECU, a child process on the same bus, sends each back, which is checked
+ * by the tester. The result is the messages/s and the bytes/s of the round trips, each
+ * message goes over the bus twice. ll_dl above 8 is CAN FD. On the socketwin hub:
+ *   socketwin_can_driver.exe 0 -f FFFFFFFF#FFFFFFFF
+ *   lascantp_bench.exe socketwin 0 4095 100 8 0 0
+ *   lascantp_bench.exe socketwin 0 4095 100 64 8 100
+ * or on the vcan0 of socket with mtu 72. */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "lascanlib.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_BUS     0
+#define BENCH_CHANNEL 0
+#define BENCH_TESTER_RXID 0x732
+#define BENCH_TESTER_TXID 0x731
+/* the ECU exits if no request in this time */
+#define BENCH_TIMEOUT_MS 3000
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+extern int can_open(unsigned long busid,const char* device_name,unsigned long port, unsigned long baudrate);
+extern void luai_canlib_open(void);
+/* ============================ [ DATAS     ] ====================================================== */
+static const char* device;
+static int port;
+static uint32_t msgSize = 4095;
+static uint32_t msgNum = 100;
+static uint32_t ll_dl = 8;
+static uint32_t bs = 0;
+static uint32_t stmin_us = 0;
+/* ============================ [ LOCALS    ] ====================================================== */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000u + ts.tv_nsec;
+}
+
+static int open_channel(uint32_t rxid, uint32_t txid)
+{
+	luai_canlib_open();
+
+	if(FALSE == can_open(BENCH_BUS, device, port, 1000000))
+	{
+		return -1;
+	}
+
+	if(FALSE == lascantp_open(BENCH_CHANNEL, BENCH_BUS, rxid, txid, ll_dl, bs, stmin_us, 0x55))
+	{
+		printf("open the cantp channel failed\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void close_channel(void)
+{	/* the bus is left to the exit, the socketwin close frees the handle under its rx thread */
+	lascantp_close(BENCH_CHANNEL);
+}
+
+static int ecu_main(void)
+{
+	uint8_t* data;
+	uint32_t size;
+
+	if(0 != open_channel(BENCH_TESTER_TXID, BENCH_TESTER_RXID))
+	{
+		return -1;
+	}
+
+	while(lascantp_receive(BENCH_CHANNEL, &data, &size, BENCH_TIMEOUT_MS))
+	{
+		(void)lascantp_transmit(BENCH_CHANNEL, data, size, BENCH_TIMEOUT_MS);
+		free(data);
+	}
+
+	close_channel();
+
+	return 0;
+}
+
+static int tester_main(void)
+{
+	uint32_t i, j;
+	uint8_t* request;
+	uint8_t* response;
+	uint32_t size;
+	uint32_t done = 0;
+	uint32_t failed = 0;
+	uint64_t start, elapsed;
+
+	if(0 != open_channel(BENCH_TESTER_RXID, BENCH_TESTER_TXID))
+	{
+		return -1;
+	}
+	/* let the ECU be on-line */
+	usleep(300000);
+
+	request = malloc(msgSize);
+	if(NULL == request)
+	{
+		return -1;
+	}
+
+	start = now_ns();
+	for(i=0; i<msgNum; i++)
+	{
+		for(j=0; j<msgSize; j++)
+		{
+			request[j] = (uint8_t)(i+j);
+		}
+
+		if(FALSE == lascantp_transmit(BENCH_CHANNEL, request, msgSize, BENCH_TIMEOUT_MS))
+		{
+			printf("message %u transmit failed\n", i);
+			failed ++;
+			break;
+		}
+
+		if(FALSE == lascantp_receive(BENCH_CHANNEL, &response, &size, BENCH_TIMEOUT_MS))
+		{
+			printf("message %u no response\n", i);
+			failed ++;
+			break;
+		}
+
+		if((size != msgSize) || (0 != memcmp(request, response, size)))
+		{
+			printf("message %u response of %u bytes is not the request\n", i, size);
+			failed ++;
+		}
+		free(response);
+		done ++;
+	}
+	elapsed = now_ns() - start;
+
+	free(request);
+	close_channel();
+
+	printf("%s(%d): size=%u, ll_dl=%u, BS=%u, STmin=%uus\n", device, port, msgSize, ll_dl, bs, stmin_us);
+	if(done > 0)
+	{
+		printf("%u round trips in %.3f s: %.1f messages/s, %.0f bytes/s each way\n", done,
+				elapsed/1000000000.0, done*1000000000.0/elapsed, (double)done*msgSize*1000000000.0/elapsed);
+	}
+	printf("failed %u\n", failed);
+
+	return ((done == msgNum) && (0 == failed)) ? 0 : -1;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int main(int argc, char* argv[])
+{
+	int rv, status;
+	pid_t ecu;
+
+	if(argc < 3)
+	{
+		printf( "Usage:%s <device> <port> [size] [messages] [ll_dl] [bs] [stmin_us]\n"
+				"  device  : socketwin or socket\n"
+				"  size    : bytes of each message, default 4095\n"
+				"  messages: messages sent, default 100\n"
+				"  ll_dl   : 8, or up to 64 for CAN FD, default 8\n"
+				"  bs      : block size of the FC, default 0\n"
+				"  stmin_us: STmin of the FC in us, default 0\n", argv[0]);
+		return -1;
+	}
+
+	device = argv[1];
+	port = atoi(argv[2]);
+	if(argc > 3) msgSize = strtoul(argv[3], NULL, 10);
+	if(argc > 4) msgNum = strtoul(argv[4], NULL, 10);
+	if(argc > 5) ll_dl = strtoul(argv[5], NULL, 10);
+	if(argc > 6) bs = strtoul(argv[6], NULL, 10);
+	if(argc > 7) stmin_us = strtoul(argv[7], NULL, 10);
+
+	ecu = fork();
+	if(0 == ecu)
+	{
+		return ecu_main();
+	}
+
+	rv = tester_main();
+
+	kill(ecu, SIGTERM);
+	waitpid(ecu, &status, 0);
+
+	return rv;
+}
+#endif
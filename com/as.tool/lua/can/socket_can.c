@@ -196,12 +196,11 @@ static boolean socket_probe(uint32_t busid,uint32_t port,uint32_t baudrate,can_d
 	if( (TRUE == socketH->terminated) &&
 		(FALSE == STAILQ_EMPTY(&socketH->head)) )
 	{
-		if( 0 == pthread_create(&(socketH->rx_thread),NULL,rx_daemon,NULL))
-		{
-			socketH->terminated = FALSE;
-		}
-		else
+		/* before the rx daemon runs, else it could see it terminated and quit */
+		socketH->terminated = FALSE;
+		if( 0 != pthread_create(&(socketH->rx_thread),NULL,rx_daemon,NULL))
 		{
+			socketH->terminated = TRUE;
 			asAssert(0);
 		}
 	}
@@ -20,6 +20,7 @@
 #include <Ws2tcpip.h>
 #else
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #endif
@@ -61,6 +62,13 @@
 #define CAN_MAX_DLEN 64 /* 64 for CANFD */
 #define CAN_MTU sizeof(struct can_frame)
 #define CAN_PORT_MIN  80
+/* the frames taken by one read */
+#define CAN_RX_BATCH 16
+
+/* the frame to socketwin_can_driver itself, not a CAN ID: data[0] is the command */
+#define CAN_HUB_CTRL_ID 0xFFFFFFFF
+/* data[1..4] mask, data[5..8] code, in big endian */
+#define CAN_HUB_CTRL_FILTER 0x01
 
 #define CAN_FRAME_TYPE_RAW 0
 #define CAN_FRAME_TYPE_MTU 1
@@ -111,6 +119,9 @@ struct Can_SocketHandle_s
 	can_device_rx_notification_t rx_notification;
 	int s; /* can raw socket */
 	struct sockaddr_in addr;
+	/* a read could end in the middle of a frame, the part is kept for the next read */
+	uint32_t rxLen;
+	uint8_t rxBuf[CAN_RX_BATCH*CAN_MTU];
 	STAILQ_ENTRY(Can_SocketHandle_s) entry;
 };
 struct Can_SocketHandleList_s
@@ -123,6 +134,7 @@ struct Can_SocketHandleList_s
 static boolean socket_probe(uint32_t busid,uint32_t port,uint32_t baudrate,can_device_rx_notification_t rx_notification);
 static boolean socket_write(uint32_t busid,uint32_t port,uint32_t canid,uint32_t dlc,uint8_t* data);
 static void socket_close(uint32_t busid,uint32_t port);
+static boolean socket_filter(uint32_t busid,uint32_t port,uint32_t mask,uint32_t code);
 static void * rx_daemon(void *);
 /* ============================ [ DATAS     ] ====================================================== */
 const Can_DeviceOpsType can_socketwin_ops =
@@ -135,6 +147,7 @@ const Can_DeviceOpsType can_socketwin_ops =
 	.probe = socket_probe,
 	.close = socket_close,
 	.write = socket_write,
+	.filter = socket_filter,
 };
 static struct Can_SocketHandleList_s* socketH = NULL;
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -162,6 +175,25 @@ static struct Can_SocketHandle_s* getHandle(uint32_t port)
 	return handle;
 }
 
+/* the stream could take the frame in parts */
+static int send_frame(int s, const char* frame)
+{
+	int len;
+	int sent = 0;
+
+	while(sent < (int)CAN_MTU)
+	{
+		len = send(s, &frame[sent], CAN_MTU-sent, 0);
+		if(len <= 0)
+		{
+			break;
+		}
+		sent += len;
+	}
+
+	return sent;
+}
+
 static boolean socket_probe(uint32_t busid,uint32_t port,uint32_t baudrate,can_device_rx_notification_t rx_notification)
 {
 	boolean rv = TRUE;;
@@ -246,6 +278,11 @@ static boolean socket_probe(uint32_t busid,uint32_t port,uint32_t baudrate,can_d
 				}
 				rv = FALSE;
 			}
+			else
+			{	/* the FC of ISO-TP is waited by the sender, not to be held by Nagle */
+				int on = 1;
+				setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+			}
 		}
 #endif
 		if( rv )
@@ -257,6 +294,7 @@ static boolean socket_probe(uint32_t busid,uint32_t port,uint32_t baudrate,can_d
 			handle->baudrate = baudrate;
 			handle->rx_notification = rx_notification;
 			handle->s = s;
+			handle->rxLen = 0;
 			memcpy(&(handle->addr),&addr,sizeof(addr));
 			STAILQ_INSERT_TAIL(&socketH->head,handle,entry);
 		}
@@ -269,12 +307,11 @@ static boolean socket_probe(uint32_t busid,uint32_t port,uint32_t baudrate,can_d
 	if( (TRUE == socketH->terminated) &&
 		(FALSE == STAILQ_EMPTY(&socketH->head)) )
 	{
-		if( 0 == pthread_create(&(socketH->rx_thread),NULL,rx_daemon,NULL))
-		{
-			socketH->terminated = FALSE;
-		}
-		else
+		/* before the rx daemon runs, else it could see it terminated and quit */
+		socketH->terminated = FALSE;
+		if( 0 != pthread_create(&(socketH->rx_thread),NULL,rx_daemon,NULL))
 		{
+			socketH->terminated = TRUE;
 			asAssert(0);
 		}
 	}
@@ -296,7 +333,7 @@ static boolean socket_write(uint32_t busid,uint32_t port,uint32_t canid,uint32_t
 #ifdef USE_CAN_UDP
 		if (sendto(handle->s, (const char*)&frame, CAN_MTU, 0, (struct sockaddr*)&handle->addr, sizeof(struct sockaddr)) != CAN_MTU) {
 #else
-		if (send(handle->s, (const char*)&frame, CAN_MTU,0) != CAN_MTU) {
+		if (send_frame(handle->s, (const char*)&frame) != CAN_MTU) {
 #endif
 			perror("CAN socket write");
 			ASWARNING(("CAN Socket port=%d send message failed!\n",port));
@@ -329,19 +366,71 @@ static void socket_close(uint32_t busid,uint32_t port)
 	}
 }
 
+/* the hub keeps the filters of this node and forwards it only the frames matched */
+static boolean socket_filter(uint32_t busid,uint32_t port,uint32_t mask,uint32_t code)
+{
+	boolean rv = TRUE;
+	struct Can_SocketHandle_s* handle = getHandle(port);
+	(void)busid;
+	if(handle != NULL)
+	{
+		struct can_frame frame;
+		memset(&frame, 0, sizeof(frame));
+		mSetCANID(frame , CAN_HUB_CTRL_ID);
+		mSetCANDLC(frame , 9);
+		frame.data[0] = CAN_HUB_CTRL_FILTER;
+		frame.data[1] = (uint8_t)(mask>>24);
+		frame.data[2] = (uint8_t)(mask>>16);
+		frame.data[3] = (uint8_t)(mask>>8);
+		frame.data[4] = (uint8_t)(mask);
+		frame.data[5] = (uint8_t)(code>>24);
+		frame.data[6] = (uint8_t)(code>>16);
+		frame.data[7] = (uint8_t)(code>>8);
+		frame.data[8] = (uint8_t)(code);
+#ifdef USE_CAN_UDP
+		rv = FALSE;
+#else
+		if (send_frame(handle->s, (const char*)&frame) != CAN_MTU) {
+			ASWARNING(("CAN Socket port=%d set filter failed!\n",port));
+			rv = FALSE;
+		}
+#endif
+	}
+	else
+	{
+		rv = FALSE;
+		ASWARNING(("CAN Socket port=%d is not on-line, not able to set filter!\n",port));
+	}
+
+	return rv;
+}
+
 static void rx_notifiy(struct Can_SocketHandle_s* handle)
 {
 	int nbytes,len = sizeof(struct sockaddr_in);
+	uint32_t offset;
 	struct can_frame frame;
 	struct sockaddr_in addr;
-	nbytes = recvfrom(handle->s, (char*)&frame, sizeof(frame), 0, (struct sockaddr*)&addr, &len);
+	/* the stream could give many frames and a part of the next one in one read */
+	nbytes = recvfrom(handle->s, (char*)&handle->rxBuf[handle->rxLen], sizeof(handle->rxBuf)-handle->rxLen,
+					0, (struct sockaddr*)&addr, &len);
 	if (nbytes < 0) {
 		perror("CAN socket read");
 		ASWARNING(("CAN Socket port=%d read message failed!\n",handle->port));
 	}
-	else if(nbytes==sizeof(frame))
+	else if(nbytes > 0)
 	{
-		handle->rx_notification(handle->busid,mCANID(frame),mCANDLC(frame),frame.data);
+		handle->rxLen += nbytes;
+		for(offset=0; (handle->rxLen-offset) >= CAN_MTU; offset+=CAN_MTU)
+		{
+			memcpy(&frame, &handle->rxBuf[offset], CAN_MTU);
+			handle->rx_notification(handle->busid,mCANID(frame),mCANDLC(frame),frame.data);
+		}
+		handle->rxLen -= offset;
+		if(handle->rxLen > 0)
+		{
+			memmove(handle->rxBuf, &handle->rxBuf[offset], handle->rxLen);
+		}
 	}
 	else
 	{
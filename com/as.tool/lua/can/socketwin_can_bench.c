@@ -0,0 +1,489 @@
+#ifdef __SOCKET_WIN_CAN_BENCH__
+/**
+ * AS - the open source Automotive Software on https://github.com/parai
+ *
+ * Copyright (C) 2019  AS <parai@foxmail.com>
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ */
+/* Load of the socketwin_can_driver hub: N nodes on the bus, each sends its frames as fast as
+ * it could or at a given rate and receives the frames of all the others. The send time and
+ * a sequence number are carried in the frame data, the result is the frames/s taken by the
+ * hub, the frames/s delivered to the nodes and the forwarding latency. Node 0 is the
+ * socketwin client of lascanlib, the others are raw sockets, which with 'split' write a
+ * few frames at a time cut at random places, so that the hub and the client get parts of
+ * frames in a read. With 'filter' the client sets the hub to forward it only the frames of
+ * node 1. With 'stall' one more node is on the bus which never reads, the hub shall drop the
+ * frames to it but not hold up the others. Any frame lost, out of order or not filtered fails
+ * the run. Start the hub with a log filter which matches nothing, else the printf dominates:
+ *   socketwin_can_driver.exe 0 -f FFFFFFFF#FFFFFFFF
+ *   socketwin_can_bench.exe 0 8 10000
+ *   socketwin_can_bench.exe 0 8 10000 0 split filter
+ *   socketwin_can_bench.exe 0 8 10000 0 stall */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include "lascanlib.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#define CAN_MAX_DLEN 64 /* 64 for CANFD */
+#define CAN_MTU sizeof(struct can_frame)
+#define CAN_PORT_MIN  80
+#define CAN_BUS_NODE_MAX 32
+
+#define mSetCANID(frame,canid) do {	frame->data[CAN_MAX_DLEN+0] = (uint8_t)(canid>>24);	\
+									frame->data[CAN_MAX_DLEN+1] = (uint8_t)(canid>>16);	\
+									frame->data[CAN_MAX_DLEN+2] = (uint8_t)(canid>> 8);	\
+									frame->data[CAN_MAX_DLEN+3] = (uint8_t)(canid); } while(0)
+#define mSetCANDLC(frame,dlc) do { frame->data[CAN_MAX_DLEN+4] = dlc; } while(0)
+
+/* the frames not forwarded in this time are lost */
+#define BENCH_RX_TIMEOUT_S 3
+/* the most frames in one write of 'split' */
+#define BENCH_SPLIT_FRAMES 4
+/* the node which is the socketwin client */
+#define BENCH_CLIENT 0
+/* the node whose frames the client gets with 'filter' */
+#define BENCH_FILTER_NODE 1
+#define BENCH_CANID(node) (0x100+(node))
+/* ============================ [ TYPES     ] ====================================================== */
+struct can_frame {
+	uint8_t    data[CAN_MAX_DLEN + 5];
+};
+
+struct bench_payload {
+	uint64_t stamp; /* CLOCK_MONOTONIC ns */
+	uint32_t seq;
+	uint32_t node;
+};
+
+struct bench_node {
+	int id;
+	int s;
+	pthread_t tx_thread;
+	pthread_t rx_thread;
+	uint32_t* latency; /* ns of each frame received */
+	uint32_t received;
+	uint32_t reordered;
+	uint32_t unexpected; /* the frames which the filter shall drop */
+	uint32_t next_seq[CAN_BUS_NODE_MAX];
+	uint64_t last_rx;
+};
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static int nodeNum = 8;
+static uint32_t frameNum = 10000;
+static uint32_t frameRate = 0; /* per node, 0 is as fast as it could */
+static int splitWrite = 0;
+static int clientFilter = 0;
+static int stallNode = 0;
+static int stallSocket = -1;
+static int busPort;
+static struct bench_node nodes[CAN_BUS_NODE_MAX];
+static pthread_barrier_t startBarrier;
+/* ============================ [ LOCALS    ] ====================================================== */
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000u + ts.tv_nsec;
+}
+
+static int connect_node(int port)
+{
+	int s;
+	int on = 1;
+	struct sockaddr_in addr;
+	struct timeval tv;
+
+	s = socket(AF_INET, SOCK_STREAM, 0);
+	assert(s >= 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	addr.sin_port = htons(CAN_PORT_MIN+port);
+	if(connect(s, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		printf("connect to can(%d) hub failed: %s\n", port, strerror(errno));
+		exit(-1);
+	}
+
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+	tv.tv_sec = BENCH_RX_TIMEOUT_S;
+	tv.tv_usec = 0;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+
+	return s;
+}
+
+static int send_all(int s, const uint8_t* buf, size_t len)
+{
+	ssize_t n;
+
+	while(len > 0)
+	{
+		n = send(s, (const char*)buf, len, 0);
+		if(n <= 0)
+		{
+			return -1;
+		}
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+/* the frames in random parts, a part goes out alone as TCP_NODELAY */
+static int send_split(int s, const uint8_t* buf, size_t len, unsigned int* seed)
+{
+	size_t n;
+
+	while(len > 0)
+	{
+		n = 1 + rand_r(seed)%len;
+		if(0 != send_all(s, buf, n))
+		{
+			return -1;
+		}
+		buf += n;
+		len -= n;
+		if(0 == (rand_r(seed)%4))
+		{	/* let the hub read what is sent so far */
+			sched_yield();
+		}
+	}
+
+	return 0;
+}
+
+static int recv_frame(int s, struct can_frame* frame)
+{
+	size_t got = 0;
+	ssize_t len;
+
+	while(got < CAN_MTU)
+	{
+		len = recv(s, (char*)frame+got, CAN_MTU-got, 0);
+		if(len <= 0)
+		{
+			return -1;
+		}
+		got += len;
+	}
+
+	return 0;
+}
+
+static void record(struct bench_node* node, const uint8_t* data)
+{
+	struct bench_payload payload;
+	uint64_t t = now_ns();
+
+	memcpy(&payload, data, sizeof(payload));
+	if((payload.node >= (uint32_t)nodeNum) || (payload.node == (uint32_t)node->id))
+	{
+		return;
+	}
+	if((BENCH_CLIENT == node->id) && clientFilter && (BENCH_FILTER_NODE != payload.node))
+	{
+		node->unexpected++;
+	}
+	if(payload.seq != node->next_seq[payload.node])
+	{
+		node->reordered++;
+	}
+	node->next_seq[payload.node] = payload.seq + 1;
+	node->latency[node->received] = (uint32_t)(t - payload.stamp);
+	node->last_rx = t;
+	__atomic_store_n(&node->received, node->received+1, __ATOMIC_RELEASE);
+}
+
+static void client_rx_notification(uint32_t busid,uint32_t canid,uint32_t dlc,uint8_t* data)
+{
+	(void)busid;
+	(void)canid;
+	(void)dlc;
+	record(&nodes[BENCH_CLIENT], data);
+}
+
+static void* tx_main(void* arg)
+{
+	struct bench_node* node = (struct bench_node*)arg;
+	struct can_frame frames[BENCH_SPLIT_FRAMES];
+	struct can_frame* pf;
+	struct bench_payload payload;
+	uint64_t start;
+	uint64_t next;
+	struct timespec ts;
+	uint32_t i;
+	uint32_t k;
+	uint32_t n = 0;
+	unsigned int seed = (unsigned int)now_ns() + node->id;
+
+	pthread_barrier_wait(&startBarrier);
+
+	memset(frames, 0, sizeof(frames));
+	for(k=0; k<BENCH_SPLIT_FRAMES; k++)
+	{
+		pf = &frames[k];
+		mSetCANID(pf, BENCH_CANID(node->id));
+		mSetCANDLC(pf, 8);
+	}
+	payload.node = node->id;
+	/* the frames of a write of 'split' */
+	k = 1;
+
+	start = now_ns();
+	for(i=0; i<frameNum; i++)
+	{
+		if(frameRate > 0)
+		{
+			next = start + (uint64_t)i*1000000000u/frameRate;
+			ts.tv_sec = next/1000000000u;
+			ts.tv_nsec = next%1000000000u;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		}
+		payload.seq = i;
+		payload.stamp = now_ns();
+		if(BENCH_CLIENT == node->id)
+		{
+			if(FALSE == can_socketwin_ops.write(BENCH_CLIENT, busPort, BENCH_CANID(node->id), 16, (uint8_t*)&payload))
+			{
+				break;
+			}
+		}
+		else if(splitWrite)
+		{
+			memcpy(frames[n].data, &payload, sizeof(payload));
+			n++;
+			if((n >= k) || ((i+1) == frameNum))
+			{
+				if(0 != send_split(node->s, (const uint8_t*)frames, n*CAN_MTU, &seed))
+				{
+					printf("node %d send failed: %s\n", node->id, strerror(errno));
+					break;
+				}
+				n = 0;
+				k = 1 + rand_r(&seed)%BENCH_SPLIT_FRAMES;
+			}
+		}
+		else
+		{
+			memcpy(frames[0].data, &payload, sizeof(payload));
+			if(0 != send_all(node->s, (const uint8_t*)&frames[0], CAN_MTU))
+			{
+				printf("node %d send failed: %s\n", node->id, strerror(errno));
+				break;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void* rx_main(void* arg)
+{
+	struct bench_node* node = (struct bench_node*)arg;
+	struct can_frame frame;
+	uint32_t expected = (uint32_t)(nodeNum-1)*frameNum;
+	uint32_t received;
+
+	if((BENCH_CLIENT == node->id) && clientFilter)
+	{
+		expected = frameNum;
+	}
+	uint32_t idle = 0;
+
+	if(BENCH_CLIENT == node->id)
+	{	/* received by the rx thread of the client, wait until it has all or stops */
+		while(((received = __atomic_load_n(&node->received, __ATOMIC_ACQUIRE)) < expected) &&
+			  (idle < BENCH_RX_TIMEOUT_S*1000))
+		{
+			usleep(1000);
+			idle = (received == __atomic_load_n(&node->received, __ATOMIC_ACQUIRE)) ? idle+1 : 0;
+		}
+		return NULL;
+	}
+
+	while(node->received < expected)
+	{
+		if(0 != recv_frame(node->s, &frame))
+		{
+			break;
+		}
+		record(node, frame.data);
+	}
+
+	return NULL;
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*)a;
+	uint32_t y = *(const uint32_t*)b;
+
+	return (x > y) - (x < y);
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int main(int argc, char* argv[])
+{
+	int i;
+	int port;
+	uint64_t start;
+	uint64_t end = 0;
+	uint64_t received = 0;
+	uint64_t expected;
+	uint64_t reordered = 0;
+	uint64_t unexpected = 0;
+	uint32_t* all;
+	double elapsed;
+
+	if(argc < 2)
+	{
+		printf( "Usage:%s <port> [nodes] [frames] [rate]\n"
+				"  nodes : nodes on the bus, default 8\n"
+				"  frames: frames sent by each node, default 10000\n"
+				"  rate  : frames/s sent by each node, default 0, as fast as it could\n", argv[0]);
+		return -1;
+	}
+
+	port = atoi(argv[1]);
+	if(argc > 2) nodeNum = atoi(argv[2]);
+	if(argc > 3) frameNum = strtoul(argv[3], NULL, 10);
+	if(argc > 4) frameRate = strtoul(argv[4], NULL, 10);
+	for(i=5; i<argc; i++)
+	{
+		if(0 == strcmp(argv[i], "split")) splitWrite = 1;
+		if(0 == strcmp(argv[i], "filter")) clientFilter = 1;
+		if(0 == strcmp(argv[i], "stall")) stallNode = 1;
+	}
+	assert((nodeNum >= 2) && (nodeNum <= CAN_BUS_NODE_MAX));
+	busPort = port;
+
+	for(i=0; i<nodeNum; i++)
+	{
+		nodes[i].id = i;
+		if(BENCH_CLIENT == i)
+		{
+			nodes[i].s = -1;
+			if(FALSE == can_socketwin_ops.probe(BENCH_CLIENT, port, 1000000, client_rx_notification))
+			{
+				printf("connect to can(%d) hub failed\n", port);
+				return -1;
+			}
+			if(clientFilter &&
+				(FALSE == can_socketwin_ops.filter(BENCH_CLIENT, port, 0x7FF, BENCH_CANID(BENCH_FILTER_NODE))))
+			{
+				printf("set filter to can(%d) hub failed\n", port);
+				return -1;
+			}
+		}
+		else
+		{
+			nodes[i].s = connect_node(port);
+		}
+		nodes[i].latency = malloc(sizeof(uint32_t)*(nodeNum-1)*frameNum);
+		assert(nodes[i].latency);
+	}
+	if(stallNode)
+	{	/* a small receive buffer, so that the hub soon has to queue and drop the frames */
+		int size = 4096;
+		stallSocket = connect_node(port);
+		setsockopt(stallSocket, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+	}
+	/* let the hub take all the nodes on-line */
+	usleep(200000);
+
+	pthread_barrier_init(&startBarrier, NULL, nodeNum+1);
+
+	for(i=0; i<nodeNum; i++)
+	{
+		pthread_create(&nodes[i].rx_thread, NULL, rx_main, &nodes[i]);
+		pthread_create(&nodes[i].tx_thread, NULL, tx_main, &nodes[i]);
+	}
+
+	start = now_ns();
+	pthread_barrier_wait(&startBarrier);
+
+	for(i=0; i<nodeNum; i++)
+	{
+		pthread_join(nodes[i].tx_thread, NULL);
+		pthread_join(nodes[i].rx_thread, NULL);
+		received += nodes[i].received;
+		reordered += nodes[i].reordered;
+		unexpected += nodes[i].unexpected;
+		if(nodes[i].last_rx > end)
+		{
+			end = nodes[i].last_rx;
+		}
+	}
+
+	expected = (uint64_t)nodeNum*(nodeNum-1)*frameNum;
+	if(clientFilter)
+	{
+		expected -= (uint64_t)(nodeNum-2)*frameNum;
+	}
+	all = malloc(sizeof(uint32_t)*(received+1));
+	assert(all);
+	received = 0;
+	for(i=0; i<nodeNum; i++)
+	{
+		memcpy(&all[received], nodes[i].latency, sizeof(uint32_t)*nodes[i].received);
+		received += nodes[i].received;
+		if(BENCH_CLIENT == i)
+		{
+			can_socketwin_ops.close(BENCH_CLIENT, port);
+		}
+		else
+		{
+			close(nodes[i].s);
+		}
+	}
+	if(stallSocket >= 0)
+	{
+		close(stallSocket);
+	}
+
+	if(0 == received)
+	{
+		printf("nothing forwarded by the can(%d) hub\n", port);
+		return -1;
+	}
+
+	qsort(all, received, sizeof(uint32_t), cmp_u32);
+	elapsed = (double)(end-start)/1000000000.0;
+
+	printf("nodes=%d, frames=%u per node, rate=%u frames/s per node%s%s%s\n", nodeNum, frameNum, frameRate,
+			splitWrite ? ", split writes" : "", clientFilter ? ", client filter" : "",
+			stallNode ? ", a stalled node" : "");
+	printf("hub: %.0f frames/s in, %.0f frames/s out\n",
+			(double)nodeNum*frameNum/elapsed, (double)received/elapsed);
+	printf("latency: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+			all[received*50/100]/1000.0, all[received*99/100]/1000.0, all[received-1]/1000.0);
+	printf("client: %u frames received\n", nodes[BENCH_CLIENT].received);
+	printf("lost %lld, reordered %llu, not filtered %llu\n", (long long)(expected-received),
+			(unsigned long long)reordered, (unsigned long long)unexpected);
+
+	return ((expected == received) && (0 == reordered) && (0 == unexpected)) ? 0 : -1;
+}
+#endif
@@ -22,12 +22,17 @@
 #else
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#endif
+#ifdef __linux__
+#include <sys/epoll.h>
 #endif
 #include <sys/queue.h>
 #include <sys/time.h>
-#include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -40,7 +45,7 @@
 #ifndef __GNUC__
 #pragma comment(lib, "Ws2_32.lib")
 #else
-/* -lwsock32 */
+/* -lws2_32: WSASend */
 #endif
 #endif
 /* ============================ [ MACROS    ] ====================================================== */
@@ -48,6 +53,25 @@
 #define CAN_MTU sizeof(struct can_frame)
 #define CAN_PORT_MIN  80
 #define CAN_BUS_NODE_MAX 32	/* maximum node on the bus port */
+/* frames taken from one node in a pass, the node still readable is served again in the
+ * next pass, so that a flooding node couldn't starve the others */
+#define CAN_RX_BATCH 16
+#define CAN_RX_FRAME_MAX (CAN_BUS_NODE_MAX*CAN_RX_BATCH)
+/* the frames queued for a node which couldn't take them at once, sent when it is writable
+ * again, the new ones to it are dropped while the queue is full, so that a slow node never
+ * holds up the others */
+#define CAN_TX_QUEUE 256
+/* the acceptance filters of a node, the one more than this makes it get all the frames */
+#define CAN_NODE_FILTER_MAX 32
+
+/* the frame to the hub itself, not a CAN ID: data[0] is the command */
+#define CAN_HUB_CTRL_ID 0xFFFFFFFF
+/* data[1..4] mask, data[5..8] code, in big endian, mask 0 clears the filters */
+#define CAN_HUB_CTRL_FILTER 0x01
+
+#if defined(__linux__) && !defined(__WINDOWS__)
+#define USE_EPOLL
+#endif
 
 #define CAN_FRAME_TYPE_RAW 0
 #define CAN_FRAME_TYPE_MTU 1
@@ -81,7 +105,19 @@
 #define FALSE 0
 #endif
 
-//#define USE_RX_DAEMON
+#ifdef __WINDOWS__
+#define mIoVecSet(v,b,l) do { (v)->buf = (CHAR*)(b); (v)->len = (ULONG)(l); } while(0)
+#define mIoVecBase(v) ((v)->buf)
+#define mIoVecLen(v) ((v)->len)
+#define mIoVecSkip(v,l) do { (v)->buf += (l); (v)->len -= (ULONG)(l); } while(0)
+#define mIsWouldBlock() (WSAEWOULDBLOCK == WSAGetLastError())
+#else
+#define mIoVecSet(v,b,l) do { (v)->iov_base = (void*)(b); (v)->iov_len = (l); } while(0)
+#define mIoVecBase(v) ((v)->iov_base)
+#define mIoVecLen(v) ((v)->iov_len)
+#define mIoVecSkip(v,l) do { (v)->iov_base = (char*)(v)->iov_base + (l); (v)->iov_len -= (l); } while(0)
+#define mIsWouldBlock() ((EAGAIN == errno) || (EWOULDBLOCK == errno))
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 /**
  * struct can_frame - basic CAN frame structure
@@ -103,17 +139,45 @@ struct can_frame {
 struct Can_SocketHandle_s
 {
 	int s; /* can raw socket: accept */
+	int dead; /* removed at the end of the pass, the frames of this pass may still refer it */
+	/* a read could end in the middle of a frame, the part is kept for the next read */
+	int rxLen;
+	uint8_t rxBuf[CAN_RX_BATCH*CAN_MTU];
+	/* the bytes the node hasn't taken yet, txBuf[txHead..txLen) */
+	int txHead;
+	int txLen;
+	int txWait; /* waiting for the node to be writable */
+	uint32_t txDropped;
+	uint8_t txBuf[CAN_TX_QUEUE*CAN_MTU];
+	/* set by the node as a CAN controller does, it gets the frames (canid&mask) == (code&mask)
+	 * of any of them, or all if none */
+	int filterNum;
+	uint32_t filterMask[CAN_NODE_FILTER_MAX];
+	uint32_t filterCode[CAN_NODE_FILTER_MAX];
 	STAILQ_ENTRY(Can_SocketHandle_s) entry;
 };
 struct Can_SocketHandleList_s
 {
 	int s; /* can raw socket: listen */
-	#ifdef USE_RX_DAEMON
-	pthread_t rx_thread;
-	#endif
+#ifdef USE_EPOLL
+	int ep;
+#endif
 	STAILQ_HEAD(,Can_SocketHandle_s) head;
 };
 
+struct Can_RxFrame_s
+{
+	struct can_frame frame;
+	uint32_t canid;
+	struct Can_SocketHandle_s* from;
+};
+
+#ifdef __WINDOWS__
+typedef WSABUF Can_IoVecType;
+#else
+typedef struct iovec Can_IoVecType;
+#endif
+
 struct Can_Filter_s {
 	uint32_t mask;
 	uint32_t code;
@@ -129,9 +193,10 @@ struct Can_FilterList_s
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 static struct Can_SocketHandleList_s* socketH = NULL;
-#ifdef USE_RX_DAEMON
-static pthread_mutex_t socketLock = PTHREAD_MUTEX_INITIALIZER;
-#endif
+/* all the frames received in one pass, forwarded together at the end of it */
+static struct Can_RxFrame_s rxFrames[CAN_RX_FRAME_MAX];
+static int rxFrameNum = 0;
+static Can_IoVecType txIoVec[CAN_RX_FRAME_MAX];
 static struct timeval m0;
 static struct Can_FilterList_s* canFilterH = NULL;
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -201,31 +266,42 @@ static int init_socket(int port)
 	STAILQ_INIT(&socketH->head);
 	socketH->s = s;
 
+#ifdef USE_EPOLL
+	struct epoll_event ev;
+	socketH->ep = epoll_create1(0);
+	if(socketH->ep < 0) {
+		printf("epoll_create1 failed with error: %d\n", WSAGetLastError());
+		closesocket(s);
+		return FALSE;
+	}
+	/* the listen socket is the event without handle */
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	epoll_ctl(socketH->ep, EPOLL_CTL_ADD, s, &ev);
+#endif
+
 	return TRUE;
 }
 static void try_accept(void)
 {
 	struct Can_SocketHandle_s* handle;
-	/* struct timeval tv; */
-	int s = accept(socketH->s, NULL, NULL);
+	int s;
+	int on = 1;
 
-	if(s >= 0)
+	/* take all the pending connections */
+	while((s = accept(socketH->s, NULL, NULL)) >= 0)
 	{
-		/* tv.tv_sec  = 0;
-		tv.tv_usec = 0; */
 		handle = malloc(sizeof(struct Can_SocketHandle_s));
 		assert(handle);
 		handle->s = s;
+		handle->dead = FALSE;
+		handle->rxLen = 0;
+		handle->txHead = 0;
+		handle->txLen = 0;
+		handle->txWait = FALSE;
+		handle->txDropped = 0;
+		handle->filterNum = 0;
 		#ifdef __WINDOWS__
-		/* Set Timeout for recv call */
-		/*
-		if(setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (char*)&tv, sizeof(struct timeval)) == SOCKET_ERROR)
-		{
-			wprintf(L"setsockopt failed with error: %ld\n", WSAGetLastError());
-			closesocket(s);
-			return;
-		}
-		*/
 		/* set to non blocking mode */
 		u_long iMode = 1;
 		ioctlsocket(s, FIONBIO, &iMode);
@@ -233,32 +309,24 @@ static void try_accept(void)
 		int iMode = 1;
 		ioctl(s, FIONBIO, (char *)&iMode);
 		#endif
-		#ifdef USE_RX_DAEMON
-		pthread_mutex_lock(&socketLock);
+		/* the frames of a pass go out in one write, don't hold them back */
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+		#ifdef USE_EPOLL
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = handle;
+		if(epoll_ctl(socketH->ep, EPOLL_CTL_ADD, s, &ev) < 0)
+		{
+			printf("epoll_ctl failed with error: %d\n", WSAGetLastError());
+			closesocket(s);
+			free(handle);
+			continue;
+		}
 		#endif
 		STAILQ_INSERT_TAIL(&socketH->head,handle,entry);
-		#ifdef USE_RX_DAEMON
-		pthread_mutex_unlock(&socketLock);
-		#endif
 		printf("can socket %X on-line!\n",s);
 	}
-	else
-	{
-		//wprintf(L"accept failed with error: %ld\n", WSAGetLastError());
-	}
 }
-#ifdef USE_RX_DAEMON
-static void * rx_daemon(void * param)
-{
-	(void)param;
-	while(TRUE)
-	{
-		try_accept();
-	}
-
-	return NULL;
-}
-#endif
 static void remove_socket(struct Can_SocketHandle_s* h)
 {
 	STAILQ_REMOVE(&socketH->head,h,Can_SocketHandle_s,entry);
@@ -318,84 +386,372 @@ static void log_msg(struct can_frame* frame,float rtim)
 		printf("] @ %f s\n", rtim);
 	}
 }
-static void try_recv_forward(void)
+static uint32_t get_u32(const uint8_t* data)
 {
-	int len;
-	struct can_frame frame;
-	struct Can_SocketHandle_s* h;
-	struct Can_SocketHandle_s* h2;
-	#ifdef USE_RX_DAEMON
-	pthread_mutex_lock(&socketLock);
-	#endif
-	STAILQ_FOREACH(h,&socketH->head,entry)
+	return ((uint32_t)data[0]<<24) + ((uint32_t)data[1]<<16) + ((uint32_t)data[2]<<8) + data[3];
+}
+static void on_control(struct Can_SocketHandle_s* h, struct can_frame* frame)
+{
+	uint32_t mask;
+	uint32_t code;
+
+	if(CAN_HUB_CTRL_FILTER == frame->data[0])
 	{
-		len = recv(h->s, (void*)&frame, CAN_MTU, 0);
-		if(CAN_MTU == len)
+		mask = get_u32(&frame->data[1]);
+		code = get_u32(&frame->data[5]);
+		if(0 == mask)
+		{
+			h->filterNum = 0;
+			printf("node %X gets all the frames\n",h->s);
+		}
+		else if(h->filterNum < CAN_NODE_FILTER_MAX)
 		{
-			struct timeval m1;
+			h->filterMask[h->filterNum] = mask;
+			h->filterCode[h->filterNum] = code&mask;
+			h->filterNum++;
+			printf("node %X gets the frames %08X#%08X\n",h->s,mask,code);
+		}
+		else
+		{	/* the last one takes all */
+			h->filterMask[CAN_NODE_FILTER_MAX-1] = 0;
+			h->filterCode[CAN_NODE_FILTER_MAX-1] = 0;
+			printf("node %X has too many filters, gets all the frames\n",h->s);
+		}
+	}
+	else
+	{
+		printf("node %X unknown command %02X\n",h->s,frame->data[0]);
+	}
+}
+static int is_accepted(struct Can_SocketHandle_s* h, uint32_t canid)
+{
+	int i;
+	int bOk = (0 == h->filterNum);
 
-			gettimeofday(&m1,NULL);
-			float rtim = m1.tv_sec-m0.tv_sec;
+	for(i=0; (i<h->filterNum) && (!bOk); i++)
+	{
+		bOk = ((canid&h->filterMask[i]) == h->filterCode[i]);
+	}
 
-			if(m1.tv_usec > m0.tv_usec)
-			{
-				rtim += (float)(m1.tv_usec-m0.tv_usec)/1000000.0;
-			}
-			else
-			{
-				rtim = rtim - 1 + (float)(1000000.0+m1.tv_usec-m0.tv_usec)/1000000.0;
-			}
+	return bOk;
+}
+/* one read of as many bytes as the frames this pass could still take, so that only the part
+ * of a frame stays in the buffer and the node is readable again if it has sent more */
+static void try_recv(struct Can_SocketHandle_s* h)
+{
+	int num;
+	int len;
+	int offset;
 
-			log_msg(&frame,rtim);
+	num = CAN_RX_FRAME_MAX - rxFrameNum;
+	if(num > CAN_RX_BATCH)
+	{
+		num = CAN_RX_BATCH;
+	}
 
-			STAILQ_FOREACH(h2,&socketH->head,entry)
+	if(num > 0)
+	{
+		len = recv(h->s, (void*)&h->rxBuf[h->rxLen], num*CAN_MTU - h->rxLen, 0);
+		if(len > 0)
+		{
+			h->rxLen += len;
+			for(offset=0; (h->rxLen-offset) >= (int)CAN_MTU; offset+=CAN_MTU)
 			{
-				if(h != h2)
+				struct Can_RxFrame_s* rx = &rxFrames[rxFrameNum];
+				struct can_frame* frame = &rx->frame;
+				memcpy(frame, &h->rxBuf[offset], CAN_MTU);
+				rx->canid = mCANID(frame);
+				if(CAN_HUB_CTRL_ID == rx->canid)
+				{
+					on_control(h, frame);
+				}
+				else
 				{
-					if (send(h2->s, (const char*)&frame, CAN_MTU,0) != CAN_MTU) {
-						printf("send failed with error: %d, remove this node %X!\n", WSAGetLastError(),h2->s);
-						remove_socket(h2);
-						break;
-					}
+					rx->from = h;
+					rxFrameNum++;
 				}
 			}
+			h->rxLen -= offset;
+			if(h->rxLen > 0)
+			{
+				memmove(h->rxBuf, &h->rxBuf[offset], h->rxLen);
+			}
+		}
+		else if(0 == len)
+		{
+			printf("node %X off-line!\n",h->s);
+			h->dead = TRUE;
 		}
-		else if(-1 == len)
+		else if(!mIsWouldBlock())
 		{
+			printf("recv failed with error: %d, remove this node %X!\n", WSAGetLastError(),h->s);
+			h->dead = TRUE;
+		}
+		else
+		{
+			/* Resource temporarily unavailable. */
+		}
+	}
+}
+/* one write of the vector which doesn't block, returns the bytes taken or -1 on error */
+static int write_vector(int s, Can_IoVecType* iov, int n)
+{
 #ifdef __WINDOWS__
-			if(10035!= WSAGetLastError())
+	DWORD sent = 0;
+	if(0 != WSASend(s, iov, n, &sent, 0, NULL, NULL))
+	{
+		if(!mIsWouldBlock()) return -1;
+		sent = 0;
+	}
 #else
-			if(EAGAIN != errno)
+	ssize_t sent = writev(s, iov, n);
+	if(sent < 0)
+	{
+		if(!mIsWouldBlock()) return -1;
+		sent = 0;
+	}
 #endif
+	return (int)sent;
+}
+static void wait_writable(struct Can_SocketHandle_s* h, int on)
+{
+	if(h->txWait != on)
+	{
+		h->txWait = on;
+#ifdef USE_EPOLL
+		struct epoll_event ev;
+		ev.events = on ? (EPOLLIN|EPOLLOUT) : EPOLLIN;
+		ev.data.ptr = h;
+		epoll_ctl(socketH->ep, EPOLL_CTL_MOD, h->s, &ev);
+#endif
+	}
+}
+/* send what is queued for the node as much as it could take now */
+static int flush_frames(struct Can_SocketHandle_s* h)
+{
+	Can_IoVecType iov;
+	int sent;
+
+	if(h->txLen > h->txHead)
+	{
+		mIoVecSet(&iov, &h->txBuf[h->txHead], h->txLen - h->txHead);
+		sent = write_vector(h->s, &iov, 1);
+		if(sent < 0) return FALSE;
+		h->txHead += sent;
+	}
+
+	if(h->txHead >= h->txLen)
+	{
+		h->txHead = 0;
+		h->txLen = 0;
+		wait_writable(h, FALSE);
+		if(h->txDropped > 0)
+		{
+			printf("node %X is back, %u frames to it were dropped!\n", h->s, h->txDropped);
+			h->txDropped = 0;
+		}
+	}
+
+	return TRUE;
+}
+/* one write of all the frames to the node, what it couldn't take is queued behind the ones
+ * already queued, only whole frames are dropped so the stream to it stays in frames */
+static int send_frames(struct Can_SocketHandle_s* h, Can_IoVecType* iov, int n)
+{
+	int sent;
+	int len;
+
+	if((h->txLen > 0) && (FALSE == flush_frames(h)))
+	{
+		return FALSE;
+	}
+
+	if(0 == h->txLen)
+	{
+		sent = write_vector(h->s, iov, n);
+		if(sent < 0) return FALSE;
+		while((n > 0) && (sent >= (int)mIoVecLen(iov)))
+		{
+			sent -= mIoVecLen(iov);
+			iov++;
+			n--;
+		}
+		if(n > 0)
+		{
+			mIoVecSkip(iov, sent);
+		}
+	}
+
+	for( ; n > 0; iov++, n--)
+	{
+		len = mIoVecLen(iov);
+		if(((int)sizeof(h->txBuf) - h->txLen) < len)
+		{
+			memmove(h->txBuf, &h->txBuf[h->txHead], h->txLen - h->txHead);
+			h->txLen -= h->txHead;
+			h->txHead = 0;
+		}
+		if(((int)sizeof(h->txBuf) - h->txLen) >= len)
+		{
+			memcpy(&h->txBuf[h->txLen], mIoVecBase(iov), len);
+			h->txLen += len;
+		}
+		else
+		{
+			if(0 == h->txDropped)
 			{
-				printf("recv failed with error: %d, remove this node %X!\n", WSAGetLastError(),h->s);
-				remove_socket(h);
-				break;
+				printf("node %X is slow, drop the frames to it!\n", h->s);
 			}
-			else
+			h->txDropped++;
+		}
+	}
+
+	if(h->txLen > 0)
+	{
+		wait_writable(h, TRUE);
+	}
+
+	return TRUE;
+}
+static void forward(void)
+{
+	int i;
+	int n;
+	struct timeval m1;
+	float rtim;
+	struct Can_SocketHandle_s* h;
+	struct Can_SocketHandle_s* next;
+
+	if(rxFrameNum > 0)
+	{
+		gettimeofday(&m1,NULL);
+		rtim = m1.tv_sec-m0.tv_sec;
+
+		if(m1.tv_usec > m0.tv_usec)
+		{
+			rtim += (float)(m1.tv_usec-m0.tv_usec)/1000000.0;
+		}
+		else
+		{
+			rtim = rtim - 1 + (float)(1000000.0+m1.tv_usec-m0.tv_usec)/1000000.0;
+		}
+
+		for(i=0; i<rxFrameNum; i++)
+		{
+			log_msg(&rxFrames[i].frame,rtim);
+		}
+
+		STAILQ_FOREACH(h,&socketH->head,entry)
+		{
+			if(h->dead)
+			{
+				continue;
+			}
+
+			n = 0;
+			for(i=0; i<rxFrameNum; i++)
 			{
-				/* Resource temporarily unavailable. */
+				if((h != rxFrames[i].from) && is_accepted(h, rxFrames[i].canid))
+				{
+					mIoVecSet(&txIoVec[n], &rxFrames[i].frame, CAN_MTU);
+					n++;
+				}
+			}
+
+			if((n > 0) && (FALSE == send_frames(h, txIoVec, n)))
+			{
+				printf("send failed with error: %d, remove this node %X!\n", WSAGetLastError(),h->s);
+				h->dead = TRUE;
 			}
 		}
-		else
+
+		rxFrameNum = 0;
+	}
+
+	h = STAILQ_FIRST(&socketH->head);
+	while(NULL != h)
+	{
+		next = STAILQ_NEXT(h,entry);
+		if(h->dead)
 		{
-			#ifdef __LINUX__
-			printf("recv failed with error: %d, remove this node %X!\n", WSAGetLastError(),h->s);
 			remove_socket(h);
-			#endif
-			printf("timeout recv... len=%d\n",len);
 		}
+		h = next;
 	}
-	#ifdef USE_RX_DAEMON
-	pthread_mutex_unlock(&socketLock);
-	#endif
 }
+/* block until any socket is readable, then drain all the readable ones and forward what
+ * they have sent in one pass */
 static void schedule(void)
 {
-	#ifndef USE_RX_DAEMON
-	try_accept();
-	#endif
-	try_recv_forward();
+	int i;
+	int n;
+	struct Can_SocketHandle_s* h;
+#ifdef USE_EPOLL
+	struct epoll_event events[CAN_BUS_NODE_MAX+1];
+
+	n = epoll_wait(socketH->ep, events, CAN_BUS_NODE_MAX+1, -1);
+	for(i=0; i<n; i++)
+	{
+		h = (struct Can_SocketHandle_s*)events[i].data.ptr;
+		if(NULL == h)
+		{
+			try_accept();
+			continue;
+		}
+		if((!h->dead) && (events[i].events & EPOLLOUT) && (FALSE == flush_frames(h)))
+		{
+			printf("send failed with error: %d, remove this node %X!\n", WSAGetLastError(),h->s);
+			h->dead = TRUE;
+		}
+		if((!h->dead) && (events[i].events & ~EPOLLOUT))
+		{
+			try_recv(h);
+		}
+	}
+#else
+	fd_set rfds;
+	fd_set wfds;
+	int maxfd = socketH->s;
+
+	FD_ZERO(&rfds);
+	FD_ZERO(&wfds);
+	FD_SET(socketH->s, &rfds);
+	STAILQ_FOREACH(h,&socketH->head,entry)
+	{
+		FD_SET(h->s, &rfds);
+		if(h->txWait)
+		{
+			FD_SET(h->s, &wfds);
+		}
+		if(h->s > maxfd)
+		{
+			maxfd = h->s;
+		}
+	}
+
+	n = select(maxfd+1, &rfds, &wfds, NULL, NULL);
+	if(n > 0)
+	{
+		STAILQ_FOREACH(h,&socketH->head,entry)
+		{
+			if(FD_ISSET(h->s, &wfds) && (FALSE == flush_frames(h)))
+			{
+				printf("send failed with error: %d, remove this node %X!\n", WSAGetLastError(),h->s);
+				h->dead = TRUE;
+			}
+			if((!h->dead) && FD_ISSET(h->s, &rfds))
+			{
+				try_recv(h);
+			}
+		}
+		if(FD_ISSET(socketH->s, &rfds))
+		{
+			try_accept();
+		}
+	}
+	(void)i;
+#endif
+	forward();
 }
 
 static void arg_filter(char* s)
@@ -450,15 +806,6 @@ int main(int argc,char* argv[])
 		argv = argv + 2;
 	}
 
-	#ifdef USE_RX_DAEMON
-	if( 0 == pthread_create(&(socketH->rx_thread),NULL,rx_daemon,NULL))
-	{
-	}
-	else
-	{
-		return -1;
-	}
-	#endif
 	for(;;)
 	{
 		schedule();
@@ -34,8 +34,14 @@ static const luaL_Reg aslib[] = {
 #ifdef USE_LUA_CAN
 		{"can_write",luai_can_write},
 		{"can_read", luai_can_read},
+		{"can_read_batch", luai_can_read_batch},
 		{"can_open", luai_can_open},
 		{"can_log",  luai_can_log},
+		{"can_filter",luai_can_filter},
+		{"cantp_open",luai_cantp_open},
+		{"cantp_transmit",luai_cantp_transmit},
+		{"cantp_receive",luai_cantp_receive},
+		{"cantp_close",luai_cantp_close},
 #endif
 		{"time",     luai_as_time},
 #ifdef USE_LUA_DEV
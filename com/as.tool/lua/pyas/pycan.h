@@ -17,6 +17,8 @@
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include <stdio.h>
 /* ============================ [ MACROS    ] ====================================================== */
+/* the bytes of each frame in the data of can_read_batch, as lascanlib.h */
+#define CAN_READ_BATCH_MTU 64
 
 /* ============================ [ TYPES     ] ====================================================== */
 
@@ -27,8 +29,16 @@ void luai_canlib_close(void);
 int can_open(unsigned long busid,const char* device,unsigned long port, unsigned long baudrate);
 int can_write(unsigned long busid,unsigned long canid,unsigned long dlc,unsigned char* data);
 int can_read(unsigned long busid,unsigned long canid,unsigned long *p_canid,unsigned long *dlc,unsigned char** data);
+int can_read_batch(unsigned long busid,unsigned long canid,unsigned long num,unsigned long timeout,
+		unsigned long* p_canid,unsigned long* dlc,unsigned char* data,unsigned long long* timestamp);
 int can_close(unsigned long busid);
 int can_reset(unsigned long busid);
+int can_filter(unsigned long busid,unsigned long mask,unsigned long code);
+int cantp_open(unsigned long channel,unsigned long busid,unsigned long rxid,unsigned long txid,
+		unsigned long ll_dl,unsigned long bs,unsigned long stmin_us,unsigned long padding);
+int cantp_transmit(unsigned long channel,unsigned long size,unsigned char* data,unsigned long timeout);
+int cantp_receive(unsigned long channel,unsigned long* size,unsigned char** data,unsigned long timeout);
+int cantp_close(unsigned long channel);
 }
 /* ============================ [ CLASS     ] ====================================================== */
 class can
@@ -57,6 +67,12 @@ public:
 		return can_read(busid,canid,p_canid,dlc,data);
 	}
 
+	int read_batch(unsigned long busid,unsigned long canid,unsigned long num,unsigned long timeout,
+			unsigned long* p_canid,unsigned long* dlc,unsigned char* data,unsigned long long* timestamp)
+	{
+		return can_read_batch(busid,canid,num,timeout,p_canid,dlc,data,timestamp);
+	}
+
 	int close(unsigned long busid)
 	{
 		return can_close(busid);
@@ -66,6 +82,44 @@ public:
 	{
 		return can_reset(busid);
 	}
+
+	int filter(unsigned long busid,unsigned long mask,unsigned long code)
+	{
+		return can_filter(busid,mask,code);
+	}
+};
+
+/* ISO 15765-2 on a bus opened by the class can */
+class cantp
+{
+public:
+	explicit cantp()
+	{
+	}
+	~cantp()
+	{
+	}
+
+	int open(unsigned long channel,unsigned long busid,unsigned long rxid,unsigned long txid,
+			unsigned long ll_dl,unsigned long bs,unsigned long stmin_us,unsigned long padding)
+	{
+		return cantp_open(channel,busid,rxid,txid,ll_dl,bs,stmin_us,padding);
+	}
+
+	int transmit(unsigned long channel,unsigned long size,unsigned char* data,unsigned long timeout)
+	{
+		return cantp_transmit(channel,size,data,timeout);
+	}
+
+	int receive(unsigned long channel,unsigned long* size,unsigned char** data,unsigned long timeout)
+	{
+		return cantp_receive(channel,size,data,timeout);
+	}
+
+	int close(unsigned long channel)
+	{
+		return cantp_close(channel);
+	}
 };
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -43,12 +43,19 @@ local CANTP_ST_SEND_FC = 6
 local cfgSTmin = 10
 local cfgBS    = 8
 local cfgPadding = 0x55
+-- the C ISO-TP of the as library, run on the rx thread of the CAN device
+local cfgNative = (nil ~= as.cantp_open)
 -- ===================== [ LOCAL    ] ================================
 local M = {}
 local runtime = {}
 -- ===================== [ DATA     ] ================================
 cantp = M 
 -- ===================== [ FUNCTION ] ================================
+-- true if cantp.receive could be polled by a timeout
+function M.is_native()
+  return cfgNative
+end
+
 function M.init(channel,bus,rxid,txid)
   runtime[channel] = {}
   runtime[channel]["bus"]  = bus
@@ -64,6 +71,11 @@ function M.init(channel,bus,rxid,txid)
   runtime[channel]["BS"] = 0
   runtime[channel]["STmin"] = 0
   runtime[channel]["state"] = CANTP_ST_IDLE
+
+  if cfgNative then
+    as.cantp_close(channel)
+    as.cantp_open(channel,bus,rxid,txid,8,cfgBS,cfgSTmin*1000,cfgPadding)
+  end
 end
 
 local function sendSF(channel,data)
@@ -244,7 +256,9 @@ end
 
 function M.transmit(channel,data)
   -- print("request: ",channel,table.concat(data, ":"))
-  if rawlen(data) < 7 then
+  if cfgNative then
+    ercd = as.cantp_transmit(channel,data)
+  elseif rawlen(data) < 7 then
     ercd = sendSF(channel,data)
   else
     ercd = ScheduleTx(channel,data)
@@ -351,7 +365,18 @@ local function sendFC(channel)
   return as.can_write(bus,txid,pdu)
 end
 
-function M.receive(channel)
+-- the timeout in ms is only for the native cantp, a reception in progress is not
+-- given up by a short timeout, so it could be polled with 0
+function M.receive(channel,timeout)
+  if cfgNative then
+    if nil == timeout then
+      ercd,response = as.cantp_receive(channel)
+    else
+      ercd,response = as.cantp_receive(channel,timeout)
+    end
+    return ercd,response
+  end
+
   ercd = true
   response = {}
   
@@ -22,6 +22,8 @@ require("cantp")
 -- ===================== [ LOCAL    ] ================================
 local M = {}
 local runtime = {}
+-- called while waiting for the response, returns false if nothing more to do
+local l_idle = nil
 local l_service = { [0x10]="diagnostic session control",[0x11]="ecu reset",[0x14]="clear diagnostic information",
                 [0x19]="read dtc information",[0x22]="read data by identifier",[0x23]="read memory by address",
                 [0x24]="read scaling data by identifier",[0x27]="security access",[0x28]="communication control",
@@ -109,13 +111,35 @@ local function show_response(res)
   print(ss)
 end
 
+-- the idle hook is run while the server is working on the request, so that the
+-- tester could get its next request ready, it's only for the native cantp
+function M.set_idle(idle)
+  l_idle = idle
+end
+
+local function receive(channel)
+  if (nil ~= l_idle) and cantp.is_native() then
+    while true do
+      ercd,res = cantp.receive(channel,0)
+      if (ercd == true) or (false == l_idle()) then
+        break
+      end
+    end
+    if ercd == true then
+      return ercd,res
+    end
+  end
+
+  return cantp.receive(channel)
+end
+
 function M.transmit(channel,req)
   ercd = true
   response  = nil
   show_request(req)
   cantp.transmit(channel,req)
   while ercd == true do
-    ercd,res = cantp.receive(channel)
+    ercd,res = receive(channel)
     if ercd == true then
       show_response(res)
       if (req[1]|0x40 == res[1]) then
@@ -16,6 +16,7 @@
 require("dcm")
 require("as")
 require("s19")
+require("lzss")
 require("math")
 require("os")
 -- ===================== [ MACRO    ] ================================
@@ -26,15 +27,39 @@ local dcm_chl = 0
 
 local FLASH_WRITE_SIZE = 512
 local FLASH_READ_SIZE  = 512
+-- must be the FLASH_ERASE_SIZE of the target for delta, the staging is sector by sector,
+-- and not bigger than the BL_LZSS_WINDOW_BITS of the bootloader, see the arguments of main
+local FLASH_ERASE_SIZE = 512
+local LZSS_WINDOW_BITS = 10
 
 local l_flsdrv = nil
 local l_app = nil
 local l_flsdrv_s = nil
 local l_app_s = nil
+-- none, lzss or delta(against the l_base image installed on the target,
+-- the bootloader must be built with BL_LZSS_DELTA)
+local l_compression = "none"
+local l_base = nil
+local l_raw_size = 0
+local l_zip_size = 0
+local l_crc32_tab = nil
+-- the images are chunked to the TransferData requests and their CRCs are computed once, by
+-- a coroutine which is run by the idle hook of dcm while the ECU is busy, or on demand
+local l_prepare = nil
+local l_flsdrv_p = {}
+local l_flsdrv_crc = {}
+local l_app_p = {}
+local l_app_crc = {}
+local l_prepare_cost = 0
+local l_prepare_idle = 0
+-- the cost of each phase and the bytes of the TransferData for the report
+local l_phases = {"session","erase","transfer","verify","jump"}
+local l_phase_cost = {}
+local l_transfer_size = 0
 -- ===================== [ DATA     ] ================================
 -- ===================== [ FUNCTION ] ================================
 function is_all_zero(data,size)
-  bAllZero = true
+  local bAllZero = true
   for i=1,size,1 do
     if data[i] ~= 0 then
       bAllZero = false
@@ -44,6 +69,31 @@ function is_all_zero(data,size)
   return bAllZero
 end
 
+function crc32(data,size)
+  if nil == l_crc32_tab then
+    l_crc32_tab = {}
+    for i=0,255,1 do
+      local c = i
+      for j=1,8,1 do
+        if 1 == (c&1) then
+          c = (c>>1) ~ 0xEDB88320
+        else
+          c = c>>1
+        end
+      end
+      l_crc32_tab[i] = c
+    end
+  end
+  local crc = 0xFFFFFFFF
+  for i=1,size,1 do
+    crc = l_crc32_tab[(crc ~ data[i])&0xFF] ~ (crc>>8)
+    if (0 == (i&0xFFF)) and coroutine.isyieldable() then
+      coroutine.yield()
+    end
+  end
+  return crc ~ 0xFFFFFFFF
+end
+
 function enter_extend_session()
   ercd,res = dcm.transmit(dcm_chl,{0x10,0x03})
   
@@ -118,6 +168,11 @@ end
 
 function routine_erase_flash()
 
+  if "delta" == l_compression then
+    print("  >> routine erase flash skipped, erased sector by sector by the delta download!")
+    return true
+  end
+
   srecord = l_app_s
   
   if( nil == srecord ) then
@@ -208,10 +263,10 @@ function request_transfer_exit()
   return ercd
 end
 
-function request_download(addr,size,mem)
+function request_download(addr,size,mem,dfi)
   data = {}
   data[1] = 0x34
-  data[2] = 0x00 -- data format identifier
+  data[2] = dfi or 0x00 -- data format identifier
   data[3] = 0x44 -- address and length format
   data[4] = (addr>>24)&0xFF
   data[5] = (addr>>16)&0xFF
@@ -249,33 +304,20 @@ function request_transfer_exit()
   return ercd
 end
 
-function download_one_record(addr,size,data,mem)
-  ercd = request_download(addr,size,mem)
-  
-  -- download application
-  blockSequenceCounter = 1
-  left_size = size
-  pos = 0
-
-  ability = math.floor((4096-4)/FLASH_WRITE_SIZE) * FLASH_WRITE_SIZE
-
-  while (left_size > 0) and (true== ercd) do
-    req ={}
-    req[1] = 0x36
-    req[2] = blockSequenceCounter
-    req[3] = 0
-    req[4] = mem
-    
-    sz = ability
-    if (left_size > ability) then      
-      left_size = left_size - ability
-    else
-      sz = math.floor((left_size+FLASH_WRITE_SIZE-1)/FLASH_WRITE_SIZE)*FLASH_WRITE_SIZE
-	  left_size = 0
+-- the record with all its TransferData requests, it's run in the coroutine of the
+-- preparation so only the locals could be used
+function prepare_one_record(addr,size,data,mem)
+  local record = {addr=addr,size=size,mem=mem,dfi=0x00,blocks={}}
+  local blockSequenceCounter = 1
+  local pos = 0
+  local ability = math.floor((4096-4)/FLASH_WRITE_SIZE) * FLASH_WRITE_SIZE
+
+  while pos < size do
+    local sz = ability
+    if (size-pos) < ability then
+      sz = math.floor((size-pos+FLASH_WRITE_SIZE-1)/FLASH_WRITE_SIZE)*FLASH_WRITE_SIZE
     end
-
-    --print(string.format("next pos=%X,sz=%X,ability=%X",pos,sz,ability))
-
+    local req = {0x36,blockSequenceCounter,0,mem}
     for i=1,sz,1 do
       if(pos+i <= size) then
         req[4+i] = data[pos+i]
@@ -283,28 +325,81 @@ function download_one_record(addr,size,data,mem)
         req[4+i] = 0xFF
       end
     end
-
-    ercd,res = dcm.transmit(dcm_chl,req)
-    
-    -- TODO: I don't know why sz becomes sz+4
-    --if(sz > ability) then
-    --  print("somehow bug here")
-    --  sz = ability
-    --end
-    -- pos = pos + sz
+    record.blocks[rawlen(record.blocks)+1] = req
     pos = pos + ability
+    blockSequenceCounter = (blockSequenceCounter + 1)&0xFF
+    if coroutine.isyieldable() then
+      coroutine.yield()
+    end
+  end
 
+  return record
+end
+
+-- addr and size must be FLASH_WRITE_SIZE aligned, for delta the base is the old content of
+-- the same region and the region must be FLASH_ERASE_SIZE aligned
+function prepare_one_record_compressed(addr,size,data,mem,base)
+  local record = {addr=addr,size=size,mem=mem,dfi=0x10,blocks={}}
+  if nil ~= base then
+    record.dfi = 0x20
+  end
+  local pre = as.time()
+  local zdata = lzss.compress(data,size,base,LZSS_WINDOW_BITS,FLASH_ERASE_SIZE)
+  local zsize = rawlen(zdata)
+  print(string.format("  >> compress %d bytes to %d bytes(%.1f%%) in %.2fs",
+                      size,zsize,zsize*100/size,as.time()-pre))
+  l_raw_size = l_raw_size + size
+  l_zip_size = l_zip_size + zsize
+
+  local blockSequenceCounter = 1
+  local pos = 0
+  local ability = 4096-4
+  while pos < zsize do
+    local req = {0x36,blockSequenceCounter,0,mem}
+    local sz = math.min(ability,zsize-pos)
+    for i=1,sz,1 do
+      req[4+i] = zdata[pos+i]
+    end
+    record.blocks[rawlen(record.blocks)+1] = req
+    pos = pos + sz
     blockSequenceCounter = (blockSequenceCounter + 1)&0xFF
- 
   end
-  
+
+  return record
+end
+
+-- each request is ready, so the next goes out as soon as the positive response is in
+function download_prepared_record(record)
+  if (nil == record) or (false == record) then
+    print("  >> the record is not prepared!")
+    return false
+  end
+
+  ercd = request_download(record.addr,record.size,record.mem,record.dfi)
+
+  for i=1,rawlen(record.blocks),1 do
+    if true ~= ercd then
+      break
+    end
+    ercd,res = dcm.transmit(dcm_chl,record.blocks[i])
+    l_transfer_size = l_transfer_size + rawlen(record.blocks[i]) - 4
+  end
+
   if (true == ercd) then
     ercd = request_transfer_exit()
   end
-  
+
   return ercd
 end
 
+function download_one_record(addr,size,data,mem)
+  return download_prepared_record(prepare_one_record(addr,size,data,mem))
+end
+
+function download_one_record_compressed(addr,size,data,mem,base)
+  return download_prepared_record(prepare_one_record_compressed(addr,size,data,mem,base))
+end
+
 function upload_one_record(addr,size,mem)
   ercd = request_upload(addr,size,mem)
   record = {}
@@ -357,12 +452,9 @@ function download_flash_driver()
     print("  >> invalid flash driver srecord file!")
     return false
   end
-  -- flash driver mapped to address 0
   secnbr = rawlen(srecord)
   for i=1,secnbr,1 do
-    ss = srecord[i]
-    addr =  ss["addr"]-srecord[1]["addr"]
-    ercd =  download_one_record(addr,ss["size"],ss["data"],0xFD)
+    ercd =  download_prepared_record(prepared(l_flsdrv_p,i))
     if (false == ercd) then
       break
     end
@@ -392,7 +484,58 @@ function fl_compare(s1,s2)
   return ercd
 end
 
+-- RoutineControl CalculateChecksum, compare the CRC32 of the target memory with the image,
+-- so that only 13 bytes need to be sent instead of reading back the whole image, the expected
+-- CRC is the one of the preparation
+function check_one_record(addr,size,expected,mem)
+  local req,ercd,res,crc
+  req = {0x31,0x01,0xFF,0x02,
+         (addr>>24)&0xFF,(addr>>16)&0xFF,(addr>>8)&0xFF,(addr>>0)&0xFF,
+         (size>>24)&0xFF,(size>>16)&0xFF,(size>>8)&0xFF,(size>>0)&0xFF,
+         mem}
+  ercd,res = dcm.transmit(dcm_chl,req)
+  if (true == ercd) then
+    crc = (res[5]<<24) + (res[6]<<16) + (res[7]<<8) + res[8]
+    if crc ~= expected then
+      print(string.format("  >> checksum of %X(%d bytes) is %08X, expected %08X",addr,size,crc,expected))
+      ercd = false
+    end
+  else
+    print("  >> routine calculate checksum failed!")
+  end
+  return ercd
+end
+
 function check_flash_driver()
+  srecord = l_flsdrv_s
+
+  if( nil == srecord ) then
+    print("  >> invalid flash driver srecord file!")
+    return false
+  end
+  -- flash driver mapped to address 0
+  secnbr = rawlen(srecord)
+  for i=1,secnbr,1 do
+    ss = srecord[i]
+    addr =  ss["addr"]-srecord[1]["addr"]
+    ercd =  check_one_record(addr,ss["size"],prepared(l_flsdrv_crc,i),0xFD)
+    if (false == ercd) then
+      break
+    end
+  end
+
+  if (false == ercd) then
+    print("  >> check flash driver failed!")
+    ercd = check_flash_driver_readback()
+  else
+    print("  >> check flash driver ok!")
+  end
+
+  return ercd
+end
+
+-- read back the whole image, slow but dump what is on the target for the diagnosis
+function check_flash_driver_readback()
   srecord = s19.open(l_flsdrv)
   
   if( nil == srecord ) then
@@ -428,6 +571,126 @@ function check_flash_driver()
   return ercd
 end
 
+-- flat image of the srecord over [saddr,eaddr), the gaps are 0xFF
+function get_image(srecord,saddr,eaddr)
+  local image = {}
+  for i=1,eaddr-saddr,1 do
+    image[i] = 0xFF
+  end
+  for i=1,rawlen(srecord),1 do
+    local ss = srecord[i]
+    if (ss["addr"] >= saddr) and (ss["addr"]+ss["size"] <= eaddr) then
+      for j=1,ss["size"],1 do
+        image[ss["addr"]-saddr+j] = ss["data"][j]
+      end
+    end
+  end
+  return image
+end
+
+-- the delta record of the application, false if no valid base
+function prepare_application_delta()
+  local srecord = l_app_s
+  local base = s19.open(l_base)
+
+  if( nil == base ) then
+    print("  >> invalid base srecord file!")
+    return false
+  end
+
+  local saddr = srecord[1]["addr"]
+  local eaddr = saddr
+  for i=1,rawlen(srecord),1 do
+    local ss = srecord[i]
+    if false == is_all_zero(ss["data"],ss["size"]) then
+      eaddr = ss["addr"]+ss["size"]
+    end
+  end
+  saddr = math.floor(saddr/FLASH_ERASE_SIZE)*FLASH_ERASE_SIZE
+  eaddr = math.floor((eaddr+FLASH_ERASE_SIZE-1)/FLASH_ERASE_SIZE)*FLASH_ERASE_SIZE
+
+  return prepare_one_record_compressed(saddr,eaddr-saddr,get_image(srecord,saddr,eaddr),0xFF,
+                                       get_image(base,saddr,eaddr))
+end
+
+function download_application_delta()
+  return download_prepared_record(prepared(l_app_p,"delta"))
+end
+
+-- the records in the order they are downloaded, then the CRCs in the order they are checked
+local function prepare_images()
+  local srecord = l_flsdrv_s
+  if nil ~= srecord then
+    -- flash driver mapped to address 0
+    for i=1,rawlen(srecord),1 do
+      local ss = srecord[i]
+      l_flsdrv_p[i] = prepare_one_record(ss["addr"]-srecord[1]["addr"],ss["size"],ss["data"],0xFD)
+    end
+    for i=1,rawlen(srecord),1 do
+      l_flsdrv_crc[i] = crc32(srecord[i]["data"],srecord[i]["size"])
+    end
+  end
+
+  srecord = l_app_s
+  if nil ~= srecord then
+    if "delta" == l_compression then
+      l_app_p["delta"] = prepare_application_delta()
+    end
+    for i=1,rawlen(srecord),1 do
+      local ss = srecord[i]
+      local addr = ss["addr"]
+      local p = {zero=is_all_zero(ss["data"],ss["size"])}
+      if (false == p.zero) and ("delta" ~= l_compression) then
+        if ("lzss" == l_compression) and (0 == (addr%FLASH_WRITE_SIZE)) then
+          local sz = math.floor((ss["size"]+FLASH_WRITE_SIZE-1)/FLASH_WRITE_SIZE)*FLASH_WRITE_SIZE
+          p.record = prepare_one_record_compressed(addr,sz,get_image(srecord,addr,addr+sz),0xFF)
+        else
+          p.record = prepare_one_record(addr,ss["size"],ss["data"],0xFF)
+        end
+      end
+      l_app_p[i] = p
+    end
+    for i=1,rawlen(srecord),1 do
+      local ss = srecord[i]
+      if false == l_app_p[i].zero then
+        l_app_crc[i] = crc32(ss["data"],ss["size"])
+      else
+        l_app_crc[i] = 0
+      end
+    end
+  end
+end
+
+-- one step of the preparation, false if all is done
+local function prepare_step()
+  if (nil == l_prepare) or ("dead" == coroutine.status(l_prepare)) then
+    return false
+  end
+  local pre = as.time()
+  local ok,err = coroutine.resume(l_prepare)
+  l_prepare_cost = l_prepare_cost + as.time() - pre
+  if false == ok then
+    print(string.format("  >> prepare the images failed: %s",err))
+    return false
+  end
+
+  return "dead" ~= coroutine.status(l_prepare)
+end
+
+local function prepare_idle()
+  local pre = as.time()
+  local busy = prepare_step()
+  l_prepare_idle = l_prepare_idle + as.time() - pre
+  return busy
+end
+
+-- the prepared item, run the preparation until it is there
+function prepared(items,key)
+  while (nil == items[key]) and prepare_step() do
+  end
+  return items[key]
+end
+
 function download_application()
 
   srecord = l_app_s
@@ -437,12 +700,18 @@ function download_application()
     return false
   end
   
-  secnbr = rawlen(srecord)
+  if "delta" == l_compression then
+    ercd = download_application_delta()
+    secnbr = 0
+  else
+    secnbr = rawlen(srecord)
+  end
   for i=1,secnbr,1 do
     ss = srecord[i]
     addr =  ss["addr"]
-    if false == is_all_zero(ss["data"],ss["size"]) then
-    ercd =  download_one_record(addr,ss["size"],ss["data"],0xFF)
+    p = prepared(l_app_p,i) or {zero=false}
+    if false == p.zero then
+    ercd =  download_prepared_record(p.record)
     if (false == ercd) then
       break
     end
@@ -460,6 +729,38 @@ end
 
 function check_application()
   srecord = l_app_s
+
+  if( nil == srecord ) then
+    print("  >> invalid application srecord file!")
+    return false
+  end
+
+  -- an image of only all zero records has nothing to check
+  local ercd = true
+  secnbr = rawlen(srecord)
+  for i=1,secnbr,1 do
+    ss = srecord[i]
+    if false == prepared(l_app_p,i).zero then
+      ercd =  check_one_record(ss["addr"],ss["size"],prepared(l_app_crc,i),0xFF)
+      if (false == ercd) then
+        break
+      end
+    end
+  end
+
+  if (false == ercd) then
+    print("  >> check application failed!")
+    ercd = check_application_readback()
+  else
+    print("  >> check application ok!")
+  end
+
+  return ercd
+end
+
+-- read back the whole image, slow but dump what is on the target for the diagnosis
+function check_application_readback()
+  srecord = l_app_s
   
   if( nil == srecord ) then
     print("  >> invalid application srecord file!")
@@ -507,17 +808,33 @@ function routine_test_jump_to_application()
   
 end
 
-operation_list = {enter_extend_session, security_extds_access,
-                  enter_program_session,security_prgs_access,
-                  download_flash_driver, -- check_flash_driver,
-                  routine_erase_flash, download_application, -- check_application,
-				          routine_test_jump_to_application
+operation_list = {{enter_extend_session,"session"}, {security_extds_access,"session"},
+                  {enter_program_session,"session"},{security_prgs_access,"session"},
+                  {download_flash_driver,"transfer"}, {check_flash_driver,"verify"},
+                  {routine_erase_flash,"erase"}, {download_application,"transfer"},
+                  {check_application,"verify"},
+                  {routine_test_jump_to_application,"jump"}
 }
 
+local function show_phases()
+  for i=1,rawlen(l_phases),1 do
+    phase = l_phases[i]
+    cost = l_phase_cost[phase] or 0
+    if ("transfer" == phase) and (cost > 0) then
+      print(string.format("  >> phase %-8s %.2fs, %d bytes, %.1f KB/s",phase,cost,
+                          l_transfer_size,l_transfer_size/cost/1024))
+    else
+      print(string.format("  >> phase %-8s %.2fs",phase,cost))
+    end
+  end
+  print(string.format("  >> prepare the images %.2fs, %.2fs of it while waiting for the ECU",
+                      l_prepare_cost,l_prepare_idle))
+end
+
 function main(argc,argv)
   data = {}
   if argc == 0 then
-  	 print("Usage: flashloader.lua flsdrv app device port baudrate")
+  	 print("Usage: flashloader.lua flsdrv app device port baudrate [none|lzss|delta] [base] [erase_size] [window_bits]")
 	 return
   else
     l_flsdrv = argv[1]
@@ -525,6 +842,16 @@ function main(argc,argv)
 	device = argv[3] -- serial socket peak vxl tcp	
 	port = argv[4]
 	baudrate = argv[5]
+	if argc >= 6 then
+	  l_compression = argv[6]
+	  l_base = argv[7]
+	end
+	if argc >= 8 then
+	  FLASH_ERASE_SIZE = math.tointeger(tonumber(argv[8]))
+	end
+	if argc >= 9 then
+	  LZSS_WINDOW_BITS = math.tointeger(tonumber(argv[9]))
+	end
 	if device == "socket" then
       if os.name() == "posix" then
         os.execute("sudo modprobe vcan")
@@ -547,13 +874,28 @@ function main(argc,argv)
   
   l_flsdrv_s = s19.open(l_flsdrv)
   l_app_s = s19.open(l_app)
+  l_prepare = coroutine.create(prepare_images)
+  dcm.set_idle(prepare_idle)
 
+  pre = as.time()
   for i=1,rawlen(operation_list),1 do
-    ercd = operation_list[i]()
+    spre = as.time()
+    ercd = operation_list[i][1]()
+    cost = as.time()-spre
+    phase = operation_list[i][2]
+    l_phase_cost[phase] = (l_phase_cost[phase] or 0) + cost
+    print(string.format("  >> cost %.2fs",cost))
     if false == ercd then
       break
     end
   end
+  dcm.set_idle(nil)
+  print(string.format("  >> flashing cost %.2fs",as.time()-pre))
+  show_phases()
+  if l_zip_size > 0 then
+    print(string.format("  >> compressed %d bytes to %d bytes, ratio %.1f%%",
+                        l_raw_size,l_zip_size,l_zip_size*100/l_raw_size))
+  end
   as.can_log() -- no paramter close the file
   os.execute("pgrep .exe|xargs -i kill -9 {}")
   os.execute("cat laslog/flash-loader.asc")
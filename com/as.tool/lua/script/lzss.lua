@@ -0,0 +1,187 @@
+-- /**
+-- * AS - the open source Automotive Software on https://github.com/parai
+-- *
+-- * Copyright (C) 2018  AS <parai@foxmail.com>
+-- *
+-- * This source code is free software; you can redistribute it and/or modify it
+-- * under the terms of the GNU General Public License version 2 as published by the
+-- * Free Software Foundation; See <http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt>.
+-- *
+-- * This program is distributed in the hope that it will be useful, but
+-- * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+-- * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+-- * for more details.
+-- */
+
+-- LZSS encoder for the bootloader RequestDownload compressionMethod 1(lzss) and 2(delta),
+-- the stream format is described in com/as.infrastructure/boot/common/bl_lzss.c
+-- ===================== [ INCLUDE  ] ================================
+require("math")
+-- ===================== [ MACRO    ] ================================
+local MIN_MATCH = 3
+local MAX_MATCH = 18
+local MAX_CHAIN = 16
+local MIN_DELTA = 8 -- a delta copy costs 7 bytes
+local MAX_DELTA = 65536
+-- ===================== [ LOCAL    ] ================================
+local M = {}
+-- ===================== [ DATA     ] ================================
+lzss = M
+-- ===================== [ FUNCTION ] ================================
+-- positions are 0 based, the data tables are 1 based as the s19 records
+local function key(data,i)
+  return (data[i+1]<<16) + (data[i+2]<<8) + data[i+3]
+end
+
+local function common(a,ai,b,bi,limit)
+  local l = 0
+  while (l < limit) and (a[ai+l+1] == b[bi+l+1]) do
+    l = l + 1
+  end
+  return l
+end
+
+local function add_hash(head,data,i)
+  local k = key(data,i)
+  local chain = head[k]
+  if nil == chain then
+    chain = {}
+    head[k] = chain
+  end
+  chain[rawlen(chain)+1] = i
+end
+
+local function match(data,size,i,head,max_distance)
+  local best_len,best_dist = 0,0
+  if i+MIN_MATCH > size then
+    return best_len,best_dist
+  end
+  local chain = head[key(data,i)]
+  if nil == chain then
+    return best_len,best_dist
+  end
+  local limit = math.min(MAX_MATCH,size-i)
+  local n = rawlen(chain)
+  for j=n,math.max(1,n-MAX_CHAIN+1),-1 do
+    local dist = i - chain[j]
+    if dist > max_distance then
+      break
+    end
+    local l = common(data,i,data,chain[j],limit)
+    if l > best_len then
+      best_len,best_dist = l,dist
+      if l == limit then
+        break
+      end
+    end
+  end
+  return best_len,best_dist
+end
+
+local function delta_limit(i,disp,size,erase_size)
+  -- the old image is available from the start of the sector being written
+  local src = i + disp
+  local offset = i % erase_size
+  if (src < i-offset) or (src >= size) then
+    return 0
+  end
+  local limit = math.min(size-i,size-src,MAX_DELTA)
+  if disp < 0 then
+    -- the next sector is erased before it's written, the copy shall not cross it
+    limit = math.min(limit,erase_size-offset)
+  end
+  return limit
+end
+
+local function delta(data,size,i,base,bhead,last_disp,erase_size)
+  local best_len,best_disp = 0,0
+  local cands = {0,last_disp}
+  if i+MIN_MATCH <= size then
+    local poss = bhead[key(data,i)]
+    if nil ~= poss then
+      -- the old positions nearby, poss is sorted
+      local lo,hi = 1,rawlen(poss)+1
+      while lo < hi do
+        local mid = (lo+hi)//2
+        if poss[mid] < i then lo = mid+1 else hi = mid end
+      end
+      for j=math.max(1,lo-2),math.min(rawlen(poss),lo+1),1 do
+        cands[rawlen(cands)+1] = poss[j]-i
+      end
+    end
+  end
+  for _,disp in ipairs(cands) do
+    local limit = delta_limit(i,disp,size,erase_size)
+    if limit > best_len then
+      local l = common(data,i,base,i+disp,limit)
+      if l > best_len then
+        best_len,best_disp = l,disp
+      end
+    end
+  end
+  return best_len,best_disp
+end
+
+-- compress size bytes of data, if base(the installed image of the same region, with the
+-- same size) is given, the result is a delta stream for compressionMethod 2, it yields about
+-- every 4KB if run in a coroutine
+function M.compress(data,size,base,window_bits,erase_size)
+  window_bits = window_bits or 10
+  erase_size = erase_size or 512
+  local max_distance = (1<<window_bits) - 1
+  local out = {window_bits}
+  local head = {}
+  local bhead = {}
+  if nil ~= base then
+    for p=0,size-MIN_MATCH,1 do
+      add_hash(bhead,base,p)
+    end
+  end
+  local last_disp = 0
+  local flagpos,flagbit = 0,8
+  local i = 0
+  local next_yield = 4096
+  while i < size do
+    if (i >= next_yield) and coroutine.isyieldable() then
+      next_yield = i + 4096
+      coroutine.yield()
+    end
+    if flagbit == 8 then
+      flagpos = rawlen(out)+1
+      out[flagpos] = 0
+      flagbit = 0
+    end
+    local mlen,mdist = match(data,size,i,head,max_distance)
+    local dlen,ddisp = 0,0
+    if nil ~= base then
+      dlen,ddisp = delta(data,size,i,base,bhead,last_disp,erase_size)
+    end
+    local n = rawlen(out)
+    local step
+    if (dlen >= MIN_DELTA) and (dlen > mlen) then
+      local d = ddisp & 0xFFFFFF
+      local c = dlen - 1
+      out[n+1],out[n+2] = 0,0
+      out[n+3],out[n+4],out[n+5] = (d>>16)&0xFF,(d>>8)&0xFF,d&0xFF
+      out[n+6],out[n+7] = (c>>8)&0xFF,c&0xFF
+      last_disp = ddisp
+      step = dlen
+    elseif mlen >= MIN_MATCH then
+      out[n+1] = (mdist>>4)&0xFF
+      out[n+2] = ((mdist&0x0F)<<4) + (mlen-MIN_MATCH)
+      step = mlen
+    else
+      out[flagpos] = out[flagpos] | (1<<flagbit)
+      out[n+1] = data[i+1]
+      step = 1
+    end
+    flagbit = flagbit + 1
+    for p=i,math.min(i+step,size-MIN_MATCH+1)-1,1 do
+      add_hash(head,data,p)
+    end
+    i = i + step
+  end
+  return out
+end
+
+return lzss
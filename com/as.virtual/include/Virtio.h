@@ -37,7 +37,8 @@
 #define RPROC_RPMSG_CFG_SIZE  16
 #define RPROC_NUM_OF_VRINGS 2
 
-#define RPROC_RPMSG_FEATURES (1 << 0)
+/* VIRTIO_RPMSG_F_NS and VIRTIO_RING_F_EVENT_IDX */
+#define RPROC_RPMSG_FEATURES ((1 << 0) | (1 << VIRTIO_RING_F_EVENT_IDX))
 
 /* This marks a buffer as continuing via the next field. */
 #define VRING_DESC_F_NEXT	1
@@ -74,6 +75,14 @@
 #define RPMSG_NAME_SIZE			32
 #define RPMSG_DATA_SIZE         512
 
+/* the ECU runs in another thread, the ring entries must be visible before the
+ * index which publishes them, and the other way round. */
+#if defined(__GNUC__)
+#define vring_mb() __sync_synchronize()
+#else
+#define vring_mb()
+#endif
+
 extern unsigned long Ipc_BaseAddress;
 #define IPC_MAP_PA_TO_VA(addr) ((void*)(unsigned long)(Ipc_BaseAddress+addr))
 /* ============================ [ TYPES     ] ====================================================== */
@@ -217,10 +226,15 @@ private:
     quint32 free_head;
     /* Number we've added since last sync. */
     quint32 num_added;
+    /* VIRTIO_RING_F_EVENT_IDX negotiated */
+    bool event_idx;
+    /* avail index when the ECU was kicked the last time */
+    quint16 last_kick_idx;
     quint32 heap[1024*1024/4];
 public:
-    explicit Vring ( Rproc_ReseouceVdevVringType* ring ) : ring(ring)
+    explicit Vring ( Rproc_ReseouceVdevVringType* ring, quint32 features ) : ring(ring)
     {
+        event_idx = (0 != (features & (1 << VIRTIO_RING_F_EVENT_IDX)));
         init();
     }
     quint32 ring_num(void){ return vr.num; }
@@ -233,14 +247,27 @@ public:
         void* buf;
         Vring_UsedElemType* used;
         /* There's nothing available? */
-        if (last_used_idx == vr.used->idx) {
+        if ((quint16)last_used_idx == vr.used->idx) {
             /* We need to know about added buffers */
-            vr.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+            if(event_idx)
+            {   /* used_event: kick me when the next one is used */
+                vr.avail->ring[vr.num] = (quint16)last_used_idx;
+            }
+            else
+            {
+                vr.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+            }
+            /* the ECU may have used one before it saw the request */
+            vring_mb();
+        }
 
+        if ((quint16)last_used_idx == vr.used->idx) {
             buf = NULL;
         }
         else
         {
+            /* read the ring entry after the index which published it */
+            vring_mb();
             /*
              * Grab the next descriptor number they're advertising, and increment
              * the index we've seen.
@@ -263,7 +290,10 @@ public:
        }
        else
        {
-           vr.avail->ring[vr.avail->idx++ % vr.num] = idx;
+           vr.avail->ring[vr.avail->idx % vr.num] = idx;
+           /* the entry must be visible before the index */
+           vring_mb();
+           vr.avail->idx++;
            num_added ++;
        }
     }
@@ -280,6 +310,7 @@ public:
             vr.desc[free_head].len  = len;
             vr.desc[free_head].flags = VRING_DESC_F_NEXT;
             free_head = vr.desc[free_head].next;
+            vring_mb();
             vr.avail->idx ++;
             vr.avail->ring[free_head] = free_head;
             num_added ++;
@@ -292,6 +323,29 @@ public:
         }
         return added;
     }
+    /* whether the ECU shall be kicked about the buffers added since the last kick,
+     * with EVENT_IDX only if it has consumed all it was kicked for before */
+    bool need_kick(void)
+    {
+        bool needed;
+        quint16 new_idx;
+        quint16 old_idx;
+        /* the avail index must be visible before the event index is read */
+        vring_mb();
+        new_idx = vr.avail->idx;
+        old_idx = last_kick_idx;
+        last_kick_idx = new_idx;
+        if(event_idx)
+        {   /* avail_event is after the used ring */
+            quint16 event = *(volatile quint16*)&vr.used->ring[vr.num];
+            needed = ((quint16)(new_idx - event - 1) < (quint16)(new_idx - old_idx));
+        }
+        else
+        {
+            needed = (0 == (vr.used->flags & VRING_USED_F_NO_NOTIFY));
+        }
+        return needed;
+    }
 
 private:
     void init(void)
@@ -314,6 +368,7 @@ private:
 
         last_avail_idx = 0;
         last_used_idx  = 0;
+        last_kick_idx  = 0;
 
         if(8 == sizeof(void*))
         {
@@ -346,16 +401,20 @@ private:
 public:
     explicit Vdev ( Rproc_ResourceVdevType* vdev ): vdev(vdev)
     {
-        r_ring = new Vring(&vdev->vring[1]);
-        w_ring = new Vring(&vdev->vring[0]);
+        r_ring = new Vring(&vdev->vring[1],vdev->gfeatures);
+        w_ring = new Vring(&vdev->vring[0],vdev->gfeatures);
     }
     void start(void)
     {
-        kick_w();
+        (void)w_ring->need_kick();
+        emit kick(w_ring->get_notifyid());
     }
     void kick_w(void)
     {
-        emit kick(w_ring->get_notifyid());
+        if(w_ring->need_kick())
+        {
+            emit kick(w_ring->get_notifyid());
+        }
     }
 
     void kick_r(void)
@@ -423,13 +482,13 @@ public:
         quint32 len;
         void* buf;
         ASLOG(VDEV,"rx_notification(idx=%Xh)\n",r_ring->get_notifyid());
-        buf = r_ring->get_used_buf(&idx,&len);
-
-        assert(buf);
-        ASLOG(VDEV,"Message(idx=%d,len=%d)\n",idx,len);
-        asmem(buf,len);
+        while(NULL != (buf = r_ring->get_used_buf(&idx,&len)))
+        {
+            ASLOG(VDEV,"Message(idx=%d,len=%d)\n",idx,len);
+            asmem(buf,len);
 
-        r_ring->put_used_buf_back(idx);
+            r_ring->put_used_buf_back(idx);
+        }
 
     }
     virtual void tx_confirmation(void){
@@ -143,7 +143,12 @@ void Virtio::run ( void )
 #ifdef __WINDOWS__
         WaitForMultipleObjects( sizeof( pvObjectList ) / sizeof( HANDLE ), pvObjectList, TRUE, INFINITE );
 #else
-        (void)pthread_cond_wait ((pthread_cond_t *)r_event,(pthread_mutex_t *)r_lock);
+        /* check the fifo under the lock so a signal sent before this wait isn't lost */
+        (void)pthread_mutex_lock((pthread_mutex_t *)r_lock);
+        while(0 == r_fifo->count)
+        {
+            (void)pthread_cond_wait ((pthread_cond_t *)r_event,(pthread_mutex_t *)r_lock);
+        }
 #endif
         do {
             ercd = fifo_read(&idx);
@@ -313,53 +318,53 @@ void RPmsg::rx_noificaton(void){
     quint32 len;
     RPmsg_HandlerType* buf;
     ASLOG(OFF,"rx_notification(idx=%Xh)\n",get_r_notifyid());
-    buf = (RPmsg_HandlerType*)get_used_r_buf(&idx,&len);
-
-    assert(buf);
-    ASLOG(OFF,"Message(idx=%d,len=%d)\n",idx,len);
-    ASLOG(VIRTIO,"src=%Xh,dst=%Xh,flags=%Xh\n",buf->src,buf->dst,buf->flags);
-
-    if(online)
+    /* one kick may stand for several messages */
+    while(NULL != (buf = (RPmsg_HandlerType*)get_used_r_buf(&idx,&len)))
     {
-        if((buf->src == sample_src_ept) && (buf->dst == sample_can_ept))
-        {
-            Can_RPmsgPduType * msg = (Can_RPmsgPduType *)buf->data;
-            ASLOG(VIRTIO,"CAN ID=0x%08X LEN=%d DATA=[%02X %02X %02X %02X %02X %02X %02X %02X]\n",
-                  msg->id,msg->length,msg->sdu[0],msg->sdu[1],msg->sdu[2],msg->sdu[3],
-                    msg->sdu[4],msg->sdu[5],msg->sdu[6],msg->sdu[7]);
-            emit Can_RxIndication(msg->bus,msg->id,msg->length,msg->sdu);
-        }
-        else
+        ASLOG(OFF,"Message(idx=%d,len=%d)\n",idx,len);
+        ASLOG(VIRTIO,"src=%Xh,dst=%Xh,flags=%Xh\n",buf->src,buf->dst,buf->flags);
+
+        if(online)
         {
-            assert(0);
-        }
-    }
-    else
-    {
-       if(RPMSG_NAME_SERVICE_PORT == buf->dst)
-       { /*naming service*/
-            RPmsg_NamseServiceMessageType* nsMsg = (RPmsg_NamseServiceMessageType*)buf->data;
-            if(0==strcmp(nsMsg->name,"RPMSG-SAMPLE"))
+            if((buf->src == sample_src_ept) && (buf->dst == sample_can_ept))
             {
-                ASLOG(RPMSG,"RPMSG-SAMPLE on-line\n");
-                sample_src_ept = buf->src;
-                sample_can_ept = 0xCAB;
-                sample_shell_ept = 0xCAD;
-                online = true;
+                Can_RPmsgPduType * msg = (Can_RPmsgPduType *)buf->data;
+                ASLOG(VIRTIO,"CAN ID=0x%08X LEN=%d DATA=[%02X %02X %02X %02X %02X %02X %02X %02X]\n",
+                      msg->id,msg->length,msg->sdu[0],msg->sdu[1],msg->sdu[2],msg->sdu[3],
+                        msg->sdu[4],msg->sdu[5],msg->sdu[6],msg->sdu[7]);
+                emit Can_RxIndication(msg->bus,msg->id,msg->length,msg->sdu);
             }
             else
             {
                 assert(0);
             }
-       }
-       else
-       {
-           assert(0);
-       }
-    }
-
-    put_used_r_buf_back(idx);
+        }
+        else
+        {
+           if(RPMSG_NAME_SERVICE_PORT == buf->dst)
+           { /*naming service*/
+                RPmsg_NamseServiceMessageType* nsMsg = (RPmsg_NamseServiceMessageType*)buf->data;
+                if(0==strcmp(nsMsg->name,"RPMSG-SAMPLE"))
+                {
+                    ASLOG(RPMSG,"RPMSG-SAMPLE on-line\n");
+                    sample_src_ept = buf->src;
+                    sample_can_ept = 0xCAB;
+                    sample_shell_ept = 0xCAD;
+                    online = true;
+                }
+                else
+                {
+                    assert(0);
+                }
+           }
+           else
+           {
+               assert(0);
+           }
+        }
 
+        put_used_r_buf_back(idx);
+    }
 }
 
 void RPmsg::tx_confirmation(void){
@@ -367,7 +372,8 @@ void RPmsg::tx_confirmation(void){
     quint32 len;
     RPmsg_HandlerType* buf;
     ASLOG(OFF,"tx_confirmation(idx=%Xh)\n",get_w_notifyid());
-    buf = (RPmsg_HandlerType*)get_used_w_buf(&idx,&len);
-    assert(buf);
-    w_buffer.append((void*)buf);
+    while(NULL != (buf = (RPmsg_HandlerType*)get_used_w_buf(&idx,&len)))
+    {
+        w_buffer.append((void*)buf);
+    }
 }
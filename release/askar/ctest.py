@@ -143,16 +143,49 @@ def RunCommand(cmd):
         return -1
     return 0
 
-def check(target,case):
+def run(exe):
+    import subprocess,time
+    if(not os.path.exists(exe)):
+        return 'FAIL: %s is not built'%(exe)
+    p = subprocess.Popen(exe, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    os.set_blocking(p.stdout.fileno(), False)
+    timeLeft = 100 # *100ms
+    string = ''
+    while(timeLeft>0):
+        time.sleep(0.1)
+        timeLeft -= 1
+        data = p.stdout.read()
+        if(data):
+            string += data.decode('utf-8')
+        if((string.find('FAIL')!=-1) or (string.find('>> END <<')!=-1) or (p.poll() is not None)):
+            break
+    p.kill()
+    p.wait()
+    return string
+
+def check(target,case,smp=1):
     schedfifo = os.getenv('schedfifo')
-    print('>> Starting test for %s %s schedfifo="%s" ...'%(target,case,schedfifo))
-    if(0==RunCommand('qemu-system-arm -machine help')):
+    schedtable = os.getenv('schedtable')
+    print('>> Starting test for %s %s schedfifo="%s" schedtable="%s" ...'%(target,case,schedfifo,schedtable))
+    if(os.getenv('ARCH') == 'posix'):
+        result = run('out/%s/%s/%s'%(target,case,target))
+        if((result.find('FAIL')!=-1) or (result.find('>> END <<')==-1)):
+            print('>> Test for %s %s FAIL'%(target,case))
+            print(result)
+            exit(-1)
+        print('>> Test for %s %s PASS'%(target,case))
+        return
+    if(os.getenv('ARCH') == 'virt'):
+        qemu = 'qemu-system-aarch64'
+        cmd='%s -m 128 -M virt -cpu cortex-a57 -smp %s -nographic -kernel out/%s/%s/%s -serial tcp:127.0.0.1:1103,server'%(qemu,smp,target,case,target)
+    elif(0==RunCommand('qemu-system-arm -machine help')):
         qemu = 'qemu-system-arm'
     else:
         qemu = './qemu-system-arm'
         if(not os.path.exists(qemu)):
             RunCommand('wget https://github.com/idrawone/qemu-rpi/raw/master/tools/qemu-system-arm-rpi_UART1.tar.gz && tar xf qemu-system-arm-rpi_UART1.tar.gz')
-    cmd='%s -m 128 -M versatilepb -nographic -kernel out/%s/%s/%s -serial tcp:127.0.0.1:1103,server'%(qemu,target,case,target)
+    if(os.getenv('ARCH') != 'virt'):
+        cmd='%s -m 128 -M versatilepb -nographic -kernel out/%s/%s/%s -serial tcp:127.0.0.1:1103,server'%(qemu,target,case,target)
 
     if(os.name == 'nt'):
         cmd = 'start '+cmd
@@ -161,7 +194,7 @@ def check(target,case):
     else:
         pid = os.fork()
     if(pid == 0):
-        RunCommand('pgrep qemu-system-arm | xargs -i kill -9 {}')
+        RunCommand('pgrep %s | xargs -i kill -9 {}'%(qemu))
         RunCommand(cmd)
         exit(0)
     else:
@@ -170,7 +203,7 @@ def check(target,case):
             RunCommand('taskkill /IM qemu-system-arm.exe')
         else:
             os.kill(pid,9)
-            RunCommand('pgrep qemu-system-arm | xargs -i kill -9 {}')
+            RunCommand('pgrep %s | xargs -i kill -9 {}'%(qemu))
         if((result.find('FAIL')!=-1) or (result.find('>> END <<')==-1)):
             print('>> Test for %s %s FAIL'%(target,case))
             print(result)
@@ -191,10 +224,15 @@ def test(target,case,vv):
         xml = reoil.to_xml('%s/etc/%s.oil'%(CTEST,target))
         fixXml(xml,vv)
         genCTEST_CFGH(xml,'src/%s/%s'%(target, case))
+    # the multicore cases could only run on the arch virt
+    smp = int(xml.find('General').attrib.get('CPU_CORE_NUMBER', '1'))
+    if((smp > 1) and (os.getenv('ARCH') != 'virt')):
+        print('>> Test for %s %s SKIP as %s cores requires ARCH=virt'%(target,case,smp))
+        return
     saveXml(xml, 'src/%s/%s/test.xml'%(target, case))
-    RunCommand('make dep-os TARGET=%s CASE=%s'%(target, case))
-    RunCommand(cmd='make all TARGET=%s CASE=%s'%(target, case))
-    check(target,case)
+    RunCommand('make dep-os TARGET=%s CASE=%s SMP=%s'%(target, case, smp))
+    RunCommand(cmd='make all TARGET=%s CASE=%s SMP=%s'%(target, case, smp))
+    check(target,case,smp)
 
 if(__name__ == '__main__'):
     AppendPythonPath(['../../com/as.tool/config.infrastructure.system',
@@ -24,6 +24,17 @@ void timer_stop(void);
 void vic_setup(void);
 void irq_init(void);
 #endif
+#ifdef __arch_virt__
+extern void uart_putc(unsigned char byte);
+#endif
+#ifdef __arch_posix__
+#include <unistd.h>
+#define ISR2_IRQ    1
+#define ISR3_IRQ    2
+#define COUNTER_IRQ 3
+extern void Os_PortInstallIsr(int irq, void (*handler)(void));
+extern void Os_PortRaiseIsr(int irq);
+#endif
 extern ISR(ISR2);
 extern ISR(ISR3);
 /* ============================ [ DATAS     ] ====================================================== */
@@ -69,7 +80,24 @@ void __putchar(char ch)
 #ifdef __arch_versatilepb__
 	serial_send_char(ch);
 #endif
+#ifdef __arch_virt__
+	uart_putc((unsigned char)ch);
+#endif
+#ifdef __arch_posix__
+	(void)write(1, &ch, 1);
+#endif
+}
+
+#ifdef __arch_posix__
+/* the counters are only driven by IncrementCounter as on the versatilepb */
+void Os_PortTickCounter(void)
+{
+#ifdef MTEST
+	extern ISR(SystemTimer);
+	ISRMainSystemTimer();
+#endif
 }
+#endif
 
 void TriggerISR2(void)
 {
@@ -85,6 +113,12 @@ void TriggerISR2(void)
 	timer_init(isr2_handler);
 	while(isr2Flag == 0);
 #endif
+#ifdef __arch_posix__
+	isr2Flag = 0;
+	Os_PortInstallIsr(ISR2_IRQ, isr2_handler);
+	Os_PortRaiseIsr(ISR2_IRQ);
+	while(isr2Flag == 0);
+#endif
 }
 
 void TriggerISR3(void)
@@ -101,6 +135,12 @@ void TriggerISR3(void)
 	timer_init(isr3_handler);
 	while(isr3Flag == 0);
 #endif
+#ifdef __arch_posix__
+	isr3Flag = 0;
+	Os_PortInstallIsr(ISR3_IRQ, isr3_handler);
+	Os_PortRaiseIsr(ISR3_IRQ);
+	while(isr3Flag == 0);
+#endif
 }
 void counter_handler(void)
 {
@@ -112,6 +152,15 @@ void counter_handler(void)
 #endif
 }
 
+uint64 GetCycleCounter(void)
+{
+	uint64 cycles = 0;
+#if defined(__arch_posix__) && (defined(__x86_64__) || defined(__i386__))
+	cycles = __builtin_ia32_rdtsc();
+#endif
+	return cycles;
+}
+
 #ifdef __ASKAR_OS__
 uint32 IncrementCounter
 (
@@ -136,6 +185,16 @@ uint32 IncrementCounter
 		Increment --;
 	}
 #endif
+#ifdef __arch_posix__
+	Os_PortInstallIsr(COUNTER_IRQ, counter_handler);
+	while(Increment>0)
+	{
+		counterFlag = 0;
+		Os_PortRaiseIsr(COUNTER_IRQ);
+		while(counterFlag == 0);
+		Increment --;
+	}
+#endif
 }
 #endif
 